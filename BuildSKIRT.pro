@@ -5,7 +5,8 @@
 
 #---------------------------------------------------------------------
 # This "subdirs" project builds all library and application projects
-# needed for SKIRT, FitSKIRT and DoxStyle (documentation streamliner)
+# needed for SKIRT, FitSKIRT, DoxStyle (documentation streamliner)
+# and VoigtBench (micro-benchmark for the Voigt profile)
 #---------------------------------------------------------------------
 
 TEMPLATE = subdirs
@@ -22,6 +23,7 @@ SUBDIRS += \
     MPIsupport \
     SKIRTcore \
     SKIRTmain \
+    VoigtBench \
     Voro
 
 # conditionally add GUI subproject subdirectories
@@ -32,6 +34,7 @@ BUILDING_GUI:SUBDIRS += SkirtMakeUp
 SKIRTcore.depends    = Cfitsio Voro Fundamentals MPIsupport
 Discover.depends     = Cfitsio Voro Fundamentals MPIsupport SKIRTcore
 SKIRTmain.depends    = Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover
+VoigtBench.depends   = Cfitsio Voro Fundamentals MPIsupport SKIRTcore
 FitSKIRTcore.depends = GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover
 FitSKIRTmain.depends = GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover FitSKIRTcore
 BUILDING_GUI:SkirtMakeUp.depends = GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover FitSKIRTcore
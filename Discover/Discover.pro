@@ -34,6 +34,7 @@ HEADERS += \
     DoubleListPropertyHandler.hpp \
     DoublePropertyHandler.hpp \
     EnumPropertyHandler.hpp \
+    HierarchyCopier.hpp \
     IntPropertyHandler.hpp \
     ItemListPropertyHandler.hpp \
     ItemPropertyHandler.hpp \
@@ -53,6 +54,7 @@ SOURCES += \
     DoubleListPropertyHandler.cpp \
     DoublePropertyHandler.cpp \
     EnumPropertyHandler.cpp \
+    HierarchyCopier.cpp \
     IntPropertyHandler.cpp \
     ItemListPropertyHandler.cpp \
     ItemPropertyHandler.cpp \
@@ -0,0 +1,123 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "BoolPropertyHandler.hpp"
+#include "DoublePropertyHandler.hpp"
+#include "DoubleListPropertyHandler.hpp"
+#include "EnumPropertyHandler.hpp"
+#include "FatalError.hpp"
+#include "HierarchyCopier.hpp"
+#include "IntPropertyHandler.hpp"
+#include "ItemListPropertyHandler.hpp"
+#include "ItemPropertyHandler.hpp"
+#include "SimulationItem.hpp"
+#include "SimulationItemDiscovery.hpp"
+#include "StringPropertyHandler.hpp"
+
+using namespace SimulationItemDiscovery;
+
+////////////////////////////////////////////////////////////////////
+
+HierarchyCopier::HierarchyCopier()
+    : _copies(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+
+SimulationItem* HierarchyCopier::copyHierarchy(SimulationItem* item, QHash<SimulationItem*,SimulationItem*>& copies)
+{
+    _copies = &copies;
+    return copyItem(item);
+}
+
+////////////////////////////////////////////////////////////////////
+
+SimulationItem* HierarchyCopier::copyItem(SimulationItem* item)
+{
+    // reuse the item provided by the caller, if any
+    if (_copies->contains(item)) return _copies->value(item);
+
+    // create a fresh item of the same type
+    SimulationItem* copy = createSimulationItem(itemType(item));
+    if (!copy) throw FATALERROR("Simulation item of type '" + QString(itemType(item)) + "' couldn't be created");
+    _copies->insert(item, copy);
+
+    // copy all properties of the item; the visitor recursively copies the children, which
+    // replaces the target handlers, so remember those of this item
+    QHash<QByteArray,PropertyHandlerPtr> targets = createPropertyHandlersDict(copy);
+    foreach (PropertyHandlerPtr handler, createSortedPropertyHandlersList(item))
+    {
+        _targets = targets;
+        handler->acceptVisitor(this);
+    }
+    return copy;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(BoolPropertyHandler* handler)
+{
+    static_cast<BoolPropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(IntPropertyHandler* handler)
+{
+    static_cast<IntPropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(DoublePropertyHandler* handler)
+{
+    static_cast<DoublePropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(DoubleListPropertyHandler* handler)
+{
+    static_cast<DoubleListPropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(StringPropertyHandler* handler)
+{
+    static_cast<StringPropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(EnumPropertyHandler* handler)
+{
+    static_cast<EnumPropertyHandler*>(_targets.value(handler->name()).data())->setValue(handler->value());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(ItemPropertyHandler* handler)
+{
+    if (handler->value())
+    {
+        ItemPropertyHandler* target = static_cast<ItemPropertyHandler*>(_targets.value(handler->name()).data());
+        target->setValue(copyItem(handler->value()));
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void HierarchyCopier::visitPropertyHandler(ItemListPropertyHandler* handler)
+{
+    ItemListPropertyHandler* target = static_cast<ItemListPropertyHandler*>(_targets.value(handler->name()).data());
+    foreach (SimulationItem* item, handler->value())
+    {
+        target->addValue(copyItem(item));
+    }
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,89 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef HIERARCHYCOPIER_HPP
+#define HIERARCHYCOPIER_HPP
+
+#include <QHash>
+#include "PropertyHandler.hpp"
+#include "PropertyHandlerVisitor.hpp"
+class SimulationItem;
+
+////////////////////////////////////////////////////////////////////
+
+/** This class creates a fresh copy of a simulation hierarchy (or part of it), i.e. a hierarchy
+    with the same structure and property values that has not yet been setup. The result is the
+    same as writing the original hierarchy to XML with the XmlHierarchyWriter class and reading it
+    back in with the XmlHierarchyCreator class, without the overhead of converting the property
+    values to and from text. The class inherits from PropertyHandlerVisitor to facilitate
+    handling of the various types of properties. */
+class HierarchyCopier : public PropertyHandlerVisitor
+{
+public:
+    /** Constructs a HierarchyCopier instance without doing anything; call the copyHierarchy()
+        function to actually copy a simulation hierarchy. */
+    HierarchyCopier();
+
+    /** Creates a copy of the specified simulation item and its children, and returns a pointer to
+        the top-most simulation item in the copy (handing over ownership to the caller). The
+        dictionary \em copies maps items in the original hierarchy to the corresponding items in
+        the copy. If the dictionary already contains an entry for an original item when it is
+        encountered, the item listed in the dictionary is moved into the copy instead of creating a
+        new one, so that the caller can reuse existing items (including their children). On return,
+        the dictionary contains an entry for each item that has been copied or reused. If an item
+        can't be created, the function throws a fatal error. */
+    SimulationItem* copyHierarchy(SimulationItem* item, QHash<SimulationItem*,SimulationItem*>& copies);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(BoolPropertyHandler* handler);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(IntPropertyHandler* handler);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(DoublePropertyHandler* handler);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(DoubleListPropertyHandler* handler);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(StringPropertyHandler* handler);
+
+    /** Copies the value of the specified property to the corresponding property of the copy, as
+        part of the visitor pattern initiated by the copyItem() function. */
+    void visitPropertyHandler(EnumPropertyHandler* handler);
+
+    /** Copies the item held by the specified property, recursively, and hands it to the
+        corresponding property of the copy, as part of the visitor pattern initiated by the
+        copyItem() function. */
+    void visitPropertyHandler(ItemPropertyHandler* handler);
+
+    /** Copies the items held by the specified property, recursively, and hands them to the
+        corresponding property of the copy, as part of the visitor pattern initiated by the
+        copyItem() function. */
+    void visitPropertyHandler(ItemListPropertyHandler* handler);
+
+private:
+    /** Recursively copies the specified item and its children, or returns the item listed for it
+        in the copies dictionary. The properties are copied by asking each of them to accept "this"
+        PropertyHandlerVisitor instance as a visitor, which causes a call-back to the
+        visitPropertyHandler() function with the appropriate PropertyHandler subtype. */
+    SimulationItem* copyItem(SimulationItem* item);
+
+    // the dictionary of copied items, provided by the caller
+    QHash<SimulationItem*,SimulationItem*>* _copies;
+
+    // handlers for the properties of the item being copied into, indexed on property name
+    QHash<QByteArray,PropertyHandlerPtr> _targets;
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // HIERARCHYCOPIER_HPP
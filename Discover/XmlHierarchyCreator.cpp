@@ -71,6 +71,7 @@ SimulationItem* XmlHierarchyCreator::createHierarchyFromReader(QByteArray topIte
 {
     // the hierarchy to be created
     SimulationItem* result = 0;
+    _labeled.clear();
 
     // read the root element and verify the top item type
     if (!_reader.atEnd() && _reader.readNextStartElement())
@@ -100,11 +101,19 @@ SimulationItem* XmlHierarchyCreator::createHierarchyFromReader(QByteArray topIte
     if (_reader.hasError())
     {
         delete result;
+        _labeled.clear();
         return 0;
     }
     else return result;
 }
 
+////////////////////////////////////////////////////////////////////
+
+QMultiHash<QString, PropertyHandlerPtr> XmlHierarchyCreator::labeledProperties() const
+{
+    return _labeled;
+}
+
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
@@ -184,6 +193,7 @@ void XmlHierarchyCreator::setScalarPropertyForAttribute(SimulationItem* item,
         // remove enclosing square brackets and corresponding label (used by FitSKIRT to tag attribute values)
         if (value.startsWith('[') && value.endsWith(']') && value.contains(':'))
         {
+            _labeled.insert(value.mid(1, value.indexOf(':')-1), handlers.value(name));
             value.chop(1);
             value = value.right(value.size()-value.indexOf(':')-1);
         }
@@ -42,6 +42,14 @@ public:
         some error condition, the function throws a fatal error. */
     template<class itemClass> itemClass* createHierarchy(QByteArray content);
 
+    /** Returns a dictionary with a handler for each property of which the attribute value in the
+        most recently processed XML data was tagged with a label, as used by FitSKIRT, i.e.
+        enclosed in square brackets and preceded by the label and a colon. The dictionary is keyed
+        on the label; since the same label can tag multiple attributes, there may be multiple
+        handlers for a label. The handlers refer to items in the hierarchy returned by the most
+        recent invocation of createHierarchy(). */
+    QMultiHash<QString, PropertyHandlerPtr> labeledProperties() const;
+
 private:
     /** This is the private version of the function to create a simulation hierarchy from a file; it is
         called from the public template function with the same name and first argument. */
@@ -170,6 +178,9 @@ private:
     // XML reader
     QFile _file;
     QXmlStreamReader _reader;
+
+    // handlers for the labeled properties, indexed on label
+    QMultiHash<QString, PropertyHandlerPtr> _labeled;
 };
 
 ////////////////////////////////////////////////////////////////////
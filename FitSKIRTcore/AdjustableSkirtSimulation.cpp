@@ -6,15 +6,21 @@
 #include "AdjustableSkirtSimulation.hpp"
 
 #include "DoublePropertyHandler.hpp"
+#include "DustGridStructure.hpp"
+#include "DustMix.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "FitScheme.hpp"
+#include "HierarchyCopier.hpp"
 #include "InstrumentFrame.hpp"
 #include "InstrumentSystem.hpp"
 #include "Log.hpp"
 #include "MultiFrameInstrument.hpp"
+#include "OligoDustSystem.hpp"
+#include "OligoMonteCarloSimulation.hpp"
 #include "ParallelFactory.hpp"
 #include "Simulation.hpp"
+#include "SimulationItemDiscovery.hpp"
 #include "StellarSystem.hpp"
 #include "Units.hpp"
 #include "WavelengthGrid.hpp"
@@ -23,11 +29,14 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QSharedPointer>
+#include <QThread>
+
+using namespace SimulationItemDiscovery;
 
 ////////////////////////////////////////////////////////////////////
 
 AdjustableSkirtSimulation::AdjustableSkirtSimulation()
-    :_units(0)
+    :_units(0), _template(0), _retainable(false)
 {
 }
 
@@ -36,6 +45,13 @@ AdjustableSkirtSimulation::AdjustableSkirtSimulation()
 AdjustableSkirtSimulation::~AdjustableSkirtSimulation()
 {
     delete  _units;
+    foreach (LiveSimulation* live, _live)
+    {
+        delete live->simulation;
+        delete live;
+    }
+    _labeled.clear();
+    delete _template;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -60,10 +76,30 @@ void AdjustableSkirtSimulation::setupSelfBefore()
     if (_skiContent.isEmpty())
         throw FATALERROR("Could not read the ski file " + filepath);
 
-    // construct the simulation from the default ski content; use shared pointer for automatic clean-up
+    // verify the syntax of the labeled attribute values
+    adjustedSkiContent();
+
+    // construct the template simulation from the ski content, which uses the default values for labeled
+    // attributes, and remember the labeled properties
     find<Log>()->info("Constructing simulation hierarchy from ski file " + filepath + "...");
     XmlHierarchyCreator creator;
-    QSharedPointer<Simulation> simulation( creator.createHierarchy<Simulation>(adjustedSkiContent()) );
+    _template = creator.createHierarchy<Simulation>(_skiContent);
+    _labeled = creator.labeledProperties();
+
+    // determine whether performInMemory() can set the labeled values directly in a retained simulation,
+    // and which template items are affected by the labeled values
+    _retainable = _template->inherits("OligoMonteCarloSimulation");
+    foreach (PropertyHandlerPtr handler, _labeled)
+    {
+        if (!dynamic_cast<DoublePropertyHandler*>(handler.data())) _retainable = false;
+        for (QObject* item = handler->target(); item; item = item->parent())
+            _tainted.insert(static_cast<SimulationItem*>(item));
+    }
+
+    // construct the default simulation as a copy of the template; use shared pointer for automatic clean-up
+    QHash<SimulationItem*,SimulationItem*> copies;
+    HierarchyCopier copier;
+    QSharedPointer<Simulation> simulation( static_cast<Simulation*>(copier.copyHierarchy(_template, copies)) );
 
     // setup any simulation attributes that are not loaded from the ski content
     // copy file paths
@@ -120,9 +156,204 @@ void AdjustableSkirtSimulation::performWith(AdjustableSkirtSimulation::Replaceme
                                             QString prefix)
 {
     // construct the simulation from the ski content; use shared pointer for automatic clean-up
+    QSharedPointer<Simulation> simulation( createSimulation(replacements, prefix) );
+
+    // run the simulation
+    simulation->setupAndRun();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void AdjustableSkirtSimulation::performInMemory(AdjustableSkirtSimulation::ReplacementDict replacements,
+                                                QString prefix, QList<QList<Array> >* frames)
+{
+    Simulation* simulation = 0;
+    QSharedPointer<Simulation> fresh;   // for automatic clean-up of a simulation that is not retained
+    bool rerun = false;                 // true if the simulation has been set up by a previous invocation
+
+    if (!_retainable)
+    {
+        // construct the simulation from the adjusted ski content
+        fresh = QSharedPointer<Simulation>( createSimulation(replacements, prefix) );
+        simulation = fresh.data();
+    }
+    else
+    {
+        // get the simulation retained by this thread, if any; the items in a simulation hierarchy must be
+        // created by the thread that owns the hierarchy, so each thread retains its own simulation
+        LiveSimulation* live = 0;
+        {
+            QMutexLocker lock(&_liveMutex);
+            live = _live.value(QThread::currentThread());
+            if (!live)
+            {
+                live = new LiveSimulation;
+                _live.insert(QThread::currentThread(), live);
+            }
+        }
+
+        // determine the labeled values and the top-level template items holding a changed value
+        QHash<PropertyHandler*,double> values = labeledValues(replacements);
+        QSet<SimulationItem*> changed;
+        if (live->simulation)
+        {
+            foreach (PropertyHandler* handler, values.keys())
+            {
+                if (live->values.value(handler) != values.value(handler))
+                    changed.insert(topLevelItem(handler->target()));
+            }
+        }
+
+        // the stellar, dust and instrument systems can be replaced in a set-up simulation; any other change
+        // requires copying and setting up the complete simulation
+        OligoMonteCarloSimulation* templ = static_cast<OligoMonteCarloSimulation*>(_template);
+        bool all = !live->simulation;
+        foreach (SimulationItem* item, changed)
+        {
+            if (item != templ->stellarSystem() && item != templ->dustSystem() && item != templ->instrumentSystem())
+                all = true;
+        }
+
+        // copy the items to be replaced from the template
+        QSet<SimulationItem*> replaced;
+        if (all)
+        {
+            delete live->simulation;
+            live->items.clear();
+            live->simulation = static_cast<Simulation*>(copyItem(live, _template));
+
+            // setup any simulation attributes that are not loaded from the ski content
+            int threads = find<FitScheme>()->parallelThreadCount();
+            if (threads > 0) live->simulation->parallelFactory()->setMaxThreadCount(threads);
+            live->simulation->log()->setLowestLevel(Log::Error);
+            FilePaths* myfilepaths = find<FilePaths>();
+            FilePaths* itsfilepaths = live->simulation->filePaths();
+            itsfilepaths->setInputPath(myfilepaths->inputPath());
+            itsfilepaths->setOutputPath(myfilepaths->outputPath());
+        }
+        else
+        {
+            OligoMonteCarloSimulation* oligo = static_cast<OligoMonteCarloSimulation*>(live->simulation);
+            if (changed.contains(templ->stellarSystem()))
+            {
+                oligo->setStellarSystem(static_cast<StellarSystem*>(copyItem(live, templ->stellarSystem())));
+                replaced.insert(templ->stellarSystem());
+            }
+            if (changed.contains(templ->dustSystem()))
+            {
+                oligo->setDustSystem(static_cast<OligoDustSystem*>(copyItem(live, templ->dustSystem(), true)));
+                replaced.insert(templ->dustSystem());
+            }
+            // the instruments accumulate the fluxes detected during a run, so they are always replaced
+            oligo->setInstrumentSystem(static_cast<InstrumentSystem*>(copyItem(live, templ->instrumentSystem())));
+            replaced.insert(templ->instrumentSystem());
+        }
+
+        // set the labeled values in the fresh items
+        foreach (PropertyHandler* handler, values.keys())
+        {
+            SimulationItem* target = handler->target();
+            if (all || replaced.contains(topLevelItem(target)))
+            {
+                PropertyHandlerPtr livehandler = createPropertyHandler(live->items.value(target), handler->name());
+                static_cast<DoublePropertyHandler*>(livehandler.data())->setValue(values.value(handler));
+            }
+        }
+        live->values = values;
+        rerun = !all;
+        live->simulation->filePaths()->setOutputPrefix(find<FilePaths>()->outputPrefix() + "_" + prefix);
+        simulation = live->simulation;
+    }
+
+    // keep the calibrated frames in memory rather than writing them to FITS files
+    InstrumentSystem* instrSys = simulation->find<InstrumentSystem>(false);
+    MultiFrameInstrument* multiframe = instrSys ? instrSys->find<MultiFrameInstrument>(false) : 0;
+    if (!multiframe) throw FATALERROR("The simulation must have a multi-frame instrument");
+    if (!multiframe->writeStellarComps())
+        throw FATALERROR("The multi-frame instrument must output the flux for each stellar component");
+    multiframe->setWriteFiles(false);
+
+    // run the simulation; a retained simulation only sets up the items that have been replaced
+    if (rerun) simulation->rerun();
+    else simulation->setupAndRun();
+
+    // copy the calibrated frames for each stellar component, rounded to single precision like the pixels
+    // in the FITS files written by performWith(), so that the fit does not depend on the evaluation path
+    frames->clear();
+    foreach (InstrumentFrame* insFrame, multiframe->frames())
+    {
+        QList<Array> components;
+        for (int k = 0; k < _ncomponents; k++)
+        {
+            Array flux = insFrame->stellarFlux(k);
+            for (size_t i = 0; i < flux.size(); i++) flux[i] = static_cast<float>(flux[i]);
+            components.append(flux);
+        }
+        frames->append(components);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+QHash<PropertyHandler*,double> AdjustableSkirtSimulation::labeledValues(ReplacementDict replacements)
+{
+    QHash<PropertyHandler*,double> values;
+    foreach (QString label, _labeled.uniqueKeys()) foreach (PropertyHandlerPtr labeled, _labeled.values(label))
+    {
+        DoublePropertyHandler* handler = static_cast<DoublePropertyHandler*>(labeled.data());
+        double value = handler->value();
+        if (replacements.contains(label))
+        {
+            // convert the replacement value exactly as it would be inserted in and read from the ski content
+            QString text = DoublePropertyHandler::convertDoubletoString(replacements[label].first,
+                                                                        replacements[label].second, _units);
+            if (!DoublePropertyHandler::isValidDoubleString(text, handler->quantity(), _units))
+                throw FATALERROR("Value '" + text + "' for label '" + label + "' can't be converted to double");
+            value = DoublePropertyHandler::convertStringtoDouble(text, handler->quantity(), _units);
+            // silently clip the value to the specified range
+            if (value < handler->minValue()) value = handler->minValue();
+            if (value > handler->maxValue()) value = handler->maxValue();
+        }
+        values.insert(handler, value);
+    }
+    return values;
+}
+
+////////////////////////////////////////////////////////////////////
+
+SimulationItem* AdjustableSkirtSimulation::topLevelItem(SimulationItem* item)
+{
+    while (item != _template && item->parent() != _template) item = static_cast<SimulationItem*>(item->parent());
+    return item;
+}
+
+////////////////////////////////////////////////////////////////////
+
+SimulationItem* AdjustableSkirtSimulation::copyItem(LiveSimulation* live, SimulationItem* item, bool reuse)
+{
+    // forget the retained counterparts of the template items to be copied, except for those that can be reused
+    foreach (SimulationItem* templ, live->items.keys())
+    {
+        bool inside = false;
+        for (QObject* ancestor = templ; ancestor && !inside; ancestor = ancestor->parent()) inside = ancestor == item;
+        DustGridStructure* grid = dynamic_cast<DustGridStructure*>(templ);
+        bool reusable = reuse && !_tainted.contains(templ) &&
+                        (dynamic_cast<DustMix*>(templ) || (grid && !grid->dependsOnDistribution()));
+        if (inside && !reusable) live->items.remove(templ);
+    }
+
+    // copy the template items, moving the reusable items into the copy
+    HierarchyCopier copier;
+    return copier.copyHierarchy(item, live->items);
+}
+////////////////////////////////////////////////////////////////////
+
+Simulation* AdjustableSkirtSimulation::createSimulation(AdjustableSkirtSimulation::ReplacementDict replacements,
+                                                        QString prefix)
+{
+    // construct the simulation from the ski content
     XmlHierarchyCreator creator;
-    QSharedPointer<Simulation> simulation( creator.createHierarchy<Simulation>(
-                                                adjustedSkiContent(replacements)) );
+    Simulation* simulation = creator.createHierarchy<Simulation>(adjustedSkiContent(replacements));
 
     // setup any simulation attributes that are not loaded from the ski content
     // copy file paths
@@ -136,8 +367,7 @@ void AdjustableSkirtSimulation::performWith(AdjustableSkirtSimulation::Replaceme
     if (threads > 0) simulation->parallelFactory()->setMaxThreadCount(threads);
     // suppress log messages
     simulation->log()->setLowestLevel(Log::Error);
-    // run the simulation
-    simulation->setupAndRun();
+    return simulation;
 }
 
 ////////////////////////////////////////////////////////////////////
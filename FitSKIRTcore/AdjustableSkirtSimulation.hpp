@@ -7,9 +7,15 @@
 #define ADJUSTABLESKIRTSIMULATION_HPP
 
 #include <QHash>
+#include <QMutex>
 #include <QPair>
+#include <QSet>
+#include "Array.hpp"
+#include "PropertyHandler.hpp"
 #include "SimulationItem.hpp"
 
+class QThread;
+class Simulation;
 class Units;
 
 ////////////////////////////////////////////////////////////////////
@@ -31,13 +37,17 @@ public:
     /** The default constructor. */
     Q_INVOKABLE AdjustableSkirtSimulation();
 
-    /** The destructor deletes the simulation items stolen from the default simulation. */
+    /** The destructor deletes the simulation items stolen from the default simulation, the
+        simulation hierarchy constructed from the ski file, and the simulations retained by
+        performInMemory(). */
     ~AdjustableSkirtSimulation();
 
 protected:
-    /** This function reads the specified ski file into memory, performs a single simulation
-        using the default values provided in the ski file, and outputs an xml and tex version
-        of this default ski file. */
+    /** This function reads the specified ski file into memory, constructs a simulation hierarchy
+        from it using the default values provided in the ski file, and sets up a copy of this
+        default simulation to obtain information on the instrument frames and stellar components.
+        The simulation hierarchy constructed from the ski file is kept (without setting it up) as a
+        template for the simulations performed by performInMemory(). */
     void setupSelfBefore();
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -135,7 +145,66 @@ is no match, the value provided in the ski file (after the colon) serves as a de
 */
     void performWith(ReplacementDict replacements, QString prefix=QString());
 
+    /** This function runs the SKIRT simulation with the labeled attribute values replaced as
+        described for the performWith() function, except that the calibrated instrument frames are
+        not written to FITS files. Instead, they are copied into the list \em frames, which is
+        indexed on frame (i.e. wavelength) index and then on stellar component index. This avoids
+        writing the frames to disk only to read them back in. The pixel values are rounded to
+        single precision, as they would be in the FITS files. The instrument in the simulation must
+        have the writeStellarComps flag turned on. Since the frames are calibrated on the root
+        process only, this function should not be used when the simulation itself is parallelized
+        over multiple processes.
+
+        Rather than generating and parsing adjusted ski content, this function sets the replacement
+        values directly in a simulation hierarchy retained from the previous invocation in the same
+        thread. Only the stellar system and the dust system that hold a changed value are replaced
+        by a fresh copy of the corresponding part of the template hierarchy constructed from the
+        ski file; the instrument system, which accumulates the fluxes, is replaced for each
+        invocation. The other items keep their setup, including the wavelength grid and, when the
+        dust system is replaced, the dust mixes and any dust grid that does not depend on the dust
+        distribution, unless they hold a labeled value themselves. The complete simulation is
+        copied from the template and set up anew for the first invocation in a thread, and when a
+        changed value is held by any other item. If a label tags a property that is not a floating
+        point number, or the simulation is not an OligoMonteCarloSimulation, each invocation
+        instead constructs a fresh simulation hierarchy from the adjusted ski content, as
+        performWith() does. */
+    void performInMemory(ReplacementDict replacements, QString prefix, QList<QList<Array> >* frames);
+
 private:
+    /** A simulation hierarchy retained by performInMemory() between invocations in the same
+        thread, with the information needed to determine which of its items must be replaced. */
+    struct LiveSimulation
+    {
+        Simulation* simulation;                             // the retained simulation, or null
+        QHash<SimulationItem*,SimulationItem*> items;       // the retained item for each template item
+        QHash<PropertyHandler*,double> values;              // the value for each labeled template property
+        LiveSimulation() : simulation(0) { }
+    };
+
+    /** This private function returns the value for each labeled property in the template
+        hierarchy, after the replacements specified by \em replacements. The replacement values are
+        converted to and from their textual representation in the ski file, and clipped to the
+        range of the property, so that the values are identical to those in a simulation
+        constructed by performWith(). */
+    QHash<PropertyHandler*,double> labeledValues(ReplacementDict replacements);
+
+    /** This private function returns the top-level item in the template hierarchy (i.e. the child
+        of the top-most simulation item) that contains the specified template item, or the
+        top-most simulation item itself if that is the specified item. */
+    SimulationItem* topLevelItem(SimulationItem* item);
+
+    /** This private function creates a fresh copy of the specified item in the template hierarchy
+        for the retained simulation \em live, and updates the item dictionary of the retained
+        simulation accordingly. If \em reuse is true, the dust mixes and dust grids that do not
+        depend on the labeled values are moved into the copy rather than copied. */
+    SimulationItem* copyItem(LiveSimulation* live, SimulationItem* item, bool reuse=false);
+
+    /** This private function constructs the SKIRT simulation hierarchy from the ski file contents
+        after the adjustments specified by \em replacements, and configures the attributes that
+        are not loaded from the ski file as described for the performWith() function. The caller
+        receives ownership of the returned simulation. */
+    Simulation* createSimulation(ReplacementDict replacements, QString prefix);
+
     /** This private function performs the specified adjustments on the previously loaded ski content
         as described for the performWith() function, and returns the result. If the arguments are missing,
         all conditions are considered to be "true" (i.e. all conditional content is included) and all
@@ -157,6 +226,12 @@ private:
     QList<double> _xpress;              // the x increment stolen from the default simulation hierarchy
     QList<double> _ypress;              // the y increment stolen from the default simulation hierarchy
 
+    Simulation* _template;              // the simulation hierarchy constructed from the ski file, never setup
+    QMultiHash<QString,PropertyHandlerPtr> _labeled;  // the handlers for the labeled properties in the template
+    QSet<SimulationItem*> _tainted;     // the template items that hold or contain a labeled property
+    bool _retainable;                   // true if performInMemory() can retain the simulation hierarchy
+    QMutex _liveMutex;                  // the mutex guarding the dictionary of retained simulations
+    QHash<QThread*,LiveSimulation*> _live;  // the simulation retained by performInMemory() for each thread
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -12,6 +12,73 @@ using namespace std;
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the time spent in the Fourier space convolution per complex butterfly operation (including the padding,
+    // the multiplication with the kernel transform and the copying), relative to the time for a multiply-add in
+    // the one-dimensional passes, as measured for frames of 100 to 1000 pixels on a side
+    const double FFTCOSTFACTOR = 15.;
+
+    // returns the smallest power of two that is larger than or equal to n
+    int paddedSize(int n)
+    {
+        int size = 1;
+        while (size < n) size *= 2;
+        return size;
+    }
+
+    // performs an in-place fast Fourier transform (or its unnormalized inverse) of n complex values;
+    // n must be a power of two
+    void fft1(complex<double>* data, int n, bool inverse)
+    {
+        // bit-reversal permutation
+        for (int i=1, j=0; i<n; i++)
+        {
+            int bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) swap(data[i], data[j]);
+        }
+
+        // butterflies
+        for (int len=2; len<=n; len <<= 1)
+        {
+            double angle = (inverse ? 2 : -2) * M_PI / len;
+            complex<double> wlen(cos(angle), sin(angle));
+            for (int i=0; i<n; i+=len)
+            {
+                complex<double> w(1.);
+                for (int j=0; j<len/2; j++)
+                {
+                    complex<double> u = data[i+j];
+                    complex<double> v = data[i+j+len/2] * w;
+                    data[i+j] = u + v;
+                    data[i+j+len/2] = u - v;
+                    w *= wlen;
+                }
+            }
+        }
+    }
+
+    // performs an in-place two-dimensional fast Fourier transform (or its unnormalized inverse) of nx*ny values
+    // stored row by row; nx and ny must be powers of two
+    void fft2(vector< complex<double> >& data, int nx, int ny, bool inverse)
+    {
+        for (int y=0; y<ny; y++) fft1(&data[nx*y], nx, inverse);
+
+        // transform the columns in a contiguous buffer to limit cache misses
+        vector< complex<double> > column(ny);
+        for (int x=0; x<nx; x++)
+        {
+            for (int y=0; y<ny; y++) column[y] = data[x + nx*y];
+            fft1(&column[0], ny, inverse);
+            for (int y=0; y<ny; y++) data[x + nx*y] = column[y];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 Convolution::Convolution()
     : _fwhm(0), _dimension(0)
 {
@@ -28,6 +95,19 @@ void Convolution::setupSelfBefore()
 
     // verify dimension value
      if (_dimension < 0) throw FATALERROR("Frame dimension should be positive");
+
+    // construct the normalized one-dimensional kernel; the two-dimensional Gaussian is the product of two such kernels
+    if (_fwhm > 0 && _dimension > 0)
+    {
+        double sigma = _fwhm/2.3548;
+        _kernel.resize(_dimension);
+        for (int k=0; k<_dimension; k++)
+        {
+            int Xi = (_dimension-1)/2 - k;
+            _kernel[k] = exp(-(Xi*Xi)/(2*sigma*sigma));
+        }
+        _kernel /= _kernel.sum();
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -62,50 +142,101 @@ int Convolution::dimension() const
 
 void Convolution::convolve(Array *frame, int xdim, int ydim) const
 {
-    double sum = 0;
-    double sigma = _fwhm/2.3548;
+    if (_kernel.size() == 0) return;
+
+    // estimate the cost of two one-dimensional passes (in which the kernel is clipped to the frame) and of the
+    // convolution in Fourier space (two transforms of the padded frame, each consisting of nx*ny*log2(nx*ny)/2
+    // complex butterfly operations)
+    int nx = paddedSize(xdim + _dimension - 1);
+    int ny = paddedSize(ydim + _dimension - 1);
+    double separablecost = double(xdim) * ydim * (min(_dimension, xdim) + min(_dimension, ydim));
+    double fftcost = FFTCOSTFACTOR * double(nx) * ny * log2(double(nx) * ny);
+
+    if (fftcost < separablecost) convolveFFT(frame, xdim, ydim, nx, ny);
+    else convolveSeparable(frame, xdim, ydim);
+}
+
+////////////////////////////////////////////////////////////////////
 
-    //create kernel frame
-    double conv[_dimension][_dimension];
-    for (int yk=1; yk< _dimension+1; yk++)
+void Convolution::convolveSeparable(Array *frame, int xdim, int ydim) const
+{
+    // the pixel at kernel index k receives flux from the pixel at a distance k-c
+    int c = (_dimension-1)/2;
+
+    // horizontal pass from the frame into a temporary array
+    Array temp(xdim*ydim);
+    for (int yi=0; yi<ydim; yi++)
     {
-        for (int xk=1; xk< _dimension+1; xk++)
+        const double* in = &(*frame)[xdim*yi];
+        double* out = &temp[xdim*yi];
+        for (int xi=0; xi<xdim; xi++)
         {
-            int Xi = (_dimension+1)/2 - xk;
-            int Yi = (_dimension+1)/2 - yk;
-            conv[xk-1][yk-1] = 1/(2*M_PI*sigma*sigma) * exp(-(Xi*Xi+Yi*Yi)/(2*sigma*sigma));
-            sum += conv[xk-1][yk-1];
+            int kmin = max(0, xi+c-xdim+1);
+            int kmax = min(_dimension-1, xi+c);
+            double sum = 0;
+            for (int k=kmin; k<=kmax; k++) sum += in[xi+c-k] * _kernel[k];
+            out[xi] = sum;
         }
     }
 
-    //create convolved image by looping over all frame pixels and all kernel pixels
-    Array convolved_frame(frame->size());
-
-    for (int l=0; l< xdim*ydim; l++)
+    // vertical pass from the temporary array back into the frame
+    for (int yi=0; yi<ydim; yi++)
     {
-        int yi = l/xdim;
-        int xi = l-xdim*yi;
-
-        for (int xk=0; xk< _dimension; xk++)
+        int kmin = max(0, yi+c-ydim+1);
+        int kmax = min(_dimension-1, yi+c);
+        double* out = &(*frame)[xdim*yi];
+        for (int xi=0; xi<xdim; xi++) out[xi] = 0;
+        for (int k=kmin; k<=kmax; k++)
         {
-            for (int yk=0; yk< _dimension; yk++)
-            {
-                int startX = xi - (_dimension-1)/2;
-                int startY = yi - (_dimension-1)/2;
-
-                //excluding pixels out of bound
-                if (startX + xk >= 0 && startY + yk >= 0
-                    && startX + xk < xdim && startY + yk < ydim)
-                    convolved_frame[(startX + xk)+xdim*(startY + yk)] += (*frame)[xi+xdim*(yi)] * 1/sum * conv[xk][yk];
-            }
+            const double* in = &temp[xdim*(yi+c-k)];
+            double w = _kernel[k];
+            for (int xi=0; xi<xdim; xi++) out[xi] += in[xi] * w;
         }
     }
+}
 
-    //create output array
-    for (int m=0;m<xdim*ydim;m++)
+////////////////////////////////////////////////////////////////////
+
+void Convolution::convolveFFT(Array *frame, int xdim, int ydim, int nx, int ny) const
+{
+    // get the transform of the kernel for these padded dimensions, calculating it if needed
+    QSharedPointer<const KernelTransform> transform;
     {
-        (*frame)[m] = convolved_frame[m];
+        QMutexLocker lock(&_transformMutex);
+        if (!_transform || _transform->nx != nx || _transform->ny != ny)
+        {
+            KernelTransform* kt = new KernelTransform;
+            kt->nx = nx;
+            kt->ny = ny;
+            kt->values.resize(nx*ny);
+
+            // place the kernel value for a displacement (dx,dy) at pixel (dx mod nx, dy mod ny)
+            int c = (_dimension-1)/2;
+            for (int ky=0; ky<_dimension; ky++)
+                for (int kx=0; kx<_dimension; kx++)
+                    kt->values[((kx-c+nx)%nx) + nx*((ky-c+ny)%ny)] = _kernel[kx]*_kernel[ky];
+            fft2(kt->values, nx, ny, false);
+            _transform = QSharedPointer<const KernelTransform>(kt);
+        }
+        transform = _transform;
     }
+
+    // zero-pad the frame and transform it
+    vector< complex<double> > data(nx*ny);
+    for (int yi=0; yi<ydim; yi++)
+        for (int xi=0; xi<xdim; xi++)
+            data[xi + nx*yi] = (*frame)[xi + xdim*yi];
+    fft2(data, nx, ny, false);
+
+    // multiply by the kernel transform and transform back
+    for (int l=0; l<nx*ny; l++) data[l] *= transform->values[l];
+    fft2(data, nx, ny, true);
+
+    // copy the result into the frame, applying the normalization of the inverse transform
+    double norm = 1. / (double(nx)*ny);
+    for (int yi=0; yi<ydim; yi++)
+        for (int xi=0; xi<xdim; xi++)
+            (*frame)[xi + xdim*yi] = data[xi + nx*yi].real() * norm;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -6,12 +6,24 @@
 #ifndef CONVOLUTION_HPP
 #define CONVOLUTION_HPP
 
+#include <complex>
+#include <vector>
+#include <QMutex>
+#include <QSharedPointer>
 #include "Array.hpp"
 #include "SimulationItem.hpp"
 
 ////////////////////////////////////////////////////////////////////
 
-/** The Convolution class contains all information to convolve a given frame*/
+/** The Convolution class contains all information to convolve a given frame with a Gaussian point
+    spread function. The kernel is constructed once during setup. Since the Gaussian kernel is
+    separable, a frame is usually convolved with two one-dimensional passes, at a cost
+    proportional to the kernel dimension rather than to its square. For very large kernels, the
+    convolution is instead performed in Fourier space, using fast Fourier transforms on a frame
+    padded to avoid wrap-around effects; the transform of the kernel is cached between calls for
+    the same frame dimensions. The method with the lowest estimated cost is chosen automatically.
+    All methods produce the same result, i.e. a linear convolution in which flux scattered
+    outside of the frame is lost. */
 class Convolution : public SimulationItem
 {
     Q_OBJECT
@@ -37,6 +49,8 @@ public:
     Q_INVOKABLE Convolution();
 
 protected:
+    /** This function verifies the property values and constructs the normalized one-dimensional
+        Gaussian kernel. */
     void setupSelfBefore();
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -57,14 +71,41 @@ public:
     //======================== Other Functions =======================
 public:
     /** This function convolves the specified frame, with dimensions \em xdim x \em ydim, using the Convolution properties.
-        The kernel frame is created in such a way so no intensity is lost.*/
+        The kernel is normalized to unit sum, so the total intensity is conserved only for sources that lie at least
+        half a kernel dimension away from the frame edges. The frame is treated as if it were surrounded by empty
+        pixels: intensity spread beyond the frame edges is lost, and no intensity enters the frame from outside. For an
+        even kernel dimension, each pixel receives intensity from one more pixel towards the lower indices than towards
+        the higher indices. The convolution is performed in Fourier space only if the estimated cost is lower than that of the two
+        one-dimensional passes, which in practice happens only for kernels with a dimension of several hundred pixels
+        on frames of a similar size. If the full width at half max or the convolution frame dimension is zero, the
+        frame is left unchanged. This function may be called from multiple threads at the same time. */
     void convolve(Array *frame, int xdim, int ydim) const;
 
+private:
+    /** This function convolves the frame using two one-dimensional passes with the separable kernel. */
+    void convolveSeparable(Array* frame, int xdim, int ydim) const;
+
+    /** This function convolves the frame in Fourier space, with the frame zero-padded to the
+        specified dimensions \em nx x \em ny (which must be powers of two). */
+    void convolveFFT(Array* frame, int xdim, int ydim, int nx, int ny) const;
+
     //======================== Data Members ========================
 
 private:
     double _fwhm;
     int _dimension;
+
+    // the normalized one-dimensional kernel; the two-dimensional kernel is its outer product with itself
+    Array _kernel;
+
+    // the Fourier transform of the kernel padded to the dimensions nx x ny, cached between calls
+    struct KernelTransform
+    {
+        int nx, ny;
+        std::vector< std::complex<double> > values;
+    };
+    mutable QMutex _transformMutex;
+    mutable QSharedPointer<const KernelTransform> _transform;
 };
 
 ////////////////////////////////////////////////////////////////////
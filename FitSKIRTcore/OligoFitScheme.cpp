@@ -12,6 +12,7 @@
 #include "Log.hpp"
 #include "Optimization.hpp"
 #include "ParameterRange.hpp"
+#include "ProcessManager.hpp"
 #include "ParameterRanges.hpp"
 #include "ReferenceImage.hpp"
 #include "ReferenceImages.hpp"
@@ -28,7 +29,11 @@ OligoFitScheme::OligoFitScheme()
 void OligoFitScheme::runSelf()
 {
     _optim->initialize();
-    while(!_optim->done())
+    if (_optim->asynchronous())
+    {
+        _optim->evolve();
+    }
+    else while(!_optim->done())
     {
         _optim->step();
     }
@@ -119,41 +124,99 @@ double OligoFitScheme::objective(AdjustableSkirtSimulation::ReplacementDict repl
 {
     //perform the adjusted simulation
     QString prefix = "tmp/tmp_"+QString::number(index);
-    _simulation->performWith(replacement, prefix);
-    QString instrname = find<AdjustableSkirtSimulation>()->instrname();
-
-    //read the simulation frames and compare the frame size with the reference image
-    int counter=0;
-    QList<Array> Simulations;
     QList<QList<Array>> frames;
-    FilePaths* path = find<FilePaths>();
 
-    foreach (ReferenceImage* rima, _rimages->images())
+    //in a single process, the frames are handed back in memory; otherwise they are exchanged through FITS files
+    bool inmemory = !ProcessManager::isMultiProc();
+    if (inmemory)
+    {
+        _simulation->performInMemory(replacement, prefix, &frames);
+    }
+    else
     {
-        int nx,ny,nz; //dummy values;
-        QString filepath;
-
-        for(int i =0; i<_simulation->ncomponents();i++){
-            Array CompTotal;
-            filepath = path->output(prefix+"_"+instrname+"_stellar_"+
-                                    QString::number(i)+"_"+QString::number(counter)+".fits");
-            FITSInOut::read(filepath,CompTotal,nx,ny,nz);
-            Simulations.append(CompTotal);
+        _simulation->performWith(replacement, prefix);
+        QString instrname = find<AdjustableSkirtSimulation>()->instrname();
+        FilePaths* path = find<FilePaths>();
+
+        //read the simulation frames
+        for (int counter=0; counter<_rimages->size(); counter++)
+        {
+            int nx,ny,nz; //dummy values;
+            QList<Array> Simulations;
+            for(int i =0; i<_simulation->ncomponents();i++){
+                Array CompTotal;
+                QString filepath = path->output(prefix+"_"+instrname+"_stellar_"+
+                                                QString::number(i)+"_"+QString::number(counter)+".fits");
+                FITSInOut::read(filepath,CompTotal,nx,ny,nz);
+                Simulations.append(CompTotal);
+            }
+            frames.append(Simulations);
         }
+    }
 
+    //compare the frame size with the reference image
+    if (frames.size() != _rimages->size())
+        throw FATALERROR("Number of instrument frames does not match the number of reference frames");
+    int counter=0;
+    foreach (ReferenceImage* rima, _rimages->images())
+    {
         int framesize = (rima->xdim())*(rima->ydim());
-        int simsize = Simulations[0].size();
+        int simsize = frames[counter][0].size();
         if (framesize != simsize)
             throw FATALERROR("Simulations and Reference Images have different dimensions");
-
-        frames.append(Simulations);
-        Simulations.clear();
         counter++;
     }
 
-    //determine the best fitting luminosities and lowest chi2 value
+    //determine the best fitting luminosities and lowest chi2 value; the chi2 function alters
+    //the frames it is handed, so operate on a copy
+    QList<QList<Array>> original = frames;
     double test_chi2functions = _rimages->chi2(&frames,luminosities, Chis);
+
+    //keep the frames of a potential new best fit in memory, so that they can be written out later;
+    //with generational evaluation, PopEvaluate writes out an individual only if it improves on the best fit
+    //so far and on all individuals with a lower index in the generation, so the frames are kept only while
+    //that is still possible
+    if (inmemory)
+    {
+        QMutexLocker lock(&_framesMutex);
+        bool asynchronous = _optim->asynchronous();
+        if (!asynchronous) _chi2s.insert(index, test_chi2functions);
+        if (test_chi2functions < _optim->bestChi2())
+        {
+            bool candidate = true;
+            if (!asynchronous)
+            {
+                foreach (int k, _chi2s.keys())
+                    if (k < index && _chi2s[k] <= test_chi2functions) candidate = false;
+                if (candidate)
+                {
+                    foreach (int j, _frames.keys())
+                        if (j > index && _chi2s[j] >= test_chi2functions) _frames.remove(j);
+                }
+            }
+            if (candidate) _frames.insert(index, original);
+        }
+    }
     return test_chi2functions;
 }
 
 ////////////////////////////////////////////////////////////////////
+
+bool OligoFitScheme::takeFrames(int index, QList<QList<Array> >* frames)
+{
+    QMutexLocker lock(&_framesMutex);
+    if (!_frames.contains(index)) return false;
+    *frames = _frames.take(index);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void OligoFitScheme::clearFrames()
+{
+    QMutexLocker lock(&_framesMutex);
+    _frames.clear();
+    _chi2s.clear();
+}
+
+////////////////////////////////////////////////////////////////////
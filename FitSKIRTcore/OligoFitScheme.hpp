@@ -6,6 +6,7 @@
 #ifndef OLIGOFITSCHEME_HPP
 #define OLIGOFITSCHEME_HPP
 
+#include <QMutex>
 #include "AdjustableSkirtSimulation.hpp"
 #include "FitScheme.hpp"
 
@@ -86,10 +87,28 @@ public:
 
     /** This function is used by the Optimization object. It requires a ReplacementDict for the
         AdjustableSkirtSimulation and returns the total \f$\chi^2\f$ value together with lists of the best fitting
-        luminosities, the separate \f$\chi^2\f$ values and the masked simulations. */
+        luminosities, the separate \f$\chi^2\f$ values and the masked simulations. In a single
+        process, the simulated frames are kept in memory if the individual may have to be written
+        out as a new best fit. With generational evaluation, the best solutions are written out in
+        index order, so the frames of an individual are kept only if it improves on all
+        individuals with a lower index evaluated so far, and they are released as soon as an
+        individual with a lower index and a lower \f$\chi^2\f$ value arrives. In asynchronous
+        mode, each individual is written out or discarded immediately after its evaluation, so the
+        frames of all candidates are kept until then. */
     double objective(AdjustableSkirtSimulation::ReplacementDict replacement, QList<QList<double>> *luminosities,
                      QList<double> *Chis, int index);
 
+    /** This function retrieves and removes the simulated frames for the individual with the
+        specified index in the current generation, if they were kept in memory by the objective()
+        function, and returns true. Otherwise it returns false, and the frames must be read from
+        the temporary FITS files. The frames are indexed on reference image index and then on
+        stellar component index. */
+    bool takeFrames(int index, QList<QList<Array> >* frames);
+
+    /** This function discards all simulated frames kept in memory for the current generation, and
+        forgets the \f$\chi^2\f$ values of the individuals evaluated in the current generation. */
+    void clearFrames();
+
     //======================== Data Members ========================
 
 protected:
@@ -99,6 +118,12 @@ protected:
     ParameterRanges* _ranges;
     ReferenceImages* _rimages;
     Optimization* _optim;
+
+    // simulated frames kept in memory for candidate best fits in the current generation, indexed on individual,
+    // the chi2 values of the individuals evaluated so far in the current generation, and a mutex guarding both
+    QHash<int, QList<QList<Array> > > _frames;
+    QHash<int, double> _chi2s;
+    QMutex _framesMutex;
 };
 
 ////////////////////////////////////////////////////////////////////
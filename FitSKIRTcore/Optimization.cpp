@@ -17,12 +17,56 @@
 #include "ParameterRanges.hpp"
 #include "ReferenceImages.hpp"
 #include "Units.hpp"
+#include "garandom.h"
 #include <QDir>
 
 using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // steady-state genetic algorithm that can also create and insert individuals one at a time,
+    // so that their evaluation can proceed asynchronously (used in asynchronous mode)
+    class SteadyStateGA : public GASteadyStateGA
+    {
+    public:
+        SteadyStateGA(const GAGenome& genome) : GASteadyStateGA(genome), _numinserted(0) { }
+
+        // returns a new individual created from the current population; the caller takes ownership
+        GAGenome* offspring()
+        {
+            GAGenome& mom = pop->select();
+            GAGenome& dad = pop->select();
+            stats.numsel += 2;
+
+            GAGenome* child = mom.clone();
+            if (GAFlipCoin(pCrossover())) stats.numcro += (*scross)(mom, dad, child, (GAGenome*)0);
+            else if (GARandomBit()) child->copy(dad);
+            stats.nummut += child->mutate(pMutation());
+            stats.numeval++;
+            return child;
+        }
+
+        // inserts an evaluated individual in the population, replacing the worst individual;
+        // the population takes ownership; the statistics are updated by one generation each
+        // time the number of individuals replaced in a generation has been inserted
+        void insert(GAGenome* child)
+        {
+            pop->add(child);
+            pop->scale();
+            delete pop->remove(GAPopulation::WORST, GAPopulation::SCALED);
+            stats.numrep++;
+            if (++_numinserted % nReplacement() == 0) stats.update(*pop);
+        }
+
+    private:
+        int _numinserted;
+    };
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void MPIEvaluator(GAPopulation & p)
 {
     Optimization *opt = (Optimization *)p.userData();
@@ -32,10 +76,11 @@ void MPIEvaluator(GAPopulation & p)
 //////////////////////////////////////////////////////////////////////
 
 Optimization::Optimization()
-    :_genome(0)
+    :_genome(0), _numOffspring(0)
 {
         _bestChi2=1e20;
         _consec=0;
+        _asynchronous=false;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -57,7 +102,7 @@ void Optimization::setupSelfBefore()
     _genome->mutator(GARealGaussianMutator);
     _genome->crossover(GARealUniformCrossover);
     _genome->userData(this);
-    _ga= new GASteadyStateGA(*_genome);
+    _ga= new SteadyStateGA(*_genome);
     GASigmaTruncationScaling scaling;
     _ga->minimize();
     GAPopulation popu = _ga->population();
@@ -146,6 +191,20 @@ double Optimization::pcross() const
 
 //////////////////////////////////////////////////////////////////////
 
+void Optimization::setAsynchronous(bool value)
+{
+    _asynchronous = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool Optimization::asynchronous() const
+{
+    return _asynchronous;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 bool Optimization::done()
 {
    return _ga->done();
@@ -224,29 +283,32 @@ void Optimization::splitChi()
     data = comm->performTask(data);
 
     for(int i =0;i<_genValues.size();i++)
-    {
-        QList<QVariant> output = data[i].toList();
-        double chi_sum = output[0].toDouble();
-        QList<QVariant> lumis = output[1].toList();
-        QList<QVariant> chivalues = output[2].toList();
-        QList<double> Chis;
-        QList<double> All_luminosities;
-
-        for(int j = 0; j<lumis.size(); j++)
-        {
-            All_luminosities.append(lumis[j].toDouble());
-        }
-        for(int j = 0; j<chivalues.size(); j++)
-        {
-            Chis.append(chivalues[j].toDouble());
-        }
+        storeResult(i, data[i]);
+}
+
+//////////////////////////////////////////////////////////////////////
 
-        _genScores[i]=chi_sum;
-        _genLum[i]=All_luminosities;
-        _genChis[i]=Chis;
+void Optimization::storeResult(int i, QVariant output)
+{
+    QList<QVariant> outputList = output.toList();
+    double chi_sum = outputList[0].toDouble();
+    QList<QVariant> lumis = outputList[1].toList();
+    QList<QVariant> chivalues = outputList[2].toList();
+    QList<double> Chis;
+    QList<double> All_luminosities;
 
+    for(int j = 0; j<lumis.size(); j++)
+    {
+        All_luminosities.append(lumis[j].toDouble());
+    }
+    for(int j = 0; j<chivalues.size(); j++)
+    {
+        Chis.append(chivalues[j].toDouble());
     }
 
+    _genScores[i]=chi_sum;
+    _genLum[i]=All_luminosities;
+    _genChis[i]=Chis;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -258,6 +320,87 @@ void Optimization::step()
 
 //////////////////////////////////////////////////////////////////////
 
+void Optimization::evolve()
+{
+    SteadyStateGA* ga = static_cast<SteadyStateGA*>(_ga);
+    _numOffspring = (_ga->nGenerations() - _ga->generation()) * ga->nReplacement();
+    find<Log>()->info("Evaluating " + QString::number(_numOffspring) + " individuals asynchronously");
+
+    //creating a temporary folder to store the simulations
+    QString folderpath = find<FilePaths>()->output("tmp");
+    if(!QDir(folderpath).exists())
+        QDir().mkdir(folderpath);
+
+    //hand out a new individual each time a slave becomes available
+    find<MasterSlaveCommunicator>()->performTask(0, this, &Optimization::produceOffspring,
+                                                 &Optimization::consumeOffspring);
+    clearGen(folderpath);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+QVariant Optimization::produceOffspring()
+{
+    int i = _genValues.size();
+    if (i >= _numOffspring) return QVariant();
+
+    GAGenome* child = static_cast<SteadyStateGA*>(_ga)->offspring();
+    _offspring.insert(i, child);
+    appendValues((GARealGenome &)*child);
+    _genScores.resize(i+1);
+    _genLum.resize(i+1);
+    _genChis.resize(i+1);
+
+    QList<QVariant> valuesVarList;
+    for(int j = 0; j<_genValues[i].size(); j++)
+    {
+        valuesVarList.append((double)(_genValues[i])[j]);
+    }
+    QList<QVariant> totalVarList;
+    totalVarList.append(i);
+    totalVarList.insert(totalVarList.size(),valuesVarList);
+    return totalVarList;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Optimization::consumeOffspring(QVariant input, QVariant output)
+{
+    int i = input.toList()[0].toInt();
+    storeResult(i, output);
+
+    //write out the individual and check whether it is the best solution so far
+    int generation = _ga->generation();
+    _stream<<generation<<" ";
+    writeLine(&_stream, i);
+    if (_genScores[i]<_bestChi2)
+    {
+        _bestChi2=_genScores[i];
+        writeBest(i,_consec);
+        _consec++;
+    }
+    else
+    {
+        //discard the simulated frames kept in memory for this individual, if any
+        QList<QList<Array> > frames;
+        find<OligoFitScheme>()->takeFrames(i, &frames);
+    }
+
+    //remove the temporary files for this individual
+    QDir dir(find<FilePaths>()->output("tmp"));
+    foreach (QString filename, dir.entryList(QStringList("tmp_"+QString::number(i)+"_*"), QDir::Files))
+        dir.remove(filename);
+
+    //insert the evaluated individual in the population
+    GAGenome* child = _offspring.take(i);
+    child->score(_genScores[i]);
+    static_cast<SteadyStateGA*>(_ga)->insert(child);
+    if (_ga->generation() > generation)
+        find<Log>()->info("Completed generation "+QString::number(generation));
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void Optimization::writeList(std::ofstream *stream, QList<double> list)
 {
     for (int i=0; i<list.size(); i++)
@@ -266,6 +409,13 @@ void Optimization::writeList(std::ofstream *stream, QList<double> list)
 
 //////////////////////////////////////////////////////////////////////
 
+double Optimization::bestChi2() const
+{
+    return _bestChi2;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void Optimization::writeBest(int index, int consec)
 {
     _beststream<<consec<<" ";
@@ -302,24 +452,8 @@ void Optimization::PopEvaluate(GAPopulation & p)
     {
         if (p.individual(i).isEvaluated()==gaFalse)
         {
-            GARealGenome & genome = (GARealGenome &)p.individual(i);
-            ParameterRanges* ranges = find<ParameterRanges>();
-
-            //loop over all ranges to use the correct label but use the genome values to create the replacement
-            int counter=0;
-            QVector<double> currentUnitsValues, currentValues;
-            foreach (ParameterRange* range, ranges->ranges())
-            {
-                double value = genome.gene(counter);
-                currentValues.push_back(value);
-                if (range->quantityString()!="")
-                    value = find<Units>()->out(range->quantityString(),value);
-                currentUnitsValues.push_back(value);
-                counter++;
-            }
             _genIndices.append(i);
-            _genValues.append(currentValues);
-            _genUnitsValues.append(currentUnitsValues);
+            appendValues((GARealGenome &)p.individual(i));
         }
     }
     _genScores.resize(_genIndices.size());
@@ -348,6 +482,28 @@ void Optimization::PopEvaluate(GAPopulation & p)
 
 //////////////////////////////////////////////////////////////////////
 
+void Optimization::appendValues(const GARealGenome& genome)
+{
+    ParameterRanges* ranges = find<ParameterRanges>();
+
+    //loop over all ranges to use the correct label but use the genome values to create the replacement
+    int counter=0;
+    QVector<double> currentUnitsValues, currentValues;
+    foreach (ParameterRange* range, ranges->ranges())
+    {
+        double value = genome.gene(counter);
+        currentValues.push_back(value);
+        if (range->quantityString()!="")
+            value = find<Units>()->out(range->quantityString(),value);
+        currentUnitsValues.push_back(value);
+        counter++;
+    }
+    _genValues.append(currentValues);
+    _genUnitsValues.append(currentUnitsValues);
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void Optimization::clearGen(const QString & dirName)
 {
     _genReplacement.clear();
@@ -357,6 +513,7 @@ void Optimization::clearGen(const QString & dirName)
     _genLum.clear();
     _genChis.clear();
     _genUnitsValues.clear();
+    find<OligoFitScheme>()->clearFrames();
 
     QDir dir(dirName);
     find<Log>()->info("removing: "+dirName);
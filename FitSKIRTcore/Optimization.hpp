@@ -11,7 +11,9 @@
 #include "GARealGenome.h"
 #include "GASStateGA.h"
 #include "SimulationItem.hpp"
+#include <QHash>
 #include <QVector>
+#include <atomic>
 #include <fstream>
 
 ////////////////////////////////////////////////////////////////////
@@ -20,7 +22,18 @@
     This class uses the genetic algorithm library, GAlib. The ParameterRanges object from the OligoFitScheme is
     used to set the boundaries and to interpret the output values. The popevaluate function present in this document
     is used by the optimization library and feeds the genome values to the OligoFitScheme object in the form of a
-    ReplacementDict. This is done in parallalel for all individuals over the amount of available threads. */
+    ReplacementDict. This is done in parallalel for all individuals over the amount of available threads.
+
+    By default, the genetic algorithm proceeds in generations: all new individuals of a generation
+    are evaluated in parallel, and the next generation is created only after the last of them has
+    been evaluated. Since the run time of the simulations varies between individuals, many slaves
+    sit idle while waiting for the slowest simulation of each generation. In asynchronous mode,
+    the initial population is evaluated as before, but from then on each slave is handed a new
+    individual as soon as it returns a score. The new individual is created through selection,
+    crossover and mutation from the current population, and each evaluated individual immediately
+    replaces the worst individual in the population (steady-state replacement). The total number
+    of evaluations is the same as in the default mode, i.e. the number of generations times the
+    number of individuals replaced in each generation of the steady-state algorithm. */
 class Optimization: public SimulationItem
 {
     Q_OBJECT
@@ -50,6 +63,11 @@ class Optimization: public SimulationItem
     Q_CLASSINFO("MinValue", "0")
     Q_CLASSINFO("MaxValue", "1")
 
+    Q_CLASSINFO("Property", "asynchronous")
+    Q_CLASSINFO("Title", "evaluate new individuals as soon as a slave becomes available")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -87,6 +105,13 @@ public:
     /** This function returns the populationsize. */
     Q_INVOKABLE double pcross() const;
 
+    /** This function sets the flag that enables the asynchronous mode described in the class
+        header. The default value is false. */
+    Q_INVOKABLE void setAsynchronous(bool value);
+
+    /** This function returns the flag that enables the asynchronous mode. */
+    Q_INVOKABLE bool asynchronous() const;
+
     //======================== Other Functions =======================
 
     /** Checks if the optimization process is done. */
@@ -107,21 +132,51 @@ public:
     /** Proceed one step in the optimization process. */
     void step();
 
+    /** Performs all remaining evaluations of the optimization process in asynchronous mode, as
+        described in the class header. The temporary files of each individual are removed as soon
+        as it has been evaluated. */
+    void evolve();
+
+    /** Creates a new individual from the current population and returns its values in a QVariant
+        object suitable for the chi2() function, or an invalid QVariant if all evaluations have
+        been handed out. This function is used as the producer in asynchronous mode. */
+    QVariant produceOffspring();
+
+    /** Sets the score of the individual specified by the input of the chi2() function, writes out
+        its results, and inserts it in the population. This function is used as the consumer in
+        asynchronous mode. */
+    void consumeOffspring(QVariant input, QVariant output);
+
     /** Translates variables to QVariant and performs the chi2 funtion in parallel. */
     void splitChi();
 
     /** Write out a list of doubles to the output file. */
     void writeList(std::ofstream *stream, QList<double> list);
 
+    /** Returns the lowest \f$\chi^2\f$ value found in the generations evaluated so far. The value
+        is updated only after all individuals of a generation have been evaluated, or, in
+        asynchronous mode, as soon as an individual has been evaluated. */
+    double bestChi2() const;
+
     /** Write out the current genome to the best simulations file. */
     void writeBest(int index, int consec);
 
     /** Write out an entire line. */
     void writeLine(std::ofstream *stream, int i);
 
-    /** Clears the generation information. Removes the temporary folder. */
+    /** Clears the generation information, including the simulated frames kept in memory by the
+        fit scheme. Removes the temporary folder. */
     void clearGen(const QString & dirName);
 
+private:
+    /** Appends the values of the specified genome, in internal and in output units, to the
+        generation information. */
+    void appendValues(const GARealGenome& genome);
+
+    /** Stores the output of the chi2() function in the generation information with the specified
+        index. */
+    void storeResult(int i, QVariant output);
+
     //======================== Data Members ========================
 
 private:
@@ -130,7 +185,8 @@ private:
     int _consec;
     double _pmut;
     double _pcross;
-    double _bestChi2;
+    bool _asynchronous;
+    std::atomic<double> _bestChi2;  // read by the parallel evaluations while being updated in asynchronous mode
     GARealAlleleSetArray _allelesetarray;
     GARealGenome* _genome;
     GASteadyStateGA* _ga;
@@ -143,6 +199,8 @@ private:
     QList<QVector<double> > _genUnitsValues;
     QVector<QList<double> > _genLum;
     QVector<QList<double> > _genChis;
+    int _numOffspring;                  // the total number of individuals to be evaluated in asynchronous mode
+    QHash<int, GAGenome*> _offspring;   // the individuals being evaluated in asynchronous mode, indexed on row
 
 };
 
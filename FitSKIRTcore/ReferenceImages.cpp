@@ -12,6 +12,7 @@
 #include "InstrumentFrame.hpp"
 #include "Log.hpp"
 #include "MultiFrameInstrument.hpp"
+#include "OligoFitScheme.hpp"
 #include "Optimization.hpp"
 #include "ReferenceImage.hpp"
 #include "Units.hpp"
@@ -109,17 +110,30 @@ void ReferenceImages::writeOutBest(int index, int consec) const
     QString instrname = adjSS->instrname();
     find<Log>()->info("Found new best fit");
 
+    // use the simulated frames kept in memory if available; otherwise read them from the temporary files
+    QList<QList<Array>> frames;
+    bool inmemory = find<OligoFitScheme>()->takeFrames(index, &frames);
+
     foreach (ReferenceImage* rima, _rimages)
     {
-        int nx, ny, nz;
+        int nx = rima->xdim();
+        int ny = rima->ydim();
+        int nz = 1;
         QList<Array> Total;
         QString filepath;
-        for(int i =0; i<adjSS->ncomponents();i++){
-            Array CompTotal;
-            filepath = path->output(prefix+"_"+instrname+"_stellar_"+
-                                    QString::number(i)+"_"+QString::number(counter)+".fits");
-            FITSInOut::read(filepath,CompTotal,nx,ny,nz);
-            Total.append(CompTotal);
+        if (inmemory)
+        {
+            Total = frames[counter];
+        }
+        else
+        {
+            for(int i =0; i<adjSS->ncomponents();i++){
+                Array CompTotal;
+                filepath = path->output(prefix+"_"+instrname+"_stellar_"+
+                                        QString::number(i)+"_"+QString::number(counter)+".fits");
+                FITSInOut::read(filepath,CompTotal,nx,ny,nz);
+                Total.append(CompTotal);
+            }
         }
         rima->returnFrame(&Total);
         filepath = path->output("Best_"+QString::number(consec)+"_"+QString::number(counter)+".fits");
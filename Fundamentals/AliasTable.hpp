@@ -0,0 +1,123 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef ALIASTABLE_HPP
+#define ALIASTABLE_HPP
+
+#include <vector>
+#include "Array.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+/** An instance of the AliasTable class holds a discrete probability distribution over the indices
+    \f$i=0,\dots,N-1\f$ in a form that allows drawing random indices in constant time, using the
+    alias method in the numerically stable formulation of Vose (1991, IEEE Transactions on Software
+    Engineering 17, 972). Drawing an index from a normalized cumulative distribution built by
+    NR::cdf() requires a binary search with \f$\log_2 N\f$ steps, each of which is likely to
+    cause a cache miss for large \f$N\f$. In contrast, drawing an index from an alias table
+    requires at most two memory accesses. The price is a somewhat larger memory footprint: an
+    alias table holds a double and an integer for each index, while a cumulative distribution holds
+    a single double.
+
+    The table is constructed by dividing the probability mass into \f$N\f$ columns of equal
+    height \f$1/N\f$. Column \f$i\f$ holds a fraction \f$q_i\f$ of its height for index \f$i\f$, and
+    the remainder for a single other index, the \em alias \f$a_i\f$. To draw an index, a uniform
+    deviate \f$X\f$ is split into the column index \f$i=\lfloor XN \rfloor\f$ and the fractional
+    part \f$f=XN-i\f$; the result is \f$i\f$ if \f$f<q_i\f$ and \f$a_i\f$ otherwise. Indices with a
+    zero probability are never drawn.
+
+    All implementations are provided inline in the header. */
+class AliasTable
+{
+public:
+    /** The default constructor creates an empty table. */
+    AliasTable() : _n(0) { }
+
+    /** This function (re-)initializes the table for the discrete distribution specified as an
+        array \f$p_i\f$ with at least one element, as described for the other version of this
+        function. */
+    void initialize(const Array& pv)
+    {
+        initialize(pv.size(), [&pv](int i){return pv[i];});
+    }
+
+    /** This function (re-)initializes the table for the discrete distribution specified by a
+        function object with signature double pv(int i); the number of indices \f$N>0\f$ is
+        specified as a separate argument. The source function is called once for each index
+        \f$i=0,\dots,N-1\f$. The distribution does not need to be normalized, but its elements must
+        be nonnegative. If all of them are zero, the table is initialized to a uniform distribution.
+        */
+    template<typename Functor> void initialize(int n, Functor pv)
+    {
+        _n = n;
+        _qv.resize(n);
+        _av.resize(n);
+
+        // scale the probabilities so that their average is one
+        double sum = 0.;
+        for (int i=0; i<n; i++) sum += (_qv[i] = pv(i));
+        if (sum > 0.)
+        {
+            double scale = n / sum;
+            for (int i=0; i<n; i++) _qv[i] *= scale;
+        }
+        else _qv = 1.;
+
+        // partition the indices in those with a scaled probability below and above the average
+        std::vector<int> smallv, largev;
+        smallv.reserve(n);
+        largev.reserve(n);
+        for (int i=0; i<n; i++) (_qv[i] < 1. ? smallv : largev).push_back(i);
+
+        // fill each column for a small index with the excess of a large index
+        while (!smallv.empty() && !largev.empty())
+        {
+            int s = smallv.back();  smallv.pop_back();
+            int l = largev.back();  largev.pop_back();
+            _av[s] = l;
+            _qv[l] = (_qv[l] + _qv[s]) - 1.;
+            (_qv[l] < 1. ? smallv : largev).push_back(l);
+        }
+
+        // the remaining columns are full, except for roundoff errors
+        for (int l : largev) { _qv[l] = 1.; _av[l] = l; }
+        for (int s : smallv) { _qv[s] = 1.; _av[s] = s; }
+    }
+
+    /** This function releases the memory held by the table, leaving an empty table. */
+    void clear()
+    {
+        _n = 0;
+        _qv.resize(0);
+        std::vector<int>().swap(_av);
+    }
+
+    /** This function returns the number of indices \f$N\f$ in the distribution, or zero if the
+        table is empty. */
+    int size() const { return _n; }
+
+    /** This function returns the number of bytes of memory used by the table. */
+    size_t bytes() const { return _n * (sizeof(double)+sizeof(int)); }
+
+    /** This function returns an index drawn from the distribution given a uniform deviate \em X in
+        the interval \f$[0,1)\f$, as described in the class header. The table must not be empty.
+        */
+    int sample(double X) const
+    {
+        double u = X * _n;
+        int i = static_cast<int>(u);
+        if (i >= _n) i = _n-1;
+        return u-i < _qv[i] ? i : _av[i];
+    }
+
+private:
+    int _n;                 // the number of indices
+    Array _qv;              // the fraction of each column assigned to its own index
+    std::vector<int> _av;   // the alias index for each column
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // ALIASTABLE_HPP
@@ -24,6 +24,7 @@ QMAKE_CXXFLAGS_RELEASE += -O3
 #--------------------------------------------------
 
 HEADERS += \
+    AliasTable.hpp \
     Array.hpp \
     ArrayTable.hpp \
     Box.hpp \
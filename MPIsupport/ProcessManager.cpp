@@ -163,6 +163,36 @@ void ProcessManager::broadcast(int* value, int root)
 
 //////////////////////////////////////////////////////////////////////
 
+void ProcessManager::alltoall(const double* sendarray, const int* sendcounts, const int* senddispls,
+                              double* recvarray, const int* recvcounts, const int* recvdispls)
+{
+#ifdef BUILDING_WITH_MPI
+    MPI_Alltoallv(const_cast<double*>(sendarray), const_cast<int*>(sendcounts), const_cast<int*>(senddispls),
+                  MPI_DOUBLE, recvarray, const_cast<int*>(recvcounts), const_cast<int*>(recvdispls),
+                  MPI_DOUBLE, MPI_COMM_WORLD);
+#else
+    Q_UNUSED(sendarray) Q_UNUSED(sendcounts) Q_UNUSED(senddispls)
+    Q_UNUSED(recvarray) Q_UNUSED(recvcounts) Q_UNUSED(recvdispls)
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void ProcessManager::allgatherv(const double* sendarray, int sendcount,
+                                double* recvarray, const int* recvcounts, const int* recvdispls)
+{
+#ifdef BUILDING_WITH_MPI
+    MPI_Allgatherv(const_cast<double*>(sendarray), sendcount, MPI_DOUBLE,
+                   recvarray, const_cast<int*>(recvcounts), const_cast<int*>(recvdispls),
+                   MPI_DOUBLE, MPI_COMM_WORLD);
+#else
+    Q_UNUSED(sendarray) Q_UNUSED(sendcount)
+    Q_UNUSED(recvarray) Q_UNUSED(recvcounts) Q_UNUSED(recvdispls)
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
 bool ProcessManager::isRoot()
 {
 #ifdef BUILDING_WITH_MPI
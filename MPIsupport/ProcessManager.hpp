@@ -99,6 +99,23 @@ public:
         root during the communication. */
     static void broadcast(int* value, int root);
 
+    /** This function is used to exchange blocks of double values between all processes, so that
+        each process sends a (possibly empty) block to every process and receives a block from
+        every process. The block sent to process \em r consists of \c sendcounts[r] values
+        starting at offset \c senddispls[r] in \em sendarray; the block received from process \em
+        r is stored at offset \c recvdispls[r] in \em recvarray and must contain \c recvcounts[r]
+        values. All processes must call this function for the communication to proceed. */
+    static void alltoall(const double* sendarray, const int* sendcounts, const int* senddispls,
+                         double* recvarray, const int* recvcounts, const int* recvdispls);
+
+    /** This function is used to gather blocks of double values of variable size from all processes
+        and to distribute the concatenated result to all processes. Each process contributes the
+        \em sendcount values in \em sendarray. The block contributed by process \em r is stored at
+        offset \c recvdispls[r] in \em recvarray on every process and must contain \c recvcounts[r]
+        values. All processes must call this function for the communication to proceed. */
+    static void allgatherv(const double* sendarray, int sendcount,
+                           double* recvarray, const int* recvcounts, const int* recvdispls);
+
     /** This function returns a boolean indicating whether the process is assigned as root or not.
         The rank of the process is always the 'true' rank, irrespective of whether the object that
         calls this function has acquired the MPI resource or not. */
@@ -202,9 +202,8 @@ double AdaptiveMeshDustDistribution::density(Position bfr) const
 
 Position AdaptiveMeshDustDistribution::generatePosition() const
 {
-    Random* random = find<Random>();
-    int m = NR::locate_clip(_cumrhov, random->uniform());
-    return _mesh->randomPosition(random, m);
+    int m = NR::locate_clip(_cumrhov, _random->uniform());
+    return _mesh->randomPosition(_random, m);
 }
 
 //////////////////////////////////////////////////////////////////////
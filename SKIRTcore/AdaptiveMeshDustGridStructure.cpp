@@ -44,6 +44,13 @@ void AdaptiveMeshDustGridStructure::setupSelfBefore()
 
 //////////////////////////////////////////////////////////////////////
 
+bool AdaptiveMeshDustGridStructure::dependsOnDistribution() const
+{
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double AdaptiveMeshDustGridStructure::xmax() const
 {
     return _mesh->extent().xmax();
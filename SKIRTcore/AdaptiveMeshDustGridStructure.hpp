@@ -37,6 +37,10 @@ public:
     //======================== Other Functions =======================
 
 public:
+    /** This function returns true since the adaptive mesh is obtained from the dust
+        distribution. */
+    bool dependsOnDistribution() const;
+
     /** This function returns the maximum extent \f$x_{\text{max}}\f$ of the grid structure in the
         \f$x\f$ direction. */
     double xmax() const;
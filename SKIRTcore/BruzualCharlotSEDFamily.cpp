@@ -8,8 +8,13 @@
 #include "BruzualCharlotSEDFamily.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
+#include "IdenticalAssigner.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
+#include "ParallelTarget.hpp"
+#include "ResourceCacheFile.hpp"
 #include "Units.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -23,21 +28,68 @@ namespace
     const int Nlambda = 1221;
     const int Nt = 221;
     const int NZ = 6;
+
+    // class to calculate the luminosities of a set of stellar populations (parallelized);
+    // the luminosity of population i at wavelength ell is stored in Xvv[ell][i+1]
+    class LuminosityCalculator : public ParallelTarget
+    {
+    private:
+        const BruzualCharlotSEDFamily* _family;
+        const vector<double>& _Mv;
+        const vector<double>& _Zv;
+        const vector<double>& _tv;
+        ArrayTable<2>& _Xvv;
+
+    public:
+        LuminosityCalculator(const BruzualCharlotSEDFamily* family, const vector<double>& Mv,
+                             const vector<double>& Zv, const vector<double>& tv, ArrayTable<2>& Xvv)
+            : _family(family), _Mv(Mv), _Zv(Zv), _tv(tv), _Xvv(Xvv) { }
+
+        void body(size_t i)
+        {
+            const Array& Lv = _family->luminosities(_Mv[i], _Zv[i], _tv[i]);
+            int n = Lv.size();
+            for (int ell=0; ell<n; ell++) _Xvv[ell][i+1] = Lv[ell];
+        }
+    };
+
+    // class to turn the luminosities in each row of Xvv into a normalized cumulative distribution,
+    // storing the total luminosity for the row in Ltotv (parallelized)
+    class CumulativeCalculator : public ParallelTarget
+    {
+    private:
+        ArrayTable<2>& _Xvv;
+        Array& _Ltotv;
+
+    public:
+        CumulativeCalculator(ArrayTable<2>& Xvv, Array& Ltotv) : _Xvv(Xvv), _Ltotv(Ltotv) { }
+
+        void body(size_t ell)
+        {
+            Array& Xv = _Xvv[ell];
+            int n = Xv.size()-1;
+            Xv[0] = 0.;
+            for (int i=0; i<n; i++) Xv[i+1] += Xv[i];
+            _Ltotv[ell] = Xv[n];
+            Xv /= Xv[n];
+        }
+    };
 }
 
 //////////////////////////////////////////////////////////////////////
 
 BruzualCharlotSEDFamily::BruzualCharlotSEDFamily(SimulationItem* item)
+    : _item(item)
 {
     // local constants for units
     const double Lsun = Units::Lsun();
     const double Angstrom = 1e-10;
 
     // Prepare the vectors for the Bruzual & Charlot library SEDs
-    _lambdav.resize(Nlambda);
+    Array lambdav(Nlambda);
     _tv.resize(Nt);
     _Zv.resize(NZ);
-    _jvv.resize(Nt,NZ,Nlambda);
+    ArrayTable<3> jvv(Nt,NZ,Nlambda);
 
     // Fill the metallicity vector
     vector<QString> Zcodev(NZ);
@@ -48,63 +100,98 @@ BruzualCharlotSEDFamily::BruzualCharlotSEDFamily(SimulationItem* item)
     _Zv[4] = 0.02;	     Zcodev[4] = "m62";
     _Zv[5] = 0.05;	     Zcodev[5] = "m72";
 
-    // Read the wavelength, age and emissivity vectors from the Bruzual & Charlot library
+    // Determine the names of the Bruzual & Charlot library files
+    QStringList bcfilenames;
     for (int m=0; m<NZ; m++)
+        bcfilenames << FilePaths::resource("SED/BruzualCharlot/chabrier/bc2003_lr_"
+                                           + Zcodev[m] + "_chab_ssp.ised_ASCII");
+
+    // If the library has been cached in binary form, read the wavelength, age and emissivity vectors from the cache
+    ResourceCacheFile cache("BruzualCharlot_chabrier_lr", bcfilenames);
+    if (cache.isCached())
     {
-        QString bcfilename = FilePaths::resource("SED/BruzualCharlot/chabrier/bc2003_lr_"
-                                                 + Zcodev[m] + "_chab_ssp.ised_ASCII");
-        ifstream bcfile(bcfilename.toLocal8Bit().constData());
-        if (! bcfile.is_open()) throw FATALERROR("Could not open the data file " + bcfilename);
-
-        item->find<Log>()->info("Reading SED data from file " + bcfilename + "...");
-        int iNt, iNlambda;
-        bcfile >> iNt;
-        if (iNt != Nt)
-            throw FATALERROR("iNt is not equal to Nt");
-        for (int p=0; p<Nt; p++)
-        {
-            double t;
-            bcfile >> t;
-            _tv[p] = t;     // age in file in yr, we want in yr
-        }
-        string dummy;
-        for (int l=0; l<6; l++)
-            getline(bcfile,dummy); // skip six lines...
-        bcfile >> iNlambda;
-        if (iNlambda != Nlambda)
-            throw FATALERROR("iNlambda is not equal to Nlambda");
-        for (int k=0; k<Nlambda; k++)
-        {
-            double lambda;
-            bcfile >> lambda;
-            _lambdav[k] = lambda * Angstrom;   // lambda in file in A, we want in m
-        }
+        item->find<Log>()->info("Reading SED data from cache file " + cache.filepath() + "...");
+        cache.readArray(lambdav);
+        cache.readArray(_tv);
         for (int p=0; p<Nt; p++)
+            for (int m=0; m<NZ; m++)
+                cache.readArray(jvv(p,m));
+        if (lambdav.size() != Nlambda || _tv.size() != Nt || jvv(Nt-1,NZ-1).size() != Nlambda)
+            throw FATALERROR("The cache file " + cache.filepath() + " does not match the library");
+    }
+
+    // Otherwise, read the wavelength, age and emissivity vectors from the Bruzual & Charlot library files,
+    // and cache them in binary form for later use
+    else
+    {
+        for (int m=0; m<NZ; m++)
         {
-            Array& jv = _jvv(p,m);
+            QString bcfilename = bcfilenames[m];
+            ifstream bcfile(bcfilename.toLocal8Bit().constData());
+            if (! bcfile.is_open()) throw FATALERROR("Could not open the data file " + bcfilename);
+
+            item->find<Log>()->info("Reading SED data from file " + bcfilename + "...");
+            int iNt, iNlambda;
+            bcfile >> iNt;
+            if (iNt != Nt)
+                throw FATALERROR("iNt is not equal to Nt");
+            for (int p=0; p<Nt; p++)
+            {
+                double t;
+                bcfile >> t;
+                _tv[p] = t;     // age in file in yr, we want in yr
+            }
+            string dummy;
+            for (int l=0; l<6; l++)
+                getline(bcfile,dummy); // skip six lines...
             bcfile >> iNlambda;
             if (iNlambda != Nlambda)
                 throw FATALERROR("iNlambda is not equal to Nlambda");
             for (int k=0; k<Nlambda; k++)
             {
-                double j;
-                bcfile >> j;
-                jv[k] = j * Lsun/Angstrom;   // emissivity in file in Lsun/A, we want in W/m.
+                double lambda;
+                bcfile >> lambda;
+                lambdav[k] = lambda * Angstrom;   // lambda in file in A, we want in m
             }
-            int idummy;
-            bcfile >> idummy;
-            for (int k=0; k<idummy; k++)
+            for (int p=0; p<Nt; p++)
             {
-                double dummy;
-                bcfile >> dummy;
+                Array& jv = jvv(p,m);
+                bcfile >> iNlambda;
+                if (iNlambda != Nlambda)
+                    throw FATALERROR("iNlambda is not equal to Nlambda");
+                for (int k=0; k<Nlambda; k++)
+                {
+                    double j;
+                    bcfile >> j;
+                    jv[k] = j * Lsun/Angstrom;   // emissivity in file in Lsun/A, we want in W/m.
+                }
+                int idummy;
+                bcfile >> idummy;
+                for (int k=0; k<idummy; k++)
+                {
+                    double dummy;
+                    bcfile >> dummy;
+                }
             }
+            bcfile.close();
+            item->find<Log>()->info("File " + bcfilename + " closed.");
         }
-        bcfile.close();
-        item->find<Log>()->info("File " + bcfilename + " closed.");
+        cache.writeArray(lambdav);
+        cache.writeArray(_tv);
+        for (int p=0; p<Nt; p++)
+            for (int m=0; m<NZ; m++)
+                cache.writeArray(jvv(p,m));
+        if (cache.save()) item->find<Log>()->info("Cached SED data in file " + cache.filepath());
     }
 
-    // cache the simulation's wavelength grid
-    _lambdagrid = item->find<WavelengthGrid>();
+    // resample each library SED to the simulation's wavelength grid,
+    // and convert emissivities to luminosities (i.e. multiply by the wavelength bins)
+    WavelengthGrid* lambdagrid = item->find<WavelengthGrid>();
+    _Lvv.resize(Nt,NZ,0);
+    for (int p=0; p<Nt; p++)
+        for (int m=0; m<NZ; m++)
+            _Lvv(p,m) = NR::resample<NR::interpolate_loglog>(lambdagrid->lambdav(), lambdav, jvv(p,m))
+                        * lambdagrid->dlambdav();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -140,22 +227,48 @@ Array BruzualCharlotSEDFamily::luminosities(double M, double Z, double t) const
         double tR = _tv[pR];
         ht = (t-tL)/(tR-tL);
     }
-    const Array& jLLv = _jvv(pL,mL);
-    const Array& jLRv = _jvv(pL,mR);
-    const Array& jRLv = _jvv(pR,mL);
-    const Array& jRRv = _jvv(pR,mR);
-    Array jv(Nlambda);
-    for (int k=0; k<Nlambda; k++)
-        jv[k] = (1.0-ht)*(1.0-hZ)*jLLv[k]
-                + (1.0-ht)*hZ*jLRv[k]
-                + ht*(1.0-hZ)*jRLv[k]
-                + ht*hZ*jRRv[k];
-
-    // resample to the simulation wavelength grid,
-    // convert emissivities to luminosities (i.e. multiply by the wavelength bins),
-    // multiply by the mass of the population (in solar masses),
-    // and return the result
-    return NR::resample<NR::interpolate_loglog>(_lambdagrid->lambdav(), _lambdav, jv) * _lambdagrid->dlambdav() * M;
+    const Array& LLLv = _Lvv(pL,mL);
+    const Array& LLRv = _Lvv(pL,mR);
+    const Array& LRLv = _Lvv(pR,mL);
+    const Array& LRRv = _Lvv(pR,mR);
+
+    // interpolate the precomputed luminosities on the simulation wavelength grid,
+    // multiply by the mass of the population (in solar masses), and return the result
+    double wLL = (1.0-ht)*(1.0-hZ)*M;
+    double wLR = (1.0-ht)*hZ*M;
+    double wRL = ht*(1.0-hZ)*M;
+    double wRR = ht*hZ*M;
+    int n = LLLv.size();
+    Array Lv(n);
+    for (int ell=0; ell<n; ell++)
+        Lv[ell] = wLL*LLLv[ell] + wLR*LLRv[ell] + wRL*LRLv[ell] + wRR*LRRv[ell];
+    return Lv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void BruzualCharlotSEDFamily::cdfs(const vector<double>& Mv, const vector<double>& Zv, const vector<double>& tv,
+                                   ArrayTable<2>& Xvv, Array& Ltotv) const
+{
+    int N = Mv.size();
+    int Nell = _Lvv(0,0).size();
+    Xvv.resize(Nell, N+1);
+    Ltotv.resize(Nell);
+
+    // every process calculates the complete set of distributions, distributed over its threads
+    Parallel* parallel = _item->find<ParallelFactory>()->parallel();
+    IdenticalAssigner* assigner = new IdenticalAssigner(_item);
+
+    // calculate the luminosity of each population at each wavelength
+    LuminosityCalculator lumcalc(this, Mv, Zv, tv, Xvv);
+    assigner->assign(N);
+    parallel->call(&lumcalc, assigner);
+
+    // accumulate and normalize the luminosities for each wavelength
+    CumulativeCalculator cumcalc(Xvv, Ltotv);
+    assigner->assign(Nell);
+    parallel->call(&cumcalc, assigner);
+    delete assigner;
 }
 
 //////////////////////////////////////////////////////////////////////
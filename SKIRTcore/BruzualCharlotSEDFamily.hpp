@@ -6,9 +6,9 @@
 #ifndef BRUZUALCHARLOTSEDFAMILY_HPP
 #define BRUZUALCHARLOTSEDFAMILY_HPP
 
+#include <vector>
 #include "ArrayTable.hpp"
 class SimulationItem;
-class WavelengthGrid;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -17,32 +17,50 @@ class WavelengthGrid;
     Charlot 2003, RAS 344, 1000-1026). The data was downloaded from
     http://www2.iap.fr/users/charlot/bc2003/. We use the low resolution version of the
     Padova1994/chabrier model, which is one of the two recommended models. The Bruzual & Charlot
-    library data is read from the appropriate resource files in the constructor, and it is
-    subsequently interpolated to the desired parameters and wavelength grid points by calling the
-    luminosities() function as often as needed. */
+    library data is read from the appropriate resource files in the constructor and immediately
+    resampled to the simulation's wavelength grid, so that the luminosities() function, which can
+    be called as often as needed, only has to interpolate between the precomputed library
+    luminosities for the desired parameters. For components consisting of many stellar populations,
+    the cdfs() function calculates the luminosities of all populations in parallel. */
 class BruzualCharlotSEDFamily
 {
 public:
     /** The constructor reads the Bruzual & Charlot library data from the appropriate resource
-        files and stores all relevant information internally. The specified simulation item is used
-        to retrieve the simulation's wavelength grid and log object. */
+        files, resamples each library SED to the simulation's wavelength grid, and stores the
+        resulting luminosities per unit of initial mass internally. The specified simulation item
+        is used to retrieve the simulation's wavelength grid, log object and parallel factory. */
     BruzualCharlotSEDFamily(SimulationItem* item);
 
     /** This function returns the luminosity \f$L_\ell\f$ at each wavelength in the simulation's
         wavelength grid for a stellar population with given initial mass \em M (in \f$M_\odot\f$
         at \f$t=0\f$), metallicity \em Z (as a dimensionless fraction), and age \em t (in years).
         The luminosity is defined as the emissivity multiplied by the width of the wavelength bin.
-        */
+        The function performs a bilinear interpolation in age and metallicity between the library
+        luminosities, which have been resampled to the simulation's wavelength grid by the
+        constructor. */
     Array luminosities(double M, double Z, double t) const;
 
+    /** This function calculates the luminosities for a set of \f$N\f$ stellar populations, with
+        initial masses, metallicities and ages specified by the vectors \em Mv, \em Zv and \em tv
+        (in the same units as for the luminosities() function), and uses them to build the
+        normalized cumulative luminosity distribution over the populations for each wavelength in
+        the simulation's wavelength grid. Upon return, \em Xvv is an \f$N_\lambda\times(N+1)\f$
+        table holding these distributions in the format produced by NR::cdf(), and \em Ltotv
+        holds the total luminosity of all populations at each wavelength. The luminosities are
+        written directly into the target table rather than into a temporary table, and the
+        calculation is parallelized over the populations and then over the wavelengths. */
+    void cdfs(const std::vector<double>& Mv, const std::vector<double>& Zv, const std::vector<double>& tv,
+              ArrayTable<2>& Xvv, Array& Ltotv) const;
+
 private:
-    WavelengthGrid* _lambdagrid;
+    SimulationItem* _item;
 
-    // contents of the library, read by constructor
-    Array _lambdav;
+    // age and metallicity grid of the library, read by constructor
     Array _tv;
     Array _Zv;
-    ArrayTable<3> _jvv;
+
+    // library luminosities per unit of initial mass on the simulation's wavelength grid, indexed on t and Z
+    ArrayTable<3> _Lvv;
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -0,0 +1,148 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstring>
+#include "CheckpointFile.hpp"
+#include "FatalError.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the file header: magic string followed by the format version
+    const char* MAGIC = "SKIRTCKP";
+    const qint64 VERSION = 1;
+
+    // the extension appended to the checkpoint file name to form the temporary file name
+    const char* TEMPEXTENSION = ".tmp";
+}
+
+////////////////////////////////////////////////////////////////////
+
+CheckpointFile::CheckpointFile(QString filepath, bool write)
+    : _filepath(filepath), _write(write), _ok(true)
+{
+    if (_write)
+    {
+        _file.setFileName(_filepath + TEMPEXTENSION);
+        if (!_file.open(QIODevice::WriteOnly))
+            throw FATALERROR("Could not open the checkpoint file " + _file.fileName() + " for writing");
+        writeData(MAGIC, 8);
+        writeInt(VERSION);
+    }
+    else
+    {
+        _file.setFileName(_filepath);
+        if (!_file.open(QIODevice::ReadOnly))
+            throw FATALERROR("Could not open the checkpoint file " + _filepath);
+        char magic[8];
+        readData(magic, 8);
+        if (memcmp(magic, MAGIC, 8))
+            throw FATALERROR("The file " + _filepath + " is not a valid checkpoint file");
+        verifyInt(VERSION, "format version");
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+CheckpointFile::~CheckpointFile()
+{
+    if (_file.isOpen())
+    {
+        _file.close();
+        if (_write) _file.remove();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::commit()
+{
+    _file.close();
+    if (!_ok)
+    {
+        _file.remove();
+        throw FATALERROR("Could not write the checkpoint file " + _file.fileName());
+    }
+    QFile::remove(_filepath);
+    if (!_file.rename(_filepath))
+        throw FATALERROR("Could not rename the checkpoint file " + _file.fileName() + " to " + _filepath);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::writeInt(qint64 value)
+{
+    writeData(&value, sizeof(value));
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::writeDouble(double value)
+{
+    writeData(&value, sizeof(value));
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::writeArray(const Array& values)
+{
+    qint64 n = values.size();
+    writeInt(n);
+    if (n) writeData(begin(values), n*sizeof(double));
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::writeData(const void* data, qint64 size)
+{
+    _ok = _ok && _file.write(static_cast<const char*>(data), size) == size;
+}
+
+////////////////////////////////////////////////////////////////////
+
+qint64 CheckpointFile::readInt()
+{
+    qint64 value;
+    readData(&value, sizeof(value));
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double CheckpointFile::readDouble()
+{
+    double value;
+    readData(&value, sizeof(value));
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::readArray(Array& values)
+{
+    qint64 n = values.size();
+    verifyInt(n, "array size");
+    if (n) readData(begin(values), n*sizeof(double));
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::readData(void* data, qint64 size)
+{
+    if (_file.read(static_cast<char*>(data), size) != size)
+        throw FATALERROR("Unexpected end of the checkpoint file " + _filepath);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void CheckpointFile::verifyInt(qint64 value, QString description)
+{
+    if (readInt() != value)
+        throw FATALERROR("The checkpoint file " + _filepath + " does not match the simulation ("
+                         + description + " differs)");
+}
+
+////////////////////////////////////////////////////////////////////
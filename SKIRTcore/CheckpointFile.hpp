@@ -0,0 +1,85 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef CHECKPOINTFILE_HPP
+#define CHECKPOINTFILE_HPP
+
+#include <QFile>
+#include "Array.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+/** CheckpointFile is a technical class for writing and reading the binary checkpoint files that
+    allow a long simulation to be restarted after an interruption. A checkpoint file consists of
+    the 8 characters "SKIRTCKP" and a 64-bit format version number (currently 1), followed by a
+    sequence of items written by the various simulation items that hold state. There is no
+    per-item metadata other than the sizes of arrays, so the items must be read in exactly the same
+    order as they were written. All numbers are stored in the native byte order of the host.
+
+    To avoid leaving a corrupt checkpoint behind when the program is interrupted while writing,
+    the data is first written to a temporary file, which replaces the actual checkpoint file only
+    when the commit() function is called. */
+class CheckpointFile
+{
+public:
+    /** The constructor opens the checkpoint file with the specified path, for writing if \em write
+        is true and for reading otherwise. When opened for writing, the data is written to a
+        temporary file next to the checkpoint file. When opened for reading, the header is verified.
+        If the file can't be opened, or if the header is invalid, a fatal error is thrown. */
+    CheckpointFile(QString filepath, bool write);
+
+    /** The destructor closes the file. If the file was opened for writing and commit() has not
+        been called, the temporary file is removed. */
+    ~CheckpointFile();
+
+    /** This function closes a file opened for writing, and replaces any existing checkpoint file
+        with the newly written data. If an error occurred while writing, a fatal error is thrown.
+        */
+    void commit();
+
+    /** This function writes the specified integer value. */
+    void writeInt(qint64 value);
+
+    /** This function writes the specified floating point value. */
+    void writeDouble(double value);
+
+    /** This function writes the size of the specified array followed by its values. */
+    void writeArray(const Array& values);
+
+    /** This function writes the specified number of bytes starting at the specified address. It
+        should be used only for plain data structures. */
+    void writeData(const void* data, qint64 size);
+
+    /** This function reads an integer value. */
+    qint64 readInt();
+
+    /** This function reads a floating point value. */
+    double readDouble();
+
+    /** This function reads an array into the specified target array, which must already have the
+        same size as the array that was written. If this is not the case, a fatal error is thrown.
+        */
+    void readArray(Array& values);
+
+    /** This function reads the specified number of bytes into the memory starting at the specified
+        address. */
+    void readData(void* data, qint64 size);
+
+    /** This function reads an integer value and throws a fatal error if it differs from the
+        specified value. It is used to verify that the checkpoint file matches the configuration of
+        the simulation being restarted; \em description is a brief description of the value used in
+        the error message. */
+    void verifyInt(qint64 value, QString description);
+
+private:
+    QString _filepath;  // the path of the checkpoint file
+    QFile _file;        // the file being written (i.e. the temporary file) or read
+    bool _write;        // true if the file is opened for writing
+    bool _ok;           // false if an error occurred while writing
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // CHECKPOINTFILE_HPP
@@ -0,0 +1,223 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstring>
+#include <vector>
+#include <QDateTime>
+#include <QFileInfo>
+#include "ColumnDataFile.hpp"
+#include "FatalError.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the binary file header: magic string followed by version, number of columns, number of records
+    const char* MAGIC = "SKIRTCOL";
+    const qint64 VERSION = 1;
+    const int HEADERSIZE = 8 + 3*sizeof(qint64);
+
+    // the extension appended to the text file name to form the binary file name
+    const char* EXTENSION = ".scol";
+
+    // throws a fatal error if the host does not use little-endian byte order
+    void verifyByteOrder()
+    {
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+        throw FATALERROR("Binary column data files are supported only on little-endian hosts");
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+ColumnDataFile::ColumnDataFile(QString filepath, QString description, bool allowBinary)
+    : _binary(false), _line(0), _values(0), _Ncols(0), _Nrows(0), _row(-1)
+{
+    // use the binary version of the file if it exists and is up to date
+    QFileInfo textinfo(filepath);
+    QFileInfo bininfo(binaryPath(filepath));
+    _binary = allowBinary && bininfo.exists()
+              && (!textinfo.exists() || !(bininfo.lastModified() < textinfo.lastModified()));
+    _filepath = _binary ? binaryPath(filepath) : filepath;
+
+    if (_binary)
+    {
+        verifyByteOrder();
+        _infile.setFileName(_filepath);
+        if (!_infile.open(QIODevice::ReadOnly))
+            throw FATALERROR("Could not open the " + description + " file " + _filepath);
+
+        // map the complete file into memory and verify the header
+        qint64 size = _infile.size();
+        const uchar* data = size >= HEADERSIZE ? _infile.map(0, size) : 0;
+        if (!data || memcmp(data, MAGIC, 8))
+            throw FATALERROR("The " + description + " file " + _filepath + " is not a valid binary column data file");
+        qint64 header[3];
+        memcpy(header, data+8, sizeof(header));
+        if (header[0] != VERSION)
+            throw FATALERROR("The " + description + " file " + _filepath + " has an unsupported format version");
+        _Ncols = header[1];
+        _Nrows = header[2];
+        if (_Ncols < 0 || _Nrows < 0 || size != HEADERSIZE + _Ncols*_Nrows*qint64(sizeof(double)))
+            throw FATALERROR("The " + description + " file " + _filepath + " has an inconsistent size");
+        _values = reinterpret_cast<const double*>(data + HEADERSIZE);
+    }
+    else
+    {
+        _infile.setFileName(_filepath);
+        if (!_infile.open(QIODevice::ReadOnly|QIODevice::Text))
+            throw FATALERROR("Could not open the " + description + " file " + _filepath);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+ColumnDataFile::~ColumnDataFile()
+{
+    _infile.close();  // this also releases the memory map
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString ColumnDataFile::filepath() const
+{
+    return _filepath;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ColumnDataFile::isBinary() const
+{
+    return _binary;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ColumnDataFile::read()
+{
+    if (_binary)
+    {
+        if (_row+1 < _Nrows)
+        {
+            _row++;
+            return true;
+        }
+        _row = _Nrows;
+        return false;
+    }
+    else
+    {
+        // read the next line, splitting it in columns, and skip empty and comment lines
+        while (!_infile.atEnd())
+        {
+            _columns = _infile.readLine().simplified().split(' ');
+            _line++;
+            if (!_columns[0].isEmpty() && !_columns[0].startsWith('#'))
+            {
+                return true;
+            }
+        }
+        _columns.clear();
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+qint64 ColumnDataFile::lineNumber() const
+{
+    if (_binary) return _row >= 0 && _row < _Nrows ? _row+1 : 0;
+    return _columns.isEmpty() ? 0 : _line;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int ColumnDataFile::numValues() const
+{
+    if (_binary) return _row >= 0 && _row < _Nrows ? _Ncols : 0;
+    return _columns.size();
+}
+
+////////////////////////////////////////////////////////////////////
+
+double ColumnDataFile::value(int index, bool* ok) const
+{
+    if (index < 0 || index >= numValues())
+    {
+        if (ok) *ok = false;
+        return 0.;
+    }
+    if (_binary)
+    {
+        if (ok) *ok = true;
+        return _values[index*_Nrows + _row];
+    }
+    return _columns[index].toDouble(ok);
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString ColumnDataFile::binaryPath(QString filepath)
+{
+    return filepath + EXTENSION;
+}
+
+////////////////////////////////////////////////////////////////////
+
+qint64 ColumnDataFile::convert(QString filepath)
+{
+    verifyByteOrder();
+
+    // read the text file into memory, one vector per column; the first record determines the number of columns
+    vector< vector<double> > columns;
+    qint64 Nrows = 0;
+    {
+        ColumnDataFile infile(filepath, "text column data", false);
+        while (infile.read())
+        {
+            int n = infile.numValues();
+            if (!Nrows) columns.resize(n);
+            if (n != static_cast<int>(columns.size()))
+                throw FATALERROR("Line " + QString::number(infile.lineNumber()) + " of text column data file "
+                                 + filepath + " has " + QString::number(n) + " values rather than "
+                                 + QString::number(columns.size()));
+            for (int c = 0; c < n; c++)
+            {
+                bool ok;
+                columns[c].push_back(infile.value(c, &ok));
+                if (!ok)
+                    throw FATALERROR("Line " + QString::number(infile.lineNumber()) + " of text column data file "
+                                     + filepath + " has an invalid value in column " + QString::number(c+1));
+            }
+            Nrows++;
+        }
+    }
+
+    // write the binary file
+    QString binpath = binaryPath(filepath);
+    QFile outfile(binpath);
+    if (!outfile.open(QIODevice::WriteOnly))
+        throw FATALERROR("Could not open the binary column data file " + binpath + " for writing");
+    qint64 header[3] = { VERSION, static_cast<qint64>(columns.size()), Nrows };
+    bool ok = outfile.write(MAGIC, 8) == 8;
+    ok = ok && outfile.write(reinterpret_cast<const char*>(header), sizeof(header)) == sizeof(header);
+    for (const vector<double>& column : columns)
+    {
+        qint64 size = Nrows * sizeof(double);
+        ok = ok && (!size || outfile.write(reinterpret_cast<const char*>(&column[0]), size) == size);
+    }
+    outfile.close();
+    if (!ok)
+    {
+        QFile::remove(binpath);
+        throw FATALERROR("Could not write the binary column data file " + binpath);
+    }
+    return Nrows;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,102 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef COLUMNDATAFILE_HPP
+#define COLUMNDATAFILE_HPP
+
+#include <QFile>
+#include <QList>
+
+////////////////////////////////////////////////////////////////////
+
+/** ColumnDataFile is a technical class for reading a sequence of records, each consisting of a
+    number of floating point values, from a data file. It is used to import particle data such as
+    SPH particles or Voronoi mesh generators. The data can be provided in two formats.
+
+    The text format is a regular text file in which each line represents a record containing
+    whitespace-separated values. Comment lines are ignored, i.e. lines with a crosshatch (#) as the
+    first non-whitespace character, lines containing only whitespace, and empty lines.
+
+    The binary format is intended for large data sets, since parsing a text file with many millions
+    of records takes a substantial amount of time. A binary file has the same name as the
+    corresponding text file with the extension ".scol" appended (for example, "gas.dat.scol"), and
+    it consists of a 32-byte header followed by the data in column-major order. The header holds
+    the 8 characters "SKIRTCOL" followed by three 64-bit integers: the format version (currently
+    1), the number of columns \f$N_c\f$ and the number of records \f$N_r\f$. The header is followed
+    by \f$N_c\f$ contiguous arrays of \f$N_r\f$ double-precision floating point values, one array
+    for each column. All numbers are stored in little-endian byte order. A binary file is mapped
+    into memory rather than read, so that the values can be accessed without any copying.
+
+    The constructor automatically opens the binary version of a data file if it exists and if it is
+    not older than the text version (or if the text version does not exist). A binary file can be
+    produced from a text file with the convert() function; all records in the text file must have
+    the same number of values. */
+class ColumnDataFile
+{
+public:
+    /** The constructor opens the data file with the specified path, or its binary version as
+        described in the class header, and prepares it for reading. If \em allowBinary is false,
+        the text file is always used. If the file can't be opened, or if the binary file is
+        invalid, a fatal error is thrown; \em description is a brief description of the file
+        contents used in the error message. */
+    ColumnDataFile(QString filepath, QString description, bool allowBinary = true);
+
+    /** The destructor closes the data file, releasing the memory map if applicable. */
+    ~ColumnDataFile();
+
+    /** This function returns the path of the file that was actually opened, i.e. the binary file
+        if it is used, or the text file otherwise. */
+    QString filepath() const;
+
+    /** This function returns true if the binary version of the data file is being used. */
+    bool isBinary() const;
+
+    /** This function reads the next record from the file, and holds its values ready for
+        inspection through the value() function. The function returns true if a record was
+        successfully read, or false if the end of the file was reached. */
+    bool read();
+
+    /** This function returns the one-based line number of the current record in the text file,
+        or the one-based record index for a binary file. If there is no current record, the
+        function returns zero. */
+    qint64 lineNumber() const;
+
+    /** This function returns the number of values in the current record, or zero if there is no
+        current record. For a binary file, this is the number of columns in the file. */
+    int numValues() const;
+
+    /** This function returns the value with the specified zero-based index in the current record.
+        Missing values (including the case where there is no current record) and values that can't
+        be converted to a floating point number are returned as zero. If the optional \em ok
+        argument is provided, it is set to false in those cases, and to true otherwise. */
+    double value(int index, bool* ok = 0) const;
+
+    /** This function returns the path of the binary version of the data file with the specified
+        path, as described in the class header. */
+    static QString binaryPath(QString filepath);
+
+    /** This function converts the text data file with the specified path to the binary format
+        described in the class header, and stores the result next to the text file. It returns the
+        number of records written. If the text file can't be read, if a record has a different
+        number of values than the first record or contains a value that can't be converted to a
+        floating point number, or if the binary file can't be written, a fatal error is thrown
+        that mentions the file and, if applicable, the line number. */
+    static qint64 convert(QString filepath);
+
+private:
+    QString _filepath;           // the path of the file that was actually opened
+    QFile _infile;               // the input file
+    bool _binary;                // true if the binary version of the file is used
+    QList<QByteArray> _columns;  // text: the columns of the current record, or empty if there is no current record
+    qint64 _line;                // text: the number of lines read so far, i.e. the line number of the current record
+    const double* _values;       // binary: pointer to the first value of the first column in the memory map
+    int _Ncols;                  // binary: the number of columns
+    qint64 _Nrows;               // binary: the number of records
+    qint64 _row;                 // binary: the index of the current record, or -1 if there is no current record
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // COLUMNDATAFILE_HPP
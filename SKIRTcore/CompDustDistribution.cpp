@@ -112,8 +112,7 @@ const
 
 Position CompDustDistribution::generatePosition() const
 {
-    Random* random = find<Random>();
-    int h = NR::locate_clip(_cumrhov, random->uniform());
+    int h = NR::locate_clip(_cumrhov, _random->uniform());
     return _dcv[h]->geometry()->generatePosition();
 }
 
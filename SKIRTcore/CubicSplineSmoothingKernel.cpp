@@ -53,7 +53,7 @@ double CubicSplineSmoothingKernel::density(double u) const
 
 double CubicSplineSmoothingKernel::generateRadius() const
 {
-    double X = find<Random>()->uniform();
+    double X = _random->uniform();
     int k = NR::locate_clip(_Xv,X);
     double p = (X-_Xv[k])/(_Xv[k+1]-_Xv[k]);
     double u = (k+p)/_Nu;
@@ -58,9 +58,12 @@ std::vector<int> Dim1DustLib::mapping() const
     double Umin = DBL_MAX;
     double Umax = 0.0;
     vector<double> Ucellv(Ncells);
+    ArrayTable<2> wvv(1,0);
+    wvv[0] = lambdagrid->dlambdav();
+    Table<2> Jtotvv = ds->meanintensityintegrals(wvv);
     for (int m=0; m<Ncells; m++)
     {
-        double Jtot = ( ds->meanintensityv(m) * lambdagrid->dlambdav() ).sum();
+        double Jtot = Jtotvv(m,0);
         double U = Jtot/JtotMW;
         // ignore cells with extremely small radiation fields (compared to the average in the Milky Way)
         // to avoid wasting library grid points on fields that won't change simulation results anyway
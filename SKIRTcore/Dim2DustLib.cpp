@@ -3,12 +3,16 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <algorithm>
 #include <cfloat>
 #include "Dim2DustLib.hpp"
 #include "DustMix.hpp"
 #include "FatalError.hpp"
+#include "IdenticalAssigner.hpp"
 #include "Log.hpp"
 #include "PanDustSystem.hpp"
+#include "ParallelChunkTarget.hpp"
+#include "ParallelFactory.hpp"
 #include "Units.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -17,7 +21,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 Dim2DustLib::Dim2DustLib()
-    : _NT(0), _NW(0)
+    : _NT(0), _NW(0), _cellassigner(0)
 {
 }
 
@@ -28,6 +32,9 @@ void Dim2DustLib::setupSelfBefore()
     DustLib::setupSelfBefore();
 
     if (_NT < 3 || _NW < 3) throw FATALERROR("there must be at least 3 library grid points in each dimension");
+
+    // every process calculates the mapping for all cells
+    _cellassigner = new IdenticalAssigner(this);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -67,6 +74,82 @@ int Dim2DustLib::entries() const
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // helper class to calculate the mean temperature and mean wavelength of the ISRF for consecutive chunks
+    // of cells, and to determine the minimum and maximum values of these quantities within each chunk
+    class StatisticsCalculator : public ParallelChunkTarget
+    {
+    private:
+        const PanDustSystem* _ds;
+        const Table<2>& _sumvv;     // the integrals over the mean intensity for each cell and dust component
+        int _Ncomp;
+
+    public:
+        // results for each cell
+        Array& _Tmeanv;
+        Array& _lambdameanv;
+
+        // results for each chunk
+        vector<double> _Tminv, _Tmaxv, _lambdaminv, _lambdamaxv;
+
+        StatisticsCalculator(const PanDustSystem* ds, const Table<2>& sumvv, Array& Tmeanv, Array& lambdameanv)
+            : ParallelChunkTarget(ds->Ncells()), _ds(ds), _sumvv(sumvv), _Ncomp(ds->Ncomp()),
+              _Tmeanv(Tmeanv), _lambdameanv(lambdameanv)
+        {
+            int Nchunks = chunks();
+            _Tminv.assign(Nchunks, DBL_MAX);
+            _Tmaxv.assign(Nchunks, 0.0);
+            _lambdaminv.assign(Nchunks, DBL_MAX);
+            _lambdamaxv.assign(Nchunks, 0.0);
+        }
+
+    protected:
+        void chunkbody(size_t chunk, size_t begin, size_t end)
+        {
+            double Tmin = DBL_MAX;
+            double Tmax = 0.0;
+            double lambdamin = DBL_MAX;
+            double lambdamax = 0.0;
+
+            for (size_t m=begin; m<end; m++)
+            {
+                if (_ds->Labs(m) > 0.0)
+                {
+                    double Tmean = 0.;
+                    double lambdamean = 0.;
+                    double sumrho = 0.;
+                    for (int h=0; h<_Ncomp; h++)
+                    {
+                        double sum0 = _sumvv(m,2*h);
+                        double sum1 = _sumvv(m,2*h+1);
+                        double rho = _ds->density(m,h);
+                        Tmean += rho * _ds->mix(h)->invplanckabs(sum0);
+                        lambdamean += rho * (sum1/sum0);
+                        sumrho += rho;
+                    }
+                    Tmean /= sumrho;
+                    lambdamean /= sumrho;
+                    _Tmeanv[m] = Tmean;
+                    _lambdameanv[m] = lambdamean;
+
+                    Tmin = min(Tmin,Tmean);
+                    Tmax = max(Tmax,Tmean);
+                    lambdamin = min(lambdamin,lambdamean);
+                    lambdamax = max(lambdamax,lambdamean);
+                }
+            }
+
+            _Tminv[chunk] = Tmin;
+            _Tmaxv[chunk] = Tmax;
+            _lambdaminv[chunk] = lambdamin;
+            _lambdamaxv[chunk] = lambdamax;
+        }
+    };
+}
+
+////////////////////////////////////////////////////////////////////
+
 std::vector<int> Dim2DustLib::mapping() const
 {
     // get basic information about the wavelength grid and the dust system
@@ -80,44 +163,31 @@ std::vector<int> Dim2DustLib::mapping() const
 
     // calculate the properties of the ISRF in all cells of the dust system;
     // determine the minimum and maximum values of the mean temperature and mean wavelength
-    double Tmin = DBL_MAX;
-    double Tmax = 0.0;
-    double lambdamin = DBL_MAX;
-    double lambdamax = 0.0;
     Array Tmeanv(Ncells);
     Array lambdameanv(Ncells);
-    for (int m=0; m<Ncells; m++)
+
+    // the integrals over the mean intensity needed for each dust component
+    ArrayTable<2> wvv(2*Ncomp,Nlambda);
+    for (int h=0; h<Ncomp; h++)
     {
-        if (ds->Labs(m) > 0.0)
+        for (int ell=0; ell<Nlambda; ell++)
         {
-            const Array& Jv = ds->meanintensityv(m);
-            double sumrho = 0.;
-            for (int h=0; h<Ncomp; h++)
-            {
-                double sum0 = 0.0;
-                double sum1 = 0.0;
-                for (int ell=0; ell<Nlambda; ell++)
-                {
-                    double lambda = lambdagrid->lambda(ell);
-                    double dlambda = lambdagrid->dlambda(ell);
-                    double sigmaJ = ds->mix(h)->sigmaabs(ell) * Jv[ell];
-                    sum0 += sigmaJ * dlambda;
-                    sum1 += sigmaJ * lambda * dlambda;
-                }
-                double rho = ds->density(m,h);
-                Tmeanv[m] += rho * ds->mix(h)->invplanckabs(sum0);
-                lambdameanv[m] += rho * (sum1/sum0);
-                sumrho += rho;
-            }
-            Tmeanv[m] /= sumrho;
-            lambdameanv[m] /= sumrho;
-
-            Tmin = min(Tmin,Tmeanv[m]);
-            Tmax = max(Tmax,Tmeanv[m]);
-            lambdamin = min(lambdamin,lambdameanv[m]);
-            lambdamax = max(lambdamax,lambdameanv[m]);
+            double lambda = lambdagrid->lambda(ell);
+            double dlambda = lambdagrid->dlambda(ell);
+            double sigma = ds->mix(h)->sigmaabs(ell);
+            wvv[2*h][ell] = sigma * dlambda;
+            wvv[2*h+1][ell] = sigma * lambda * dlambda;
         }
     }
+    Table<2> sumvv = ds->meanintensityintegrals(wvv);
+
+    StatisticsCalculator calc(ds, sumvv, Tmeanv, lambdameanv);
+    calc.call(find<ParallelFactory>()->parallel(), _cellassigner);
+
+    double Tmin = *min_element(calc._Tminv.begin(), calc._Tminv.end());
+    double Tmax = *max_element(calc._Tmaxv.begin(), calc._Tmaxv.end());
+    double lambdamin = *min_element(calc._lambdaminv.begin(), calc._lambdaminv.end());
+    double lambdamax = *max_element(calc._lambdamaxv.begin(), calc._lambdamaxv.end());
     log->info("Temperatures vary"
               " from T = " + QString::number(units->otemperature(Tmin)) + " " + units->utemperature() +
               " to T = " + QString::number(units->otemperature(Tmax)) + " " + units->utemperature() + ".");
@@ -7,6 +7,7 @@
 #define DIM2DUSTLIB_HPP
 
 #include "DustLib.hpp"
+class IdenticalAssigner;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -93,7 +94,9 @@ protected:
         {\bar{\lambda}}_{\text{min}} \left( \frac{ {\bar{\lambda}}_{\text{max}} }{
         {\bar{\lambda}}_{\text{min}} } \right)^{j/N_{\bar{\lambda}}} \qquad
         j=0,\ldots,N_{\bar{\lambda}}. \f] The function then calculates for each cell \f$m\f$ its
-        library entry \f$n \equiv (i,j)\f$. */
+        library entry \f$n \equiv (i,j)\f$. The mean temperature and mean wavelength of the cells,
+        and their extremal values, are calculated in parallel execution threads for consecutive
+        chunks of cells; the extremal values for the chunks are combined afterwards. */
     std::vector<int> mapping() const;
 
     //======================== Data Members ========================
@@ -102,6 +105,9 @@ private:
     // discoverable properties
     int _NT;        // number of mean temperature grid points
     int _NW;        // number of mean wavelength grid points
+
+    // other data members
+    IdenticalAssigner* _cellassigner;   // assigns chunks of cells to all processes for calculating the mapping
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -4,17 +4,28 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "DustDistribution.hpp"
+#include "Random.hpp"
 
 using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
 DustDistribution::DustDistribution()
+    : _random(0)
 {
 }
 
 //////////////////////////////////////////////////////////////////////
 
+void DustDistribution::setupSelfBefore()
+{
+    SimulationItem::setupSelfBefore();
+
+    _random = find<Random>();
+}
+
+//////////////////////////////////////////////////////////////////////
+
 int DustDistribution::indexformix(const DustMix* dustmix)
 {
     int n = Ncomp();
@@ -10,6 +10,7 @@
 #include "SimulationItem.hpp"
 
 class DustMix;
+class Random;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -29,6 +30,10 @@ protected:
     /** The default constructor; it is protected since this is an abstract class. */
     DustDistribution();
 
+    /** This function caches a pointer to the simulation's random number generator, as a service
+        to subclasses. */
+    void setupSelfBefore();
+
     //======================== Other Functions =======================
 
 public:
@@ -97,6 +102,11 @@ public:
     /** This pure virtual function returns the Z-axis surface density of the dust distribution. */
     virtual double SigmaZ() const = 0;
 
+    //======================== Data Members ========================
+
+protected:
+    // data member initialized in this class, as a service to subclasses
+    Random* _random;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -104,6 +104,13 @@ int DustGridStructure::Ncells() const
 
 //////////////////////////////////////////////////////////////////////
 
+bool DustGridStructure::dependsOnDistribution() const
+{
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double DustGridStructure::weight(int m) const
 {
     if (m==-1)
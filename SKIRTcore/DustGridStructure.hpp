@@ -85,6 +85,13 @@ public:
         structure in the \f$z\f$ direction. */
     virtual double zmax() const = 0;
 
+    /** This virtual function returns true if the structure of the grid depends on the dust
+        distribution in the simulation, i.e. if the grid must be rebuilt when the dust distribution
+        changes, and false otherwise. The default implementation returns false, which is
+        appropriate for grids that are fully specified by their own properties. The function is
+        overridden by subclasses that sample the dust distribution while building the grid. */
+    virtual bool dependsOnDistribution() const;
+
     /** This virtual function returns the weight corresponding to the cell with cell number
         \f$m\f$. It is defaulted to return the value 1 for all cells, which is appropriate for
         virtually all dust grid structures. However, this function can (and will) be overwritten by
@@ -3,6 +3,9 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <QMultiHash>
 #include <QTime>
 #include "DustLib.hpp"
@@ -22,7 +25,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 DustLib::DustLib()
-    : _assigner(0)
+    : _assigner(0), _isrfTolerance(0)
 {
 }
 
@@ -54,6 +57,20 @@ ProcessAssigner* DustLib::assigner() const
 
 ////////////////////////////////////////////////////////////////////
 
+void DustLib::setIsrfTolerance(double value)
+{
+    _isrfTolerance = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double DustLib::isrfTolerance() const
+{
+    return _isrfTolerance;
+}
+
+////////////////////////////////////////////////////////////////////
+
 namespace
 {
     class EmissionCalculator : public ParallelTarget
@@ -61,6 +78,10 @@ namespace
     private:
         // data members initialized in constructor
         ArrayTable<2>& _Lvv;        // output luminosities indexed on m or n and ell (writable reference)
+        ArrayTable<2>& _Jlastvv;    // ISRF of the last luminosity calculation, indexed on n (writable reference)
+        const vector<char>& _reusablev; // for each library entry, true if the luminosities may be reused; or empty
+        double _tolerance;          // the relative change in the ISRF below which the luminosities are reused
+        std::atomic<int> _Nreused;  // the number of library entries for which the luminosities were reused
         QMultiHash<int,int> _mh;    // hash map <n,m> of cells for each library entry
         Log* _log;
         PanDustSystem* _ds;
@@ -68,12 +89,15 @@ namespace
         WavelengthGrid* _lambdagrid;
         int _Nlambda;
         int _Ncomp;
+        ArrayTable<2> _Jgatheredvv; // average ISRF for each library entry (only if absorption tables are distributed)
         QTime _timer;           // measures the time elapsed since the most recent log message
 
     public:
         // constructor
-        EmissionCalculator(ArrayTable<2>& Lvv, vector<int>& nv, int Nlib, SimulationItem* item)
-            : _Lvv(Lvv)
+        EmissionCalculator(ArrayTable<2>& Lvv, ArrayTable<2>& Jlastvv, const vector<char>& reusablev,
+                           double tolerance, vector<int>& nv, int Nlib, ProcessAssigner* assigner,
+                           SimulationItem* item)
+            : _Lvv(Lvv), _Jlastvv(Jlastvv), _reusablev(reusablev), _tolerance(tolerance), _Nreused(0)
         {
             // get basic information about the wavelength grid and the dust system
             _log = item->find<Log>();
@@ -95,13 +119,49 @@ namespace
 
             // resize result vectors appropriately (for every cell or for every library entry)
             // If there are multiple dust components, the _Lvv vector is indexed on m (the dust cells)
+            // If the luminosities of the previous calculation may be reused, only clear the rows for
+            // dust cells that no longer map to a library entry
             int Nout = _Ncomp>1 ? Ncells : Nlib;
-            _Lvv.resize(Nout,_Nlambda);  // also sets all values to zero
+            if (_reusablev.empty())
+            {
+                _Lvv.resize(Nout,_Nlambda);  // also sets all values to zero
+            }
+            else if (_Ncomp > 1)
+            {
+                for (int m=0; m<Ncells; m++) if (nv[m] < 0) _Lvv[m] = 0.;
+            }
+
+            // if the luminosities may be reused in the future, prepare to remember the ISRF for each library entry
+            if (_tolerance > 0 && _Jlastvv.size(0) != static_cast<size_t>(Nlib)) _Jlastvv.resize(Nlib,0);
+
+            // if each process holds the absorbed luminosities for only part of the wavelengths,
+            // gather the average ISRF for the library entries assigned to this process in advance
+            if (_ds->distributed()) _Jgatheredvv = _ds->meanintensities(nv, Nlib, assigner);
 
             // start the logging timer
             _timer.start();
         }
 
+        // returns the number of library entries for which the luminosities were reused
+        int reused() const
+        {
+            return _Nreused;
+        }
+
+        // returns true if the specified ISRF differs from the last one by no more than the tolerance
+        bool unchanged(const Array& Jv, const Array& Jlastv) const
+        {
+            if (Jlastv.size() != Jv.size()) return false;
+            double diff = 0.;
+            double prev = 0.;
+            for (size_t ell=0; ell<Jv.size(); ell++)
+            {
+                diff += fabs(Jv[ell]-Jlastv[ell]);
+                prev += Jlastv[ell];
+            }
+            return diff <= _tolerance*prev;
+        }
+
         // the parallized loop body; calculates the emission for a single library entry
         void body(size_t n)
         {
@@ -109,6 +169,13 @@ namespace
             QList<int> mv = _mh.values(n);
             int Nmapped = mv.size();
 
+            // if this library entry is no longer used, clear the results of any previous calculation
+            if (Nmapped == 0 && _tolerance > 0)
+            {
+                _Jlastvv[n].resize(0);
+                if (_Ncomp == 1) _Lvv[n] = 0.;
+            }
+
             // if this library entry is used by at least one cell, calculate the emission for those cells
             if (Nmapped > 0)
             {
@@ -125,8 +192,31 @@ namespace
 
                 // calculate the average ISRF for this library entry from the ISRF of all dust cells that map to it
                 Array Jv(_Nlambda);
-                foreach (int m, mv) Jv += _ds->meanintensityv(m);
-                Jv /= Nmapped;
+                if (_ds->distributed())
+                {
+                    Jv = _Jgatheredvv[n];
+                }
+                else
+                {
+                    Array Jmv(_Nlambda);
+                    foreach (int m, mv)
+                    {
+                        _ds->meanintensityv(m, Jmv);
+                        Jv += Jmv;
+                    }
+                    Jv /= Nmapped;
+                }
+
+                // if the ISRF has hardly changed since the luminosities were last calculated, keep those
+                if (_tolerance > 0)
+                {
+                    if (!_reusablev.empty() && _reusablev[n] && unchanged(Jv, _Jlastvv[n]))
+                    {
+                        _Nreused++;
+                        return;
+                    }
+                    _Jlastvv[n] = Jv;
+                }
 
                 // multiple dust components: calculate emission for each dust cell separately
                 if (_Ncomp > 1)
@@ -140,6 +230,7 @@ namespace
                     {
                         // get a reference to the output array for this dust cell
                         Array& Lv = _Lvv[m];
+                        Lv = 0.;
 
                         // calculate the emission for this cell
                         for (int h=0; h<_Ncomp; h++) Lv += evv[h] * _ds->density(m,h);
@@ -176,15 +267,38 @@ void DustLib::calculate()
 {
     // get mapping from cells to library entries
     int Nlib = entries();
-    _nv = mapping();
+    vector<int> nv = mapping();
+
+    // determine the library entries for which the luminosities of the previous calculation may be reused;
+    // with multiple dust components, this requires that the set of cells mapping to the entry is unchanged
+    vector<char> reusablev;
+    if (_isrfTolerance > 0 && _nv.size() == nv.size() && _Jlastvv.size(0) == static_cast<size_t>(Nlib))
+    {
+        reusablev.assign(Nlib, 1);
+        if (find<PanDustSystem>()->Ncomp() > 1)
+        {
+            for (size_t m=0; m<nv.size(); m++)
+            {
+                if (nv[m] != _nv[m])
+                {
+                    if (nv[m] >= 0) reusablev[nv[m]] = 0;
+                    if (_nv[m] >= 0) reusablev[_nv[m]] = 0;
+                }
+            }
+        }
+    }
+    _nv.swap(nv);
 
     // assign each process to a set of library entries
     _assigner->assign(Nlib);
 
     // calculate the emissivity for each library entry assigned to this process
-    EmissionCalculator calc(_Lvv, _nv, Nlib, this);
+    EmissionCalculator calc(_Lvv, _Jlastvv, reusablev, _isrfTolerance, _nv, Nlib, _assigner, this);
     Parallel* parallel = find<ParallelFactory>()->parallel();
     parallel->call(&calc, _assigner);
+    if (_isrfTolerance > 0)
+        find<Log>()->info("Reused the emission spectra for " + QString::number(calc.reused()) +
+                          " library entries with a nearly unchanged radiation field.");
 
     // Wait for the other processes to reach this point
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
@@ -216,31 +330,75 @@ void DustLib::assemble()
 {
     // Get a pointer to the PeerToPeerCommunicator of this simulation
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+    int Nprocs = comm->size();
+    int myrank = comm->rank();
+
+    // determine the rank of the process that calculated each row of _Lvv (or -1 for rows that remain zero)
+    size_t Ncells = _nv.size();
+    size_t Nrows = _Lvv.size(0);
+    size_t Nlambda = _Lvv.size(1);
+    vector<int> rankv(Nrows);
+    if (Nrows == Ncells)    // _Lvv is indexed on m, the index of the dust cells
+    {
+        for (size_t m = 0; m < Ncells; m++) rankv[m] = _nv[m] >= 0 ? _assigner->rankForIndex(_nv[m]) : -1;
+    }
+    else    // _Lvv is indexed on n, the library entry index
+    {
+        for (size_t n = 0; n < Nrows; n++) rankv[n] = _assigner->rankForIndex(n);
+    }
+
+    // determine the number of rows exchanged in a single collective operation
+    const size_t MAXVALUES = 1 << 24;
+    size_t Nbatch = max(static_cast<size_t>(1), MAXVALUES / max(Nlambda, static_cast<size_t>(1)));
+    size_t Ncoll = (Nrows + Nbatch - 1) / Nbatch;
 
     Log* log = find<Log>();
-    TimeLogger logger(log->verbose() && comm->isMultiProc() ? log : 0, "communication of the dust emission spectra");
+    TimeLogger logger(log->verbose() && comm->isMultiProc() ? log : 0, "communication of the dust emission spectra"
+                      " (" + QString::number(Nrows) + " spectra in " + QString::number(Ncoll) + " collective operations)");
 
-    size_t Ncells = _nv.size();
-    if (_Lvv.size(0) == Ncells)     // _Lvv is indexed on m, the index of the dust cells
+    Array sendarr, recvarr;
+    vector<int> recvcounts(Nprocs);
+    vector<size_t> offsetv(Nprocs);
+    for (size_t first = 0; first < Nrows; first += Nbatch)
     {
-        for (size_t m = 0; m < Ncells; m++) // for each dust cell
-        {
-            size_t n = _nv[m];                      // get the library index for this dust cell ..
-            int rank = _assigner->rankForIndex(n);    // .. to determine which process calculated the emission SED
+        size_t last = min(Nrows, first + Nbatch);
+
+        // count the number of values calculated by each process in this batch
+        fill(recvcounts.begin(), recvcounts.end(), 0);
+        for (size_t i = first; i < last; i++) if (rankv[i] >= 0) recvcounts[rankv[i]] += Nlambda;
 
-            // finally, broadcast the emission SED from that process to all the other processes
-            comm->broadcast(_Lvv[m],rank);
+        // pack the rows calculated by this process contiguously
+        sendarr.resize(recvcounts[myrank]);
+        double* dest = begin(sendarr);
+        for (size_t i = first; i < last; i++)
+        {
+            if (rankv[i] == myrank)
+            {
+                const Array& Lv = _Lvv[i];
+                dest = copy(begin(Lv), begin(Lv)+Nlambda, dest);
+            }
         }
 
-    }
-    else    // _Lvv is indexed on n, the library entry index
-    {
-        for (size_t n = 0; n < _Lvv.size(0); n++)   // for each library entry
+        // gather the rows from all processes
+        size_t Nrecv = 0;
+        for (int r = 0; r < Nprocs; r++)
         {
-            int rank = _assigner->rankForIndex(n);    // determine which process calculated the emission SED of this entry
+            offsetv[r] = Nrecv;
+            Nrecv += recvcounts[r];
+        }
+        recvarr.resize(Nrecv);
+        comm->allgatherv(sendarr, recvarr, recvcounts);
 
-            // broadcast the emission SED from that process to all the other processes
-            comm->broadcast(_Lvv[n],rank);
+        // unpack the rows in the order in which they were packed by each process
+        for (size_t i = first; i < last; i++)
+        {
+            int r = rankv[i];
+            if (r >= 0)
+            {
+                const double* src = begin(recvarr) + offsetv[r];
+                copy(src, src+Nlambda, begin(_Lvv[i]));
+                offsetv[r] += Nlambda;
+            }
         }
     }
 }
@@ -34,10 +34,18 @@ class DustLib : public SimulationItem
     Q_CLASSINFO("Optional", "true")
     Q_CLASSINFO("Silent", "true")
 
+    Q_CLASSINFO("Property", "isrfTolerance")
+    Q_CLASSINFO("Title", "the relative change in the radiation field below which library entries are not recalculated")
+    Q_CLASSINFO("MinValue", "0")
+    Q_CLASSINFO("MaxValue", "1")
+    Q_CLASSINFO("Default", "0")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 protected:
-    /** Default constructor. */
+    /** The default constructor sets the tolerance on the change in the radiation field to zero, so
+        that all library entries are recalculated each time (see setIsrfTolerance()). */
     DustLib();
 
     /** This function creates a default assigner if no assigner has been set during construction
@@ -61,6 +69,24 @@ public:
     /** Returns the process assigner for this dust library. */
     Q_INVOKABLE ProcessAssigner* assigner() const;
 
+    /** This function sets the tolerance on the relative change in the mean radiation field of a
+        library entry below which the emission spectra calculated for that entry by a previous call
+        to calculate() are reused rather than recalculated. The relative change is measured as
+        \f$\sum_\ell |J_\ell-J_\ell^{\text{prev}}| / \sum_\ell J_\ell^{\text{prev}}\f$, where
+        \f$J_\ell^{\text{prev}}\f$ is the radiation field for which the spectra were last
+        calculated. In the later cycles of the dust self-absorption phase, the radiation field in
+        most dust cells hardly changes, so that reusing the spectra avoids most of the (possibly
+        very expensive) emissivity calculations. If there are multiple dust components, the
+        spectra are reused only if, in addition, the set of dust cells mapping to the library entry
+        has not changed. The default value of zero disables this mechanism, so that all library
+        entries are recalculated each time. A nonzero value requires storing the radiation field
+        for each library entry handled by this process. */
+    Q_INVOKABLE void setIsrfTolerance(double value);
+
+    /** Returns the tolerance on the relative change in the mean radiation field of a library entry
+        below which its emission spectra are reused. */
+    Q_INVOKABLE double isrfTolerance() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -77,7 +103,9 @@ public:
         parallelization here is obviously the calculation of the %SED for one particular library entry.
         The calculation itself is implemented in a helper class, called EmissionCalculator. For a
         particular library entry, the EmissionCalculator object first determines the mean %ISRF by
-        averaging the ISRFs of all the dust cells that map onto it. Then, it calls on the
+        averaging the ISRFs of all the dust cells that map onto it (if the dust system distributes its
+        absorption tables over the processes, these averages are obtained in advance for all library
+        entries assigned to this process through PanDustSystem::meanintensities()). Then, it calls on the
         DustEmissivity object held by the dust system to actually calculate the emissivities
         corresponding to the library entry. If the dust system contains multiple dust components
         \f$h\f$, each with its own dust mix, the emissivity \f$\varepsilon_{n,h,\ell}\f$ is calculated
@@ -102,7 +130,10 @@ public:
         communication between the processes is required. Another ProcessAssigner can be chosen which
         assigns each process to the same library entries, avoiding the need for communication
         afterwards. Whether or not the assemble function has to be called is determined by the parallel
-        function of the ProcessAssigner. */
+        function of the ProcessAssigner. If a nonzero tolerance has been configured with
+        setIsrfTolerance(), the spectra calculated by the previous invocation of this function are
+        reused for library entries with a nearly unchanged radiation field, and the number of
+        reused entries is logged. */
     void calculate();
 
     /** This function returns the luminosity fraction \f$L_\ell\f$ at the wavelength index
@@ -118,17 +149,17 @@ private:
         only the emission luminosities for a particular set of library entries or dust cells (depending
         on which DustLib subclass is used and whether or not multiple dust components are present). In
         order to perform the simulation of thermal photon packages, each process needs the emission %SED
-        for all dust cells (or all library entries). This function uses the PeerToPeerCommunicator to
-        broadcast the SEDs of the dust cells (or library entries) assigned to a particular process to
-        all other processes and storing them in the appropriate place in the list. This is implemented
-        as a loop over all dust cells (or all library entries), where for each dust cell (library
-        entry) the ProcessAssigner is called to determine which process was assigned to it. Next, the
-        broadcast function of the PeerToPeerCommunicator class is called, passing the %SED of that dust
-        cell (library entry) and rank of that process as arguments. Only for that process, the %SED
-        contains actual luminosities, whereas for the other processes the %SED is zero. When the
-        broadcast function returns, the luminosities from the former process have been copied in the
-        memory of the other processes. When this is done for each dust cell (library entry), the
-        assembly is complete. */
+        for all dust cells (or all library entries). Since every process knows the mapping from dust
+        cells to library entries and the ProcessAssigner, each process can determine which process
+        calculated the %SED of any dust cell (library entry) without communication. The SEDs are
+        exchanged in batches of consecutive dust cells (library entries). For each batch, every
+        process packs the SEDs it calculated contiguously into a buffer, and a single call to the
+        allgatherv function of the PeerToPeerCommunicator class distributes the concatenated
+        buffers to all processes. The SEDs are then unpacked into the appropriate place in the list.
+        Dust cells that do not map to any library entry have a zero %SED and are not communicated.
+        The batch size limits the memory used for the temporary buffers and keeps the number of
+        values in a single collective operation within the range of an integer, while the number of
+        collective operations remains small. */
     void assemble();
 
 protected:
@@ -148,7 +179,13 @@ private:
     // results of calculate(), used by luminosity()
     std::vector<int> _nv;        // library index for each cell or -1, indexed on m
     ArrayTable<2> _Lvv;          // luminosities indexed on m or n and ell
+    ArrayTable<2> _Jlastvv;      // radiation field for which the luminosities were last calculated, indexed on n
+                                 // and ell; the next calculation compares against it using the isrfTolerance
+                                 // (only if the tolerance is nonzero and only for entries handled by this process)
+
+    // discoverable attributes
     ProcessAssigner* _assigner;  // the process assigner; determines which library entries are assigned to this process
+    double _isrfTolerance;       // the relative change in the radiation field below which entries are reused
 };
 
 ////////////////////////////////////////////////////////////////////
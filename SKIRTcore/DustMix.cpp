@@ -807,41 +807,22 @@ double DustMix::hydrogenscatterangle(double x, double a)
 
 Vec DustMix::scatteringatomdirection(double length, Direction vector)
 {
+    // construct two unit vectors perpendicular to the incoming direction and to each other
+    double kx, ky, kz;
+    vector.cartesian(kx,ky,kz);
+    Vec e1 = fabs(kz) < 0.9 ? Vec(-ky, kx, 0.) : Vec(0., -kz, ky);
+    e1 /= e1.norm();
+    Vec e2 = Vec::cross(vector, e1);
 
-    double A,B,C;
-    vector.cartesian(A,B,C);
-    double length1, length2, length3;
-    Direction vec1,vec2,vec3;
-    double result_x, result_y, result_z;
-    vec1 = Direction(A,B,C);
-
-    if(C!=0.0){
-       vec2 = Direction(0.0,1.0,-B/C);
-       vec3 = Direction( (((-B*B)/C)-C) , ((A*B)/C) , A);
-    }
-    else if(A!=0.0){
-        vec2 = Direction(0.0,0.0,1.0);
-        vec3 = Direction(B, -A  ,    0.0    );
-    }
-    else{
-        vec2 = Direction(1.0,0.0, 0.0);
-        vec3 = Direction( 0.0 , 0.0 , 1.0 );
-    }
-
-    length1 = length * (1.0/sqrt(vec1.kx() * vec1.kx() + vec1.ky() * vec1.ky() + vec1.kz() * vec1.kz() ));
-    double R1 = _random->uniform();
-    double R2 = _random->uniform();
-    length2 = sqrt(   ( -log10(R1)/log10(exp(1.0)) )   )*cos(2*M_PI*R2);
-    length3 = sqrt(   ( -log10(R1)/log10(exp(1.0)) )   )*sin(2*M_PI*R2);
-
-    result_x = length1 * vec1.kx() + length2 * vec2.kx() + length3 * vec3.kx();
-    result_y = length1 * vec1.ky() + length2 * vec2.ky() + length3 * vec3.ky();
-    result_z = length1 * vec1.kz() + length2 * vec2.kz() + length3 * vec3.kz();
-
-    return Vec(result_x,result_y, result_z);
-
+    // draw both perpendicular velocity components from the Gaussian distribution exp(-u^2)
+    // with the Box-Muller method, using a single logarithm for the pair
+    double r = sqrt(-log(_random->uniform()));
+    double phi = 2.0*M_PI*_random->uniform();
+    return length*vector + (r*cos(phi))*e1 + (r*sin(phi))*e2;
 }
 
+////////////////////////////////////////////////////////////////////////
+
 Direction DustMix::scatterDirection (double theta, double phi, Direction in)
 {
     double cosphi = cos(phi);
@@ -366,7 +366,8 @@ public:
     /** The function returns a direction that stands for the thermal velocity of the atom responible for the scattering.
         It uses the velocity component in the propagation direction of the photon (before scattering), the propagation
         direction itself and the temperature. The velocity component in the propagation direction of the photon is to
-        be calculated using the thermalvelocitydistribution function of MonteCarloSimulation.cpp.
+        be calculated using the VoigtProfile::sampleParallelVelocity() function. The two perpendicular components are
+        drawn from a Gaussian distribution \f$\propto{\rm e}^{-u^2}\f$, in units of the thermal velocity.
     */
     Vec scatteringatomdirection(double length, Direction vector);
 
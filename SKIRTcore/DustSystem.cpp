@@ -39,7 +39,7 @@ using namespace std;
 DustSystem::DustSystem()
     : _dd(0), _grid(0), _gdi(0), _Nrandom(100),
       _writeConvergence(true), _writeDensity(true), _writeDepthMap(false),
-      _writeQuality(false), _writeCellProperties(false), _writeCellsCrossed(false), _assigner(0)
+      _writeQuality(false), _writeCellProperties(false), _writeCellsCrossed(false), _assigner(0), _random(0)
 {
 }
 
@@ -55,6 +55,12 @@ void DustSystem::setupSelfBefore()
 
     // If no assigner was set, use a StaggeredAssigner as default
     if (!_assigner) setAssigner(new StaggeredAssigner(this));
+
+    // cache the random generator
+    _random = find<Random>();
+
+    // tabulate the line profile for resonant scattering
+    _voigt.initialize();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -958,7 +964,7 @@ DustMix* DustSystem::randomMixForPosition(Position bfr, int ell) const
         {
             Array Xv;
             NR::cdf(Xv, _Ncomp, [this,ell,m](int h){return mix(h)->kappasca(ell)*density(m,h);} );
-            hmix = NR::locate_clip(Xv, find<Random>()->uniform());
+            hmix = NR::locate_clip(Xv, _random->uniform());
         }
     }
     return mix(hmix);
@@ -1019,20 +1025,16 @@ Vec DustSystem::bulkVelocity(int m, int h) const
 
 //////////////////////////////////////////////////////////////////////
 
+double DustSystem::voigt(double a, double x) const
+{
+    return _voigt(a,x);
+}
 
+//////////////////////////////////////////////////////////////////////
 
-double DustSystem::voigt(double a, double x) const
+const VoigtProfile& DustSystem::voigtProfile() const
 {
-    double zeta =  (pow(x,2.0) - 0.855) / (pow(x,2.0) + 3.42);
-    double q = 0.0;
-    if(zeta > 0.0){
-        double PiZeta = 5.678 * pow(zeta,4.0) - 9.207 * pow(zeta,3.0) + 4.421 * pow(zeta,2.0) + 0.1117 * zeta;
-        q = (1.0+(21.0/x*x)) * (a/(M_PI*(x*x+1.0)))*PiZeta;
-    }
-    else{
-        q = 0;
-    }
-    return (q * sqrt(M_PI) + exp(-x*x));
+    return _voigt;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1106,6 +1108,25 @@ void DustSystem::write() const
 
 ////////////////////////////////////////////////////////////////////
 
+void DustSystem::flushabsorption()
+{
+}
+
+////////////////////////////////////////////////////////////////////
+
+double DustSystem::absorptionflushtime()
+{
+    return 0.;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DustSystem::releaseabsorptionbuffers()
+{
+}
+
+////////////////////////////////////////////////////////////////////
+
 bool DustSystem::polarization() const
 {
     for (int h=0; h<_Ncomp; h++)
@@ -12,6 +12,7 @@
 #include "Position.hpp"
 #include "SimulationItem.hpp"
 #include "Table.hpp"
+#include "VoigtProfile.hpp"
 
 class DustDistribution;
 class DustGridDensityInterface;
@@ -19,6 +20,7 @@ class DustGridStructure;
 class DustMix;
 class PhotonPackage;
 class ProcessAssigner;
+class Random;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -320,11 +322,15 @@ public:
         non-existing cell outside the grid, the value zero is returned. */
     Vec bulkVelocity(int m, int h) const;
 
-    /** This function returns the value of the voigt function, using the natural line width and photon
-        frequency.
-        */
+    /** This function returns the value of the Voigt function \f$H(a,x)\f$ for the specified
+        damping parameter \f$a\f$ and frequency offset \f$x\f$, as provided by the VoigtProfile
+        object returned by voigtProfile(). */
     double voigt(double a, double x) const;
 
+    /** This function returns a reference to the Voigt line profile used for resonant line
+        scattering, which is initialized during setup. */
+    const VoigtProfile& voigtProfile() const;
+
     /** This function calculates the optical depth
         \f$\tau_{\ell,{\text{path}}}({\boldsymbol{r}},{\boldsymbol{k}})\f$ at wavelength index
         \f$\ell\f$ along a path through the dust system starting at the position
@@ -391,6 +397,24 @@ public:
         only for panchromatic simulations). */
     virtual void absorb(int m, int ell, double DeltaL, bool ynstellar) = 0;
 
+    /** This function transfers any absorbed luminosities that have been buffered by the calling
+        execution thread to the dust system's permanent data structures. It must be called by each
+        thread at the end of every chunk of photon packages that may have invoked the absorb()
+        function. The implementation in this base class does nothing; it is overridden in
+        subclasses that buffer absorption. */
+    virtual void flushabsorption();
+
+    /** This function returns the time (in seconds, summed over all execution threads) spent in the
+        flushabsorption() function since the previous invocation of this function, and resets the
+        accumulated time to zero. The implementation in this base class always returns zero. */
+    virtual double absorptionflushtime();
+
+    /** This function releases any memory used by the dust system for buffering absorbed
+        luminosities. It is called from the main thread at the end of each photon shooting phase
+        that may have invoked the absorb() function. The implementation in this base class does
+        nothing. */
+    virtual void releaseabsorptionbuffers();
+
     /** This function returns true if at least one dust mix in this dust system supports
         polarization; false otherwise. */
     bool polarization() const;
@@ -432,6 +456,8 @@ protected:
     ProcessAssigner* _assigner;
 
     // data members initialized during setup
+    Random* _random;
+    VoigtProfile _voigt;
     int _Ncomp;
     int _Ncells;
     Array _volumev;     // volume for each cell (indexed on m)
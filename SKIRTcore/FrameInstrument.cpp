@@ -5,7 +5,6 @@
 
 #include "FatalError.hpp"
 #include "FrameInstrument.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -14,6 +13,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 FrameInstrument::FrameInstrument()
+    : _ftoth(-1)
 {
 }
 
@@ -25,6 +25,7 @@ void FrameInstrument::setupSelfBefore()
 
     int Nlambda = find<WavelengthGrid>()->Nlambda();
     _ftotv.resize(Nlambda*_Nframep);
+    _ftoth = registerDetector(_ftotv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -42,7 +43,7 @@ FrameInstrument::detect(PhotonPackage* pp)
         double extf = exp(-taupath);
         double Lextf = L*extf;
 
-        LockFree::add(_ftotv[m], Lextf);
+        record(_ftoth, m, Lextf);
     }
 }
 
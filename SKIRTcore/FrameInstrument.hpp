@@ -44,6 +44,7 @@ protected:
 
 private:
     Array _ftotv;
+    int _ftoth;     // handle for the registered detector array _ftotv
 };
 
 ////////////////////////////////////////////////////////////////////
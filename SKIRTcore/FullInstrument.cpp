@@ -6,7 +6,6 @@
 #include "DustEmissivity.hpp"
 #include "FatalError.hpp"
 #include "FullInstrument.hpp"
-#include "LockFree.hpp"
 #include "PanDustSystem.hpp"
 #include "PhotonPackage.hpp"
 #include "WavelengthGrid.hpp"
@@ -16,7 +15,9 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 FullInstrument::FullInstrument()
-    : _Nscatt(0), _dustsystem(false), _dustemission(false), _polarization(false)
+    : _Nscatt(0), _dustsystem(false), _dustemission(false), _polarization(false),
+      _fdirh(-1), _fscah(-1), _ftrah(-1), _fdush(-1), _ftotQh(-1), _ftotUh(-1), _ftotVh(-1),
+      _Fdirh(-1), _Fscah(-1), _Ftrah(-1), _Fdush(-1), _FtotQh(-1), _FtotUh(-1), _FtotVh(-1)
 {
 }
 
@@ -84,6 +85,29 @@ void FullInstrument::setupSelfBefore()
             _FtotVv.resize(Nlambda);
         }
     }
+
+    // register the detector arrays, registering the SEDs first because they are updated most often;
+    // arrays that have not been sized never use thread-private buffers
+    _Fscahv.assign(_Nscatt+1, -1);
+    _fscahv.assign(_Nscatt+1, -1);
+    _Fdirh = registerDetector(_Fdirv);
+    _Ftrah = registerDetector(_Ftrav);
+    _Fscah = registerDetector(_Fscav);
+    if (_Fscavv.size(0))
+        for (int nscatt=1; nscatt<=_Nscatt; nscatt++) _Fscahv[nscatt] = registerDetector(_Fscavv[nscatt]);
+    _Fdush = registerDetector(_Fdusv);
+    _FtotQh = registerDetector(_FtotQv);
+    _FtotUh = registerDetector(_FtotUv);
+    _FtotVh = registerDetector(_FtotVv);
+    _fdirh = registerDetector(_fdirv);
+    _ftrah = registerDetector(_ftrav);
+    _fscah = registerDetector(_fscav);
+    if (_fscavv.size(0))
+        for (int nscatt=1; nscatt<=_Nscatt; nscatt++) _fscahv[nscatt] = registerDetector(_fscavv[nscatt]);
+    _fdush = registerDetector(_fdusv);
+    _ftotQh = registerDetector(_ftotQv);
+    _ftotUh = registerDetector(_ftotUv);
+    _ftotVh = registerDetector(_ftotVv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -117,24 +141,24 @@ void FullInstrument::detect(PhotonPackage* pp)
         int nscatt = pp->nScatt();
         if (nscatt==0)
         {
-            if (_dustsystem) LockFree::add(_Ftrav[ell], L);
-            LockFree::add(_Fdirv[ell], Lextf);
+            if (_dustsystem) record(_Ftrah, ell, L);
+            record(_Fdirh, ell, Lextf);
         }
         else
         {
-            LockFree::add(_Fscav[ell], Lextf);
-            if (nscatt<=_Nscatt) LockFree::add(_Fscavv[nscatt][ell], Lextf);
+            record(_Fscah, ell, Lextf);
+            if (nscatt<=_Nscatt) record(_Fscahv[nscatt], ell, Lextf);
         }
     }
     else
     {
-        LockFree::add(_Fdusv[ell], Lextf);
+        record(_Fdush, ell, Lextf);
     }
     if (_polarization)
     {
-        LockFree::add(_FtotQv[ell], Lextf*pp->stokesQ());
-        LockFree::add(_FtotUv[ell], Lextf*pp->stokesU());
-        LockFree::add(_FtotVv[ell], Lextf*pp->stokesV());
+        record(_FtotQh, ell, Lextf*pp->stokesQ());
+        record(_FtotUh, ell, Lextf*pp->stokesU());
+        record(_FtotVh, ell, Lextf*pp->stokesV());
     }
 
     // frames
@@ -146,24 +170,24 @@ void FullInstrument::detect(PhotonPackage* pp)
             int nscatt = pp->nScatt();
             if (nscatt==0)
             {
-                if (_dustsystem) LockFree::add(_ftrav[m], L);
-                LockFree::add(_fdirv[m], Lextf);
+                if (_dustsystem) record(_ftrah, m, L);
+                record(_fdirh, m, Lextf);
             }
             else
             {
-                LockFree::add(_fscav[m], Lextf);
-                if (nscatt<=_Nscatt) LockFree::add(_fscavv[nscatt][m], Lextf);
+                record(_fscah, m, Lextf);
+                if (nscatt<=_Nscatt) record(_fscahv[nscatt], m, Lextf);
             }
         }
         else
         {
-            LockFree::add(_fdusv[m], Lextf);
+            record(_fdush, m, Lextf);
         }
         if (_polarization)
         {
-            LockFree::add(_ftotQv[m], Lextf*pp->stokesQ());
-            LockFree::add(_ftotUv[m], Lextf*pp->stokesU());
-            LockFree::add(_ftotVv[m], Lextf*pp->stokesV());
+            record(_ftotQh, m, Lextf*pp->stokesQ());
+            record(_ftotUh, m, Lextf*pp->stokesU());
+            record(_ftotVh, m, Lextf*pp->stokesV());
         }
     }
 }
@@ -6,6 +6,7 @@
 #ifndef FULLINSTRUMENT_HPP
 #define FULLINSTRUMENT_HPP
 
+#include <vector>
 #include "ArrayTable.hpp"
 #include "SingleFrameInstrument.hpp"
 
@@ -143,6 +144,26 @@ private:
     Array _FtotQv;
     Array _FtotUv;
     Array _FtotVv;
+
+    // handles for the registered detector arrays (frames)
+    int _fdirh;
+    int _fscah;
+    int _ftrah;
+    int _fdush;
+    std::vector<int> _fscahv;
+    int _ftotQh;
+    int _ftotUh;
+    int _ftotVh;
+
+    // handles for the registered detector arrays (SEDs)
+    int _Fdirh;
+    int _Fscah;
+    int _Ftrah;
+    int _Fdush;
+    std::vector<int> _Fscahv;
+    int _FtotQh;
+    int _FtotUh;
+    int _FtotVh;
 };
 
 ////////////////////////////////////////////////////////////////////
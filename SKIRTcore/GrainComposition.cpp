@@ -5,6 +5,7 @@
 
 #include <cmath>
 #include <fstream>
+#include <QCryptographicHash>
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "GrainComposition.hpp"
@@ -166,6 +167,43 @@ bool GrainComposition::polarization() const
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // adds the specified number of values starting at the specified address to the hash
+    void addvalues(QCryptographicHash& hash, const double* values, size_t n)
+    {
+        if (n) hash.addData(reinterpret_cast<const char*>(values), n*sizeof(double));
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+QByteArray GrainComposition::opticalhash() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    int sizes[3] = { _Nlambda, _Na, _Ntheta };
+    hash.addData(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    addvalues(hash, &_rhobulk, 1);
+    addvalues(hash, begin(_lambdav), _lambdav.size());
+    addvalues(hash, begin(_av), _av.size());
+    if (_Nlambda && _Na)
+    {
+        addvalues(hash, &_Qabsvv(0,0), _Nlambda*_Na);
+        addvalues(hash, &_Qscavv(0,0), _Nlambda*_Na);
+        addvalues(hash, &_asymmparvv(0,0), _Nlambda*_Na);
+        if (_Ntheta)
+        {
+            addvalues(hash, &_S11vvv(0,0,0), _Nlambda*_Na*_Ntheta);
+            addvalues(hash, &_S12vvv(0,0,0), _Nlambda*_Na*_Ntheta);
+            addvalues(hash, &_S33vvv(0,0,0), _Nlambda*_Na*_Ntheta);
+            addvalues(hash, &_S34vvv(0,0,0), _Nlambda*_Na*_Ntheta);
+        }
+    }
+    return hash.result();
+}
+
+////////////////////////////////////////////////////////////////////
+
 namespace
 {
     // this helper function returns the appropriate index for the specified value of theta,
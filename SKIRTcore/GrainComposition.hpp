@@ -101,6 +101,12 @@ public:
         nearest border is used instead. */
     void Sxx(double lambda, double a, double theta, double& S11, double& S12, double& S33, double& S34) const;
 
+    /** This function returns a cryptographic hash of the optical properties (including the
+        polarization properties, if any) and the bulk density stored for this grain composition.
+        Since the hash changes whenever the underlying data changes, it allows clients to cache
+        quantities derived from these properties across simulation runs. */
+    QByteArray opticalhash() const;
+
     //========= Setup Functions for Use in Subclasses ========
 
 protected:
@@ -13,16 +13,25 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 GreyBodyDustEmissivity::GreyBodyDustEmissivity()
+    : _lambdagrid(0)
 {
 }
 
 ////////////////////////////////////////////////////////////////////
 
+void GreyBodyDustEmissivity::setupSelfBefore()
+{
+    DustEmissivity::setupSelfBefore();
+
+    _lambdagrid = find<WavelengthGrid>();
+}
+
+////////////////////////////////////////////////////////////////////
+
 Array GreyBodyDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) const
 {
     // get basic information about the wavelength grid
-    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
-    int Nlambda = lambdagrid->Nlambda();
+    int Nlambda = _lambdagrid->Nlambda();
 
     // get basic information about the dust mix
     int Npop = mix->Npop();
@@ -35,7 +44,7 @@ Array GreyBodyDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) co
         PlanckFunction B(T);
         for (int ell=0; ell<Nlambda; ell++)
         {
-            ev[ell] += mix->sigmaabs(ell,c) * B(lambdagrid->lambda(ell));
+            ev[ell] += mix->sigmaabs(ell,c) * B(_lambdagrid->lambda(ell));
         }
     }
 
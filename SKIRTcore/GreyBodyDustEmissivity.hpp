@@ -7,6 +7,7 @@
 #define GREYBODYDUSTEMISSIVITY_HPP
 
 #include "DustEmissivity.hpp"
+class WavelengthGrid;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -33,6 +34,10 @@ public:
     /** Default constructor. */
     Q_INVOKABLE GreyBodyDustEmissivity();
 
+protected:
+    /** This function caches a pointer to the simulation's wavelength grid. */
+    void setupSelfBefore();
+
     //======================== Other Functions =======================
 
 public:
@@ -41,6 +46,11 @@ public:
         field \f$J_\ell\f$, assuming the simulation's wavelength grid. */
     Array emissivity(const DustMix* mix, const Array& Jv) const;
 
+    //======================== Data Members ========================
+
+private:
+    // data member initialized during setup
+    WavelengthGrid* _lambdagrid;
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -4,9 +4,13 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "Instrument.hpp"
+#include "CheckpointFile.hpp"
 #include "DustSystem.hpp"
 #include "FatalError.hpp"
+#include "InstrumentSystem.hpp"
+#include "LockFree.hpp"
 #include "Log.hpp"
+#include "ParallelFactory.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
 #include "TimeLogger.hpp"
@@ -16,7 +20,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 Instrument::Instrument()
-    : _ds(0)
+    : _ds(0), _parfac(0), _bufferlimit(0), _buffersize(0)
 {
 }
 
@@ -36,6 +40,32 @@ void Instrument::setupSelfBefore()
     {
         _ds = 0;
     }
+
+    // prepare for registering detector arrays
+    _parfac = find<ParallelFactory>();
+    _bufferlimit = find<InstrumentSystem>()->bufferMemory() * 1e9;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::setupSelfAfter()
+{
+    SimulationItem::setupSelfAfter();
+
+    int Nused = 0;
+    int Nshared = 0;
+    for (int d=0; d<_detectors.size(); d++)
+    {
+        if (_detectors[d]->size())
+        {
+            Nused++;
+            if (!_privatev[d]) Nshared++;
+        }
+    }
+    if (Nshared && _parfac->maxThreadCount() > 1)
+        find<Log>()->info("Instrument " + _instrumentname + " uses shared memory for "
+                          + QString::number(Nshared) + " out of " + QString::number(Nused)
+                          + " detector arrays because of the thread-private buffer memory limit");
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -54,6 +84,73 @@ QString Instrument::instrumentName() const
 
 ////////////////////////////////////////////////////////////////////
 
+int Instrument::registerDetector(Array& detector)
+{
+    int Nthreads = _parfac->maxThreadCount();
+    double bytes = static_cast<double>(Nthreads) * detector.size() * sizeof(double);
+    bool threadprivate = Nthreads > 1 && detector.size() && _buffersize + bytes <= _bufferlimit;
+    if (threadprivate) _buffersize += bytes;
+
+    _detectors << &detector;
+    _privatev.push_back(threadprivate);
+    _buffervv.resize(Nthreads);
+    for (int t=0; t<Nthreads; t++) _buffervv[t].resize(_detectors.size());
+    return _detectors.size()-1;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::record(int detector, size_t index, double value)
+{
+    Array& shared = *_detectors[detector];
+    if (_privatev[detector])
+    {
+        Array& buffer = _buffervv[_parfac->currentThreadIndex()][detector];
+        if (!buffer.size()) buffer.resize(shared.size());
+        buffer[index] += value;
+    }
+    else
+    {
+        LockFree::add(shared[index], value);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::flush()
+{
+    for (size_t t=0; t<_buffervv.size(); t++)
+    {
+        for (int d=0; d<_detectors.size(); d++)
+        {
+            Array& buffer = _buffervv[t][d];
+            if (buffer.size())
+            {
+                *_detectors[d] += buffer;
+                buffer.resize(0);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::saveState(CheckpointFile& file) const
+{
+    file.writeInt(_detectors.size());
+    foreach (Array* detector, _detectors) file.writeArray(*detector);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::restoreState(CheckpointFile& file)
+{
+    file.verifyInt(_detectors.size(), "number of detector arrays for instrument " + _instrumentname);
+    foreach (Array* detector, _detectors) file.readArray(*detector);
+}
+
+////////////////////////////////////////////////////////////////////
+
 void Instrument::sumResults(QList<Array*> arrays)
 {
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
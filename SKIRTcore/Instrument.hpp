@@ -8,11 +8,13 @@
 
 #include <cfloat>
 #include <vector>
+#include "Array.hpp"
 #include "Direction.hpp"
 #include "Position.hpp"
 #include "SimulationItem.hpp"
-class Array;
+class CheckpointFile;
 class DustSystem;
+class ParallelFactory;
 class PhotonPackage;
 
 ////////////////////////////////////////////////////////////////////
@@ -43,6 +45,10 @@ protected:
     /** This function performs setup for the instrument. */
     void setupSelfBefore();
 
+    /** This function logs the number of detector arrays that could not be provided with
+        thread-private buffers because of the memory limit set in the instrument system. */
+    void setupSelfAfter();
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -56,6 +62,27 @@ public:
     //======================== Other Functions =======================
 
 protected:
+    /** This function registers the specified detector array with the instrument, so that the
+        record() function can accumulate contributions to the array in thread-private buffers
+        rather than in the shared array itself. It must be called during setup, after the detector
+        array has been sized. The function returns a handle for the array, which the caller should
+        store and pass to record() instead of the array itself. If the number of parallel threads
+        is larger than one, and the memory required for a copy of the array in each thread fits
+        within the memory limit set in the instrument system (taking into account the arrays
+        registered earlier for this instrument), the array is flagged to use thread-private
+        buffers. Otherwise the array keeps using atomic updates of its shared elements. Since
+        smaller arrays are usually updated much more often, subclasses should register their SED
+        arrays before their frame arrays. An empty array never uses thread-private buffers. */
+    int registerDetector(Array& detector);
+
+    /** This function adds the specified value to the element with the specified index in the
+        detector array identified by the specified handle, as returned by registerDetector(), in a
+        way that is safe for concurrent use by multiple parallel threads. If the detector array has
+        been registered to use thread-private buffers, the value is added to the buffer for the
+        current thread, which is allocated on first use. Otherwise the value is added directly to
+        the shared array using an atomic operation. */
+    void record(int detector, size_t index, double value);
+
     /** This function is used to sum a list of flux arrays element-wise across the different
         processes. The resulting arrays with the total fluxes are stored in the memory of the root
         process, replacing the original fluxes. This function can be called a different number of
@@ -86,6 +113,22 @@ public:
         files. Its implementation must be provided in a subclass. */
     virtual void write() = 0;
 
+    /** This function adds the contents of the thread-private buffers to the corresponding shared
+        detector arrays, and releases the memory held by the buffers. It must be called after each
+        photon shooting phase, and in any case before the detector arrays are used in the write()
+        function. */
+    void flush();
+
+    /** This function writes the contents of the registered detector arrays to the specified
+        checkpoint file. It must be called after flush(), while no photon packages are being
+        detected. */
+    void saveState(CheckpointFile& file) const;
+
+    /** This function restores the contents of the registered detector arrays from the specified
+        checkpoint file, as written by saveState(). If the number or the sizes of the detector
+        arrays differ from those in the checkpoint, a fatal error is thrown. */
+    void restoreState(CheckpointFile& file);
+
     /** This function is provided for use in subclasses. It calculates and returns the optical
         depth over the specified distance along the current path of the specified photon package,
         at the photon package's wavelength. If the distance is not specified, the complete path is
@@ -101,6 +144,14 @@ protected:
 private:
     // other data members
     DustSystem* _ds;   // cached pointer to dust system to call opticalDepth() function
+
+    // thread-private detector buffers
+    ParallelFactory* _parfac;   // cached pointer to parallel factory to obtain the current thread index
+    double _bufferlimit;        // the maximum number of bytes to be used for thread-private buffers
+    double _buffersize;         // the number of bytes reserved for thread-private buffers so far
+    QList<Array*> _detectors;   // the registered detector arrays
+    std::vector<bool> _privatev;                // for each detector array, true if it uses thread-private buffers
+    std::vector< std::vector<Array> > _buffervv; // the thread-private buffers, indexed on thread and detector
 };
 
 ////////////////////////////////////////////////////////////////////
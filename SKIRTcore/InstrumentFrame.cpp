@@ -8,7 +8,6 @@
 #include "FITSInOut.hpp"
 #include "InstrumentFrame.hpp"
 #include "Log.hpp"
-#include "LockFree.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
 #include "MultiFrameInstrument.hpp"
@@ -21,7 +20,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 InstrumentFrame::InstrumentFrame()
-    : _Nxp(0), _xpmax(0), _Nyp(0), _ypmax(0)
+    : _Nxp(0), _xpmax(0), _Nyp(0), _ypmax(0), _ftoth(-1)
 {
 }
 
@@ -59,6 +58,14 @@ void InstrumentFrame::setupSelfBefore()
     // initialize pixel frame(s)
     if (_writeTotal) _ftotv.resize(_Nxp*_Nyp);
     if (_writeStellarComps) _fcompvv.resize(find<StellarSystem>()->Ncomp(), _Nxp*_Nyp);
+
+    // register the pixel frame(s) with the parent instrument
+    _ftoth = _instrument->registerDetector(_ftotv);
+    if (_writeStellarComps)
+    {
+        int Ncomp = find<StellarSystem>()->Ncomp();
+        for (int k=0; k<Ncomp; k++) _fcomphv.push_back(_instrument->registerDetector(_fcompvv[k]));
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -150,8 +157,8 @@ void InstrumentFrame::detect(PhotonPackage* pp)
         double extf = exp(-taupath);
         double Lextf = L*extf;
 
-        if (_writeTotal) LockFree::add(_ftotv[l], Lextf);
-        if (_writeStellarComps && pp->isStellar()) LockFree::add(_fcompvv(pp->stellarCompIndex(),l), Lextf);
+        if (_writeTotal) _instrument->record(_ftoth, l, Lextf);
+        if (_writeStellarComps && pp->isStellar()) _instrument->record(_fcomphv[pp->stellarCompIndex()], l, Lextf);
     }
 }
 
@@ -187,6 +194,20 @@ void InstrumentFrame::calibrateAndWriteData(int ell)
 
 ////////////////////////////////////////////////////////////////////
 
+const Array& InstrumentFrame::totalFlux() const
+{
+    return _ftotv;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const Array& InstrumentFrame::stellarFlux(int k) const
+{
+    return _fcompvv[k];
+}
+
+////////////////////////////////////////////////////////////////////
+
 void InstrumentFrame::calibrateAndWriteDataFrames(int ell, QList<Array*> farrays, QStringList fnames)
 {
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
@@ -220,7 +241,8 @@ void InstrumentFrame::calibrateAndWriteDataFrames(int ell, QList<Array*> farrays
         (*farr) *= (unitfactor / (dlambda * area * fourpid2));
     }
 
-    // write a FITS file for each array
+    // write a FITS file for each array, unless the frames are retrieved from memory
+    if (!_instrument->writeFiles()) return;
     for (int q = 0; q < farrays.size(); q++)
     {
         QString filename = find<FilePaths>()->output(_instrument->instrumentName()
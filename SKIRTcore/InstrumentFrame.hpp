@@ -6,6 +6,7 @@
 #ifndef INSTRUMENTFRAME_HPP
 #define INSTRUMENTFRAME_HPP
 
+#include <vector>
 #include "ArrayTable.hpp"
 #include "SimulationItem.hpp"
 class PhotonPackage;
@@ -117,6 +118,15 @@ public:
         index. */
     void calibrateAndWriteData(int ell);
 
+    /** This function returns the total flux per pixel recorded by the frame. After
+        calibrateAndWriteData() has been called, the flux is calibrated in output units. */
+    const Array& totalFlux() const;
+
+    /** This function returns the flux per pixel recorded by the frame for the stellar component
+        with index \em k. After calibrateAndWriteData() has been called, the flux is calibrated in
+        output units. */
+    const Array& stellarFlux(int k) const;
+
 private:
     /** This private function properly calibrates and outputs the instrument data. It is invoked
         from the public calibrateAndWriteData() function. */
@@ -149,6 +159,10 @@ private:
     // total flux per pixel
     Array _ftotv;
     ArrayTable<2> _fcompvv;
+
+    // handles for the frames registered with the parent instrument
+    int _ftoth;
+    std::vector<int> _fcomphv;
 };
 
 ////////////////////////////////////////////////////////////////////
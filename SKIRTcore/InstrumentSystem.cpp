@@ -3,6 +3,7 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include "CheckpointFile.hpp"
 #include "FatalError.hpp"
 #include "Instrument.hpp"
 #include "InstrumentSystem.hpp"
@@ -12,6 +13,7 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 InstrumentSystem::InstrumentSystem()
+    : _bufferMemory(1)
 {
 }
 
@@ -40,9 +42,50 @@ QList<Instrument*> InstrumentSystem::instruments() const
 
 //////////////////////////////////////////////////////////////////////
 
+void InstrumentSystem::setBufferMemory(double value)
+{
+    _bufferMemory = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double InstrumentSystem::bufferMemory() const
+{
+    return _bufferMemory;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void InstrumentSystem::write()
 {
-    foreach (Instrument* instrument, _instruments) instrument->write();
+    foreach (Instrument* instrument, _instruments)
+    {
+        instrument->flush();
+        instrument->write();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::flush()
+{
+    foreach (Instrument* instrument, _instruments) instrument->flush();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::saveState(CheckpointFile& file) const
+{
+    file.writeInt(_instruments.size());
+    foreach (Instrument* instrument, _instruments) instrument->saveState(file);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::restoreState(CheckpointFile& file)
+{
+    file.verifyInt(_instruments.size(), "number of instruments");
+    foreach (Instrument* instrument, _instruments) instrument->restoreState(file);
 }
 
 //////////////////////////////////////////////////////////////////////
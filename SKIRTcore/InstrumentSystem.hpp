@@ -10,6 +10,7 @@
 #include <QMutex>
 #include <QPair>
 #include "SimulationItem.hpp"
+class CheckpointFile;
 class Instrument;
 class ParallelFactory;
 
@@ -28,6 +29,13 @@ class InstrumentSystem : public SimulationItem
     Q_CLASSINFO("Optional", "true")
     Q_CLASSINFO("Default", "SimpleInstrument")
 
+    Q_CLASSINFO("Property", "bufferMemory")
+    Q_CLASSINFO("Title", "the maximum memory (in GB) per instrument for thread-private detector buffers")
+    Q_CLASSINFO("MinValue", "0")
+    Q_CLASSINFO("MaxValue", "1000")
+    Q_CLASSINFO("Default", "1")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -46,6 +54,18 @@ public:
     /** This function returns the list of instruments in the instrument system. */
     Q_INVOKABLE QList<Instrument*> instruments() const;
 
+    /** Sets the maximum amount of memory, in GB, that each instrument may use for thread-private
+        detector buffers. When photon packages are detected by multiple parallel threads, each
+        thread accumulates its contributions in a private copy of the instrument's detector arrays
+        to avoid contention on the shared arrays. Detector arrays for which these copies would
+        exceed the limit keep using atomic updates on the shared array. The default value is 1 GB;
+        a value of zero disables thread-private buffers altogether. */
+    Q_INVOKABLE void setBufferMemory(double value);
+
+    /** Returns the maximum amount of memory, in GB, that each instrument may use for
+        thread-private detector buffers. */
+    Q_INVOKABLE double bufferMemory() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -53,11 +73,25 @@ public:
         function for each of the instruments. */
     void write();
 
+    /** This function adds the contents of the thread-private detector buffers to the shared
+        detector arrays for each of the instruments. It should be called at the end of each photon
+        shooting phase. */
+    void flush();
+
+    /** This function writes the contents of the detector arrays for each of the instruments to the
+        specified checkpoint file. */
+    void saveState(CheckpointFile& file) const;
+
+    /** This function restores the contents of the detector arrays for each of the instruments from
+        the specified checkpoint file, as written by saveState(). */
+    void restoreState(CheckpointFile& file);
+
     //======================== Data Members ========================
 
 private:
     // discoverable attributes
     QList<Instrument*> _instruments;
+    double _bufferMemory;
 };
 
 ////////////////////////////////////////////////////////////////////
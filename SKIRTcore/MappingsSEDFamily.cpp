@@ -10,6 +10,7 @@
 #include "FilePaths.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "ResourceCacheFile.hpp"
 #include "Units.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -58,29 +59,66 @@ MappingsSEDFamily::MappingsSEDFamily(SimulationItem* item)
     _logpv[3] = 7.0;      logpnamev[3] = "p7";
     _logpv[4] = 8.0;      logpnamev[4] = "p8";
 
-    // Read in the emissivity vectors
-    double lambda, j0, j1;
+    // Determine the names of the library files
+    QStringList filenames;
     for (int i=0; i<NZrel; i++)
         for (int j=0; j<NlogC; j++)
             for (int k=0; k<Nlogp; k++)
-            {
-                Array& j0v = _j0vv(i,j,k);
-                Array& j1v = _j1vv(i,j,k);
-                QString filename = FilePaths::resource("SED/Mappings/Mappings_")
-                                   + Zrelnamev[i] + "_" + logCnamev[j] + "_" + logpnamev[k] + ".dat";
-                ifstream file(filename.toLocal8Bit().constData());
-                if (! file.is_open()) throw FATALERROR("Could not open the data file " + filename);
-                item->find<Log>()->info("Reading SED data from file " + filename + "...");
-                for (int l=0; l<Nlambda; l++)
+                filenames << FilePaths::resource("SED/Mappings/Mappings_")
+                             + Zrelnamev[i] + "_" + logCnamev[j] + "_" + logpnamev[k] + ".dat";
+
+    // If the library has been cached in binary form, read the emissivity vectors from the cache
+    ResourceCacheFile cache("Mappings", filenames);
+    if (cache.isCached())
+    {
+        item->find<Log>()->info("Reading SED data from cache file " + cache.filepath() + "...");
+        cache.readArray(_lambdav);
+        for (int i=0; i<NZrel; i++)
+            for (int j=0; j<NlogC; j++)
+                for (int k=0; k<Nlogp; k++)
+                {
+                    cache.readArray(_j0vv(i,j,k));
+                    cache.readArray(_j1vv(i,j,k));
+                }
+        if (_lambdav.size() != Nlambda || _j1vv(NZrel-1,NlogC-1,Nlogp-1).size() != Nlambda)
+            throw FATALERROR("The cache file " + cache.filepath() + " does not match the library");
+    }
+
+    // Otherwise, read in the emissivity vectors from the library files, and cache them in binary form for later use
+    else
+    {
+        double lambda, j0, j1;
+        int n = 0;
+        for (int i=0; i<NZrel; i++)
+            for (int j=0; j<NlogC; j++)
+                for (int k=0; k<Nlogp; k++)
                 {
-                    file >> lambda >> j0 >> j1;
-                    _lambdav[l] = lambda;
-                    j0v[l] = j0;
-                    j1v[l] = j1;
+                    Array& j0v = _j0vv(i,j,k);
+                    Array& j1v = _j1vv(i,j,k);
+                    QString filename = filenames[n++];
+                    ifstream file(filename.toLocal8Bit().constData());
+                    if (! file.is_open()) throw FATALERROR("Could not open the data file " + filename);
+                    item->find<Log>()->info("Reading SED data from file " + filename + "...");
+                    for (int l=0; l<Nlambda; l++)
+                    {
+                        file >> lambda >> j0 >> j1;
+                        _lambdav[l] = lambda;
+                        j0v[l] = j0;
+                        j1v[l] = j1;
+                    }
+                    file.close();
+                    item->find<Log>()->info("File " + filename + " closed.");
                 }
-                file.close();
-                item->find<Log>()->info("File " + filename + " closed.");
-            }
+        cache.writeArray(_lambdav);
+        for (int i=0; i<NZrel; i++)
+            for (int j=0; j<NlogC; j++)
+                for (int k=0; k<Nlogp; k++)
+                {
+                    cache.writeArray(_j0vv(i,j,k));
+                    cache.writeArray(_j1vv(i,j,k));
+                }
+        if (cache.save()) item->find<Log>()->info("Cached SED data in file " + cache.filepath());
+    }
 
     // cache the simulation's wavelength grid
     _lambdagrid = item->find<WavelengthGrid>();
@@ -4,16 +4,59 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <fstream>
+#include <QFileInfo>
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "MarastonSED.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "ResourceCacheFile.hpp"
 
 using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // reads the age, wavelength and flux columns from the Maraston library file with the specified name,
+    // which has the specified number of lines; the columns are cached in binary form on first use
+    void readsedfile(SimulationItem* item, QString filename, size_t Nlines, Array& agev, Array& lambdav, Array& jv)
+    {
+        ResourceCacheFile cache("Maraston_" + QFileInfo(filename).fileName(), QStringList() << filename);
+        if (cache.isCached())
+        {
+            item->find<Log>()->info("Reading SED data from cache file " + cache.filepath() + "...");
+            cache.readArray(agev);
+            cache.readArray(lambdav);
+            cache.readArray(jv);
+            if (agev.size() != Nlines || lambdav.size() != Nlines || jv.size() != Nlines)
+                throw FATALERROR("The cache file " + cache.filepath() + " does not match the library");
+        }
+        else
+        {
+            ifstream file(filename.toLocal8Bit().constData());
+            if (! file.is_open()) throw FATALERROR("Could not open the data file " + filename);
+            item->find<Log>()->info("Reading SED data from file " + filename + "...");
+            agev.resize(Nlines);
+            lambdav.resize(Nlines);
+            jv.resize(Nlines);
+            double ZH;
+            for (size_t k=0; k<Nlines; k++)
+            {
+                file >> agev[k] >> ZH >> lambdav[k] >> jv[k];
+            }
+            file.close();
+            item->find<Log>()->info("File " + filename + " closed.");
+            cache.writeArray(agev);
+            cache.writeArray(lambdav);
+            cache.writeArray(jv);
+            if (cache.save()) item->find<Log>()->info("Cached SED data in file " + cache.filepath());
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
 MarastonSED::MarastonSED()
     : _tau(0), _Z(0)
 {
@@ -101,39 +144,29 @@ void MarastonSED::setupSelfBefore()
     Array jLRv(Nlambda);
     Array jRLv(Nlambda);
     Array jRRv(Nlambda);
-    double age, ZH, lambda, j;
 
     // read the fluxes from the left sed file
-    ifstream fileL(fileLname.toLocal8Bit().constData());
-    if (! fileL.is_open()) throw FATALERROR("Could not open the data file " + fileLname);
-    find<Log>()->info("Reading SED data from file " + fileLname + "...");
+    Array agev, lambdafv, jfv;
+    readsedfile(this, fileLname, NlinesL, agev, lambdafv, jfv);
     for (int k=0; k<NlinesL; k++)
     {
-        fileL >> age >> ZH >> lambda >> j;
         if (k<Nlambda)
-            lambdav[k] = lambda*1e-10; // conversion from Angstrom to m
-        if (age==tauL)
-            jLLv[k%Nlambda] = j;
-        else if (age==tauR)
-            jLRv[k%Nlambda] = j;
+            lambdav[k] = lambdafv[k]*1e-10; // conversion from Angstrom to m
+        if (agev[k]==tauL)
+            jLLv[k%Nlambda] = jfv[k];
+        else if (agev[k]==tauR)
+            jLRv[k%Nlambda] = jfv[k];
     }
-    fileL.close();
-    find<Log>()->info("File " + fileLname + " closed.");
 
     // read the fluxes from the right sed file
-    ifstream fileR(fileLname.toLocal8Bit().constData());
-    if (! fileR.is_open()) throw FATALERROR("Could not open the data file " + fileRname);
-    find<Log>()->info("Reading SED data from file " + fileRname + "...");
+    readsedfile(this, fileRname, NlinesR, agev, lambdafv, jfv);
     for (int k=0; k<NlinesR; k++)
     {
-        fileR >> age >> ZH >> lambda >> j;
-        if (age==tauL)
-            jRLv[k%Nlambda] = j;
-        else if (age==tauR)
-            jRRv[k%Nlambda] = j;
+        if (agev[k]==tauL)
+            jRLv[k%Nlambda] = jfv[k];
+        else if (agev[k]==tauR)
+            jRRv[k%Nlambda] = jfv[k];
     }
-    fileR.close();
-    find<Log>()->info("File " + fileRname + " closed.");
 
     // interpolate
     Array jv(Nlambda);
@@ -8,6 +8,7 @@
 #include "Parallel.hpp"
 #include "ProcessManager.hpp"
 #include <QDataStream>
+#include <QMutex>
 #include <QThread>
 
 ////////////////////////////////////////////////////////////////////
@@ -205,6 +206,82 @@ QVector<QVariant> MasterSlaveCommunicator::performTask(QVector<QVariant> inputVe
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // class to serve as a target for local parallel execution with data items obtained from a producer;
+    // each parallel body keeps performing items until the producer is exhausted or an error occurs
+    class LocalProducerTarget : public ParallelTarget
+    {
+    public:
+        LocalProducerTarget(MasterSlaveCommunicator::Task* task, MasterSlaveCommunicator::Producer* producer)
+            : _task(task), _producer(producer), _done(false) { }
+        void body(size_t)
+        {
+            try
+            {
+                while (true)
+                {
+                    QVariant input;
+                    {
+                        QMutexLocker lock(&_mutex);
+                        if (_done) return;
+                        input = _producer->produce();
+                        if (!input.isValid())
+                        {
+                            _done = true;
+                            return;
+                        }
+                    }
+                    QVariant output = _task->perform(input);
+                    QMutexLocker lock(&_mutex);
+                    _producer->consume(input, output);
+                }
+            }
+            catch (...)
+            {
+                // make the other parallel bodies stop asking for new items
+                QMutexLocker lock(&_mutex);
+                _done = true;
+                throw;
+            }
+        }
+    private:
+        MasterSlaveCommunicator::Task* _task;
+        MasterSlaveCommunicator::Producer* _producer;
+        QMutex _mutex;
+        bool _done;
+    };
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MasterSlaveCommunicator::performTask(int taskIndex, Producer* producer)
+{
+    if (QThread::currentThread() != _mainThread)
+        throw FATALERROR("Must be invoked from the thread that initialized MasterSlaveCommunicator");
+    if (_performing) throw FATALERROR("Already performing tasks");
+    if (isSlave()) throw FATALERROR("Only the master can command the slaves");
+    if (taskIndex < 0 || taskIndex >= _tasks.size()) throw FATALERROR("Task index out of range");
+
+    // bracket performing tasks with flag to control return value of isMaster() / isSlave()
+    SetFlag flag(&_performing);
+
+    if (isMultiProc())
+    {
+        master_produce_loop(taskIndex, producer);
+    }
+    else
+    {
+        // start a parallel body for each thread; each of them obtains its own items from the producer
+        LocalProducerTarget target(_tasks[taskIndex], producer);
+        Parallel* parallel = _factory.parallel();
+        _assigner->assign(parallel->threadCount());
+        parallel->call(&target, _assigner);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 namespace
 {
     // serialize a QVariant object into a QByteArray, verifying the maximum length of the result
@@ -280,6 +357,63 @@ QVector<QVariant> MasterSlaveCommunicator::master_command_loop(int taskIndex, QV
 
 ////////////////////////////////////////////////////////////////////
 
+void MasterSlaveCommunicator::master_produce_loop(int taskIndex, Producer* producer)
+{
+    // prepare a vector to remember the item most recently handed out to each slave
+    QVector<QVariant> itemForSlave(size());
+
+    // the number of slaves currently performing an item, and a flag indicating the producer is exhausted
+    int numbusy = 0;
+    bool exhausted = false;
+
+    // hand out an item to each slave (unless the producer has less items than there are slaves)
+    for (int slave=1; slave<size() && !exhausted; slave++)
+    {
+        QVariant input = producer->produce();
+        if (input.isValid())
+        {
+            QByteArray buffer = toByteArray(_bufsize, input);
+
+            ProcessManager::sendByteBuffer(buffer, slave, taskIndex);
+
+            itemForSlave[slave] = input;
+            numbusy++;
+        }
+        else exhausted = true;
+    }
+
+    // receive results, handing out a new item to each slave as soon as it is available
+    QByteArray resultbuffer(_bufsize, 0);
+    while (numbusy)
+    {
+        // receive a message from any slave
+        int slave;
+        ProcessManager::receiveByteBuffer(resultbuffer, slave);
+        numbusy--;
+
+        // pass the result to the producer, so that it can be taken into account for the next item
+        producer->consume(itemForSlave[slave], toVariant(resultbuffer));
+
+        // if more items are available, hand one to this slave
+        if (!exhausted)
+        {
+            QVariant input = producer->produce();
+            if (input.isValid())
+            {
+                QByteArray buffer = toByteArray(_bufsize, input);
+
+                ProcessManager::sendByteBuffer(buffer, slave, taskIndex);
+
+                itemForSlave[slave] = input;
+                numbusy++;
+            }
+            else exhausted = true;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MasterSlaveCommunicator::slave_obey_loop()
 {
     QByteArray inbuffer(_bufsize, 0);
@@ -123,6 +123,17 @@ int main(int argc, char** argv)
     values of variable type from scalars up to complex data structures, and which can be
     serialized using standard Qt functionality. Refer to the Qt documentation for more info.
 
+    <B>Producing work on demand</B>
+
+    The performTask() function taking a vector of data items requires all items to be known before
+    any of them is handed out, and it returns only after the last item has been processed. This
+    forces the master to wait for the slowest item in each batch. Alternatively, the items can be
+    obtained on demand from a Producer object. Each time a slave becomes available, the
+    communicator asks the producer for a new item, and each time a slave returns a result, the
+    producer is handed the item together with its result. As a result, a new item can depend on
+    the results for all items completed so far, and none of the slaves is idle while the producer
+    has work available.
+
     <B>Thread safety (or lack thereof)</B>
 
     With the exception of isMaster() and isSlave(), all MasterSlaveCommunicator functions (including
@@ -220,6 +231,50 @@ public:
         virtual QVariant perform(QVariant input) = 0;
     };
 
+    /** The declaration for this pure interface is nested in the MasterSlaveManager class
+        declaration. It is an abstract base class for objects that hand out data items on demand
+        to the performTask() function, and that receive the corresponding results. */
+    class Producer
+    {
+    public:
+        /** The empty constructor for the interface. */
+        Producer() { }
+
+        /** The empty destructor for the interface. */
+        virtual ~Producer() { }
+
+        /** The function that will be invoked by the MasterSlaveManager class each time a slave
+            becomes available. It returns the next data item to be handed out, or an invalid
+            QVariant if there are no further items. Once it has returned an invalid QVariant, the
+            function is not invoked again. This function must be implemented in the derived class.
+            */
+        virtual QVariant produce() = 0;
+
+        /** The function that will be invoked by the MasterSlaveManager class each time a slave has
+            completed the task for a data item. It receives the data item as handed out by
+            produce() and the result returned by the task. This function must be implemented in
+            the derived class. */
+        virtual void consume(QVariant input, QVariant output) = 0;
+    };
+
+    //============= Public Functions using Nested Classes =========
+
+public:
+    /** Make the slaves perform the task with specified index on data items obtained on demand from
+        the specified producer, as described in the class header. The function returns after the
+        producer has indicated that there are no further items, and the results for all items
+        handed out have been passed to the producer. The calls to the producer are serialized, i.e.
+        they never occur concurrently. Throws a fatal error if called while slaves are not
+        acquired, if called from a slave, or if the task index is out of range. */
+    void performTask(int taskIndex, Producer* producer);
+
+    /** Make the slaves perform the task with specified index on data items obtained on demand,
+        using the specified member functions for the specified target object as the produce() and
+        consume() functions of the producer. Invokes the general performTask() function taking a
+        Producer object. */
+    template<class T> void performTask(int taskIndex, T* targetObject, QVariant (T::*produceMember)(),
+                                       void (T::*consumeMember)(QVariant input, QVariant output));
+
 private:
     /** The declaration for this template class is nested in the MasterSlaveManager class
         declaration. It is used in the implementation of the registerTask() template function to
@@ -243,6 +298,31 @@ private:
         QVariant (T::*_targetMember)(QVariant input);
     };
 
+    /** The declaration for this template class is nested in the MasterSlaveManager class
+        declaration. It is used in the implementation of the performTask() template function to
+        allow specifying a producer in the form of two arbitrary target member functions and a
+        target object, similar to the MemberTask class. */
+    template<class T> class MemberProducer : public Producer
+    {
+    public:
+        /** Constructs a MemberProducer instance with produce() and consume() functions that call
+            the specified target member functions on the specified target object. */
+        MemberProducer(T* targetObject, QVariant (T::*produceMember)(),
+                       void (T::*consumeMember)(QVariant input, QVariant output))
+            : _targetObject(targetObject), _produceMember(produceMember), _consumeMember(consumeMember) { }
+
+        /** Calls the target produce member function on the target object. */
+        QVariant produce() { return (_targetObject->*(_produceMember))(); }
+
+        /** Calls the target consume member function on the target object. */
+        void consume(QVariant input, QVariant output) { (_targetObject->*(_consumeMember))(input, output); }
+
+    private:
+        T* _targetObject;
+        QVariant (T::*_produceMember)();
+        void (T::*_consumeMember)(QVariant input, QVariant output);
+    };
+
     //============= Private Functions using Nested Classes =========
 
 private:
@@ -254,6 +334,10 @@ private:
     /** Implements the command loop for the master process. */
     QVector<QVariant> master_command_loop(int taskIndex, QVector<QVariant> inputVector);
 
+    /** Implements the command loop for the master process, obtaining the data items from the
+        specified producer. */
+    void master_produce_loop(int taskIndex, Producer* producer);
+
     /** Implements the obey loop for a slave process. */
     void slave_obey_loop();
 
@@ -282,4 +366,15 @@ template<class T> int MasterSlaveCommunicator::registerTask(T* targetObject, QVa
 
 ////////////////////////////////////////////////////////////////////
 
+// performTask() template function implementation
+template<class T> void MasterSlaveCommunicator::performTask(int taskIndex, T* targetObject,
+                                                            QVariant (T::*produceMember)(),
+                                                            void (T::*consumeMember)(QVariant input, QVariant output))
+{
+    MemberProducer<T> producer(targetObject, produceMember, consumeMember);
+    performTask(taskIndex, &producer);
+}
+
+////////////////////////////////////////////////////////////////////
+
 #endif // MASTERSLAVECOMMUNICATOR_HPP
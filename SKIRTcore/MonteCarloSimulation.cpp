@@ -3,6 +3,7 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <vector>
 #include "DustGridStructure.hpp"
 #include "DustMix.hpp"
 #include "DustSystem.hpp"
@@ -29,7 +30,8 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 MonteCarloSimulation::MonteCarloSimulation()
-    : _is(0), _packages(0), _continuousScattering(false), _lambdagrid(0), _ss(0), _ds(0), _assigner(0)
+    : _is(0), _packages(0), _continuousScattering(false), _batchsize(1), _aliasSampling(true),
+      _lambdagrid(0), _ss(0), _ds(0), _assigner(0), _phaseindex(0)
 {
 }
 
@@ -44,6 +46,8 @@ void MonteCarloSimulation::setupSelfBefore()
         throw FATALERROR("Number of photon packages is larger than implementation limit of 1e15");
     if (_packages < 0)
         throw FATALERROR("Number of photon packages is negative");
+    if (_batchsize < 1)
+        throw FATALERROR("Photon package batch size should be at least one");
 
     if (!_lambdagrid) throw FATALERROR("Wavelength grid was not set");
     if (!_ss) throw FATALERROR("Stellar system was not set");
@@ -56,6 +60,14 @@ void MonteCarloSimulation::setupSelfBefore()
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::resetSelf()
+{
+    Simulation::resetSelf();
+    _phaseindex = 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::setChunkParams(double packages)
 {
     // Cache the number of wavelengths
@@ -84,11 +96,27 @@ void MonteCarloSimulation::setChunkParams(double packages)
         _Npp = _Nchunks * _chunksize;
     }
 
+    // Advance the sequence number of the photon shooting phase, used to select the random streams for the chunks
+    _phaseindex++;
+
     // Determine the log frequency; continuous scattering is much slower!
     _logchunksize = _continuousScattering ? 5000 : 50000;
 
     // Assign the _Nlambda x _Nchunks different chunks to the different parallel processes
     _assigner->assign(_Nlambda, _Nchunks);
+
+    // Verify that each chunk assigned to this process selects its own random stream;
+    // the chunk index serves as the minor stream number, which has 32 bits
+    quint64 Ntotal = _Nlambda * _Nchunks;
+    if (Ntotal > 0xFFFFFFFFull) throw FATALERROR("Too many chunks to provide each with its own random stream");
+    vector<bool> usedv(Ntotal, false);
+    for (size_t i=0; i<_assigner->nvalues(); i++)
+    {
+        size_t index = _assigner->absoluteIndex(i);
+        if (index >= Ntotal || usedv[index]) throw FATALERROR("Chunk " + QString::number(index) +
+                                                              " would reuse the random stream of another chunk");
+        usedv[index] = true;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -130,6 +158,34 @@ void MonteCarloSimulation::setContinuousScattering(bool value)
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::setBatchSize(int value)
+{
+    _batchsize = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int MonteCarloSimulation::batchSize() const
+{
+    return _batchsize;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::setAliasSampling(bool value)
+{
+    _aliasSampling = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool MonteCarloSimulation::aliasSampling() const
+{
+    return _aliasSampling;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::setAssigner(ProcessAssigner* value)
 {
     if (_assigner) delete _assigner;
@@ -194,6 +250,16 @@ void MonteCarloSimulation::logprogress(quint64 extraDone)
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::finishabsorption()
+{
+    if (_ds) _ds->releaseabsorptionbuffers();
+    double seconds = _ds ? _ds->absorptionflushtime() : 0.;
+    if (seconds > 0) _log->info("Transferring the thread-local absorption buffers took "
+                                + QString::number(seconds,'f',3) + " s (summed over all threads)");
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::runstellaremission()
 {
     TimeLogger logger(_log, "the stellar emission phase");
@@ -202,6 +268,10 @@ void MonteCarloSimulation::runstellaremission()
     Parallel* parallel = find<ParallelFactory>()->parallel();
     parallel->call(this, &MonteCarloSimulation::dostellaremissionchunk, _assigner);
 
+    // Add the thread-private detector buffers to the instruments' shared detector arrays
+    if (_is) _is->flush();
+    finishabsorption();
+
     // Wait for the other processes to reach this point
     _comm->wait("the stellar emission phase");
 }
@@ -210,6 +280,7 @@ void MonteCarloSimulation::runstellaremission()
 
 void MonteCarloSimulation::dostellaremissionchunk(size_t index)
 {
+    _random->setStream(_phaseindex, index);
     int ell = index % _Nlambda;
     double L = _ss->luminosity(ell)/_Npp;
     if (L > 0)
@@ -221,7 +292,8 @@ void MonteCarloSimulation::dostellaremissionchunk(size_t index)
         while (remaining > 0)
         {
             quint64 count = qMin(remaining, _logchunksize);
-            for (quint64 i=0; i<count; i++)
+            if (_ds && _batchsize > 1) dostellaremissionbatch(ell, L, count);
+            else for (quint64 i=0; i<count; i++)
             {
                 _ss->launch(&pp,ell,L);
                 peeloffemission(&pp,&ppp);
@@ -239,12 +311,69 @@ void MonteCarloSimulation::dostellaremissionchunk(size_t index)
             logprogress(count);
             remaining -= count;
         }
+
+        // Transfer the absorbed luminosities buffered by this thread to the dust system
+        if (_ds) _ds->flushabsorption();
     }
     else logprogress(_chunksize);
 }
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::dostellaremissionbatch(int ell, double L, quint64 count)
+{
+    double Lmin = 1e-4 * L;
+    bool dustemission = _ds->dustemission();
+    vector<PhotonPackage> ppv(qMin(count, static_cast<quint64>(_batchsize)));
+    PhotonPackage ppp;
+
+    // the photon packages in the current batch that are still alive
+    QVarLengthArray<PhotonPackage*,256> activev;
+
+    quint64 remaining = count;
+    while (remaining > 0)
+    {
+        // launch a new batch
+        int n = qMin(remaining, static_cast<quint64>(ppv.size()));
+        activev.resize(n);
+        for (int k=0; k<n; k++)
+        {
+            PhotonPackage* pp = &ppv[k];
+            _ss->launch(pp,ell,L);
+            peeloffemission(pp,&ppp);
+            activev[k] = pp;
+        }
+        remaining -= n;
+
+        // advance the batch through the life cycle until all photon packages have been retired
+        while (n > 0)
+        {
+            for (int k=0; k<n; k++)
+            {
+                _ds->fillOpticalDepth(activev[k]);
+                if (_continuousScattering) continuouspeeloffscattering(activev[k],&ppp);
+            }
+            simulateescapeandabsorption(activev.data(), n, dustemission);
+
+            // retire the photon packages that have lost most of their luminosity, preserving the order of the others
+            int nalive = 0;
+            for (int k=0; k<n; k++)
+                if (activev[k]->luminosity() > Lmin) activev[nalive++] = activev[k];
+            n = nalive;
+            activev.resize(n);
+
+            simulatepropagation(activev.data(), n);
+            for (int k=0; k<n; k++)
+            {
+                if (!_continuousScattering) peeloffscattering(activev[k],&ppp);
+                simulatescattering(activev[k]);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::peeloffemission(PhotonPackage* pp, PhotonPackage* ppp)
 {
     Position bfr = pp->position();
@@ -459,6 +588,60 @@ void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage* pp, bool d
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage** ppv, int n, bool dustemission)
+{
+    if (n <= 0) return;
+
+    // Easy case: there is only one dust component
+    if (_ds->Ncomp()==1)
+    {
+        int ell = ppv[0]->ell();
+        double albedo = _ds->mix(0)->albedo(ell);
+
+        // absorb the luminosity along each path, if needed
+        if (dustemission)
+        {
+            for (int k=0; k<n; k++)
+            {
+                PhotonPackage* pp = ppv[k];
+                double L = pp->luminosity();
+                bool ynstellar = pp->isStellar();
+                int Ncells = pp->size();
+                for (int i=0; i<Ncells; i++)
+                {
+                    int m = pp->m(i);
+                    if (m!=-1)
+                    {
+                        double taustart = (i==0) ? 0.0 : pp->tau(i-1);
+                        double dtau = pp->dtau(i);
+                        double Labsm = (1.0-albedo) * L * exp(-taustart) * (-expm1(-dtau));
+                        _ds->absorb(m,ell,Labsm,ynstellar);
+                    }
+                }
+            }
+        }
+
+        // calculate the scattered luminosities in structure-of-arrays form
+        QVarLengthArray<double,256> Lv(n);
+        QVarLengthArray<double,256> taupathv(n);
+        for (int k=0; k<n; k++)
+        {
+            Lv[k] = ppv[k]->luminosity();
+            taupathv[k] = ppv[k]->tau();
+        }
+        for (int k=0; k<n; k++) Lv[k] *= albedo * (-expm1(-taupathv[k]));
+        for (int k=0; k<n; k++) ppv[k]->setLuminosity(Lv[k]);
+    }
+
+    // Difficult case: there are different dust components; the luminosities depend on each cell along the path
+    else
+    {
+        for (int k=0; k<n; k++) simulateescapeandabsorption(ppv[k], dustemission);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::simulatepropagation(PhotonPackage* pp)
 {
     double taupath = pp->tau();
@@ -469,6 +652,32 @@ void MonteCarloSimulation::simulatepropagation(PhotonPackage* pp)
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::simulatepropagation(PhotonPackage** ppv, int n)
+{
+    if (n <= 0) return;
+
+    // generate the random optical depths for the complete batch, using the same inversion as Random::exponcutoff()
+    QVarLengthArray<double,256> Xv(n);
+    QVarLengthArray<double,256> tauv(n);
+    _random->uniform(Xv.data(), n);
+    for (int k=0; k<n; k++) tauv[k] = ppv[k]->tau();
+    for (int k=0; k<n; k++)
+    {
+        double taupath = tauv[k];
+        double tau = taupath<1e-10 ? Xv[k]*taupath : -std::log(1.0-Xv[k]*(1.0-exp(-taupath)));
+        tauv[k] = qMin(tau, taupath);
+    }
+
+    // propagate the photon packages
+    for (int k=0; k<n; k++)
+    {
+        PhotonPackage* pp = ppv[k];
+        pp->propagate(pp->pathlength(tauv[k]));
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::simulatescattering(PhotonPackage* pp)
 {
     // Randomly select a dust mix; the probability of each dust component h is weighted by kappasca(h)*rho(m,h)
@@ -500,7 +709,7 @@ void MonteCarloSimulation::simulatescattering(PhotonPackage* pp)
 
 
     //determining the velocity of the scattering atom
-    double uPara = thermalvelocitydistribution( a, x, 0.0 );  //velocity of scattering atom in the direction of incoming photon
+    double uPara = _ds->voigtProfile().sampleParallelVelocity(_random, a, x);  //velocity of scattering atom in the direction of incoming photon
     Vec vThAtom = mix->scatteringatomdirection(uPara, ki );
     Vec vAtom = Vec(vThAtom.x() + vBulk.x() ,vThAtom.y() +vBulk.y()  , vThAtom.z() + vBulk.z()  );
 
@@ -529,39 +738,5 @@ void MonteCarloSimulation::write()
     if (_ds) _ds->write();
 }
 
-////////////////////////////////////////////////////////////////////
-
-double MonteCarloSimulation::thermalvelocitydistribution(double a,double x, double u_0)
-{
-
-    bool keepvalue = false;
-    double u_parallel = 0.0;
-    while(!keepvalue){
-
-        double R = _random->uniform();
-        double theta_0 = atan((u_0-x)/a);
-        double p = (theta_0 + 0.5*M_PI)  *  (1.0/((1.0-exp(-u_0*u_0))*theta_0  +  (1.0+exp(-u_0*u_0))*0.5*M_PI));
-        double theta = 0.0;
-        if(R>p){
-            theta = (M_PI*0.5 - theta_0) * _random->uniform() + theta_0;
-        }
-        else{
-           theta = (M_PI*0.5 + theta_0) * _random->uniform() - (theta_0*0.5);
-        }
-        u_parallel = a*tan(theta) + x;
-        double Q = _random->uniform();
-
-        if(  u_parallel <u_0 && Q<(exp(u_parallel*u_parallel))  ){
-           keepvalue = true;
-        }
-        else if(u_parallel > u_0  && Q < ((exp(u_parallel*u_parallel))/(exp(u_0*u_0))) ) {
-            keepvalue = true;
-
-        }
-    }
-
-    return u_parallel;
-}
-
 /////////////////////////////////////////////////////////////////////////
 
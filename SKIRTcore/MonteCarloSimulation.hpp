@@ -45,6 +45,18 @@ class MonteCarloSimulation : public Simulation
     Q_CLASSINFO("Default", "no")
     Q_CLASSINFO("Silent", "yes")
 
+    Q_CLASSINFO("Property", "batchSize")
+    Q_CLASSINFO("Title", "the number of stellar photon packages advanced together through the transport stages")
+    Q_CLASSINFO("MinValue", "1")
+    Q_CLASSINFO("MaxValue", "1024")
+    Q_CLASSINFO("Default", "1")
+    Q_CLASSINFO("Silent", "true")
+
+    Q_CLASSINFO("Property", "aliasSampling")
+    Q_CLASSINFO("Title", "use alias tables for sampling the emission sources of photon packages")
+    Q_CLASSINFO("Default", "yes")
+    Q_CLASSINFO("Silent", "true")
+
     Q_CLASSINFO("Property", "assigner")
     Q_CLASSINFO("Title", "the assignment scheme that assigns the wavelengths to the different parallel processes")
     Q_CLASSINFO("Default", "IdenticalAssigner")
@@ -61,6 +73,11 @@ protected:
         system is optional and thus it may have a null value. */
     void setupSelfBefore();
 
+    /** This function resets the sequence number of the photon shooting phase, in addition to the
+        state reset by the base class, so that a rerun selects the same random streams for its
+        chunks as a fresh simulation. */
+    void resetSelf();
+
     /** This function determines how the specified number of photon packages should be split over
         chunks, and stores the resulting parameters in protected data members. It should be called
         at the start of each photon shooting phase.
@@ -73,7 +90,7 @@ protected:
         differentiate between 3 cases to calculate the number of chunks:
         -# if the current simulation is <b>not parallelized</b> at all, i.e. the number of processes as
         well as the number of threads per process is one, there is no reason to split the photon
-        packages into chunks, so the double MonteCarloSimulation::thermalvelocitydistribution(double a,double x)number of chunks per wavelength is set to one;
+        packages into chunks, so the number of chunks per wavelength is set to one;
         -# if <b>only multithreading</b> is used (the number of processes is one), the number of chunks
         is determined by the condition that a decent load balancing is obtained among the execution
         threads. Therefore, we dictate that at least 10 chunks (across all wavelengths) are executed by
@@ -95,7 +112,13 @@ protected:
         in turn can be rewritten into the following form: \f[ \boxed{N_\text{chunks} > 10 \times
         \frac{N_\text{threads} \times N_\text{procs}}{N_\lambda}} \f] The final condition prevents the
         chunks from being overly large (\f$S_\text{max}=10^7\f$): \f[\boxed{N_\text{chunks} >
-        \frac{N_\text{pp}}{S_\text{max}}}\f] */
+        \frac{N_\text{pp}}{S_\text{max}}}\f]
+
+        Finally, the function increments the sequence number of the photon shooting phase. Each
+        chunk body should pass this number together with the chunk index to Random::setStream(),
+        so that the random numbers consumed by a chunk don't depend on the thread executing it. The
+        function verifies that the chunks assigned to this process have distinct indices, so that no
+        two chunks launch identical photon packages, and throws a fatal error if this is not the case. */
     void setChunkParams(double packages);
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -131,6 +154,32 @@ public:
     /** Returns the flag that indicates whether continuous scattering should be used. */
     Q_INVOKABLE bool continuousScattering() const;
 
+    /** Sets the number of stellar photon packages that are advanced together through each stage of
+        their life cycle, as described for the dostellaremissionbatch() function. The default value
+        of one causes the photon packages to be processed one at a time. Since all photon packages
+        in a chunk share the same wavelength, processing them in batches allows the calculations
+        that don't depend on the dust cells along the path to be performed in tight loops that can
+        be vectorized by the compiler. Values in the range 64-256 are recommended. */
+    Q_INVOKABLE void setBatchSize(int value);
+
+    /** Returns the number of stellar photon packages advanced together through each stage of their
+        life cycle. */
+    Q_INVOKABLE int batchSize() const;
+
+    /** Sets the flag that indicates whether the stellar components, the SPH dust distribution and
+        the dust emission phases sample the emitting entity (component, particle or dust cell) for
+        a photon package from an alias table (see the AliasTable class) rather than through a
+        binary search in a cumulative distribution. Drawing from an alias table takes constant
+        time, while a binary search in a distribution with many millions of entries causes a cache
+        miss at nearly every step. An alias table takes about 1.5 times the memory of the
+        corresponding cumulative distribution, so the alias tables can be turned off when memory
+        is tight. The default value is true. */
+    Q_INVOKABLE void setAliasSampling(bool value);
+
+    /** Returns the flag that indicates whether alias tables are used for sampling the emission
+        sources of photon packages. */
+    Q_INVOKABLE bool aliasSampling() const;
+
     /** This function sets the process assigner for the Monte Carlo simulation. The process assigner is
         the object that assigns different wavelengths to different processes, to parallelize the photon
         shooting algorithm. The ProcessAssigner class is the abstract class that represents different
@@ -168,6 +217,12 @@ protected:
         number of photon packages processed since the most recent invocation in the same thread. */
     void logprogress(quint64 extraDone);
 
+    /** This function releases the thread-local absorption buffers of the dust system, and logs the
+        time spent by all execution threads in transferring these buffers to the dust system during
+        the most recent photon shooting phase, if any. It should be called at the end of each phase
+        that simulates absorption. */
+    void finishabsorption();
+
     /** This function drives the stellar emission phase in a Monte Carlo simulation. It consists of
         a parallelized loop that iterates over \f$N_{\text{pp}}\times N_\lambda\f$ monochromatic
         photons packages. Within this loop, the function simulates the life cycle of a single
@@ -185,9 +240,23 @@ protected:
         part of its original luminosity (and hence becomes irrelevant). */
     void runstellaremission();
 
-    /** This function implements the loop body for runstellaremission(). */
+    /** This function implements the loop body for runstellaremission(). If the batch size is
+        larger than one and there is a dust system, the photon packages are handed to the
+        dostellaremissionbatch() function; otherwise they are processed one at a time. */
     void dostellaremissionchunk(size_t index);
 
+    /** This function simulates the life cycle of the specified number of stellar photon packages
+        with wavelength index \em ell and initial luminosity \em L, advancing a batch of photon
+        packages together through each stage of the cycle. The function launches a full batch of
+        photon packages and peels them off towards the instruments. It then repeatedly calculates
+        the optical depth along the path of each active photon package, simulates escape and
+        absorption for the complete batch, retires the photon packages that have become irrelevant,
+        and finally simulates propagation, peel-off and scattering for the remaining packages. When
+        all photon packages in the batch have been retired, a new batch is launched. The result is
+        statistically equivalent to processing the photon packages one at a time, but the random
+        sequence is consumed in a different order. */
+    void dostellaremissionbatch(int ell, double L, quint64 count);
+
     /** This function simulates the peel-off of a photon package after an emission event. This
         means that we create peel-off or shadow photon packages, one for every instrument in the
         instrument system, that we force to propagate in the direction of the observer(s) instead
@@ -306,6 +375,14 @@ protected:
         L_{\ell,n}^{\text{abs}} = L_\ell. \f] */
     void simulateescapeandabsorption(PhotonPackage* pp, bool dustemission);
 
+    /** This function simulates the escape from the system and the absorption by dust for each of
+        the \em n photon packages in the array \em ppv, which must all have the same wavelength
+        index. The calculation is equivalent to invoking simulateescapeandabsorption() for each of
+        the photon packages. However, if there is only one dust component, the scattered fraction
+        of the luminosity is calculated for all photon packages in a single vectorizable loop,
+        using an albedo that is retrieved only once for the complete batch. */
+    void simulateescapeandabsorption(PhotonPackage** ppv, int n, bool dustemission);
+
     /** This function determines the next scattering location of a photon package and the simulates
         the propagation to this position. Given the total optical depth along the path of the
         photon package \f$\tau_{\ell,\text{path}}\f$ (this quantity is stored in the PhotonPackage
@@ -319,6 +396,15 @@ protected:
         propagated over this distance. */
     void simulatepropagation(PhotonPackage* pp);
 
+    /** This function determines the next scattering location for each of the \em n photon
+        packages in the array \em ppv and simulates the propagation to this position, as described
+        for simulatepropagation(). The uniform deviates for the complete batch are generated in one
+        go, and the random optical depths are calculated from these deviates in a single
+        vectorizable loop. To avoid a data-dependent rejection loop, the random optical depth is
+        clipped to the total optical depth along the path in the rare case that round-off errors
+        cause it to exceed this value. */
+    void simulatepropagation(PhotonPackage** ppv, int n);
+
     /** This function simulates a scattering event of a photon package. Most of the properties of
         the photon package remain unaltered, including the position and the luminosity. The
         properties that change are the number of scattering events experienced by the photon
@@ -341,9 +427,6 @@ protected:
         simulation can be analyzed. */
     void write();
 
-    double thermalvelocitydistribution(double a,double x, double u_0);
-
-
     //======================== Data Members ========================
 
 private:
@@ -351,6 +434,8 @@ private:
     InstrumentSystem* _is;
     double _packages;       // the specified number of photon packages to be launched per wavelength
     bool _continuousScattering;  // true if continuous scattering should be used
+    int _batchsize;         // the number of stellar photon packages advanced together through the transport stages
+    bool _aliasSampling;    // true if alias tables are used for sampling the emission sources
 
 protected:
     // *** discoverable attributes to be setup by a subclass ***
@@ -368,6 +453,7 @@ protected:
     quint64 _chunksize;     // the number of photon packages in one chunk
     quint64 _Npp;           // the precise number of photon packages to be launched per wavelength
     quint64 _logchunksize;  // the number of photon packages to be processed between logprogress() invocations
+    quint64 _phaseindex;    // the sequence number of the current photon shooting phase, used to select random streams
 
 private:
     // *** data members used by the XXXprogress() functions in this class ***
@@ -14,7 +14,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 MultiFrameInstrument::MultiFrameInstrument()
-    : _writeTotal(true), _writeStellarComps(false)
+    : _writeTotal(true), _writeStellarComps(false), _writeFiles(true)
 {
 }
 
@@ -99,3 +99,17 @@ void MultiFrameInstrument::write()
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void MultiFrameInstrument::setWriteFiles(bool value)
+{
+    _writeFiles = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool MultiFrameInstrument::writeFiles() const
+{
+    return _writeFiles;
+}
+
+////////////////////////////////////////////////////////////////////
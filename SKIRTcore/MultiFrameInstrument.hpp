@@ -87,9 +87,21 @@ public:
 
     /** This function calibrates and outputs the instrument data. It operates similarly to
         SimpleInstrument::write(), except that a separate output file is written for each
-        wavelength, using filenames that include the wavelength index \f$\ell\f$. */
+        wavelength, using filenames that include the wavelength index \f$\ell\f$. If file
+        output has been disabled through setWriteFiles(), the data is calibrated but not written,
+        so that it can be retrieved from the instrument frames instead. */
     void write();
 
+    /** Sets the flag that indicates whether the calibrated frames are written to FITS files. This
+        is not a discoverable attribute; it allows a program such as FitSKIRT, which performs the
+        simulation in-process, to retrieve the calibrated frames directly from memory through the
+        InstrumentFrame::totalFlux() and InstrumentFrame::stellarFlux() functions. The default
+        value is true. */
+    void setWriteFiles(bool value);
+
+    /** Returns the flag that indicates whether the calibrated frames are written to FITS files. */
+    bool writeFiles() const;
+
     //======================== Data Members ========================
 
 private:
@@ -97,6 +109,9 @@ private:
     bool _writeTotal;
     bool _writeStellarComps;
     QList<InstrumentFrame*> _frames;
+
+    // other attributes
+    bool _writeFiles;
 };
 
 ////////////////////////////////////////////////////////////////////
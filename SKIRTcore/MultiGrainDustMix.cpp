@@ -4,7 +4,12 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+#include "ArrayTable.hpp"
 #include "DustDistribution.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
@@ -12,6 +17,7 @@
 #include "GrainSizeDistributionInterface.hpp"
 #include "Log.hpp"
 #include "MultiGrainDustMix.hpp"
+#include "PeerToPeerCommunicator.hpp"
 #include "TextOutFile.hpp"
 #include "Units.hpp"
 
@@ -20,7 +26,7 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 MultiGrainDustMix::MultiGrainDustMix()
-    : _writeSize(true)
+    : _writeSize(true), _cacheProperties(false)
 {
 }
 
@@ -40,6 +46,134 @@ bool MultiGrainDustMix::writeSize() const
 
 //////////////////////////////////////////////////////////////////////
 
+void MultiGrainDustMix::setCacheProperties(bool value)
+{
+    _cacheProperties = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool MultiGrainDustMix::cacheProperties() const
+{
+    return _cacheProperties;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the properties calculated for a single dust population
+    struct Population
+    {
+        double mu;              // the total dust mass per hydrogen atom
+        double norm;            // the number of grains per hydrogen atom
+        Array sigmaabsv;        // the absorption cross sections per hydrogen atom, indexed on ell
+        Array sigmascav;        // the scattering cross sections per hydrogen atom, indexed on ell
+        Array asymmparv;        // the asymmetry parameters, indexed on ell
+        Table<2> S11vv, S12vv, S33vv, S34vv;  // the Mueller coefficients, indexed on ell and theta (if polarized)
+    };
+
+    // the cache file header: magic string, version, key, number of populations, wavelengths and theta values
+    const char* MAGIC = "SKIRTMIX";
+    const qint64 VERSION = 1;
+    const int KEYSIZE = 20;
+    const int HEADERSIZE = 8 + sizeof(qint64) + KEYSIZE + 3*sizeof(qint64);
+
+    // the number of values stored in the cache file for a single population
+    qint64 valuesperpopulation(int Nlambda, int Ntheta)
+    {
+        return 2 + 3*Nlambda + 4*Nlambda*Ntheta;
+    }
+
+    // loads the populations from the cache file with the specified path into the specified (empty) vector,
+    // and returns true if successful; returns false if the file does not exist or does not match the key
+    bool loadcache(QString filepath, QByteArray key, int Nbins, int Nlambda, int Ntheta, vector<Population>& popv)
+    {
+        QFile file(filepath);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+
+        // map the complete file into memory and verify the header
+        qint64 size = file.size();
+        qint64 Nvalues = valuesperpopulation(Nlambda, Ntheta);
+        if (size != HEADERSIZE + Nbins*Nvalues*qint64(sizeof(double))) return false;
+        const uchar* data = file.map(0, size);
+        if (!data || memcmp(data, MAGIC, 8)) return false;
+        qint64 header[4];
+        memcpy(header, data+8, sizeof(qint64));
+        memcpy(header+1, data+8+sizeof(qint64)+KEYSIZE, 3*sizeof(qint64));
+        if (header[0] != VERSION || memcmp(data+8+sizeof(qint64), key.constData(), KEYSIZE)
+            || header[1] != Nbins || header[2] != Nlambda || header[3] != Ntheta) return false;
+
+        // copy the values for each population
+        const double* values = reinterpret_cast<const double*>(data + HEADERSIZE);
+        popv.resize(Nbins);
+        for (Population& pop : popv)
+        {
+            pop.mu = *values++;
+            pop.norm = *values++;
+            for (Array* v : { &pop.sigmaabsv, &pop.sigmascav, &pop.asymmparv })
+            {
+                v->resize(Nlambda);
+                memcpy(begin(*v), values, Nlambda*sizeof(double));
+                values += Nlambda;
+            }
+            if (Ntheta)
+            {
+                for (Table<2>* t : { &pop.S11vv, &pop.S12vv, &pop.S33vv, &pop.S34vv })
+                {
+                    t->resize(Nlambda, Ntheta);
+                    memcpy(begin(t->getArray()), values, Nlambda*Ntheta*sizeof(double));
+                    values += Nlambda*Ntheta;
+                }
+            }
+        }
+        return true;  // closing the file releases the memory map
+    }
+
+    // saves the specified populations to the cache file with the specified path, and returns true if successful;
+    // the data is written to a temporary file first so that concurrent simulations never see a partial cache file
+    bool savecache(QString filepath, QByteArray key, int Nlambda, int Ntheta, vector<Population>& popv)
+    {
+        QString temppath = filepath + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+        QFile file(temppath);
+        if (!file.open(QIODevice::WriteOnly)) return false;
+
+        qint64 header[3] = { static_cast<qint64>(popv.size()), Nlambda, Ntheta };
+        bool ok = file.write(MAGIC, 8) == 8;
+        ok = ok && file.write(reinterpret_cast<const char*>(&VERSION), sizeof(qint64)) == sizeof(qint64);
+        ok = ok && file.write(key.constData(), KEYSIZE) == KEYSIZE;
+        ok = ok && file.write(reinterpret_cast<const char*>(header), sizeof(header)) == sizeof(header);
+        for (Population& pop : popv)
+        {
+            ok = ok && file.write(reinterpret_cast<const char*>(&pop.mu), sizeof(double)) == sizeof(double);
+            ok = ok && file.write(reinterpret_cast<const char*>(&pop.norm), sizeof(double)) == sizeof(double);
+            for (Array* v : { &pop.sigmaabsv, &pop.sigmascav, &pop.asymmparv })
+            {
+                qint64 size = Nlambda*sizeof(double);
+                ok = ok && file.write(reinterpret_cast<const char*>(begin(*v)), size) == size;
+            }
+            if (Ntheta)
+            {
+                for (Table<2>* t : { &pop.S11vv, &pop.S12vv, &pop.S33vv, &pop.S34vv })
+                {
+                    qint64 size = Nlambda*Ntheta*sizeof(double);
+                    ok = ok && file.write(reinterpret_cast<const char*>(begin(t->getArray())), size) == size;
+                }
+            }
+        }
+        file.close();
+        if (ok)
+        {
+            QFile::remove(filepath);
+            ok = QFile::rename(temppath, filepath);
+        }
+        if (!ok) QFile::remove(temppath);
+        return ok;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void MultiGrainDustMix::addpopulations(const GrainComposition *gc, const GrainSizeDistributionInterface *gs, int Nbins)
 {
     Log* log = find<Log>();
@@ -64,6 +198,142 @@ void MultiGrainDustMix::addpopulations(const GrainComposition *gc, const GrainSi
         }
     }
 
+    // create an integration grid over grain size within each bin
+    int Na = 201;               // # points in grid  (must be > 2)
+    ArrayTable<2> avv(Nbins,Na);       // "a" for each bin and point
+    ArrayTable<2> davv(Nbins,Na);      // "da" for each bin and point
+    ArrayTable<2> dndavv(Nbins,Na);    // "dnda" for each bin and point
+    Array weightv(Na);          // integration weight for each point (1/2 or 1)
+    for (int i=0; i<Na; i++) weightv[i] = 1.;
+    weightv[0] = weightv[Na-1] = 0.5;
+    for (int c=0; c<Nbins; c++)
+    {
+        double logamin = log10(aminv[c]);
+        double logamax = log10(amaxv[c]);
+        double dloga = (logamax-logamin)/(Na-1);
+        for (int i=0; i<Na; i++)
+        {
+            avv[c][i] = pow(10, logamin + i*dloga);
+            davv[c][i] = avv[c][i] * M_LN10 * dloga;
+            dndavv[c][i] = gs->dnda(avv[c][i]);
+        }
+    }
+
+    // get the simulation's wavelength grid
+    const Array& lambdav = simlambdav();
+    int Nlambda = lambdav.size();
+    int Ntheta = gc->polarization() ? 181 : 0;
+
+    // if requested, determine the key and path for the cache file, and attempt to load the properties from it;
+    // the key depends on all inputs to the calculation, i.e. the grain properties, integration grids and wavelengths
+    vector<Population> popv;
+    QString cachepath;
+    QByteArray key;
+    if (_cacheProperties)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(gc->opticalhash());
+        int sizes[3] = { Nbins, Na, Ntheta };
+        hash.addData(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        for (int c=0; c<Nbins; c++)
+        {
+            hash.addData(reinterpret_cast<const char*>(begin(avv[c])), Na*sizeof(double));
+            hash.addData(reinterpret_cast<const char*>(begin(davv[c])), Na*sizeof(double));
+            hash.addData(reinterpret_cast<const char*>(begin(dndavv[c])), Na*sizeof(double));
+        }
+        hash.addData(reinterpret_cast<const char*>(begin(lambdav)), Nlambda*sizeof(double));
+        key = hash.result();
+        cachepath = find<FilePaths>()->input("skirt_mix_" + QString::fromLatin1(key.toHex()) + ".smix");
+        if (loadcache(cachepath, key, Nbins, Nlambda, Ntheta, popv))
+            log->info("Loaded optical properties for " + gc->name() + " from cache file " + cachepath);
+    }
+
+    // otherwise calculate the properties for each dust population
+    if (popv.empty())
+    {
+        popv.resize(Nbins);
+        for (int c=0; c<Nbins; c++)
+        {
+            Population& pop = popv[c];
+            const Array& av = avv[c];
+            const Array& dav = davv[c];
+            const Array& dndav = dndavv[c];
+
+            // calculate the optical properties for each wavelength
+            pop.sigmaabsv.resize(Nlambda);
+            pop.sigmascav.resize(Nlambda);
+            pop.asymmparv.resize(Nlambda);
+            for (int ell=0; ell<Nlambda; ell++)
+            {
+                double lamdba = lambdav[ell];
+                double sumsigmaabs = 0.0;
+                double sumsigmasca = 0.0;
+                double sumgsigmasca = 0.0;
+                for (int i=0; i<Na; i++)
+                {
+                    double area = M_PI * av[i] * av[i];
+                    double sigmaabs = area * gc->Qabs(lamdba ,av[i]);
+                    double sigmasca = area * gc->Qsca(lamdba, av[i]);
+                    double gsigmasca = sigmasca * gc->asymmpar(lamdba, av[i]);
+                    sumsigmaabs += weightv[i] * dndav[i] * sigmaabs * dav[i];
+                    sumsigmasca += weightv[i] * dndav[i] * sigmasca * dav[i];
+                    sumgsigmasca += weightv[i] * dndav[i] * gsigmasca * dav[i];
+                }
+                pop.sigmaabsv[ell] = sumsigmaabs;
+                pop.sigmascav[ell] = sumsigmasca;
+                pop.asymmparv[ell] = sumsigmasca ? sumgsigmasca/sumsigmasca : 0.;
+            }
+
+            // calculate the total mass per hydrogen atom, and the norm of the integration
+            // (to calculate the mean mass of a single grain)
+            pop.mu = 0.;
+            pop.norm = 0.;
+            double bulkdensity = gc->bulkdensity();
+            for (int i=0; i<Na; i++)
+            {
+                double volume = 4.0*M_PI/3.0 * av[i] * av[i] * av[i];
+                pop.mu += weightv[i] * dndav[i] * volume * bulkdensity * dav[i];
+                pop.norm += weightv[i] * dndav[i] * dav[i];
+            }
+
+            // if the grain composition supports polarization, then calculate the polarization properties
+            if (Ntheta)
+            {
+                pop.S11vv.resize(Nlambda,Ntheta);
+                pop.S12vv.resize(Nlambda,Ntheta);
+                pop.S33vv.resize(Nlambda,Ntheta);
+                pop.S34vv.resize(Nlambda,Ntheta);
+                for (int ell=0; ell<Nlambda; ell++)
+                {
+                    double lambda = lambdav[ell];
+                    for (int t=0; t<Ntheta; t++)
+                    {
+                        double theta = t * M_PI/(Ntheta-1);
+                        for (int i=0; i<Na; i++)
+                        {
+                            double w = weightv[i] * dndav[i] * dav[i];
+                            double S11, S12, S33, S34;
+                            gc->Sxx(lambda, av[i], theta, S11, S12, S33, S34);
+                            pop.S11vv(ell,t) += w * S11;
+                            pop.S12vv(ell,t) += w * S12;
+                            pop.S33vv(ell,t) += w * S33;
+                            pop.S34vv(ell,t) += w * S34;
+                        }
+                    }
+                }
+            }
+        }
+
+        // store the results in the cache, if requested (only the root process writes the file)
+        if (_cacheProperties && find<PeerToPeerCommunicator>()->isRoot())
+        {
+            if (savecache(cachepath, key, Nlambda, Ntheta, popv))
+                log->info("Stored optical properties for " + gc->name() + " in cache file " + cachepath);
+            else
+                log->warning("Could not write the optical properties cache file " + cachepath);
+        }
+    }
+
     // for each dust population (i.e. for each grain size bin)
     QString gcname = gc->name(); // name of the grain composition class
     for (int c=0; c<Nbins; c++)
@@ -105,102 +375,16 @@ void MultiGrainDustMix::addpopulations(const GrainComposition *gc, const GrainSi
                             + QString::number(units->ograinsize(amaxc)));
         }
 
-        // create an integration grid over grain size within this bin
-        int Na = 201;      // # points in grid  (must be > 2)
-        Array av(Na);      // "a" for each point
-        Array dav(Na);     // "da" for each point
-        Array dndav(Na);   // "dnda" for each point
-        Array weightv(Na); // integration weight for each point (1/2 or 1)
-        {
-            double logamin = log10(aminv[c]);
-            double logamax = log10(amaxv[c]);
-            double dloga = (logamax-logamin)/(Na-1);
-            for (int i=0; i<Na; i++)
-            {
-                av[i] = pow(10, logamin + i*dloga);
-                dav[i] = av[i] * M_LN10 * dloga;
-                dndav[i] = gs->dnda(av[i]);
-                weightv[i] = 1.;
-            }
-            weightv[0] = weightv[Na-1] = 0.5;
-        }
-
-        // get the simulation's wavelength grid
-        const Array& lambdav = simlambdav();
-        int Nlambda = lambdav.size();
-
-        // calculate the optical properties for each wavelength
-        Array sigmaabsv(Nlambda);
-        Array sigmascav(Nlambda);
-        Array asymmparv(Nlambda);
-        for (int ell=0; ell<Nlambda; ell++)
-        {
-            double lamdba = lambdav[ell];
-            double sumsigmaabs = 0.0;
-            double sumsigmasca = 0.0;
-            double sumgsigmasca = 0.0;
-            for (int i=0; i<Na; i++)
-            {
-                double area = M_PI * av[i] * av[i];
-                double sigmaabs = area * gc->Qabs(lamdba ,av[i]);
-                double sigmasca = area * gc->Qsca(lamdba, av[i]);
-                double gsigmasca = sigmasca * gc->asymmpar(lamdba, av[i]);
-                sumsigmaabs += weightv[i] * dndav[i] * sigmaabs * dav[i];
-                sumsigmasca += weightv[i] * dndav[i] * sigmasca * dav[i];
-                sumgsigmasca += weightv[i] * dndav[i] * gsigmasca * dav[i];
-            }
-            sigmaabsv[ell] = sumsigmaabs;
-            sigmascav[ell] = sumsigmasca;
-            asymmparv[ell] = sumsigmasca ? sumgsigmasca/sumsigmasca : 0.;
-        }
-
-        // calculate the total mass per hydrogen atom, and the norm of the integration
-        // (to calculate the mean mass of a single grain)
-        double mu = 0.;
-        double norm = 0.;
-        double bulkdensity = gc->bulkdensity();
-        for (int i=0; i<Na; i++)
-        {
-            double volume = 4.0*M_PI/3.0 * av[i] * av[i] * av[i];
-            mu += weightv[i] * dndav[i] * volume * bulkdensity * dav[i];
-            norm += weightv[i] * dndav[i] * dav[i];
-        }
-
-        // add a dust population with these properties (without resampling)
-        addpopulation(mu, sigmaabsv, sigmascav, asymmparv);
+        // add a dust population with the calculated properties (without resampling)
+        const Population& pop = popv[c];
+        addpopulation(pop.mu, pop.sigmaabsv, pop.sigmascav, pop.asymmparv);
 
         // remember the additional multi-grain properties needed for enthalpy calculations
         _gcv.push_back(gc);
-        _meanmassv.push_back(mu/norm);
+        _meanmassv.push_back(pop.mu/pop.norm);
 
-        // if the grain composition supports polarization, then calculate and add the polarization properties
-        if (gc->polarization())
-        {
-            int Ntheta = 181;
-            Table<2> S11vv(Nlambda,Ntheta);
-            Table<2> S12vv(Nlambda,Ntheta);
-            Table<2> S33vv(Nlambda,Ntheta);
-            Table<2> S34vv(Nlambda,Ntheta);
-            for (int ell=0; ell<Nlambda; ell++)
-            {
-                double lambda = lambdav[ell];
-                for (int t=0; t<Ntheta; t++)
-                {
-                    double theta = t * M_PI/(Ntheta-1);
-                    for (int i=0; i<Na; i++)
-                    {
-                        double w = weightv[i] * dndav[i] * dav[i];
-                        double S11, S12, S33, S34;
-                        gc->Sxx(lambda, av[i], theta, S11, S12, S33, S34);
-                        S11vv(ell,t) += w * S11;
-                        S12vv(ell,t) += w * S12;
-                        S33vv(ell,t) += w * S33;
-                        S34vv(ell,t) += w * S34;
-                    }
-                }
-            }
-            addpolarization(S11vv, S12vv, S33vv, S34vv);
-        }
+        // if the grain composition supports polarization, then add the polarization properties
+        if (Ntheta) addpolarization(pop.S11vv, pop.S12vv, pop.S33vv, pop.S34vv);
     }
 }
 
@@ -31,6 +31,11 @@ class MultiGrainDustMix : public DustMix
     Q_CLASSINFO("Title", "output a data file with grain size information for the dust mix")
     Q_CLASSINFO("Default", "yes")
 
+    Q_CLASSINFO("Property", "cacheProperties")
+    Q_CLASSINFO("Title", "cache the calculated optical properties for use by subsequent simulations")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 protected:
@@ -48,6 +53,19 @@ public:
         information for the dust mixture. */
     Q_INVOKABLE bool writeSize() const;
 
+    /** Sets the flag that indicates whether the optical properties calculated for the dust
+        populations in this mix are cached in a binary file in the input path, so that subsequent
+        simulations with the same configuration can load them rather than recalculating them. The
+        name of a cache file contains a cryptographic hash of all inputs to the calculation, i.e.
+        the optical properties of the grain composition, the integration grid over grain size
+        including the size distribution values, and the simulation's wavelength grid, so that a
+        cache file is never used for a different configuration. The default value is false. */
+    Q_INVOKABLE void setCacheProperties(bool value);
+
+    /** Returns the flag that indicates whether the optical properties for the dust populations are
+        cached. */
+    Q_INVOKABLE bool cacheProperties() const;
+
     //============= Functions for Use in Subclasses during Setup =============
 
 protected:
@@ -89,7 +107,10 @@ protected:
         \rho_{\text{bulk}}\, \frac{4\pi}{3}\, a^3\, {\text{d}}a. \f]
 
         All integrations are performed using a simple trapezoidal integration rule over a
-        logarithmic grain size grid with a fixed number of points for each dust population.
+        logarithmic grain size grid with a fixed number of points for each dust population. If
+        caching is enabled (see setCacheProperties()), the results of these integrations, including
+        the Mueller matrix coefficients for grain compositions that support polarization, are
+        memory-mapped from a cache file written by an earlier simulation, if available.
 
         Assuming the corresponding write flag is turned on, the function writes information on the
         calculated grain size distribution to a file called <tt>prefix_ds_mix_h_size.dat</tt>,
@@ -133,6 +154,7 @@ public:
 private:
     // discoverable attributes
     bool _writeSize;
+    bool _cacheProperties;
 
     // additional multi-grain properties setup in setupSelfBefore()
     std::vector<const GrainComposition*> _gcv;   // indexed on c
@@ -4,7 +4,10 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cmath>
+#include <numeric>
+#include <QElapsedTimer>
 #include "ArrayTable.hpp"
+#include "CheckpointFile.hpp"
 #include "DustEmissivity.hpp"
 #include "DustGridStructure.hpp"
 #include "DustLib.hpp"
@@ -12,15 +15,20 @@
 #include "FatalError.hpp"
 #include "FITSInOut.hpp"
 #include "FilePaths.hpp"
+#include "IdenticalAssigner.hpp"
 #include "ISRF.hpp"
 #include "LockFree.hpp"
 #include "Log.hpp"
+#include "MonteCarloSimulation.hpp"
 #include "NR.hpp"
 #include "PanDustSystem.hpp"
 #include "Parallel.hpp"
+#include "ParallelChunkTarget.hpp"
 #include "ParallelFactory.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "RootAssigner.hpp"
+#include "SequentialAssigner.hpp"
+#include "StaggeredAssigner.hpp"
 #include "TextOutFile.hpp"
 #include "TimeLogger.hpp"
 #include "Units.hpp"
@@ -32,7 +40,9 @@ using namespace std;
 
 PanDustSystem::PanDustSystem()
     : _dustemissivity(0), _dustlib(0), _emissionBoost(1), _selfabsorption(true), _writeEmissivity(false),
-      _writeTemp(true), _writeISRF(true), _cycles(0), _Nlambda(0), _haveLabsstel(false), _haveLabsdust(false)
+      _writeTemp(true), _writeISRF(true), _distributedAbsorption(false), _cycles(0), _lambdagrid(0), _Nlambda(0),
+      _distributed(false), _haveLabsstel(false), _haveLabsdust(false),
+      _parfac(0), _flushtime(0), _cellassigner(0)
 {
 }
 
@@ -58,12 +68,12 @@ void PanDustSystem::setupSelfBefore()
     }
 
     // verify that the wavelength range includes the V-band center 0.55 micron (needed for normalization of dust)
-    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
-    if (lambdagrid->nearest(0.55e-6) < 0)
+    _lambdagrid = find<WavelengthGrid>();
+    if (_lambdagrid->nearest(0.55e-6) < 0)
         throw FATALERROR("Wavelength range should include 0.55 micron for a panchromatic simulation with dust");
 
     // cache size of wavelength grid
-    _Nlambda = lambdagrid->Nlambda();
+    _Nlambda = _lambdagrid->Nlambda();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -118,13 +128,61 @@ void PanDustSystem::setupSelfAfter()
     _haveLabsdust = false;
     if (dustemission())
     {
-        _Labsstelvv.resize(_Ncells,_Nlambda);
+        // determine the wavelengths for which this process stores absorbed luminosities
+        PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+        _distributed = _distributedAbsorption && comm->isMultiProc();
+        _lambdaownerv.assign(_Nlambda, comm->rank());
+        if (_distributed)
+        {
+            // use the same distribution as the simulation, so that all photon packages of a given wavelength
+            // are launched (and thus absorbed) by the process storing the absorbed luminosities for that wavelength
+            ProcessAssigner* assigner = find<MonteCarloSimulation>()->assigner();
+            if (!dynamic_cast<StaggeredAssigner*>(assigner) && !dynamic_cast<SequentialAssigner*>(assigner))
+                throw FATALERROR("Distributed absorption tables require a staggered or sequential assigner "
+                                 "for the simulation");
+            assigner->setup();
+            assigner->assign(_Nlambda);
+            for (int ell=0; ell<_Nlambda; ell++) _lambdaownerv[ell] = assigner->rankForIndex(ell);
+
+            // the ISRF and temperature outputs need the radiation field at all wavelengths in a single process
+            if (_writeISRF || _writeTemp)
+            {
+                find<Log>()->warning("Distributed absorption tables: "
+                                     "the ISRF and dust temperature output files will not be written");
+                setWriteISRF(false);
+                setWriteTemperature(false);
+            }
+        }
+        _lambdacolv.assign(_Nlambda, -1);
+        _ownlambdav.clear();
+        for (int ell=0; ell<_Nlambda; ell++)
+        {
+            if (_lambdaownerv[ell] == comm->rank())
+            {
+                _lambdacolv[ell] = _ownlambdav.size();
+                _ownlambdav.push_back(ell);
+            }
+        }
+        int Ncols = _ownlambdav.size();
+        if (_distributed)
+            find<Log>()->info("This process stores absorbed luminosities for " + QString::number(Ncols)
+                              + " out of " + QString::number(_Nlambda) + " wavelengths");
+
+        _Labsstelvv.resize(_Ncells,Ncols);
         _haveLabsstel = true;
         if (selfAbsorption())
         {
-            _Labsdustvv.resize(_Ncells,_Nlambda);
+            _Labsdustvv.resize(_Ncells,Ncols);
             _haveLabsdust = true;
         }
+
+        // provide an absorption buffer for each thread; the buffer's memory is allocated on first use
+        // and released at the end of each photon shooting phase
+        _parfac = find<ParallelFactory>();
+        _bufferv.resize(_parfac->maxThreadCount());
+
+        // every process calculates the statistics of the radiation field for all cells
+        _cellassigner = new IdenticalAssigner(this);
     }
 
     // write emissivities if so requested
@@ -272,6 +330,20 @@ int PanDustSystem::cycles() const
 
 ////////////////////////////////////////////////////////////////////
 
+void PanDustSystem::setDistributedAbsorption(bool value)
+{
+    _distributedAbsorption = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PanDustSystem::distributedAbsorption() const
+{
+    return _distributedAbsorption;
+}
+
+////////////////////////////////////////////////////////////////////
+
 bool PanDustSystem::dustemission() const
 {
     return _dustemissivity!=0;
@@ -279,17 +351,114 @@ bool PanDustSystem::dustemission() const
 
 //////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the number of hash slots in each absorption buffer (a power of two), and the number of slots
+    // that may be in use before the buffer is transferred to the table (keeping the probe sequences short)
+    const int BUFFERBITS = 13;
+    const int BUFFERSLOTS = 1 << BUFFERBITS;
+    const int BUFFERMAXUSED = BUFFERSLOTS / 2;
+
+    // returns the initial hash slot for the specified cell index (Fibonacci hashing)
+    inline int bufferslot(int m)
+    {
+        return (static_cast<quint32>(m) * 2654435769u) >> (32-BUFFERBITS);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void PanDustSystem::absorb(int m, int ell, double DeltaL, bool ynstellar)
 {
     if (ynstellar)
     {
         if (!_haveLabsstel) throw FATALERROR("This dust system does not support absorption of stellar emission");
-        LockFree::add(_Labsstelvv(m,ell), DeltaL);
     }
     else
     {
         if (!_haveLabsdust) throw FATALERROR("This dust system does not support absorption of dust emission");
-        LockFree::add(_Labsdustvv(m,ell), DeltaL);
+    }
+
+    AbsorptionBuffer& buffer = _bufferv[_parfac->currentThreadIndex()];
+    if (buffer.ell != ell || buffer.ynstellar != ynstellar)
+    {
+        if (_lambdacolv[ell] < 0)
+            throw FATALERROR("This process does not store absorbed luminosities for wavelength index "
+                             + QString::number(ell));
+        flushbuffer(buffer);
+        buffer.ell = ell;
+        buffer.ynstellar = ynstellar;
+    }
+    if (buffer.mv.empty())
+    {
+        buffer.mv.assign(BUFFERSLOTS, -1);
+        buffer.Lv.assign(BUFFERSLOTS, 0.);
+        buffer.slotv.reserve(BUFFERMAXUSED);
+    }
+    else if (static_cast<int>(buffer.slotv.size()) == BUFFERMAXUSED) flushbuffer(buffer);
+
+    // find the slot for this cell using linear probing, claiming an empty slot if the cell is not yet present
+    int slot = bufferslot(m);
+    while (buffer.mv[slot] != m)
+    {
+        if (buffer.mv[slot] < 0)
+        {
+            buffer.mv[slot] = m;
+            buffer.slotv.push_back(slot);
+            break;
+        }
+        slot = (slot+1) & (BUFFERSLOTS-1);
+    }
+    buffer.Lv[slot] += DeltaL;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::flushabsorption()
+{
+    if (!_bufferv.empty()) flushbuffer(_bufferv[_parfac->currentThreadIndex()]);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::flushbuffer(AbsorptionBuffer& buffer)
+{
+    if (buffer.slotv.empty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Table<2>& Labsvv = buffer.ynstellar ? _Labsstelvv : _Labsdustvv;
+    int col = _lambdacolv[buffer.ell];
+    for (int slot : buffer.slotv)
+    {
+        LockFree::add(Labsvv(buffer.mv[slot],col), buffer.Lv[slot]);
+        buffer.mv[slot] = -1;
+        buffer.Lv[slot] = 0.;
+    }
+    buffer.slotv.clear();
+
+    _flushtime += timer.nsecsElapsed();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double PanDustSystem::absorptionflushtime()
+{
+    return _flushtime.exchange(0) * 1e-9;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::releaseabsorptionbuffers()
+{
+    for (AbsorptionBuffer& buffer : _bufferv)
+    {
+        flushbuffer(buffer);
+        vector<int>().swap(buffer.mv);
+        vector<double>().swap(buffer.Lv);
+        vector<int>().swap(buffer.slotv);
+        buffer.ell = -1;
     }
 }
 
@@ -302,11 +471,37 @@ void PanDustSystem::rebootLabsdust()
 
 //////////////////////////////////////////////////////////////////////
 
+void PanDustSystem::saveState(CheckpointFile& file)
+{
+    file.writeArray(_Labsstelvv.getArray());
+    file.writeArray(_Labsdustvv.getArray());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::restoreState(CheckpointFile& file)
+{
+    file.readArray(_Labsstelvv.getArray());
+    file.readArray(_Labsdustvv.getArray());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool PanDustSystem::distributed() const
+{
+    return _distributed;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double PanDustSystem::Labs(int m, int ell) const
 {
+    int col = _lambdacolv[ell];
+    if (col < 0) throw FATALERROR("This process does not store absorbed luminosities for wavelength index "
+                                  + QString::number(ell));
     double sum = 0;
-    if (_haveLabsstel) sum += _Labsstelvv(m,ell);
-    if (_haveLabsdust) sum += _Labsdustvv(m,ell);
+    if (_haveLabsstel) sum += _Labsstelvv(m,col);
+    if (_haveLabsdust) sum += _Labsdustvv(m,col);
     return sum;
 }
 
@@ -314,6 +509,8 @@ double PanDustSystem::Labs(int m, int ell) const
 
 double PanDustSystem::Labs(int m) const
 {
+    if (_distributed) return _Labsbolv.size() ? _Labsbolv[m] : 0.;
+
     double sum = 0;
     if (_haveLabsstel)
         for (int ell=0; ell<_Nlambda; ell++)
@@ -331,8 +528,17 @@ double PanDustSystem::Labsstellartot() const
     double sum = 0;
     if (_haveLabsstel)
         for (int m=0; m<_Ncells; m++)
-            for (int ell=0; ell<_Nlambda; ell++)
-                sum += _Labsstelvv(m,ell);
+            for (size_t col=0; col<_ownlambdav.size(); col++)
+                sum += _Labsstelvv(m,col);
+
+    // if the tables are distributed, each process holds part of the wavelengths
+    if (_distributed)
+    {
+        Array arr(1);
+        arr[0] = sum;
+        find<PeerToPeerCommunicator>()->sum_all(arr);
+        sum = arr[0];
+    }
     return sum;
 }
 
@@ -343,8 +549,8 @@ double PanDustSystem::Labsdusttot() const
     double sum = 0;
     if (_haveLabsdust)
         for (int m=0; m<_Ncells; m++)
-            for (int ell=0; ell<_Nlambda; ell++)
-                sum += _Labsdustvv(m,ell);
+            for (size_t col=0; col<_ownlambdav.size(); col++)
+                sum += _Labsdustvv(m,col);
 
     PeerToPeerCommunicator * comm = find<PeerToPeerCommunicator>();
 
@@ -358,25 +564,158 @@ double PanDustSystem::Labsdusttot() const
 
 //////////////////////////////////////////////////////////////////////
 
+double PanDustSystem::meanintensity(int m, int ell) const
+{
+    return meanintensity(m, ell, Labs(m,ell), volume(m));
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double PanDustSystem::meanintensity(int m, int ell, double L, double V) const
+{
+    double kappaabsrho = 0.0;
+    for (int h=0; h<_Ncomp; h++) kappaabsrho += mix(h)->kappaabs(ell) * density(m,h);
+    double J = L / (kappaabsrho*4.0*M_PI*V) / _lambdagrid->dlambda(ell);
+    // guard against (rare) situations where both Labs and kappa*fac are zero
+    return std::isfinite(J) ? J : 0.0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Array PanDustSystem::meanintensityv(int m) const
 {
-    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
-    Array Jv(lambdagrid->Nlambda());
-    double fac = 4.0*M_PI*volume(m);
-    for (int ell=0; ell<lambdagrid->Nlambda(); ell++)
+    if (_distributed) throw FATALERROR("The mean intensity spectrum for a dust cell is not available "
+                                       "when the absorption tables are distributed");
+
+    Array Jv(_Nlambda);
+    meanintensityv(m, Jv);
+    return Jv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::meanintensityv(int m, Array& Jv) const
+{
+    if (_distributed) Jv = 0.;
+
+    double V = volume(m);
+    int Ncols = _ownlambdav.size();
+    for (int col=0; col<Ncols; col++)
+    {
+        double L = 0.0;
+        if (_haveLabsstel) L += _Labsstelvv(m,col);
+        if (_haveLabsdust) L += _Labsdustvv(m,col);
+        int ell = _ownlambdav[col];
+        Jv[ell] = meanintensity(m, ell, L, V);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // helper class to calculate integrals of the mean intensity for consecutive chunks of cells
+    class MeanIntensityIntegrator : public ParallelChunkTarget
     {
-        double kappaabsrho = 0.0;
-        for (int h=0; h<_Ncomp; h++)
+    private:
+        const PanDustSystem* _ds;
+        const ArrayTable<2>& _wvv;
+        Table<2>& _Ivv;
+        int _Nlambda;
+        int _K;
+
+    public:
+        MeanIntensityIntegrator(const PanDustSystem* ds, const ArrayTable<2>& wvv, Table<2>& Ivv, int Nlambda)
+            : ParallelChunkTarget(ds->Ncells()), _ds(ds), _wvv(wvv), _Ivv(Ivv), _Nlambda(Nlambda), _K(wvv.size(0)) { }
+
+    protected:
+        void chunkbody(size_t /*chunk*/, size_t begin, size_t end)
         {
-            double kappaabs = mix(h)->kappaabs(ell);
-            double rho = density(m,h);
-            kappaabsrho += kappaabs*rho;
+            Array Jv(_Nlambda);
+            for (size_t m=begin; m<end; m++)
+            {
+                _ds->meanintensityv(m, Jv);
+                double* Iv = &_Ivv(m,0);
+                for (int ell=0; ell<_Nlambda; ell++)
+                {
+                    double J = Jv[ell];
+                    if (J) for (int k=0; k<_K; k++) Iv[k] += J * _wvv[k][ell];
+                }
+            }
         }
-        double J = Labs(m,ell) / (kappaabsrho*fac) / lambdagrid->dlambda(ell);
-        // guard against (rare) situations where both Labs and kappa*fac are zero
-        Jv[ell] = std::isfinite(J) ? J : 0.0;
+    };
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Table<2> PanDustSystem::meanintensityintegrals(const ArrayTable<2>& wvv) const
+{
+    Table<2> Ivv(_Ncells,wvv.size(0));
+    MeanIntensityIntegrator integrator(this, wvv, Ivv, _Nlambda);
+    integrator.call(_parfac->parallel(), _cellassigner);
+    if (_distributed) find<PeerToPeerCommunicator>()->sum_all(Ivv.getArray());
+    return Ivv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+ArrayTable<2> PanDustSystem::meanintensities(const vector<int>& nv, int Nlib, ProcessAssigner* assigner) const
+{
+    PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+    int Nprocs = comm->size();
+    int rank = comm->rank();
+    bool parallel = assigner->parallel();
+
+    // count the number of cells mapping to each library entry
+    vector<int> countv(Nlib);
+    for (int m=0; m<_Ncells; m++) if (nv[m] >= 0) countv[nv[m]]++;
+
+    // determine the library entries handled by this process
+    vector<int> ownentryv;
+    for (int n=0; n<Nlib; n++) if (!parallel || assigner->rankForIndex(n) == rank) ownentryv.push_back(n);
+
+    // sum the mean intensity over the cells mapping to each library entry, for the wavelengths stored by this process
+    int Ncols = _ownlambdav.size();
+    Table<2> Jsumvv(Nlib,Ncols);
+    for (int m=0; m<_Ncells; m++)
+    {
+        int n = nv[m];
+        if (n >= 0) for (int col=0; col<Ncols; col++) Jsumvv(n,col) += meanintensity(m,_ownlambdav[col]);
     }
-    return Jv;
+
+    // transpose the partial sums, so that each process receives all wavelengths for its own library entries:
+    // the block sent to process r holds the library entries handled by r (in increasing order) for our own
+    // wavelengths; the block received from process r holds our library entries for the wavelengths stored by r
+    vector<int> sendcounts(Nprocs), recvcounts(Nprocs);
+    vector< vector<int> > lambdavv(Nprocs);
+    for (int ell=0; ell<_Nlambda; ell++) lambdavv[_lambdaownerv[ell]].push_back(ell);
+    for (int r=0; r<Nprocs; r++)
+    {
+        int Nentries = 0;
+        for (int n=0; n<Nlib; n++) if (!parallel || assigner->rankForIndex(n) == r) Nentries++;
+        sendcounts[r] = Nentries * Ncols;
+        recvcounts[r] = ownentryv.size() * lambdavv[r].size();
+    }
+    Array sendv(accumulate(sendcounts.begin(), sendcounts.end(), 0));
+    int index = 0;
+    for (int r=0; r<Nprocs; r++)
+        for (int n=0; n<Nlib; n++)
+            if (!parallel || assigner->rankForIndex(n) == r)
+                for (int col=0; col<Ncols; col++) sendv[index++] = Jsumvv(n,col);
+    Jsumvv.resize(0,0);
+    Array recvv(accumulate(recvcounts.begin(), recvcounts.end(), 0));
+    comm->alltoall(sendv, sendcounts, recvv, recvcounts);
+    sendv.resize(0);
+
+    // unpack the received values into the rows for our own library entries, and convert sums to averages
+    ArrayTable<2> Jvv(Nlib,0);
+    for (int n : ownentryv) Jvv[n].resize(_Nlambda);
+    index = 0;
+    for (int r=0; r<Nprocs; r++)
+        for (int n : ownentryv)
+            for (int ell : lambdavv[r]) Jvv[n][ell] = recvv[index++];
+    for (int n : ownentryv) if (countv[n]) Jvv[n] /= countv[n];
+    return Jvv;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -400,8 +739,26 @@ void PanDustSystem::sumResults(bool ynstellar)
     Log* log = find<Log>();
     TimeLogger logger(log->verbose() && comm->isMultiProc() ? log : 0, "communication of the absorbed luminosities");
 
-    // Sum the array of luminosities across all processes
-    comm->sum_all(ynstellar ? _Labsstelvv.getArray() : _Labsdustvv.getArray());
+    if (_distributed)
+    {
+        // Each process holds the complete absorbed luminosities for its own wavelengths,
+        // so only the bolometric luminosity for each cell needs to be summed across all processes
+        int Ncols = _ownlambdav.size();
+        _Labsbolv.resize(_Ncells);
+        for (int m=0; m<_Ncells; m++)
+        {
+            double sum = 0;
+            if (_haveLabsstel) for (int col=0; col<Ncols; col++) sum += _Labsstelvv(m,col);
+            if (_haveLabsdust) for (int col=0; col<Ncols; col++) sum += _Labsdustvv(m,col);
+            _Labsbolv[m] = sum;
+        }
+        comm->sum_all(_Labsbolv);
+    }
+    else
+    {
+        // Sum the array of luminosities across all processes
+        comm->sum_all(ynstellar ? _Labsstelvv.getArray() : _Labsdustvv.getArray());
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
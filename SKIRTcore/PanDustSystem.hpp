@@ -6,18 +6,44 @@
 #ifndef PANDUSTSYSTEM_HPP
 #define PANDUSTSYSTEM_HPP
 
+#include <atomic>
+#include <vector>
+#include "ArrayTable.hpp"
 #include "DustSystem.hpp"
+class CheckpointFile;
 class DustEmissivity;
 class DustLib;
+class IdenticalAssigner;
+class ParallelFactory;
+class ProcessAssigner;
+class WavelengthGrid;
 
 //////////////////////////////////////////////////////////////////////
 
 /** A PanDustSystem class object represents a complete dust system for use with panchromatic
     simulations. This class relies on the functionality implemented in the DustSystem base class,
     and additionaly supports dust emission. It maintains information on the absorbed energy for
-    each cell at each wavelength in a (potentially very large) table. It also holds a
+    each cell at each wavelength in a (potentially very large) table. To avoid contention between
+    parallel threads on this table, absorbed luminosities are first accumulated in a thread-local
+    buffer for a single wavelength, and transferred to the table at the end of each chunk of
+    photon packages. The buffer is a small hash table with a fixed number of slots, so that it
+    takes about 100 kB per thread regardless of the number of dust cells; when half of the slots
+    are in use, the buffer is transferred to the table early. The buffers are released at the end
+    of each photon shooting phase. It also holds a
     DustEmissivity object and a DustLib object used to calculate the dust emission spectrum for
-    dust cells. */
+    dust cells.
+
+    In a multiprocess simulation, the absorption tables are by default replicated on every process
+    and summed across processes after each photon shooting phase. For large dust grids, this may
+    limit the number of processes that fit on a compute node. If the distributedAbsorption flag is
+    turned on, and the simulation assigns the wavelengths to processes with a StaggeredAssigner or
+    SequentialAssigner, each process stores the absorption tables only for the wavelengths assigned
+    to it. Since photon packages of a given wavelength are launched only by the process owning
+    that wavelength, each slice of the tables is complete without any communication. The functions
+    that need the radiation field at all wavelengths, i.e. the calculations performed by the dust
+    library, are expressed in terms of integrals over wavelength or averages over library entries,
+    which are assembled through collective communication (see meanintensityintegrals() and
+    meanintensities()). */
 class PanDustSystem : public DustSystem
 {
     Q_OBJECT
@@ -60,6 +86,12 @@ class PanDustSystem : public DustSystem
     Q_CLASSINFO("Default", "yes")
     Q_CLASSINFO("RelevantIf", "dustEmissivity")
 
+    Q_CLASSINFO("Property", "distributedAbsorption")
+    Q_CLASSINFO("Title", "distribute the absorption tables over the processes by wavelength")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+    Q_CLASSINFO("RelevantIf", "dustEmissivity")
+
     Q_CLASSINFO("Property", "cycles")
     Q_CLASSINFO("Title", "the number of cycles in each dust self-absorption stage")
     Q_CLASSINFO("Optional", "true")
@@ -77,10 +109,16 @@ protected:
     /** This function does some basic initialization. */
     void setupSelfBefore();
 
-    /** If the relevant flag is turned on, this function outputs a data file tabulating the
-        emissivity for each dust component's dust mix, assuming the dust would be embedded in the
-        local (i.e. solar neighborhood) interstellar radiation field as defined by Mathis et al.
-        (1983, A&A, 128, 212). */
+    /** This function determines the wavelengths for which this process stores absorbed
+        luminosities and allocates the absorption tables accordingly. If the distributedAbsorption
+        flag is turned on in a multiprocess simulation, the wavelengths are distributed in the same
+        way as by the simulation's process assigner, which must be a StaggeredAssigner or
+        SequentialAssigner; in that case the output of the ISRF and the dust temperature maps,
+        which need the radiation field at all wavelengths for every cell in a single process, is
+        turned off. Furthermore, if the relevant flag is turned on, this function outputs a data
+        file tabulating the emissivity for each dust component's dust mix, assuming the dust would
+        be embedded in the local (i.e. solar neighborhood) interstellar radiation field as defined
+        by Mathis et al. (1983, A&A, 128, 212). */
     void setupSelfAfter();
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -146,6 +184,15 @@ public:
         radiation field. If dust emission is turned off, this function returns false. */
     Q_INVOKABLE bool writeISRF() const;
 
+    /** Sets the flag indicating whether to distribute the absorption tables over the processes of
+        a multiprocess simulation by wavelength, as described in the class header. The default value
+        is false. */
+    Q_INVOKABLE void setDistributedAbsorption(bool value);
+
+    /** Returns the flag indicating whether to distribute the absorption tables over the processes
+        by wavelength. */
+    Q_INVOKABLE bool distributedAbsorption() const;
+
     /** Sets the the number of cycles in each dust self-absorption stage. */
     Q_INVOKABLE void setCycles(int value);
 
@@ -163,23 +210,61 @@ public:
         cell with cell number \f$m\f$, i.e. it adds a fraction \f$\Delta L\f$ to the already
         absorbed luminosity at wavelength index \f$\ell\f$. The function adds the absorbed energy
         to the appropriate item in the table for stellar or dust emission as indicated by the flag.
-        The addition is performed in a thread-safe manner so this function may be concurrently
-        called from multiple threads. */
+        The energy is actually accumulated in a buffer that is private to the calling thread and
+        that holds absorbed luminosities for a bounded number of cells at a single wavelength
+        index. The buffer is transferred to the table by the flushabsorption() function, or
+        automatically when the wavelength index or the emission type changes, or when the buffer
+        fills up. Thus this function may be concurrently called from multiple threads without any
+        contention. */
     void absorb(int m, int ell, double DeltaL, bool ynstellar);
 
+    /** This function transfers the absorbed luminosities buffered by the calling thread to the
+        table for stellar or dust emission. Only the cells that actually received a contribution
+        are visited, and each of these cells is updated in a thread-safe manner. The time spent in
+        this function is accumulated so that it can be reported by the simulation. */
+    void flushabsorption();
+
+    /** This function returns the time (in seconds, summed over all execution threads) spent in the
+        flushabsorption() function since the previous invocation of this function, and resets the
+        accumulated time to zero. */
+    double absorptionflushtime();
+
+    /** This function releases the memory held by the absorption buffers of all threads,
+        transferring any remaining contents to the table. It is called from the main thread at the
+        end of each photon shooting phase. */
+    void releaseabsorptionbuffers();
+
     /** This function resets the absorbed dust luminosity to zero in all cells of the dust system. */
     void rebootLabsdust();
 
+    /** This function writes the absorbed luminosity tables held by this process to the specified
+        checkpoint file. It must not be called while photon packages are being absorbed. */
+    void saveState(CheckpointFile& file);
+
+    /** This function restores the absorbed luminosity tables held by this process from the
+        specified checkpoint file, as written by saveState(). If the table sizes differ from those
+        in the checkpoint, a fatal error is thrown. */
+    void restoreState(CheckpointFile& file);
+
+    /** This function returns true if the absorption tables are distributed over the processes by
+        wavelength, i.e. if the distributedAbsorption flag is turned on and the simulation uses
+        multiple processes. */
+    bool distributed() const;
+
     /** This function returns the absorbed luminosity \f$L_{\ell,m}\f$ at wavelength index
-        \f$\ell\f$ in the dust cell with cell number \f$m\f$. */
+        \f$\ell\f$ in the dust cell with cell number \f$m\f$. If the absorption tables are
+        distributed, the wavelength must be assigned to this process. */
     double Labs(int m, int ell) const;
 
     /** This function returns the total (bolometric) absorbed luminosity in the dust cell with cell
-        number \f$m\f$. It is calculated by summing the absorbed luminosity at all the wavelength indices. */
+        number \f$m\f$. It is calculated by summing the absorbed luminosity at all the wavelength
+        indices. If the absorption tables are distributed, the function returns the value
+        calculated across all processes by the most recent invocation of sumResults(). */
     double Labs(int m) const;
 
     /** This function returns the total (bolometric) absorbed dust luminosity in the entire dust system.
-        It is calculated by summing the absorbed stellar luminosity of all the cells. */
+        It is calculated by summing the absorbed stellar luminosity of all the cells. If the
+        absorption tables are distributed, this function must be called by all processes. */
     double Labsstellartot() const;
 
     /** This function returns the total (bolometric) absorbed luminosity in the entire dust system.
@@ -192,9 +277,39 @@ public:
         \kappa_{\ell,h}^{\text{abs}}\, \rho_{m,h} } \f] with \f$L_{\ell,m}^{\text{abs}}\f$ the
         absorbed luminosity, \f$\kappa_{\ell,h}^{\text{abs}}\f$ the absorption coefficient
         corresponding to the \f$h\f$'th dust component, \f$\rho_{m,h}\f$ the dust density
-        corresponding to the \f$h\f$'th dust component, and \f$V_m\f$ the volume of the cell. */
+        corresponding to the \f$h\f$'th dust component, and \f$V_m\f$ the volume of the cell.
+        This function can't be used if the absorption tables are distributed. */
     Array meanintensityv(int m) const;
 
+    /** This function stores the mean radiation field \f$J_{\ell,m}\f$ in the dust cell with cell
+        number \f$m\f$ into the specified array, which must have been sized to the number of
+        wavelengths by the caller. The values are calculated as described for the other version of
+        this function, but the function does not allocate any memory, so that it can be called
+        for many cells in a row using the same buffer. If the absorption tables are distributed,
+        only the values for the wavelengths stored by this process are calculated, and the values
+        for the other wavelengths are set to zero. */
+    void meanintensityv(int m, Array& Jv) const;
+
+    /** This function returns a table with \f$N_\text{cells}\times K\f$ integrals of the mean
+        radiation field over wavelength, \f[ I_{m,k} = \sum_\ell J_{\ell,m}\, w_{k,\ell}, \f]
+        where the \f$K\f$ rows of the specified table contain the weights \f$w_{k,\ell}\f$ for
+        each wavelength index. If the absorption tables are distributed, each process calculates
+        the contributions of its own wavelengths and the results are summed across processes, so
+        that this function must be called by all processes. The calculation is performed in
+        parallel execution threads for consecutive chunks of cells, each using a single buffer
+        for the radiation field in its cells. */
+    Table<2> meanintensityintegrals(const ArrayTable<2>& wvv) const;
+
+    /** This function returns a table with the mean radiation field at all wavelength indices for
+        each of the \f$N_\text{lib}\f$ entries of a dust library, averaged over all dust cells
+        that map to the entry according to the mapping \em nv. Only the rows for the library
+        entries assigned to this process by the specified assigner (or all rows if the assigner
+        does not distribute the work) are filled; the other rows are left empty. If the absorption
+        tables are distributed, each process first sums the radiation field at its own wavelengths
+        for every library entry, after which the partial results are transposed through an
+        all-to-all exchange, so that this function must be called by all processes. */
+    ArrayTable<2> meanintensities(const std::vector<int>& nv, int Nlib, ProcessAssigner* assigner) const;
+
     /** This function (re-)calculates the relevant dust emission spectra for the dust system, based
         on the absorption data currently stored in the dust cells, and internally caches the
         results. If dust emission is turned off, this function does nothing. */
@@ -205,7 +320,9 @@ public:
         a boolean argument, indicating whether the absorbed stellar luminosities (in _Labsstelvv) or
         the absorbed thermal luminosities (in _Labsdustvv) must be summed. The communication is
         performed by calling the sum_all() function of the PeerToPeerCommunicator object, which is
-        found with the discovery mechanism. */
+        found with the discovery mechanism. If the absorption tables are distributed, the tables
+        don't need to be summed; instead, the function sums the bolometric absorbed luminosity for
+        each cell across processes. */
     void sumResults(bool ynstellar);
 
     /** This function returns the luminosity \f$L_\ell\f$ at the wavelength index \f$\ell\f$ in the
@@ -240,6 +357,35 @@ public:
         that the dust emits as a modified blackbody at an equibrium temperature. */
     void write() const;
 
+private:
+    /** This private structure holds the absorbed luminosities buffered by a single execution
+        thread for all cells at a single wavelength index, and remembers which cells actually
+        received a contribution. */
+    struct AbsorptionBuffer
+    {
+        AbsorptionBuffer() : ell(-1), ynstellar(true) { }
+        std::vector<int> mv;    // the cell index for each hash slot, or -1 if the slot is empty (allocated on first use)
+        std::vector<double> Lv; // the absorbed luminosity for each hash slot
+        std::vector<int> slotv; // the indices of the slots in use, in order of first use
+        int ell;                // the wavelength index of the buffered luminosities
+        bool ynstellar;         // true if the buffered luminosities originate from stellar emission
+    };
+
+    /** This function transfers the contents of the specified buffer to the table for stellar or
+        dust emission, and clears the buffer. */
+    void flushbuffer(AbsorptionBuffer& buffer);
+
+    /** This function returns the mean radiation field \f$J_{\ell,m}\f$ at wavelength index
+        \f$\ell\f$ in the dust cell with cell number \f$m\f$, as described for meanintensityv(). */
+    double meanintensity(int m, int ell) const;
+
+    /** This function returns the mean radiation field \f$J_{\ell,m}\f$ at wavelength index
+        \f$\ell\f$ in the dust cell with cell number \f$m\f$, given the absorbed luminosity
+        \f$L_{\ell,m}^{\text{abs}}\f$ and the volume \f$V_m\f$ of the cell, as described for
+        meanintensityv(). If the result is not finite, which happens in the rare case that both the
+        absorbed luminosity and the absorption coefficient are zero, the function returns zero. */
+    double meanintensity(int m, int ell, double L, double V) const;
+
     //======================== Data Members ========================
 
 private:
@@ -251,14 +397,29 @@ private:
     bool _writeEmissivity;
     bool _writeTemp;
     bool _writeISRF;
+    bool _distributedAbsorption;
     int _cycles;
 
     // data members initialized during setup
+    WavelengthGrid* _lambdagrid;
     int _Nlambda;
-    Table<2> _Labsstelvv;   // absorbed stellar emission for each cell and each wavelength (indexed on m,ell)
-    Table<2> _Labsdustvv;   // absorbed dust emission for each cell and each wavelength (indexed on m,ell)
+    bool _distributed;      // true if the absorption tables are distributed over the processes by wavelength
+    std::vector<int> _lambdaownerv; // the rank of the process storing absorbed luminosities for each wavelength
+    std::vector<int> _lambdacolv;   // the column in the tables for each wavelength, or -1 if stored elsewhere
+    std::vector<int> _ownlambdav;   // the wavelength indices stored by this process, in increasing order
+    Table<2> _Labsstelvv;   // absorbed stellar emission for each cell and each stored wavelength (indexed on m,column)
+    Table<2> _Labsdustvv;   // absorbed dust emission for each cell and each stored wavelength (indexed on m,column)
+    Array _Labsbolv;        // bolometric absorbed luminosity for each cell, summed across processes (distributed only)
     bool _haveLabsstel;     // true if absorbed stellar emission is relevant for this simulation
     bool _haveLabsdust;     // true if absorbed dust emission is relevant for this simulation
+
+    // thread-local absorption buffers
+    ParallelFactory* _parfac;               // cached pointer to obtain the current thread index
+    std::vector<AbsorptionBuffer> _bufferv; // the absorption buffer for each thread (indexed on thread)
+    std::atomic<qint64> _flushtime;         // the time spent in flushabsorption() (in nanoseconds)
+
+    // assigns chunks of cells to all processes for calculating statistics of the radiation field
+    IdenticalAssigner* _cellassigner;
 };
 
 //////////////////////////////////////////////////////////////////////
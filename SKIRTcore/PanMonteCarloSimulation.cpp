@@ -3,6 +3,10 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <QFile>
+#include "CheckpointFile.hpp"
+#include "FilePaths.hpp"
+#include "InstrumentSystem.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
 #include "PanDustSystem.hpp"
@@ -10,8 +14,10 @@
 #include "PanWavelengthGrid.hpp"
 #include "Parallel.hpp"
 #include "ParallelFactory.hpp"
+#include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
 #include "Random.hpp"
+#include "RootAssigner.hpp"
 #include "SED.hpp"
 #include "StellarSystem.hpp"
 #include "TimeLogger.hpp"
@@ -22,7 +28,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 PanMonteCarloSimulation::PanMonteCarloSimulation()
-    : _pds(0)
+    : _pds(0), _writeCheckpoints(false), _emissionCacheMemory(1), _cachebytes(0)
 {
 }
 
@@ -88,12 +94,50 @@ PanDustSystem* PanMonteCarloSimulation::dustSystem() const
 
 ////////////////////////////////////////////////////////////////////
 
+void PanMonteCarloSimulation::setWriteCheckpoints(bool value)
+{
+    _writeCheckpoints = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PanMonteCarloSimulation::writeCheckpoints() const
+{
+    return _writeCheckpoints;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::setEmissionCacheMemory(double value)
+{
+    _emissionCacheMemory = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double PanMonteCarloSimulation::emissionCacheMemory() const
+{
+    return _emissionCacheMemory;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void PanMonteCarloSimulation::runSelf()
 {
-    runstellaremission();
+    // resume from the most recent checkpoint if requested, or start from the beginning
+    int stage = 0;
+    int cycle = 0;
+    bool convergence = false;
+    double prevLabsdusttot = 0.;
+    if (!restart() || !readcheckpoint(stage, cycle, convergence, prevLabsdusttot))
+    {
+        runstellaremission();
+        writecheckpoint(0, 0, false, 0.);
+    }
+
     if (_pds && _pds->dustemission())
     {
-        if (_pds && _pds->selfAbsorption()) rundustselfabsorption();
+        if (_pds && _pds->selfAbsorption()) rundustselfabsorption(stage, cycle, convergence, prevLabsdusttot);
         rundustemission();
     }
 
@@ -102,13 +146,11 @@ void PanMonteCarloSimulation::runSelf()
 
 ////////////////////////////////////////////////////////////////////
 
-void PanMonteCarloSimulation::rundustselfabsorption()
+void PanMonteCarloSimulation::rundustselfabsorption(int donestage, int donecycle, bool doneconvergence,
+                                                     double prevLabsdusttot)
 {
     TimeLogger logger(_log, "the dust self-absorption phase");
 
-    // Initialize the total absorbed luminosity in the previous cycle
-    double prevLabsdusttot = 0.;
-
     // Perform three "stages" of max 100 cycles each; the first stage uses 10 times less photon packages
     const int Nstages = 3;
     const char* stage_name[] = {"first-stage", "second-stage", "last-stage"};
@@ -120,6 +162,15 @@ void PanMonteCarloSimulation::rundustselfabsorption()
         const int Ncyclesmax = fixedNcycles ? _pds->cycles() : 100;
         bool convergence = false;
         int cycle = 1;
+
+        // When resuming from a checkpoint, skip the stages and cycles that have already been completed
+        if (stage < donestage) continue;
+        if (stage == donestage)
+        {
+            convergence = doneconvergence;
+            cycle = donecycle+1;
+        }
+
         while (cycle<=Ncyclesmax && (!convergence || fixedNcycles))
         {
             TimeLogger logger(_log, "the " + QString(stage_name[stage]) + " dust self-absorption cycle "
@@ -139,9 +190,11 @@ void PanMonteCarloSimulation::rundustselfabsorption()
 
             // Perform dust self-absorption, using the appropriate number of packages for the current stage
             setChunkParams(packages()*stage_factor[stage]);
+            initemissioncache();
             initprogress(QString(stage_name[stage]) + " dust self-absorption cycle " + QString::number(cycle));
             Parallel* parallel = find<ParallelFactory>()->parallel();
             parallel->call(this, &PanMonteCarloSimulation::dodustselfabsorptionchunk, _assigner);
+            finishabsorption();
 
             // Wait for the other processes to reach this point
             _comm->wait("this self-absorption cycle");
@@ -171,6 +224,7 @@ void PanMonteCarloSimulation::rundustselfabsorption()
                 _log->info("Convergence not yet reached; the increase in the absorbed dust luminosity was "
                            + QString::number(eps*100, 'f', 2) + "%");
             }
+            writecheckpoint(stage, cycle, convergence, Labsdusttot);
             cycle++;
         }
         if (!convergence)
@@ -185,23 +239,21 @@ void PanMonteCarloSimulation::rundustselfabsorption()
 
 void PanMonteCarloSimulation::dodustselfabsorptionchunk(size_t index)
 {
+    // Select the random stream for this chunk
+    _random->setStream(_phaseindex, index);
+
     // Determine the wavelength index for this chunk
     int ell = index % _Nlambda;
 
-    // Determine the luminosity to be emitted at this wavelength index
-    Array Lv(_Ncells);
-    for (int m=0; m<_Ncells; m++)
-    {
-        double Labsbol = _Labsbolv[m];
-        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
-    }
-    double Ltot = Lv.sum();
+    // Get the distribution of the luminosity to be emitted at this wavelength index
+    QSharedPointer<EmissionCdf> cdf = emissioncdf(ell);
+    double Ltot = cdf->Ltot;
 
     // Emit photon packages
     if (Ltot > 0)
     {
-        Array Xv;
-        NR::cdf(Xv, Lv);
+        const Array& Xv = cdf->Xv;
+        const AliasTable& alias = cdf->alias;
 
         PhotonPackage pp;
         double L = Ltot / _Npp;
@@ -214,7 +266,7 @@ void PanMonteCarloSimulation::dodustselfabsorptionchunk(size_t index)
             for (quint64 i=0; i<count; i++)
             {
                 double X = _random->uniform();
-                int m = NR::locate_clip(Xv,X);
+                int m = alias.size() ? alias.sample(X) : NR::locate_clip(Xv,X);
                 Position bfr = _pds->randomPositionInCell(m);
                 Direction bfk = _random->direction();
                 pp.launch(L,ell,bfr,bfk);
@@ -230,6 +282,9 @@ void PanMonteCarloSimulation::dodustselfabsorptionchunk(size_t index)
             logprogress(count);
             remaining -= count;
         }
+
+        // Transfer the absorbed luminosities buffered by this thread to the dust system
+        _pds->flushabsorption();
     }
     else logprogress(_chunksize);
 }
@@ -253,10 +308,14 @@ void PanMonteCarloSimulation::rundustemission()
 
     // Perform the actual dust emission, possibly using more photon packages to obtain decent resolution
     setChunkParams(packages()*_pds->emissionBoost());
+    initemissioncache();
     initprogress("dust emission");
     Parallel* parallel = find<ParallelFactory>()->parallel();
     parallel->call(this, &PanMonteCarloSimulation::dodustemissionchunk, _assigner);
 
+    // Add the thread-private detector buffers to the instruments' shared detector arrays
+    if (instrumentSystem()) instrumentSystem()->flush();
+
     // Wait for the other processes to reach this point
     _comm->wait("the dust emission phase");
 }
@@ -265,23 +324,21 @@ void PanMonteCarloSimulation::rundustemission()
 
 void PanMonteCarloSimulation::dodustemissionchunk(size_t index)
 {
+    // Select the random stream for this chunk
+    _random->setStream(_phaseindex, index);
+
     // Determine the wavelength index for this chunk
     int ell = index % _Nlambda;
 
-    // Determine the luminosity to be emitted at this wavelength index
-    Array Lv(_Ncells);
-    for (int m=0; m<_Ncells; m++)
-    {
-        double Labsbol = _Labsbolv[m];
-        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
-    }
-    double Ltot = Lv.sum();
+    // Get the distribution of the luminosity to be emitted at this wavelength index
+    QSharedPointer<EmissionCdf> cdf = emissioncdf(ell);
+    double Ltot = cdf->Ltot;
 
     // Emit photon packages
     if (Ltot > 0)
     {
-        Array Xv;
-        NR::cdf(Xv, Lv);
+        const Array& Xv = cdf->Xv;
+        const AliasTable& alias = cdf->alias;
 
         PhotonPackage pp,ppp;
         double L = Ltot / _Npp;
@@ -294,7 +351,7 @@ void PanMonteCarloSimulation::dodustemissionchunk(size_t index)
             for (quint64 i=0; i<count; i++)
             {
                 double X = _random->uniform();
-                int m = NR::locate_clip(Xv,X);
+                int m = alias.size() ? alias.sample(X) : NR::locate_clip(Xv,X);
                 Position bfr = _pds->randomPositionInCell(m);
                 Direction bfk = _random->direction();
                 pp.launch(L,ell,bfr,bfk);
@@ -318,3 +375,203 @@ void PanMonteCarloSimulation::dodustemissionchunk(size_t index)
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::initemissioncache()
+{
+    _cdfv.clear();
+    _cdfv.resize(_Nlambda);
+    _buildingv.assign(_Nlambda, 0);
+    _Nremainingv.assign(_Nlambda, 0);
+    for (size_t i=0; i<_assigner->nvalues(); i++) _Nremainingv[_assigner->absoluteIndex(i) % _Nlambda]++;
+    _cachebytes = 0;
+
+    // Select the wavelengths needed by more than one chunk, in the order in which the chunks are started,
+    // for as long as the corresponding distributions are expected to fit in the cache
+    _precalcellv.clear();
+    int Nlambda = _Nlambda;
+    for (int ell=0; ell<Nlambda; ell++)
+    {
+        if (_Nremainingv[ell]>1)
+        {
+            if ((_precalcellv.size()+1)*estimatedemissioncdfbytes() > _emissionCacheMemory*1e9) break;
+            _precalcellv.push_back(ell);
+        }
+    }
+
+    // Calculate the distributions for these wavelengths in parallel, each exactly once
+    if (!_precalcellv.empty())
+    {
+        RootAssigner* assigner = new RootAssigner(0);
+        assigner->assign(_precalcellv.size());
+        Parallel* parallel = find<ParallelFactory>()->parallel();
+        parallel->call(this, &PanMonteCarloSimulation::precalculateemissioncdf, assigner);
+        delete assigner;
+        for (int ell : _precalcellv) _cachebytes += _cdfv[ell]->bytes();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::precalculateemissioncdf(size_t index)
+{
+    // each invocation writes to a different element of the cache, so there is no need for locking
+    int ell = _precalcellv[index];
+    _cdfv[ell] = calculateemissioncdf(ell);
+}
+
+////////////////////////////////////////////////////////////////////
+
+double PanMonteCarloSimulation::estimatedemissioncdfbytes() const
+{
+    return _Ncells * (aliasSampling() ? sizeof(double)+sizeof(int) : sizeof(double));
+}
+
+////////////////////////////////////////////////////////////////////
+
+QSharedPointer<PanMonteCarloSimulation::EmissionCdf> PanMonteCarloSimulation::calculateemissioncdf(int ell) const
+{
+    QSharedPointer<EmissionCdf> cdf(new EmissionCdf);
+    Array Lv(_Ncells);
+    for (int m=0; m<_Ncells; m++)
+    {
+        double Labsbol = _Labsbolv[m];
+        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
+    }
+    cdf->Ltot = Lv.sum();
+    if (cdf->Ltot > 0)
+    {
+        if (aliasSampling()) cdf->alias.initialize(Lv);
+        else NR::cdf(cdf->Xv, Lv);
+    }
+    return cdf;
+}
+
+////////////////////////////////////////////////////////////////////
+
+QSharedPointer<PanMonteCarloSimulation::EmissionCdf> PanMonteCarloSimulation::emissioncdf(int ell)
+{
+    QMutexLocker lock(&_cachemutex);
+
+    // Wait while another thread is calculating the distribution on behalf of the cache
+    while (_buildingv[ell]) _cachecond.wait(&_cachemutex);
+
+    // Look for the distribution in the cache, and evict it if this is the last chunk that needs it
+    _Nremainingv[ell]--;
+    QSharedPointer<EmissionCdf> cdf = _cdfv[ell];
+    if (cdf)
+    {
+        if (_Nremainingv[ell]<=0)
+        {
+            _cdfv[ell].clear();
+            _cachebytes -= cdf->bytes();
+        }
+        return cdf;
+    }
+
+    // If other chunks still need the distribution and it is expected to fit in the cache,
+    // let them wait for this thread to calculate it rather than calculating it themselves
+    bool latch = _Nremainingv[ell]>0 && _cachebytes+estimatedemissioncdfbytes() <= _emissionCacheMemory*1e9;
+    if (latch) _buildingv[ell] = 1;
+
+    // Calculate the distribution (without holding the lock, so that other wavelengths can proceed)
+    lock.unlock();
+    cdf = calculateemissioncdf(ell);
+    lock.relock();
+
+    // Add the distribution to the cache if other threads are waiting for it, or if other chunks still need it
+    // and there is room; another thread may have added the same distribution in the mean time
+    double bytes = cdf->bytes();
+    if (!_cdfv[ell] && (latch || (_Nremainingv[ell]>0 && _cachebytes+bytes <= _emissionCacheMemory*1e9)))
+    {
+        _cdfv[ell] = cdf;
+        _cachebytes += bytes;
+    }
+    if (latch)
+    {
+        _buildingv[ell] = 0;
+        _cachecond.wakeAll();
+    }
+    return cdf;
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString PanMonteCarloSimulation::checkpointpath() const
+{
+    QString name = "checkpoint";
+    if (_comm->isMultiProc()) name += "_" + QString::number(_comm->rank());
+    return _paths->output(name + ".dat");
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::writecheckpoint(int stage, int cycle, bool convergence, double Labsdusttot)
+{
+    if (!_writeCheckpoints) return;
+
+    QString filepath = checkpointpath();
+    TimeLogger logger(_log->verbose() ? _log : 0, "writing the checkpoint file");
+    _log->info("Writing checkpoint to " + filepath + "...");
+
+    CheckpointFile file(filepath, true);
+
+    // the configuration that must match when restarting
+    file.writeInt(_comm->size());
+    file.writeInt(_comm->rank());
+    file.writeInt(_Nlambda);
+    file.writeInt(_Ncells);
+
+    // the progress through the simulation
+    file.writeInt(stage);
+    file.writeInt(cycle);
+    file.writeInt(convergence);
+    file.writeDouble(Labsdusttot);
+    file.writeInt(_phaseindex);
+
+    // the state held by the simulation items
+    _random->saveState(file);
+    if (_pds && _pds->dustemission()) _pds->saveState(file);
+    if (instrumentSystem()) instrumentSystem()->saveState(file);
+
+    file.commit();
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PanMonteCarloSimulation::readcheckpoint(int& stage, int& cycle, bool& convergence, double& Labsdusttot)
+{
+    QString filepath = checkpointpath();
+    if (!QFile::exists(filepath))
+    {
+        _log->warning("There is no checkpoint file " + filepath + "; starting the simulation from the beginning");
+        return false;
+    }
+    _log->info("Restoring the simulation state from checkpoint " + filepath + "...");
+
+    CheckpointFile file(filepath, false);
+
+    // the configuration that must match when restarting
+    file.verifyInt(_comm->size(), "number of processes");
+    file.verifyInt(_comm->rank(), "process rank");
+    file.verifyInt(_Nlambda, "number of wavelengths");
+    file.verifyInt(_Ncells, "number of dust cells");
+
+    // the progress through the simulation
+    stage = file.readInt();
+    cycle = file.readInt();
+    convergence = file.readInt();
+    Labsdusttot = file.readDouble();
+    _phaseindex = file.readInt();
+
+    // the state held by the simulation items
+    _random->restoreState(file);
+    if (_pds && _pds->dustemission()) _pds->restoreState(file);
+    if (instrumentSystem()) instrumentSystem()->restoreState(file);
+
+    if (cycle) _log->info("Resuming after dust self-absorption cycle " + QString::number(cycle)
+                          + " in stage " + QString::number(stage+1));
+    else _log->info("Resuming after the stellar emission phase");
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
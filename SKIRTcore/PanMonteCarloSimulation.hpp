@@ -6,8 +6,14 @@
 #ifndef PANMONTECARLOSIMULATION_HPP
 #define PANMONTECARLOSIMULATION_HPP
 
+#include <vector>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWaitCondition>
+#include "AliasTable.hpp"
 #include "Array.hpp"
 #include "MonteCarloSimulation.hpp"
+class CheckpointFile;
 class PanDustSystem;
 class PanWavelengthGrid;
 
@@ -15,7 +21,17 @@ class PanWavelengthGrid;
 
 /** This is a subclass of the general MonteCarloSimulation class representing a panchromatic Monte
     Carlo simulation, i.e. operating at a range of wavelengths. In such simulations, there can be
-    absorption, scattering and thermal emission by dust grains. */
+    absorption, scattering and thermal emission by dust grains.
+
+    Because the dust self-absorption phase of a panchromatic simulation may take many hours, the
+    simulation can optionally write a checkpoint file at the end of the stellar emission phase and
+    after each dust self-absorption cycle (see setWriteCheckpoints()). A checkpoint contains the
+    absorbed luminosities held by the dust system, the detector arrays of the instruments, the
+    state of the random generator, and the progress through the self-absorption stages and cycles.
+    When the simulation is restarted (see Simulation::setRestart()), it performs the setup as
+    usual, including the construction of the dust grid, and then resumes after the phase or cycle
+    recorded in the most recent checkpoint. In a multi-process run, each process writes its own
+    checkpoint file, so a restart requires the same number of processes and threads. */
 class PanMonteCarloSimulation : public MonteCarloSimulation
 {
     Q_OBJECT
@@ -34,6 +50,18 @@ class PanMonteCarloSimulation : public MonteCarloSimulation
     Q_CLASSINFO("Optional", "true")
     Q_CLASSINFO("Default", "PanDustSystem")
 
+    Q_CLASSINFO("Property", "writeCheckpoints")
+    Q_CLASSINFO("Title", "write checkpoint files allowing the simulation to be restarted")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
+    Q_CLASSINFO("Property", "emissionCacheMemory")
+    Q_CLASSINFO("Title", "the maximum memory (in GB) for caching the dust emission distributions")
+    Q_CLASSINFO("MinValue", "0")
+    Q_CLASSINFO("MaxValue", "1000")
+    Q_CLASSINFO("Default", "1")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -65,12 +93,33 @@ public:
     /** Returns the dust system for this simulation, or null if there is no dust. */
     Q_INVOKABLE PanDustSystem* dustSystem() const;
 
+    /** Sets the flag that indicates whether the simulation writes a checkpoint file at the end of
+        the stellar emission phase and after each dust self-absorption cycle, as described in the
+        class header. The default value is false. */
+    Q_INVOKABLE void setWriteCheckpoints(bool value);
+
+    /** Returns the flag that indicates whether the simulation writes checkpoint files. */
+    Q_INVOKABLE bool writeCheckpoints() const;
+
+    /** Sets the maximum amount of memory, in GB, used for caching the luminosity distributions
+        (alias tables or normalized cumulative distributions) from which dust photon packages are
+        launched. The distribution for
+        a given wavelength is calculated by the first chunk at that wavelength and is then reused
+        by all other chunks at the same wavelength, until the last of these chunks has started.
+        Distributions that don't fit in the cache are recalculated for every chunk. The default
+        value is 1 GB; a value of zero disables the cache. */
+    Q_INVOKABLE void setEmissionCacheMemory(double value);
+
+    /** Returns the maximum amount of memory, in GB, used for caching dust emission distributions. */
+    Q_INVOKABLE double emissionCacheMemory() const;
+
     //======================== Other Functions =======================
 
 protected:
     /** This function actually runs the simulation. For a panchromatic simulation, this includes
         the stellar emission phase, the dust self-absorption phase, and the dust emission phase
-        (plus writing the results). */
+        (plus writing the results). If the restart flag is set and a checkpoint file is available,
+        the phases and cycles completed before the checkpoint was written are skipped. */
     void runSelf();
 
 private:
@@ -99,8 +148,14 @@ private:
         as a random position in the cell \f$m\f$ chosen randomly from the cumulative luminosity
         distribution \f$X_m\f$. The remaining life cycle of a photon package in the dust emission
         phase is very similar to the life cycle described in
-        MonteCarloSimulation::runstellaremission(). */
-    void rundustselfabsorption();
+        MonteCarloSimulation::runstellaremission().
+
+        When resuming from a checkpoint, the arguments specify the index of the last stage and the
+        number of the last cycle in that stage that were completed, whether convergence had been
+        reached in that stage, and the total absorbed dust luminosity in the last cycle. Otherwise
+        the arguments have their default values, i.e. no cycles have been completed. */
+    void rundustselfabsorption(int donestage = 0, int donecycle = 0, bool convergence = false,
+                               double prevLabsdusttot = 0.);
 
     /** This function implements the loop body for rundustselfabsorption(). */
     void dodustselfabsorptionchunk(size_t index);
@@ -131,6 +186,69 @@ private:
     /** This function implements the loop body for rundustemission(). */
     void dodustemissionchunk(size_t index);
 
+    /** This private structure holds the luminosity distribution over the dust cells for a given
+        wavelength, and the corresponding total luminosity \f$L_\ell\f$. Depending on the
+        MonteCarloSimulation::aliasSampling() flag, the distribution is represented either by an
+        alias table or by the normalized cumulative distribution \f$X_m\f$; the other
+        representation is left empty. If the total luminosity is zero, both are left empty. */
+    struct EmissionCdf
+    {
+        Array Xv;
+        AliasTable alias;
+        double Ltot;
+
+        // returns the number of bytes of memory used by the distribution
+        double bytes() const { return Xv.size()*sizeof(double) + alias.bytes(); }
+    };
+
+    /** This function prepares the cache of dust emission distributions for a new dust emission
+        or self-absorption phase. It discards any cached distributions, and counts the number of
+        chunks assigned to this process for each wavelength, so that a distribution can be evicted
+        from the cache as soon as the last chunk that needs it has started. It then calculates the
+        distributions for the wavelengths needed by more than one chunk, in parallel and each
+        exactly once, and stores them in the cache, starting at the shortest wavelength and for as
+        long as they are expected to fit. The function must be called from the main thread, after
+        setChunkParams() and after the bolometric luminosities in _Labsbolv have been determined. */
+    void initemissioncache();
+
+    /** This function implements the loop body for the parallel precalculation in
+        initemissioncache(). */
+    void precalculateemissioncdf(size_t index);
+
+    /** This function returns the number of bytes expected to be used by a single dust emission
+        distribution, given the number of dust cells and the sampling representation. */
+    double estimatedemissioncdfbytes() const;
+
+    /** This function calculates the dust emission distribution for the specified wavelength index
+        from the bolometric absorbed luminosities in _Labsbolv and the normalized dust emission
+        spectra. It does not consult or update the cache. */
+    QSharedPointer<EmissionCdf> calculateemissioncdf(int ell) const;
+
+    /** This function returns the dust emission distribution for the specified wavelength index.
+        If the distribution is present in the cache, it is simply returned. Otherwise it is
+        calculated and added to the cache if there is sufficient room and other chunks at the same
+        wavelength still need it. In that case, the calling thread marks the wavelength as being
+        calculated, and other threads asking for the same wavelength wait for the result rather
+        than calculating the distribution again. Each invocation counts as the start of a chunk at
+        the specified wavelength. The function may be called concurrently from multiple threads. */
+    QSharedPointer<EmissionCdf> emissioncdf(int ell);
+
+    /** This function returns the path of the checkpoint file for this process. */
+    QString checkpointpath() const;
+
+    /** This function writes a checkpoint file recording the state of the simulation after the
+        specified cycle in the specified self-absorption stage has been completed. A cycle number of
+        zero indicates the end of the stellar emission phase. The other arguments are the
+        convergence status for the stage and the total absorbed dust luminosity in the cycle. */
+    void writecheckpoint(int stage, int cycle, bool convergence, double Labsdusttot);
+
+    /** This function reads the most recent checkpoint file for this process, if there is one, and
+        restores the state of the simulation. It stores the progress information into the
+        arguments, with the same meaning as for writecheckpoint(), and returns true. If there is no
+        checkpoint file, the function returns false. If the checkpoint file does not match the
+        simulation, a fatal error is thrown. */
+    bool readcheckpoint(int& stage, int& cycle, bool& convergence, double& Labsdusttot);
+
     //======================== Data Members ========================
 
 private:
@@ -139,6 +257,18 @@ private:
     // data members used to communicate between rundustXXX() and the corresponding parallel loop
     int _Ncells;           // number of dust cells
     Array _Labsbolv;       // vector that contains the bolometric absorbed luminosity in each cell
+
+    // data members used to cache the dust emission distributions across chunks
+    bool _writeCheckpoints;                         // discoverable attribute
+
+    double _emissionCacheMemory;                    // discoverable attribute, in GB
+    QMutex _cachemutex;                             // mutex to guard the cache data members below
+    QWaitCondition _cachecond;                      // signaled when a distribution has been calculated for the cache
+    std::vector< QSharedPointer<EmissionCdf> > _cdfv; // the cached distribution for each wavelength (or null)
+    std::vector<int> _Nremainingv;                  // the number of chunks yet to start for each wavelength
+    std::vector<char> _buildingv;                   // true for a wavelength whose distribution is being calculated
+    std::vector<int> _precalcellv;                  // the wavelength indices precalculated by initemissioncache()
+    double _cachebytes;                             // the number of bytes currently held by the cache
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -0,0 +1,43 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <algorithm>
+#include "Parallel.hpp"
+#include "ParallelChunkTarget.hpp"
+#include "ProcessAssigner.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////
+
+ParallelChunkTarget::ParallelChunkTarget(size_t Nitems)
+    : _Nitems(Nitems)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t ParallelChunkTarget::chunks() const
+{
+    return (_Nitems+CHUNKSIZE-1)/CHUNKSIZE;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelChunkTarget::call(Parallel* parallel, ProcessAssigner* assigner)
+{
+    assigner->assign(chunks());
+    parallel->call(this, assigner);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelChunkTarget::body(size_t chunk)
+{
+    size_t begin = chunk*CHUNKSIZE;
+    chunkbody(chunk, begin, min(_Nitems, begin+CHUNKSIZE));
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,55 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef PARALLELCHUNKTARGET_HPP
+#define PARALLELCHUNKTARGET_HPP
+
+#include "ParallelTarget.hpp"
+class Parallel;
+class ProcessAssigner;
+
+////////////////////////////////////////////////////////////////////
+
+/** ParallelChunkTarget is an abstract ParallelTarget subclass for parallel loops over a large
+    number of items (such as dust cells) that each require only a small amount of work. The items
+    are grouped into consecutive chunks of a fixed size, and each invocation of the body() function
+    handles a complete chunk, so that the overhead of distributing the work over the parallel
+    threads is amortized over many items. A derived class implements the chunkbody() function,
+    and may use the chunk index to store partial results (such as the extremal values of some
+    quantity) that are combined after the parallel loop has finished. */
+class ParallelChunkTarget : public ParallelTarget
+{
+public:
+    /** The number of items in a chunk. */
+    static const size_t CHUNKSIZE = 1024;
+
+    /** The constructor sets the number of items in the loop. */
+    ParallelChunkTarget(size_t Nitems);
+
+    /** This function returns the number of chunks, i.e. the number of items divided by the
+        chunk size, rounded up. */
+    size_t chunks() const;
+
+    /** This function assigns the chunks to the processes using the specified assigner, and then
+        calls the body() function for the chunks assigned to this process in the parallel threads of
+        the specified Parallel instance. */
+    void call(Parallel* parallel, ProcessAssigner* assigner);
+
+    /** This function implements the body of the parallel loop. It determines the range of items in
+        the chunk with the specified index and passes it to the chunkbody() function. */
+    void body(size_t chunk);
+
+protected:
+    /** This function handles the items with indices in the range [\em begin, \em end), which
+        form the chunk with the specified index. It must be implemented in the derived class. */
+    virtual void chunkbody(size_t chunk, size_t begin, size_t end) = 0;
+
+private:
+    size_t _Nitems;
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // PARALLELCHUNKTARGET_HPP
@@ -3,6 +3,7 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <atomic>
 #include "FatalError.hpp"
 #include "Parallel.hpp"
 #include "ParallelFactory.hpp"
@@ -11,6 +12,9 @@
 
 ParallelFactory::ParallelFactory()
 {
+    static std::atomic<quint64> serial(0);
+    _serial = ++serial;
+
     // initialize default maximum number of threads
     _maxThreadCount = defaultThreadCount();
 
@@ -69,11 +73,25 @@ Parallel* ParallelFactory::parallel(int maxThreadCount)
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the thread index cached for the factory identified by the serial number
+    thread_local quint64 cachedSerial = 0;
+    thread_local int cachedIndex = 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
 int ParallelFactory::currentThreadIndex() const
 {
-    int index = _indices.value(QThread::currentThread(), -1);
-    if (index<0) throw FATALERROR("Current thread index was not found");
-    return index;
+    if (cachedSerial != _serial)
+    {
+        int index = _indices.value(QThread::currentThread(), -1);
+        if (index<0) throw FATALERROR("Current thread index was not found");
+        cachedIndex = index;
+        cachedSerial = _serial;
+    }
+    return cachedIndex;
 }
 
 ////////////////////////////////////////////////////////////////////
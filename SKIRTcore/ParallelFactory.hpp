@@ -66,7 +66,8 @@ public:
         from within a loop body being iterated by one of the factory's Parallel children, the
         function returns an index from zero to the number of threads in the Parallel instance minus
         one. When invoked from a thread that does not belong to any of the factory's children, the
-        function throws a fatal error. */
+        function throws a fatal error. The index is cached in thread-local storage, so that
+        repeated calls from the same thread for the same factory are cheap. */
     int currentThreadIndex() const;
 
 private:
@@ -79,6 +80,7 @@ private:
 
 private:
     int _maxThreadCount;                // the maximum thread count for the factory
+    quint64 _serial;                    // a number that uniquely identifies this factory instance
     const QThread* _parentThread;       // the thread that invoked our constructor
     QHash<int, Parallel*> _children;    // our children, keyed on number of threads
     QHash<const QThread*,int> _indices; // the index for each thread, including parent, for all our children
@@ -263,6 +263,13 @@ int ParticleTreeDustGridStructure::extraLevels() const
 
 //////////////////////////////////////////////////////////////////////
 
+bool ParticleTreeDustGridStructure::dependsOnDistribution() const
+{
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double ParticleTreeDustGridStructure::xmax() const
 {
     return _xmax;
@@ -53,6 +53,53 @@ void PeerToPeerCommunicator::broadcast(int& value, int sender)
 
 ////////////////////////////////////////////////////////////////////
 
+void PeerToPeerCommunicator::alltoall(const Array& sendarr, const std::vector<int>& sendcounts,
+                                      Array& recvarr, const std::vector<int>& recvcounts)
+{
+    if (!isMultiProc())
+    {
+        recvarr = sendarr;
+        return;
+    }
+
+    // determine the offset of each block in the send and receive buffers
+    int Nprocs = size();
+    std::vector<int> senddispls(Nprocs), recvdispls(Nprocs);
+    for (int r=1; r<Nprocs; r++)
+    {
+        senddispls[r] = senddispls[r-1] + sendcounts[r-1];
+        recvdispls[r] = recvdispls[r-1] + recvcounts[r-1];
+    }
+
+    // guard against taking the address of the first element in an empty array
+    static double dummy = 0.;
+    ProcessManager::alltoall(sendarr.size() ? &sendarr[0] : &dummy, &sendcounts[0], &senddispls[0],
+                             recvarr.size() ? &recvarr[0] : &dummy, &recvcounts[0], &recvdispls[0]);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeerToPeerCommunicator::allgatherv(const Array& sendarr, Array& recvarr, const std::vector<int>& recvcounts)
+{
+    if (!isMultiProc())
+    {
+        recvarr = sendarr;
+        return;
+    }
+
+    // determine the offset of each block in the receive buffer
+    int Nprocs = size();
+    std::vector<int> recvdispls(Nprocs);
+    for (int r=1; r<Nprocs; r++) recvdispls[r] = recvdispls[r-1] + recvcounts[r-1];
+
+    // guard against taking the address of the first element in an empty array
+    static double dummy = 0.;
+    ProcessManager::allgatherv(sendarr.size() ? &sendarr[0] : &dummy, sendarr.size(),
+                               recvarr.size() ? &recvarr[0] : &dummy, &recvcounts[0], &recvdispls[0]);
+}
+
+////////////////////////////////////////////////////////////////////
+
 int PeerToPeerCommunicator::root()
 {
     return ROOT;
@@ -6,6 +6,7 @@
 #ifndef PEERTOPEERCOMMUNICATOR_HPP
 #define PEERTOPEERCOMMUNICATOR_HPP
 
+#include <vector>
 #include "ArrayTable.hpp"
 #include "ProcessCommunicator.hpp"
 class Array;
@@ -50,6 +51,25 @@ public:
         second argument. */
     void broadcast(int& value, int sender);
 
+    /** This function is used for exchanging blocks of values between all processes in the
+        communicator. The first argument contains the blocks to be sent to each process in order of
+        increasing rank, where the block sent to the process with rank \em r has \c sendcounts[r]
+        values. Similarly, the blocks received from each process are stored in order of increasing
+        rank in the Array passed as the third argument, where the block received from the process
+        with rank \em r has \c recvcounts[r] values. The receiving Array must be properly sized by
+        the caller. In a single process, the values are simply copied. */
+    void alltoall(const Array& sendarr, const std::vector<int>& sendcounts,
+                  Array& recvarr, const std::vector<int>& recvcounts);
+
+    /** This function is used for gathering blocks of values of variable size from all processes in
+        the communicator, and for distributing the concatenated result to all processes. Each process
+        contributes the values in the Array passed as the first argument. The blocks are stored in
+        order of increasing rank in the Array passed as the second argument, where the block
+        contributed by the process with rank \em r has \c recvcounts[r] values; this number must
+        equal the size of the first Array at that process. The receiving Array must be properly
+        sized by the caller. In a single process, the values are simply copied. */
+    void allgatherv(const Array& sendarr, Array& recvarr, const std::vector<int>& recvcounts);
+
     /** This function returns the rank of the root process. */
     int root();
 
@@ -8,7 +8,6 @@
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "FITSInOut.hpp"
-#include "LockFree.hpp"
 #include "Log.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
@@ -30,7 +29,8 @@ namespace
 ////////////////////////////////////////////////////////////////////
 
 PerspectiveInstrument::PerspectiveInstrument()
-    : _Nx(0), _Ny(0), _Sx(0), _Vx(0), _Vy(0), _Vz(0), _Cx(0), _Cy(0), _Cz(0), _Ux(0), _Uy(0), _Uz(0), _Fe(0)
+    : _Nx(0), _Ny(0), _Sx(0), _Vx(0), _Vy(0), _Vz(0), _Cx(0), _Cy(0), _Cz(0), _Ux(0), _Uy(0), _Uz(0), _Fe(0),
+      _ftoth(-1)
 {
 }
 
@@ -105,6 +105,7 @@ void PerspectiveInstrument::setupSelfBefore()
     // the data cube
     int Nlambda = find<WavelengthGrid>()->Nlambda();
     _ftotv.resize(Nlambda*_Nx*_Ny);
+    _ftoth = registerDetector(_ftotv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -352,7 +353,7 @@ void PerspectiveInstrument::detect(PhotonPackage* pp)
         // add the adjusted luminosity to the appropriate pixel in the data cube
         int ell = pp->ell();
         int m = i + _Nx*j + _Nx*_Ny*ell;
-        LockFree::add(_ftotv[m], L);
+        record(_ftoth, m, L);
     }
 }
 
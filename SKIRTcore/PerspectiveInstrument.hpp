@@ -225,6 +225,7 @@ private:
 
     // data cube
     Array _ftotv;
+    int _ftoth;             // handle for the registered data cube
 };
 
 ////////////////////////////////////////////////////////////////////
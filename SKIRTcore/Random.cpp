@@ -3,8 +3,10 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <atomic>
 #include <cmath>
 #include "Box.hpp"
+#include "CheckpointFile.hpp"
 #include "FatalError.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
@@ -18,8 +20,10 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 Random::Random()
-    : _seed(4357), _parfac(0)
+    : _seed(4357), _generator(MersenneTwister), _rank(0), _parfac(0)
 {
+    static std::atomic<quint64> serial(0);
+    _serial = ++serial;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -29,11 +33,7 @@ void Random::setupSelfBefore()
     SimulationItem::setupSelfBefore();
 
     _parfac = find<ParallelFactory>();
-    int Nthreads = _parfac->maxThreadCount();
-    _mtv.resize(Nthreads);
-    _mtiv.resize(Nthreads);
-
-    initialize(Nthreads);
+    reset();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -52,6 +52,16 @@ void Random::initialize(int Nthreads)
         for (mti=1; mti<624; mti++)
             mt[mti] = (69069 * mt[mti-1]) & 0xffffffff;
         ++seed;
+
+        // the Philox key depends only on the configured seed and the process rank, so that a stream
+        // selected through setStream() is independent of the thread and of the number of threads;
+        // by default, each thread uses its own stream, identified by the thread index in the counter
+        PhiloxState& ph = _phv[thread];
+        ph.key[0] = _seed - Nthreads*_rank;
+        ph.key[1] = _rank;
+        ph.stream = (static_cast<quint64>(0xFFFFFFFF) << 32) | thread;
+        ph.counter = 0;
+        ph.next = 2;
     }
 }
 
@@ -71,6 +81,20 @@ int Random::seed() const
 
 //////////////////////////////////////////////////////////////////////
 
+void Random::setGenerator(Random::Generator value)
+{
+    _generator = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Random::Generator Random::generator() const
+{
+    return _generator;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void Random::randomize()
 {
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
@@ -78,51 +102,202 @@ void Random::randomize()
     int Nthreads = _parfac->maxThreadCount();
     _mtv.resize(Nthreads);      // Because the number of threads can be different during and after the setup
     _mtiv.resize(Nthreads);     // of the simulation.
+    _phv.resize(Nthreads);
 
-    _seed = _seed + Nthreads * comm->rank();
+    _rank = comm->rank();
+    _seed = _seed + Nthreads * _rank;
 
     initialize(Nthreads);
 }
 
 //////////////////////////////////////////////////////////////////////
 
-double
-Random::uniform()
+void Random::reset()
+{
+    int Nthreads = _parfac->maxThreadCount();
+    _mtv.resize(Nthreads);
+    _mtiv.resize(Nthreads);
+    _phv.resize(Nthreads);
+
+    initialize(Nthreads);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Random::saveState(CheckpointFile& file) const
+{
+    int Nthreads = _mtv.size();
+    file.writeInt(_generator);
+    file.writeInt(Nthreads);
+    for (int thread=0; thread<Nthreads; thread++)
+    {
+        file.writeData(&_mtv[thread][0], _mtv[thread].size()*sizeof(unsigned long));
+        file.writeInt(_mtiv[thread]);
+        file.writeData(&_phv[thread], sizeof(PhiloxState));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Random::restoreState(CheckpointFile& file)
 {
-    int thread = _parfac->currentThreadIndex();
-    vector<unsigned long>& mt = _mtv[thread];
-    int& mti = _mtiv[thread];
-    double ans = 0.0;
-    do
+    int Nthreads = _mtv.size();
+    file.verifyInt(_generator, "random generator engine");
+    file.verifyInt(Nthreads, "number of threads");
+    for (int thread=0; thread<Nthreads; thread++)
+    {
+        file.readData(&_mtv[thread][0], _mtv[thread].size()*sizeof(unsigned long));
+        _mtiv[thread] = file.readInt();
+        file.readData(&_phv[thread], sizeof(PhiloxState));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // generates the next uniform deviate in the open interval (0,1) from the specified generator state
+    inline double genrand(vector<unsigned long>& mt, int& mti)
     {
-        unsigned long y;
-        static unsigned long mag01[2]={0x0,0x9908b0df};
-        if (mti >= 624)
+        double ans = 0.0;
+        do
         {
-            int kk;
-            for (kk=0;kk<227;kk++)
-            {
-                y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
-                mt[kk] = mt[kk+397] ^ (y >> 1) ^ mag01[y & 0x1];
-            }
-            for (;kk<624-1;kk++)
+            unsigned long y;
+            static unsigned long mag01[2]={0x0,0x9908b0df};
+            if (mti >= 624)
             {
-                y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
-                mt[kk] = mt[kk-227] ^ (y >> 1) ^ mag01[y & 0x1];
+                int kk;
+                for (kk=0;kk<227;kk++)
+                {
+                    y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
+                    mt[kk] = mt[kk+397] ^ (y >> 1) ^ mag01[y & 0x1];
+                }
+                for (;kk<624-1;kk++)
+                {
+                    y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
+                    mt[kk] = mt[kk-227] ^ (y >> 1) ^ mag01[y & 0x1];
+                }
+                y = (mt[623]&0x80000000)|(mt[0]&0x7fffffff);
+                mt[623] = mt[396] ^ (y >> 1) ^ mag01[y & 0x1];
+                mti = 0;
             }
-            y = (mt[623]&0x80000000)|(mt[0]&0x7fffffff);
-            mt[623] = mt[396] ^ (y >> 1) ^ mag01[y & 0x1];
-            mti = 0;
+            y = mt[mti++];
+            y ^= (y>>11);
+            y ^= (y<<7) & 0x9d2c5680;
+            y ^= (y<<15) & 0xefc60000;
+            y ^= (y>>18);
+            ans = static_cast<double>(y) / static_cast<unsigned long>(0xffffffff);
+        }
+        while (ans<=0.0 || ans>=1.0);
+        return ans;
+    }
+
+    // the multipliers and key increments (Weyl sequence) for the Philox4x32 generator
+    const quint32 PHILOX_M0 = 0xD2511F53;
+    const quint32 PHILOX_M1 = 0xCD9E8D57;
+    const quint32 PHILOX_W0 = 0x9E3779B9;
+    const quint32 PHILOX_W1 = 0xBB67AE85;
+
+    // encrypts the 128-bit counter x in place with the specified key using 10 Philox rounds
+    inline void philox(quint32 x[4], const quint32 key[2])
+    {
+        quint32 k0 = key[0];
+        quint32 k1 = key[1];
+        for (int round=0; round<10; round++)
+        {
+            quint64 p0 = static_cast<quint64>(PHILOX_M0) * x[0];
+            quint64 p1 = static_cast<quint64>(PHILOX_M1) * x[2];
+            quint32 y0 = static_cast<quint32>(p1 >> 32) ^ x[1] ^ k0;
+            quint32 y1 = static_cast<quint32>(p1);
+            quint32 y2 = static_cast<quint32>(p0 >> 32) ^ x[3] ^ k1;
+            quint32 y3 = static_cast<quint32>(p0);
+            x[0] = y0; x[1] = y1; x[2] = y2; x[3] = y3;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
         }
-        y = mt[mti++];
-        y ^= (y>>11);
-        y ^= (y<<7) & 0x9d2c5680;
-        y ^= (y<<15) & 0xefc60000;
-        y ^= (y>>18);
-        ans = static_cast<double>(y) / static_cast<unsigned long>(0xffffffff);
     }
-    while (ans<=0.0 || ans>=1.0);
-    return ans;
+
+    // converts the upper 53 bits of a 64-bit integer to a double in the open interval (0,1)
+    inline double todouble(quint64 hi, quint64 lo)
+    {
+        quint64 bits = (hi << 32) | lo;
+        return ((bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    // the cached thread index for the Random instance identified by the serial number
+    thread_local quint64 cachedSerial = 0;
+    thread_local int cachedThread = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int Random::threadIndex() const
+{
+    if (cachedSerial != _serial)
+    {
+        cachedThread = _parfac->currentThreadIndex();
+        cachedSerial = _serial;
+    }
+    return cachedThread;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Random::setStream(quint64 major, quint64 minor)
+{
+    if (_generator == Philox)
+    {
+        PhiloxState& ph = _phv[threadIndex()];
+        ph.stream = (major << 32) | (minor & 0xFFFFFFFF);
+        ph.counter = 0;
+        ph.next = 2;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double Random::philoxuniform(PhiloxState& ph)
+{
+    if (ph.next == 2)
+    {
+        quint32 x[4] = { static_cast<quint32>(ph.counter), static_cast<quint32>(ph.counter >> 32),
+                         static_cast<quint32>(ph.stream), static_cast<quint32>(ph.stream >> 32) };
+        philox(x, ph.key);
+        ph.buffer[0] = todouble(x[0], x[1]);
+        ph.buffer[1] = todouble(x[2], x[3]);
+        ph.counter++;
+        ph.next = 0;
+    }
+    return ph.buffer[ph.next++];
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double
+Random::uniform()
+{
+    int thread = threadIndex();
+    if (_generator == Philox) return philoxuniform(_phv[thread]);
+    return genrand(_mtv[thread], _mtiv[thread]);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void
+Random::uniform(double* xv, int n)
+{
+    int thread = threadIndex();
+    if (_generator == Philox)
+    {
+        PhiloxState& ph = _phv[thread];
+        for (int i=0; i<n; i++) xv[i] = philoxuniform(ph);
+    }
+    else
+    {
+        vector<unsigned long>& mt = _mtv[thread];
+        int& mti = _mtiv[thread];
+        for (int i=0; i<n; i++) xv[i] = genrand(mt, mti);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////
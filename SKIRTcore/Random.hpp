@@ -10,6 +10,7 @@
 #include "Array.hpp"
 #include "SimulationItem.hpp"
 class Box;
+class CheckpointFile;
 class Direction;
 class ParallelFactory;
 class Position;
@@ -18,9 +19,24 @@ class Position;
 
 /** This class contains a random number generator, and can be used to produce series of random
     numbers for different probability distributions. Typically, only a single instance of the class
-    should be constructed for each simulation. This random number class is adapted from a C library
-    known as genrand(), written by Takuji Nishimura. More information can be found at
-    http://www.math.keio.ac.jp/matumoto/emt.html. */
+    should be constructed for each simulation. Two generator engines are available.
+
+    The default engine is the Mersenne Twister, adapted from a C library known as genrand(), written
+    by Takuji Nishimura. More information can be found at
+    http://www.math.keio.ac.jp/matumoto/emt.html. Each execution thread has its own generator,
+    seeded with a different value, so that the random sequence consumed by a particular task
+    depends on the thread that happens to execute it.
+
+    The alternative engine is the counter-based Philox4x32-10 generator described by Salmon et al.
+    (2011, Proceedings of the International Conference for High Performance Computing, Networking,
+    Storage and Analysis). Each random number is obtained by encrypting a 128-bit counter with a
+    64-bit key derived from the seed, so that the generator state is trivially small and any
+    position in any stream can be reached instantly. A client can select a stream through the
+    setStream() function; after this call, the random numbers generated in the current thread are
+    determined solely by the seed, the process rank, and the stream identifiers, regardless of the
+    thread executing the task. In particular, the Monte Carlo simulations select a stream for each
+    chunk of photon packages, so that their results no longer depend on the number of threads or on
+    the order in which the threads pick up the chunks. */
 class Random : public SimulationItem
 {
     Q_OBJECT
@@ -31,10 +47,18 @@ class Random : public SimulationItem
     Q_CLASSINFO("MinValue", "1")
     Q_CLASSINFO("Default", "4357")
 
+    Q_CLASSINFO("Property", "generator")
+    Q_CLASSINFO("Title", "the random generator engine")
+    Q_CLASSINFO("MersenneTwister", "the Mersenne Twister with a separate sequence for each thread")
+    Q_CLASSINFO("Philox", "the counter-based Philox generator with a reproducible stream for each chunk")
+    Q_CLASSINFO("Default", "MersenneTwister")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
-    /** The constructor sets a default value for the seed (see setSeed()). */
+    /** The constructor sets default values for the seed (see setSeed()) and the generator engine
+        (see setGenerator()). */
     Q_INVOKABLE Random();
 
 protected:
@@ -43,13 +67,14 @@ protected:
     void setupSelfBefore();
 
 private:
-    /** This function serves as the body of two different functions: the setupSelfBefore() function and
-        the randomize() function. Based on the seed stored in the \c _seed attribute, this function
-        generates random sequences for each different thread in the simulation. This is done by
-        incrementing the seed with each increment of the thread number. During setup, the \c _seed
-        variable is equal on each process, providing them with the same random sequences. When this
-        function is called from randomize(), each process has given a different seed, yielding
-        different random sequences for every thread in the multiprocessing environment. */
+    /** This function serves as the body of two different functions: the reset() function (which is
+        also called during setup) and the randomize() function. Based on the seed stored in the \c
+        _seed attribute, this function generates random sequences for each different thread in the
+        simulation. This is done by incrementing the seed with each increment of the thread number.
+        During setup, the \c _seed variable is equal on each process, providing them with the same
+        random sequences. When this function is called from randomize(), each process has given a
+        different seed, yielding different random sequences for every thread in the
+        multiprocessing environment. */
     void initialize(int Nthreads);
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -62,6 +87,17 @@ public:
     /** This function returns the current value of the seed. */
     Q_INVOKABLE int seed() const;
 
+    /** The enumeration type indicating the random generator engine. */
+    Q_ENUMS(Generator)
+    enum Generator { MersenneTwister, Philox };
+
+    /** This function sets the enumeration value indicating the random generator engine, as
+        described in the class header. The default value is MersenneTwister. */
+    Q_INVOKABLE void setGenerator(Generator value);
+
+    /** This function returns the enumeration value indicating the random generator engine. */
+    Q_INVOKABLE Generator generator() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -73,11 +109,41 @@ public:
         \image html randomize.png "The randomize function makes sure that each process ‘reserves’ a unique set of random seeds for its own threads." */
     void randomize();
 
+    /** This function restarts the random sequences for all threads from the current value of the
+        seed, exactly as during setup, so that a simulation that is run again on the same hierarchy
+        draws the same random numbers as a fresh simulation. */
+    void reset();
+
+    /** This function writes the current state of the random generators for all threads to the
+        specified checkpoint file. It must not be called while a parallel loop is in progress. */
+    void saveState(CheckpointFile& file) const;
+
+    /** This function restores the state of the random generators for all threads from the
+        specified checkpoint file, as written by saveState(). The generator engine and the number of
+        threads must be the same as those for the simulation that wrote the checkpoint; if not, a
+        fatal error is thrown. */
+    void restoreState(CheckpointFile& file);
+
+    /** This function selects the random stream used by the current thread from now on, identified
+        by two numbers that are meaningful to the caller. For example, the Monte Carlo simulations
+        pass the sequence number of the photon shooting phase and the index of the chunk being
+        processed. For the counter-based Philox engine, the stream of random numbers produced after
+        this call depends only on the seed, the process rank, and the two specified numbers; both
+        numbers must be smaller than \f$2^{32}-1\f$. For the Mersenne Twister engine, this
+        function does nothing. */
+    void setStream(quint64 major, quint64 minor);
+
     /** This function generates a random uniform deviate, i.e. a random double precision number in
-        the interval [0,1]. For details how this is exactly done, see the information at
-        http://www.math.keio.ac.jp/matumoto/emt.html. */
+        the interval (0,1), using the generator engine and the stream for the current thread. */
     double uniform();
 
+    /** This function stores \em n random uniform deviates in the array pointed to by \em xv. The
+        resulting sequence is identical to the one produced by \em n consecutive calls to the
+        uniform() function, but the state of the generator for the current thread is looked up only
+        once. This allows batched code to generate all random numbers needed for a processing stage
+        in one go, and to perform the subsequent calculations in tight loops over plain arrays. */
+    void uniform(double* xv, int n);
+
     /** This function generates a random number drawn from an arbitrary probability distribution
         \f$p(x)\,{\text{d}}x\f$ with corresponding cumulative distribution function \f$P(x)\f$.
         The routine reads in a discretized version \f$P_i\f$ of the cdf sampled at a set of
@@ -138,6 +204,27 @@ public:
     double scpf(double p);
 
 
+private:
+    /** This function returns the index of the current thread. It obtains the index from the
+        ParallelFactory only the first time it is called for this Random instance from a particular
+        thread, and caches it in a thread-local variable for subsequent calls. */
+    int threadIndex() const;
+
+    // the state of a Philox generator for a single thread
+    struct PhiloxState
+    {
+        quint32 key[2];    // the key, derived from the seed and the process rank
+        quint64 stream;    // the upper 64 bits of the counter, identifying the stream
+        quint64 counter;   // the lower 64 bits of the counter, i.e. the block index within the stream
+        double buffer[2];  // the two random numbers produced from the most recent block
+        int next;          // the index in the buffer of the next random number to be returned
+    };
+
+    /** This function generates the next uniform deviate in the open interval (0,1) from the
+        specified Philox generator state. Each evaluation of the Philox function on the counter
+        yields 128 random bits, which are used to produce two double precision numbers. */
+    static double philoxuniform(PhiloxState& ph);
+
     //======================== Data Members ========================
 
 private:
@@ -145,10 +232,20 @@ private:
     // (maintaining a separate generator per thread avoids time-consuming data locking)
     std::vector< std::vector<unsigned long> > _mtv;
     std::vector<int> _mtiv;
+    std::vector<PhiloxState> _phv;
 
     // the seed used to initialize the random generators (the value is incremented between generators)
     int _seed;
 
+    // the random generator engine
+    Generator _generator;
+
+    // the rank of this process, set by randomize(); used to give each process its own Philox key
+    int _rank;
+
+    // a number that uniquely identifies this instance, used to validate the cached thread index
+    quint64 _serial;
+
     // a cached pointer to the ParallelFactory instance associated with this simulation hierarchy
     ParallelFactory* _parfac;
 };
@@ -80,7 +80,7 @@ size_t RandomAssigner::absoluteIndex(size_t relativeIndex)
     size_t block = relativeIndex / _valuesInBlock;
     relativeIndex = relativeIndex - block*_valuesInBlock;
 
-    return _values[relativeIndex];
+    return block*_blocksize + _values[relativeIndex];
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -92,7 +92,7 @@ size_t RandomAssigner::relativeIndex(size_t absoluteIndex)
     size_t block = absoluteIndex / _blocksize;
     absoluteIndex = absoluteIndex - block*_blocksize;
 
-    return std::find(_values.begin(), _values.end(), absoluteIndex) - _values.begin();
+    return block*_valuesInBlock + (std::find(_values.begin(), _values.end(), absoluteIndex) - _values.begin());
 }
 
 ////////////////////////////////////////////////////////////////////
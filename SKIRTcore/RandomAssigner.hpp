@@ -66,14 +66,16 @@ public:
     /** This function takes the relative index of a certain part of the work assigned to this process
         as an argument and returns the absolute index of that part, a value from zero to the total
         amount of parts that need to be executed in the simulation. This is done by simply looking up
-        the value in the _values list. */
+        the value in the _values list. If \c blocks > 1, the index of the block multiplied by the block
+        size is added, so that each part of the work in each block has a distinct absolute index. */
     size_t absoluteIndex(size_t relativeIndex);
 
     /** This function takes the absolute index of a certain part of the work as an argument and returns
         the relative index of that part, a value from zero to the number of parts that were assigned to
         this process, _nvalues. This is done by performing a search through the _values list for the
         value that matches the absoluteIndex. The relative index that is returned corresponds to the
-        index of that value in the _values list. */
+        index of that value in the _values list, offset by the number of values assigned to this
+        process in the preceding blocks. */
     size_t relativeIndex(size_t absoluteIndex);
 
     /** This function returns the rank of the process that is assigned to a certain part of the work.
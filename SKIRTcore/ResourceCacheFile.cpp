@@ -0,0 +1,144 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstring>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include "FatalError.hpp"
+#include "ResourceCacheFile.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the file header: magic string, format version and byte order marker
+    const char* MAGIC = "SKIRTRES";
+    const qint64 VERSION = 1;
+    const qint64 BYTEORDER = 1;
+    const int HEADERSIZE = 8 + 2*sizeof(qint64);
+
+    // the extension appended to the cache name to form the cache file name
+    const char* EXTENSION = ".sres";
+}
+
+////////////////////////////////////////////////////////////////////
+
+ResourceCacheFile::ResourceCacheFile(QString name, QStringList sourcepaths)
+    : _data(0), _size(0), _pos(HEADERSIZE), _ok(true)
+{
+    // determine the directory for the cache file
+    QString dirpath = sourcepaths.isEmpty() ? QString() : QFileInfo(sourcepaths.first()).absolutePath();
+    if (dirpath.isEmpty() || !QFileInfo(dirpath).isWritable())
+    {
+        dirpath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        QDir().mkpath(dirpath);
+    }
+    _filepath = QDir(dirpath).filePath(name + EXTENSION);
+
+    // verify that the cache file exists and is up to date
+    QFileInfo cacheinfo(_filepath);
+    if (!cacheinfo.exists()) return;
+    foreach (QString sourcepath, sourcepaths)
+    {
+        QFileInfo sourceinfo(sourcepath);
+        if (sourceinfo.exists() && cacheinfo.lastModified() < sourceinfo.lastModified()) return;
+    }
+
+    // map the complete file into memory and verify the header
+    _infile.setFileName(_filepath);
+    if (!_infile.open(QIODevice::ReadOnly)) return;
+    qint64 size = _infile.size();
+    const uchar* data = size >= HEADERSIZE ? _infile.map(0, size) : 0;
+    if (!data || memcmp(data, MAGIC, 8)) return;
+    qint64 header[2];
+    memcpy(header, data+8, sizeof(header));
+    if (header[0] != VERSION || header[1] != BYTEORDER) return;
+    _data = data;
+    _size = size;
+}
+
+////////////////////////////////////////////////////////////////////
+
+ResourceCacheFile::~ResourceCacheFile()
+{
+    _infile.close();  // this also releases the memory map
+    if (_outfile.isOpen())
+    {
+        _outfile.close();
+        _outfile.remove();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ResourceCacheFile::isCached() const
+{
+    return _data != 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString ResourceCacheFile::filepath() const
+{
+    return _filepath;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ResourceCacheFile::readArray(Array& values)
+{
+    qint64 n = -1;
+    if (_data && _pos + qint64(sizeof(qint64)) <= _size) memcpy(&n, _data+_pos, sizeof(qint64));
+    if (n < 0 || _pos + qint64(sizeof(qint64)) + n*qint64(sizeof(double)) > _size)
+        throw FATALERROR("The resource cache file " + _filepath + " is inconsistent; remove it and try again");
+    _pos += sizeof(qint64);
+    values.resize(n);
+    if (n) memcpy(begin(values), _data+_pos, n*sizeof(double));
+    _pos += n*sizeof(double);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ResourceCacheFile::writeArray(const Array& values)
+{
+    // open the temporary file and write the header when needed;
+    // the temporary file name is unique to this object since several simulations may run in the same process
+    if (!_outfile.isOpen() && _ok)
+    {
+        _outfile.setFileName(_filepath + "." + QString::number(QCoreApplication::applicationPid()) + "."
+                             + QString::number(reinterpret_cast<quintptr>(this), 16) + ".tmp");
+        _ok = _outfile.open(QIODevice::WriteOnly);
+        _ok = _ok && _outfile.write(MAGIC, 8) == 8;
+        _ok = _ok && _outfile.write(reinterpret_cast<const char*>(&VERSION), sizeof(qint64)) == sizeof(qint64);
+        _ok = _ok && _outfile.write(reinterpret_cast<const char*>(&BYTEORDER), sizeof(qint64)) == sizeof(qint64);
+    }
+
+    // write the array
+    qint64 n = values.size();
+    qint64 size = n*sizeof(double);
+    _ok = _ok && _outfile.write(reinterpret_cast<const char*>(&n), sizeof(qint64)) == sizeof(qint64);
+    _ok = _ok && (!size || _outfile.write(reinterpret_cast<const char*>(begin(values)), size) == size);
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ResourceCacheFile::save()
+{
+    if (!_outfile.isOpen()) return false;
+    _outfile.close();
+    bool ok = _ok;
+    if (ok)
+    {
+        QFile::remove(_filepath);
+        ok = _outfile.rename(_filepath);
+    }
+    if (!ok) _outfile.remove();
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,82 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef RESOURCECACHEFILE_HPP
+#define RESOURCECACHEFILE_HPP
+
+#include <QFile>
+#include <QStringList>
+#include "Array.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+/** ResourceCacheFile is a technical class for caching the data parsed from one or more text
+    resource files, such as the libraries of stellar population SEDs, in a binary file that is
+    mapped into memory when it is used. This avoids parsing the same text files for every
+    simulation. A cache file consists of the 8 characters "SKIRTRES", a 64-bit format version
+    number (currently 1) and a 64-bit byte order marker with the value 1, followed by a sequence of
+    arrays, each consisting of a 64-bit element count and the corresponding double-precision
+    values. All numbers are stored in the native byte order of the host; a cache file written on a
+    host with a different byte order is ignored. There is no other metadata, so the arrays must be
+    read in exactly the same order as they were written.
+
+    The cache file has the name specified by the client with the extension ".sres" appended. It is
+    stored in the directory holding the first source file if that directory is writable, and in
+    the user's cache directory otherwise. The cache file is used only if it is not older than any
+    of the source files. To avoid exposing a partially written cache file to concurrent
+    simulations, the data is written to a temporary file, which replaces the actual cache file only
+    when it is complete.
+
+    A client constructs a ResourceCacheFile instance and calls isCached(). If this function
+    returns true, the client obtains the data by calling readArray() as many times as needed.
+    Otherwise, the client parses the text resource files, passes the resulting data to
+    writeArray(), and finally calls save(). */
+class ResourceCacheFile
+{
+public:
+    /** The constructor determines the path of the cache file with the specified name for the
+        specified list of source files, as described in the class header. If an up-to-date cache
+        file exists and its header is valid, the file is mapped into memory. */
+    ResourceCacheFile(QString name, QStringList sourcepaths);
+
+    /** The destructor closes the cache file, releasing the memory map if applicable, and removes
+        the temporary file if save() was not called after writing data. */
+    ~ResourceCacheFile();
+
+    /** This function returns true if an up-to-date cache file has been mapped into memory, so that
+        the data can be obtained through readArray(). */
+    bool isCached() const;
+
+    /** This function returns the path of the cache file. */
+    QString filepath() const;
+
+    /** This function copies the next array from the memory-mapped cache file into the specified
+        target array, resizing it as needed. If there is no next array, a fatal error is thrown. */
+    void readArray(Array& values);
+
+    /** This function writes the size of the specified array followed by its values to the
+        temporary file that will replace the cache file when save() is called. */
+    void writeArray(const Array& values);
+
+    /** This function completes a cache file written through writeArray(), and replaces any
+        existing cache file with it. It returns true if successful, and false if the cache file
+        could not be written (for example, because the directory is not writable). A failure to
+        write the cache file is not fatal since the data can always be parsed from the source
+        files. */
+    bool save();
+
+private:
+    QString _filepath;      // the path of the cache file
+    QFile _infile;          // the cache file being read
+    const uchar* _data;     // pointer to the memory map, or null if there is no valid cache file
+    qint64 _size;           // the size of the memory map in bytes
+    qint64 _pos;            // the offset in the memory map of the next array
+    QFile _outfile;         // the temporary file being written
+    bool _ok;               // false if an error occurred while writing
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // RESOURCECACHEFILE_HPP
@@ -4,7 +4,6 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "FatalError.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "SEDInstrument.hpp"
 #include "WavelengthGrid.hpp"
@@ -14,6 +13,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 SEDInstrument::SEDInstrument()
+    : _Ftoth(-1)
 {
 }
 
@@ -25,6 +25,7 @@ void SEDInstrument::setupSelfBefore()
 
     int Nlambda = find<WavelengthGrid>()->Nlambda();
     _Ftotv.resize(Nlambda);
+    _Ftoth = registerDetector(_Ftotv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -38,7 +39,7 @@ SEDInstrument::detect(PhotonPackage* pp)
     double extf = exp(-taupath);
     double Lextf = L*extf;
 
-    LockFree::add(_Ftotv[ell], Lextf);
+    record(_Ftoth, ell, Lextf);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -43,6 +43,7 @@ protected:
 
 private:
     Array _Ftotv;
+    int _Ftoth;     // handle for the registered detector array _Ftotv
 };
 
 ////////////////////////////////////////////////////////////////////
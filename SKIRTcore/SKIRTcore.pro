@@ -59,6 +59,8 @@ HEADERS += \
     BolLuminosityStellarCompNormalization.hpp \
     BruzualCharlotSED.hpp \
     BruzualCharlotSEDFamily.hpp \
+    CheckpointFile.hpp \
+    ColumnDataFile.hpp \
     CompDustDistribution.hpp \
     ConfigurableDustMix.hpp \
     Console.hpp \
@@ -167,6 +169,7 @@ HEADERS += \
     PanStellarComp.hpp \
     PanWavelengthGrid.hpp \
     Parallel.hpp \
+    ParallelChunkTarget.hpp \
     ParallelFactory.hpp \
     ParallelTarget.hpp \
     ParticleTreeDustGridStructure.hpp \
@@ -185,13 +188,14 @@ HEADERS += \
     QuasarSED.hpp \
     RadialDustCompNormalization.hpp \
     Random.hpp \
+    ResourceCacheFile.hpp \
     RingGeometry.hpp \
     SED.hpp \
     SEDInstrument.hpp \
     SIUnits.hpp \
     SPHDustDistribution.hpp \
     SPHGasParticle.hpp \
-    SPHGasParticleGrid.hpp \
+    SPHGasParticleTree.hpp \
     SepAxGeometry.hpp \
     SersicFunction.hpp \
     SersicGeometry.hpp \
@@ -235,6 +239,7 @@ HEADERS += \
     UniformCuboidGeometry.hpp \
     UniformSmoothingKernel.hpp \
     Units.hpp \
+    VoigtProfile.hpp \
     VoronoiDustDistribution.hpp \
     VoronoiDustGridStructure.hpp \
     VoronoiGeometry.hpp \
@@ -324,6 +329,8 @@ SOURCES += \
     BolLuminosityStellarCompNormalization.cpp \
     BruzualCharlotSED.cpp \
     BruzualCharlotSEDFamily.cpp \
+    CheckpointFile.cpp \
+    ColumnDataFile.cpp \
     CompDustDistribution.cpp \
     ConfigurableDustMix.cpp \
     Console.cpp \
@@ -427,6 +434,7 @@ SOURCES += \
     PanStellarComp.cpp \
     PanWavelengthGrid.cpp \
     Parallel.cpp \
+    ParallelChunkTarget.cpp \
     ParallelFactory.cpp \
     ParallelTarget.cpp \
     ParticleTreeDustGridStructure.cpp \
@@ -445,13 +453,14 @@ SOURCES += \
     QuasarSED.cpp \
     RadialDustCompNormalization.cpp \
     Random.cpp \
+    ResourceCacheFile.cpp \
     RingGeometry.cpp \
     SED.cpp \
     SEDInstrument.cpp \
     SIUnits.cpp \
     SPHDustDistribution.cpp \
     SPHGasParticle.cpp \
-    SPHGasParticleGrid.cpp \
+    SPHGasParticleTree.cpp \
     SepAxGeometry.cpp \
     SersicFunction.cpp \
     SersicGeometry.cpp \
@@ -494,6 +503,7 @@ SOURCES += \
     UniformCuboidGeometry.cpp \
     UniformSmoothingKernel.cpp \
     Units.cpp \
+    VoigtProfile.cpp \
     VoronoiDustDistribution.cpp \
     VoronoiDustGridStructure.cpp \
     VoronoiGeometry.cpp \
@@ -7,12 +7,13 @@
 #define SPHDUSTDISTRIBUTION_HPP
 
 #include <vector>
+#include "AliasTable.hpp"
 #include "Array.hpp"
 #include "DustDistribution.hpp"
 #include "DustMassInBoxInterface.hpp"
 #include "DustParticleInterface.hpp"
 #include "SPHGasParticle.hpp"
-class SPHGasParticleGrid;
+class SPHGasParticleTree;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -44,6 +45,13 @@ class SPHDustDistribution : public DustDistribution, public DustMassInBoxInterfa
     Q_CLASSINFO("Title", "the dust mix describing the attributes of the dust")
     Q_CLASSINFO("Default", "InterstellarDustMix")
 
+    Q_CLASSINFO("Property", "leafSize")
+    Q_CLASSINFO("Title", "the maximum number of particles per leaf in the intermediate particle tree")
+    Q_CLASSINFO("MinValue", "1")
+    Q_CLASSINFO("MaxValue", "100000")
+    Q_CLASSINFO("Default", "128")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -70,7 +78,9 @@ public:
         particle (in \f$M_\odot\f$), and the sixth column is the metallicity \f$Z\f$ of the gas
         (dimensionless fraction). The optional seventh column is the temperature of the gas (in K).
         If this value is provided and it is higher than the maximum temperature the particle is
-        ignored. If the temperature value is missing, the particle is never ignored. */
+        ignored. If the temperature value is missing, the particle is never ignored.
+        If a binary version of the file exists as described for the ColumnDataFile class, it is
+        used instead of the text file. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH gas particles. */
@@ -96,6 +106,19 @@ public:
     /** Returns the DustMix instance that describes the attributes of the dust. See also mix(). */
     Q_INVOKABLE DustMix* dustMix() const;
 
+    /** Sets the maximum number of particles overlapping a leaf in the adaptive tree that is
+        constructed over the particle space during setup to speed up density queries. Leaves with
+        more particles are split further, unless splitting no longer substantially reduces the number
+        of particles, which happens for regions overlapped by many large particles. Since each SPH
+        particle typically overlaps some 50 to 60 neighbours, the leaf size should be well above
+        that number. Smaller values lead to faster queries at the cost of a deeper tree, more
+        memory and a longer construction time. The default value is 128. */
+    Q_INVOKABLE void setLeafSize(int value);
+
+    /** Returns the maximum number of particles overlapping a leaf in the adaptive particle tree.
+        */
+    Q_INVOKABLE int leafSize() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -130,8 +153,9 @@ public:
     double density(Position bfr) const;
 
     /** This function generates a random position from the dust distribution. It randomly chooses a
-        particle using the normalized cumulative density distribution constructed during the setup
-        phase. Then a position is determined randomly from the smoothed distribution around the
+        particle using the alias table or the normalized cumulative density distribution
+        constructed during the setup phase, depending on the MonteCarloSimulation::aliasSampling()
+        flag. Then a position is determined randomly from the smoothed distribution around the
         particle center. The function assumes the scaled Gaussian smoothing kernel \f[ W(h,r) =
         \frac{a^3}{\pi^{3/2}\,h^3} \,\exp({-\frac{a^2 r^2}{h^2}}) \f] with the empirically
         determined value of \f$a=2.42\f$, which approximates the standard cubic spline kernel to
@@ -203,11 +227,13 @@ private:
     double _fdust;
     double _Tmax;
     DustMix* _mix;
+    int _leafsize;
 
     // the SPH particles
     std::vector<SPHGasParticle> _pv;  // the particles in the order read from the file
-    const SPHGasParticleGrid* _grid;  // a list of particles overlapping each grid cell
-    Array _cumrhov;   // cumulative density distribution for particles in pv
+    const SPHGasParticleTree* _tree;  // an adaptive tree with a list of particles overlapping each leaf
+    Array _cumrhov;   // cumulative density distribution for particles in pv, if alias sampling is off
+    AliasTable _alias;  // alias table for the density distribution of particles in pv, if alias sampling is on
 };
 
 ////////////////////////////////////////////////////////////////////
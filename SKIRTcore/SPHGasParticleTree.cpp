@@ -0,0 +1,282 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <algorithm>
+#include <limits>
+#include <QElapsedTimer>
+#include "SPHGasParticleTree.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the maximum depth of the tree; this guarantees termination even for pathological particle distributions
+    const int MAXDEPTH = 40;
+
+    // the largest fraction of the particles in a node that each child node may hold for the split to be accepted;
+    // since SPH particles overlap many of their neighbours, a split that removes only a few particles from each side
+    // would hardly speed up queries, while it would lead to an explosion of nodes and particle references
+    const double MAXCHILDFRACTION = 0.8;
+
+    // returns the x, y, or z-coordinate of the specified position, depending on the value of dir: 1->x, 2->y, 3->z
+    inline double coord(Vec r, int dir)
+    {
+        return dir==1 ? r.x() : (dir==2 ? r.y() : r.z());
+    }
+
+    // returns the minimum or maximum x, y, or z-coordinate of the specified box, depending on the value of dir
+    inline double boxmin(const Box& box, int dir)
+    {
+        return dir==1 ? box.xmin() : (dir==2 ? box.ymin() : box.zmin());
+    }
+    inline double boxmax(const Box& box, int dir)
+    {
+        return dir==1 ? box.xmax() : (dir==2 ? box.ymax() : box.zmax());
+    }
+
+    // returns the square of the argument
+    inline double square(double value)
+    {
+        return value*value;
+    }
+
+    // Determines whether an axis-aligned bounding box intersects with a sphere
+    // (algorithm due to Jim Arvo in "Graphics Gems" (1990))
+    // box: the bounding box
+    // rc, r: center and radius of the sphere
+    // returns true if the bounding box and the sphere intersect, false otherwise
+    bool intersects(const Box& box, Vec rc, double r)
+    {
+        double squaredist = square(r);
+
+        if (rc.x() < box.xmin())       squaredist -= square(rc.x() - box.xmin());
+        else if (rc.x() > box.xmax())  squaredist -= square(rc.x() - box.xmax());
+        if (rc.y() < box.ymin())       squaredist -= square(rc.y() - box.ymin());
+        else if (rc.y() > box.ymax())  squaredist -= square(rc.y() - box.ymax());
+        if (rc.z() < box.zmin())       squaredist -= square(rc.z() - box.zmin());
+        else if (rc.z() > box.zmax())  squaredist -= square(rc.z() - box.zmax());
+
+        return squaredist > 0.;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+SPHGasParticleTree::SPHGasParticleTree(const vector<SPHGasParticle>& pv, int leafsize)
+    : _leafsize(max(leafsize,1)), _pmin(0), _pmax(0), _ptotal(0), _maxdepth(0), _sumdepth(0), _buildtime(0)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // find the spatial range of the particles
+    int n = pv.size();
+    if (n > 0)
+    {
+        _xmin = _ymin = _zmin = + numeric_limits<double>::infinity();
+        _xmax = _ymax = _zmax = - numeric_limits<double>::infinity();
+        for (int p = 0; p < n; p++)
+        {
+            Vec rc = pv[p].center();
+            double h = pv[p].radius();
+            _xmin = min(_xmin, rc.x()-h);  _xmax = max(_xmax, rc.x()+h);
+            _ymin = min(_ymin, rc.y()-h);  _ymax = max(_ymax, rc.y()+h);
+            _zmin = min(_zmin, rc.z()-h);  _zmax = max(_zmax, rc.z()+h);
+        }
+    }
+
+    // build the tree starting from the root node, which initially is overlapped by all particles
+    vector<const SPHGasParticle*> particles(n);
+    for (int p = 0; p < n; p++) particles[p] = &pv[p];
+    _nodev.resize(1);
+    buildnode(0, extent(), 0, particles);
+
+    // calculate statistics
+    _pmin = n;
+    for (const vector<const SPHGasParticle*>& list : _listv)
+    {
+        int size = list.size();
+        _pmin = min(_pmin, size);
+        _pmax = max(_pmax, size);
+        _ptotal += size;
+    }
+
+    _buildtime = timer.elapsed() * 1e-3;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void SPHGasParticleTree::buildnode(int m, const Box& extent, int depth, vector<const SPHGasParticle*>& particles)
+{
+    int n = particles.size();
+    if (n > _leafsize && depth < MAXDEPTH)
+    {
+        // split along the longest axis of the node
+        Vec widths = extent.widths();
+        int axis = 1;
+        if (widths.y() > coord(widths,axis)) axis = 2;
+        if (widths.z() > coord(widths,axis)) axis = 3;
+        double lo = boxmin(extent, axis);
+        double hi = boxmax(extent, axis);
+
+        // place the split point at the median of the particle centers inside the node,
+        // or at the center of the node if that would not properly divide the node
+        vector<double> centers;
+        centers.reserve(n);
+        for (int p = 0; p < n; p++)
+        {
+            double c = particles[p]->center(axis);
+            if (c > lo && c < hi) centers.push_back(c);
+        }
+        double split = (lo+hi)/2.;
+        if (!centers.empty())
+        {
+            nth_element(centers.begin(), centers.begin()+centers.size()/2, centers.end());
+            double median = centers[centers.size()/2];
+            if (median > lo && median < hi) split = median;
+        }
+
+        // determine the extent of the child nodes and the particles overlapping each of them
+        Vec rmax1 = extent.rmax();
+        Vec rmin2 = extent.rmin();
+        if (axis==1) { rmax1.set(split, rmax1.y(), rmax1.z()); rmin2.set(split, rmin2.y(), rmin2.z()); }
+        if (axis==2) { rmax1.set(rmax1.x(), split, rmax1.z()); rmin2.set(rmin2.x(), split, rmin2.z()); }
+        if (axis==3) { rmax1.set(rmax1.x(), rmax1.y(), split); rmin2.set(rmin2.x(), rmin2.y(), split); }
+        Box extent1(extent.rmin(), rmax1);
+        Box extent2(rmin2, extent.rmax());
+        vector<const SPHGasParticle*> particles1, particles2;
+        for (int p = 0; p < n; p++)
+        {
+            if (intersects(extent1, particles[p]->center(), particles[p]->radius())) particles1.push_back(particles[p]);
+            if (intersects(extent2, particles[p]->center(), particles[p]->radius())) particles2.push_back(particles[p]);
+        }
+
+        // split the node only if this substantially reduces the number of particles on both sides
+        size_t nmax = static_cast<size_t>(MAXCHILDFRACTION*n);
+        if (particles1.size() <= nmax && particles2.size() <= nmax)
+        {
+            vector<const SPHGasParticle*>().swap(particles);  // release memory before descending
+            int child = _nodev.size();
+            _nodev.resize(child+2);
+            _nodev[m].child = child;
+            _nodev[m].list = -1;
+            _nodev[m].axis = axis;
+            _nodev[m].split = split;
+            buildnode(child, extent1, depth+1, particles1);
+            buildnode(child+1, extent2, depth+1, particles2);
+            return;
+        }
+    }
+
+    // turn this node into a leaf
+    _nodev[m].child = -1;
+    _nodev[m].list = _listv.size();
+    _nodev[m].axis = 0;
+    _nodev[m].split = 0;
+    _listv.push_back(vector<const SPHGasParticle*>());
+    _listv.back().swap(particles);
+    _maxdepth = max(_maxdepth, depth);
+    _sumdepth += depth;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int SPHGasParticleTree::numLeaves() const
+{
+    return _listv.size();
+}
+
+////////////////////////////////////////////////////////////////////
+
+int SPHGasParticleTree::maxDepth() const
+{
+    return _maxdepth;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double SPHGasParticleTree::avgDepth() const
+{
+    return _sumdepth / _listv.size();
+}
+
+////////////////////////////////////////////////////////////////////
+
+int SPHGasParticleTree::minParticlesPerLeaf() const
+{
+    return _pmin;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int SPHGasParticleTree::maxParticlesPerLeaf() const
+{
+    return _pmax;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int SPHGasParticleTree::totalParticles() const
+{
+    return _ptotal;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double SPHGasParticleTree::buildTime() const
+{
+    return _buildtime;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const vector<const SPHGasParticle*>& SPHGasParticleTree::particlesFor(Vec r) const
+{
+    int m = 0;
+    while (_nodev[m].child >= 0)
+    {
+        const Node& node = _nodev[m];
+        m = node.child + (coord(r,node.axis) < node.split ? 0 : 1);
+    }
+    return _listv[_nodev[m].list];
+}
+
+////////////////////////////////////////////////////////////////////
+
+void SPHGasParticleTree::findleaves(int m, const Box& box, vector<int>& leaves) const
+{
+    const Node& node = _nodev[m];
+    if (node.child < 0)
+    {
+        leaves.push_back(node.list);
+    }
+    else
+    {
+        if (boxmin(box,node.axis) < node.split) findleaves(node.child, box, leaves);
+        if (boxmax(box,node.axis) >= node.split) findleaves(node.child+1, box, leaves);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+vector<const SPHGasParticle*> SPHGasParticleTree::particlesFor(const Box& box) const
+{
+    // find the leaves possibly overlapping the box
+    vector<int> leaves;
+    findleaves(0, box, leaves);
+
+    // if the box is fully inside a single leaf, just return the corresponding list
+    if (leaves.size() == 1) return _listv[leaves[0]];
+
+    // otherwise join the lists for all the leaves, removing duplicates
+    vector<const SPHGasParticle*> joined;
+    for (int list : leaves) joined.insert(joined.end(), _listv[list].begin(), _listv[list].end());
+    sort(joined.begin(), joined.end());
+    joined.erase(unique(joined.begin(), joined.end()), joined.end());
+    return joined;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,107 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef SPHGASPARTICLETREE_HPP
+#define SPHGASPARTICLETREE_HPP
+
+#include <vector>
+#include "Box.hpp"
+#include "SPHGasParticle.hpp"
+#include "Vec.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+/** SPHGasParticleTree is a technical class for organizing SPHGasParticle instances in an adaptive
+    k-d tree, so that it is easy to retrieve a list of all particles that may overlap a particular
+    point in space. Rather than imposing a fixed number of grid cells, the tree adapts its
+    resolution to the local particle density: a node is split in two at the median particle center
+    along its longest axis until the number of particles overlapping the node drops below a
+    configurable leaf size, or until splitting no longer substantially reduces the number of
+    particles per node. The Box object on which this class is based specifies a cuboid
+    guaranteed to enclose all particles in the tree. */
+class SPHGasParticleTree : public Box
+{
+public:
+    /** The constructor builds the k-d tree over the specified list of particles. A node is split
+        if more than \em leafsize particles (partially or fully) overlap it, unless the maximum
+        tree depth has been reached or one of the child nodes would still be overlapped by more
+        than 80% of the particles overlapping the parent node. The latter condition avoids
+        excessive splitting in regions where the particles overlap many of their neighbours, as is
+        usual for SPH smoothing lengths. For each leaf, the tree stores a list of all particles overlapping the
+        leaf. These internal lists store pointers to the particle objects contained in the provided
+        list \em pv, so that list must not be modified or deallocated as long as this tree instance
+        exists. */
+    SPHGasParticleTree(const std::vector<SPHGasParticle>& pv, int leafsize);
+
+    /** This function returns the number of leaves in the tree. */
+    int numLeaves() const;
+
+    /** This function returns the largest depth of any leaf in the tree, where the root node has
+        depth zero. */
+    int maxDepth() const;
+
+    /** This function returns the average depth of the leaves in the tree. */
+    double avgDepth() const;
+
+    /** This function returns the smallest number of particles overlapping a single leaf. */
+    int minParticlesPerLeaf() const;
+
+    /** This function returns the largest number of particles overlapping a single leaf. */
+    int maxParticlesPerLeaf() const;
+
+    /** This function returns the total number of particle references for all leaves in the tree.
+        */
+    int totalParticles() const;
+
+    /** This function returns the time (in seconds) it took to construct the tree. */
+    double buildTime() const;
+
+    /** This function returns a list of all particles that may overlap the specified position. It
+        descends the tree to the leaf containing the specified position and returns the list of
+        particles overlapping that leaf. Thus the list may include particles that don't actually
+        overlap the specified position. Positions outside of the root box are assigned to the
+        nearest leaf. */
+    const std::vector<const SPHGasParticle*>& particlesFor(Vec r) const;
+
+    /** This function returns a list containing all particles that may overlap a given box (i.e. a
+        cuboid lined up with the coordinate axes). Note that the list may include particles that
+        don't actually overlap the specified box. The function locates all leaves overlapping the
+        box and calculates the union of the list of particles overlapping each of these leaves
+        (i.e. removing any duplicates). */
+    std::vector<const SPHGasParticle*> particlesFor(const Box& box) const;
+
+private:
+    /** This private function recursively builds the subtree for the node with the specified
+        index, given the extent of the node, its depth, and the list of particles overlapping it.
+        */
+    void buildnode(int m, const Box& extent, int depth, std::vector<const SPHGasParticle*>& particles);
+
+    /** This private function recursively adds the indices of the particle lists for all leaves in
+        the subtree of the node with index \em m that may overlap the specified box to the list \em
+        leaves. */
+    void findleaves(int m, const Box& box, std::vector<int>& leaves) const;
+
+    // a node in the tree; for leaf nodes child is -1 and list holds the index in _listv,
+    // for other nodes child holds the index of the first of two consecutive child nodes
+    struct Node
+    {
+        int child;     // index of the first child node, or -1 for a leaf node
+        int list;      // index of the particle list in _listv (leaf nodes only)
+        int axis;      // split axis: 1=x, 2=y, 3=z (nonleaf nodes only)
+        double split;  // split coordinate along the axis (nonleaf nodes only)
+    };
+
+    int _leafsize;  // the maximum number of particles in a leaf (unless the tree can't be split further)
+    std::vector<Node> _nodev;  // the nodes in the tree; the root node has index zero
+    std::vector< std::vector<const SPHGasParticle*> > _listv; // the lists of particles overlapping each leaf
+    int _pmin, _pmax, _ptotal;  // minimum, maximum nr of particles in list; total nr of particles in listv
+    int _maxdepth;     // maximum leaf depth
+    double _sumdepth;  // sum of leaf depths
+    double _buildtime; // the time it took to build the tree, in seconds
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // SPHGASPARTICLETREE_HPP
@@ -4,14 +4,14 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cmath>
-#include <QFile>
+#include "ColumnDataFile.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
 #include "Random.hpp"
 #include "SPHGeometry.hpp"
-#include "SPHGasParticleGrid.hpp"
+#include "SPHGasParticleTree.hpp"
 #include "Units.hpp"
 
 using namespace std;
@@ -19,7 +19,7 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 SPHGeometry::SPHGeometry()
-    : _Tmax(0), _grid(0)
+    : _Tmax(0), _leafsize(128), _tree(0)
 {
 }
 
@@ -27,7 +27,7 @@ SPHGeometry::SPHGeometry()
 
 SPHGeometry::~SPHGeometry()
 {
-    delete _grid;
+    delete _tree;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -42,56 +42,51 @@ void SPHGeometry::setupSelfBefore()
 
     // read in the SPH gas particles
     QString filepath = find<FilePaths>()->input(_filename);
-    QFile infile(filepath);
-    if (!infile.open(QIODevice::ReadOnly|QIODevice::Text))
-        throw FATALERROR("Could not open the SPH gas data file " + filepath);
-    find<Log>()->info("Reading SPH gas particles from file " + filepath + "...");
+    ColumnDataFile infile(filepath, "SPH gas data");
+    find<Log>()->info("Reading SPH gas particles from file " + infile.filepath() + "...");
     int Nignored = 0;
     double Mtot = 0;
     double Mmetal = 0;
-    while (!infile.atEnd())
+    while (infile.read())
     {
-        // read a line, split it in columns, and skip empty and comment lines
-        QList<QByteArray> columns = infile.readLine().simplified().split(' ');
-        if (!columns.isEmpty() && !columns[0].startsWith('#'))
+        // get the optional temperature value; missing or illegal values default to zero
+        double T = infile.value(6);
+
+        // ignore particle if the temperature is higher than the maximum (assuming both T and Tmax are valid)
+        if (T > 0 && _Tmax > 0 && T > _Tmax)
+        {
+            Nignored++;
+        }
+        else
         {
-            // get the optional temperature value; missing or illegal values default to zero
-            double T = columns.value(6).toDouble();
-
-            // ignore particle if the temperature is higher than the maximum (assuming both T and Tmax are valid)
-            if (T > 0 && _Tmax > 0 && T > _Tmax)
-            {
-                Nignored++;
-            }
-            else
-            {
-                // add a particle using the other column values; missing or illegal values default to zero
-                _pv.push_back(SPHGasParticle(Vec(columns.value(0).toDouble()*pc,
-                                                 columns.value(1).toDouble()*pc,
-                                                 columns.value(2).toDouble()*pc),
-                                             columns.value(3).toDouble()*pc,
-                                             columns.value(4).toDouble()*Msun,
-                                             columns.value(5).toDouble()));
-                Mtot += columns.value(4).toDouble();
-                Mmetal += columns.value(4).toDouble() * columns.value(5).toDouble();
-            }
-       }
+            // add a particle using the other column values; missing or illegal values default to zero
+            _pv.push_back(SPHGasParticle(Vec(infile.value(0)*pc,
+                                             infile.value(1)*pc,
+                                             infile.value(2)*pc),
+                                         infile.value(3)*pc,
+                                         infile.value(4)*Msun,
+                                         infile.value(5)));
+            Mtot += infile.value(4);
+            Mmetal += infile.value(4) * infile.value(5);
+        }
     }
-    infile.close();
     find<Log>()->info("  Number of high-temperature particles ignored: " + QString::number(Nignored));
     find<Log>()->info("  Number of SPH gas particles containing dust: " + QString::number(_pv.size()));
     find<Log>()->info("  Total gas mass: " + QString::number(Mtot) + " Msun");
     find<Log>()->info("  Total metal mass: " + QString::number(Mmetal) + " Msun");
 
-    // construct a 3D-grid over the particle space, and create a list of particles that overlap each grid cell
-    const int GRIDSIZE = 20;
-    QString size = QString::number(GRIDSIZE);
-    find<Log>()->info("Constructing intermediate " + size + "x" + size + "x" + size + " grid for particles...");
-    _grid = new SPHGasParticleGrid(_pv, GRIDSIZE);
-    find<Log>()->info("  Smallest number of particles per cell: " + QString::number(_grid->minParticlesPerCell()));
-    find<Log>()->info("  Largest  number of particles per cell: " + QString::number(_grid->maxParticlesPerCell()));
-    find<Log>()->info("  Average  number of particles per cell: "
-                      + QString::number(_grid->totalParticles() / double(GRIDSIZE*GRIDSIZE*GRIDSIZE),'f',1));
+    // construct an adaptive tree over the particle space, and create a list of particles that overlap each leaf
+    find<Log>()->info("Constructing intermediate tree for particles with at most "
+                      + QString::number(_leafsize) + " particles per leaf...");
+    _tree = new SPHGasParticleTree(_pv, _leafsize);
+    find<Log>()->info("  Number of leaves: " + QString::number(_tree->numLeaves()));
+    find<Log>()->info("  Largest  tree depth: " + QString::number(_tree->maxDepth()));
+    find<Log>()->info("  Average  tree depth: " + QString::number(_tree->avgDepth(),'f',1));
+    find<Log>()->info("  Smallest number of particles per leaf: " + QString::number(_tree->minParticlesPerLeaf()));
+    find<Log>()->info("  Largest  number of particles per leaf: " + QString::number(_tree->maxParticlesPerLeaf()));
+    find<Log>()->info("  Average  number of particles per leaf: "
+                      + QString::number(_tree->totalParticles() / double(_tree->numLeaves()),'f',1));
+    find<Log>()->info("  Tree construction time: " + QString::number(_tree->buildTime(),'f',3) + " s");
 
     // construct a vector with the normalized cumulative particle densities
     NR::cdf(_cumrhov, _pv.size(), [this](int i){return _pv[i].metalMass();} );
@@ -130,9 +125,23 @@ double SPHGeometry::maximumTemperature() const
 
 //////////////////////////////////////////////////////////////////////
 
+void SPHGeometry::setLeafSize(int value)
+{
+    _leafsize = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int SPHGeometry::leafSize() const
+{
+    return _leafsize;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double SPHGeometry::density(Position bfr) const
 {
-    const vector<const SPHGasParticle*>& particles = _grid->particlesFor(bfr);
+    const vector<const SPHGasParticle*>& particles = _tree->particlesFor(bfr);
 
     double sum = 0.0;
     int n = particles.size();
@@ -159,8 +168,8 @@ double SPHGeometry::SigmaX() const
 {
     const int NSAMPLES = 10000;
     double sum = 0;
-    double xmin = _grid->xmin();
-    double xmax = _grid->xmax();
+    double xmin = _tree->xmin();
+    double xmax = _tree->xmax();
     for (int k = 0; k < NSAMPLES; k++)
     {
         sum += density(Position(xmin + k*(xmax-xmin)/NSAMPLES, 0, 0));
@@ -174,8 +183,8 @@ double SPHGeometry::SigmaY() const
 {
     const int NSAMPLES = 10000;
     double sum = 0;
-    double ymin = _grid->ymin();
-    double ymax = _grid->ymax();
+    double ymin = _tree->ymin();
+    double ymax = _tree->ymax();
     for (int k = 0; k < NSAMPLES; k++)
     {
         sum += density(Position(0, ymin + k*(ymax-ymin)/NSAMPLES, 0));
@@ -189,8 +198,8 @@ double SPHGeometry::SigmaZ() const
 {
     const int NSAMPLES = 10000;
     double sum = 0;
-    double zmin = _grid->zmin();
-    double zmax = _grid->zmax();
+    double zmin = _tree->zmin();
+    double zmax = _tree->zmax();
     for (int k = 0; k < NSAMPLES; k++)
     {
         sum += density(Position(0, 0, zmin + k*(zmax-zmin)/NSAMPLES));
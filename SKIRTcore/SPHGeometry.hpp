@@ -10,7 +10,7 @@
 #include "DustParticleInterface.hpp"
 #include "GenGeometry.hpp"
 #include "SPHGasParticle.hpp"
-class SPHGasParticleGrid;
+class SPHGasParticleTree;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -34,6 +34,13 @@ class SPHGeometry : public GenGeometry, public DustParticleInterface
     Q_CLASSINFO("MaxValue", "1000000 K")
     Q_CLASSINFO("Default", "75000 K")
 
+    Q_CLASSINFO("Property", "leafSize")
+    Q_CLASSINFO("Title", "the maximum number of particles per leaf in the intermediate particle tree")
+    Q_CLASSINFO("MinValue", "1")
+    Q_CLASSINFO("MaxValue", "100000")
+    Q_CLASSINFO("Default", "128")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -61,7 +68,9 @@ public:
         the sixth column is the metallicity \f$Z\f$ of the gas (dimensionless fraction). The
         optional seventh column is the temperature of the gas (in K). If this value is provided and
         it is higher than the maximum temperature the particle is ignored. If the temperature value
-        is missing, the particle is never ignored. */
+        is missing, the particle is never ignored.
+        If a binary version of the file exists as described for the ColumnDataFile class, it is
+        used instead of the text file. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH gas particles. */
@@ -75,6 +84,19 @@ public:
     /** Returns the maximum temperature for a gas particle to be taken into account. */
     Q_INVOKABLE double maximumTemperature() const;
 
+    /** Sets the maximum number of particles overlapping a leaf in the adaptive tree that is
+        constructed over the particle space during setup to speed up density queries. Leaves with
+        more particles are split further, unless splitting no longer substantially reduces the number
+        of particles, which happens for regions overlapped by many large particles. Since each SPH
+        particle typically overlaps some 50 to 60 neighbours, the leaf size should be well above
+        that number. Smaller values lead to faster queries at the cost of a deeper tree, more
+        memory and a longer construction time. The default value is 128. */
+    Q_INVOKABLE void setLeafSize(int value);
+
+    /** Returns the maximum number of particles overlapping a leaf in the adaptive particle tree.
+        */
+    Q_INVOKABLE int leafSize() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -119,10 +141,11 @@ private:
     // discoverable attributes
     QString _filename;
     double _Tmax;
+    int _leafsize;
 
     // the SPH particles
     std::vector<SPHGasParticle> _pv;  // the particles in the order read from the file
-    const SPHGasParticleGrid* _grid;  // a list of particles overlapping each grid cell
+    const SPHGasParticleTree* _tree;  // an adaptive tree with a list of particles overlapping each leaf
     Array _cumrhov;   // cumulative density distribution for particles in pv
     double _norm;     // normalization factor ( 1 / M_tot )
 };
@@ -3,8 +3,8 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
-#include <QFile>
 #include "MappingsSEDFamily.hpp"
+#include "ColumnDataFile.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "Log.hpp"
@@ -46,34 +46,26 @@ void SPHStarburstComp::setupSelfBefore()
 
     // load the SPH star particles
     QString filepath = find<FilePaths>()->input(_filename);
-    QFile infile(filepath);
-    if (!infile.open(QIODevice::ReadOnly|QIODevice::Text))
-        throw FATALERROR("Could not open the SPH HII region data file " + filepath);
-    find<Log>()->info("Reading SPH HII region particles from file " + filepath + "...");
+    ColumnDataFile infile(filepath, "SPH HII region data");
+    find<Log>()->info("Reading SPH HII region particles from file " + infile.filepath() + "...");
     int Nparts = 0;
     double SFRtot = 0;
-    while (!infile.atEnd())
+    while (infile.read())
     {
-        // read a line, split it in columns, and skip empty and comment lines
-        QList<QByteArray> columns = infile.readLine().simplified().split(' ');
-        if (!columns.isEmpty() && !columns[0].startsWith('#'))
-        {
-            // get the column values; missing or illegal values default to zero
-            _rv.push_back(Vec(columns.value(0).toDouble()*pc,
-                              columns.value(1).toDouble()*pc,
-                              columns.value(2).toDouble()*pc));
-            _hv.push_back(columns.value(3).toDouble()*pc);
-            SFRv.push_back(columns.value(4).toDouble());  // star formation rate in Msun / yr
-            Zv.push_back(columns.value(5).toDouble());    // metallicity as dimensionless fraction
-            logCv.push_back(columns.value(6).toDouble()); // log compactness (Groves 2008) as dimensionless value
-            Pv.push_back(columns.value(7).toDouble());    // ISM pressure in Pa
-            fPDRv.push_back(columns.value(8).toDouble()); // dimensionless photo-dissociation region covering fraction
-
-            Nparts++;
-            SFRtot += columns.value(4).toDouble();
-        }
+        // get the column values; missing or illegal values default to zero
+        _rv.push_back(Vec(infile.value(0)*pc,
+                          infile.value(1)*pc,
+                          infile.value(2)*pc));
+        _hv.push_back(infile.value(3)*pc);
+        SFRv.push_back(infile.value(4));  // star formation rate in Msun / yr
+        Zv.push_back(infile.value(5));    // metallicity as dimensionless fraction
+        logCv.push_back(infile.value(6)); // log compactness (Groves 2008) as dimensionless value
+        Pv.push_back(infile.value(7));    // ISM pressure in Pa
+        fPDRv.push_back(infile.value(8)); // dimensionless photo-dissociation region covering fraction
+
+        Nparts++;
+        SFRtot += infile.value(4);
     }
-    infile.close();
 
     double Mtot = SFRtot * 1.e7;  // total stellar mass from total sfr over the last 10 Myr
 
@@ -63,7 +63,9 @@ public:
         constant over the past 10 Myr (in \f$M_\odot\,{\text{yr}}^{-1}\f$), metallicity \f$Z\f$ (as
         a dimensionless fraction), the logarithm of the compactness \f$\log C\f$ (as a
         dimensionless fraction), the ISM pressure \f$p\f$ (in Pa), and the dimensionless PDR
-        covering factor \f$f_{\text{PDR}}\f$. */
+        covering factor \f$f_{\text{PDR}}\f$.
+        If a binary version of the file exists as described for the ColumnDataFile class, it is
+        used instead of the text file. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH particles. */
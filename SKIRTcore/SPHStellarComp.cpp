@@ -3,12 +3,16 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
-#include <QFile>
 #include "BruzualCharlotSEDFamily.hpp"
+#include "ColumnDataFile.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
+#include "IdenticalAssigner.hpp"
 #include "Log.hpp"
+#include "MonteCarloSimulation.hpp"
 #include "NR.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
 #include "PhotonPackage.hpp"
 #include "Random.hpp"
 #include "SPHStellarComp.hpp"
@@ -21,7 +25,7 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 SPHStellarComp::SPHStellarComp()
-    : _writeLuminosities(false)
+    : _writeLuminosities(false), _random(0), _alias(false)
 {
 }
 
@@ -39,31 +43,23 @@ void SPHStellarComp::setupSelfBefore()
 
     // load the SPH star particles
     QString filepath = find<FilePaths>()->input(_filename);
-    QFile infile(filepath);
-    if (!infile.open(QIODevice::ReadOnly|QIODevice::Text))
-        throw FATALERROR("Could not open the SPH star data file " + filepath);
-    find<Log>()->info("Reading SPH star particles from file " + filepath + "...");
+    ColumnDataFile infile(filepath, "SPH star data");
+    find<Log>()->info("Reading SPH star particles from file " + infile.filepath() + "...");
     int Nstars = 0;
     double Mtot = 0;
-    while (!infile.atEnd())
+    while (infile.read())
     {
-        // read a line, split it in columns, and skip empty and comment lines
-        QList<QByteArray> columns = infile.readLine().simplified().split(' ');
-        if (!columns.isEmpty() && !columns[0].startsWith('#'))
-        {
-            // get the column values; missing or illegal values default to zero
-            _rv.push_back(Vec(columns.value(0).toDouble()*pc,
-                              columns.value(1).toDouble()*pc,
-                              columns.value(2).toDouble()*pc));
-            _hv.push_back(columns.value(3).toDouble()*pc);
-            _Mv.push_back(columns.value(4).toDouble());  // mass in Msun
-            _Zv.push_back(columns.value(5).toDouble());  // metallicity as dimensionless fraction
-            _tv.push_back(columns.value(6).toDouble());  // age in years
-            Nstars++;
-            Mtot += columns.value(4).toDouble();
-        }
+        // get the column values; missing or illegal values default to zero
+        _rv.push_back(Vec(infile.value(0)*pc,
+                          infile.value(1)*pc,
+                          infile.value(2)*pc));
+        _hv.push_back(infile.value(3)*pc);
+        _Mv.push_back(infile.value(4));  // mass in Msun
+        _Zv.push_back(infile.value(5));  // metallicity as dimensionless fraction
+        _tv.push_back(infile.value(6));  // age in years
+        Nstars++;
+        Mtot += infile.value(4);
     }
-    infile.close();
     find<Log>()->info("  Total number of SPH star particles: " + QString::number(Nstars));
     find<Log>()->info("  Total stellar mass: " + QString::number(Mtot) + " Msun");
 
@@ -72,29 +68,21 @@ void SPHStellarComp::setupSelfBefore()
     // construct the library of SED models
     BruzualCharlotSEDFamily bc(this);
 
-    // construct a temporary matrix Lvv with the luminosity of each particle at each wavelength
-    // and also the permanent vector _Ltotv with the total luminosity for every wavelength bin
-    int Nlambda = find<WavelengthGrid>()->Nlambda();
-    ArrayTable<2> Lvv(Nlambda,Nstars);
-    _Ltotv.resize(Nlambda);
-    double Ltot = 0;
-    for (int i=0; i<Nstars; i++)
-    {
-        const Array& Lv = bc.luminosities(_Mv[i], _Zv[i], _tv[i]);
-        for (int ell=0; ell<Nlambda; ell++)
-        {
-            Lvv[ell][i] = Lv[ell];
-            _Ltotv[ell] += Lv[ell];
-            Ltot += Lv[ell];
-        }
-    }
-    find<Log>()->info("  Total luminosity: " + QString::number(Ltot/Units::Lsun()) + " Lsun");
-
     // construct the permanent vectors _Xvv with the normalized cumulative luminosities (per wavelength bin)
-    _Xvv.resize(Nlambda,0);
-    for (int ell=0; ell<Nlambda; ell++)
+    // and _Ltotv with the total luminosity for every wavelength bin
+    bc.cdfs(_Mv, _Zv, _tv, _Xvv, _Ltotv);
+    int Nlambda = _Ltotv.size();
+    find<Log>()->info("  Total luminosity: " + QString::number(_Ltotv.sum()/Units::Lsun()) + " Lsun");
+
+    // if requested, replace the cumulative distributions by alias tables (per wavelength bin)
+    _alias = find<MonteCarloSimulation>()->aliasSampling();
+    if (_alias)
     {
-        NR::cdf(_Xvv[ell], Lvv[ell]);
+        _aliasv.resize(Nlambda);
+        IdenticalAssigner* assigner = new IdenticalAssigner(this);
+        assigner->assign(Nlambda);
+        find<ParallelFactory>()->parallel()->call(this, &SPHStellarComp::buildAliasTable, assigner);
+        _Xvv.resize(0,0);
     }
 
     // if requested, write a data file with the luminosities per wavelength
@@ -121,6 +109,15 @@ void SPHStellarComp::setupSelfBefore()
 
 //////////////////////////////////////////////////////////////////////
 
+void SPHStellarComp::buildAliasTable(size_t ell)
+{
+    Array& Xv = _Xvv[ell];
+    _aliasv[ell].initialize(Xv.size()-1, [&Xv](int i){return Xv[i+1]-Xv[i];} );
+    Xv.resize(0);
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void SPHStellarComp::setFilename(QString value)
 {
     _filename = value;
@@ -165,7 +162,8 @@ double SPHStellarComp::luminosity(int ell) const
 
 void SPHStellarComp::launch(PhotonPackage* pp, int ell, double L) const
 {
-    int i = NR::locate_clip(_Xvv[ell], _random->uniform());
+    double X = _random->uniform();
+    int i = _alias ? _aliasv[ell].sample(X) : NR::locate_clip(_Xvv[ell], X);
     double x = _random->gauss();
     double y = _random->gauss();
     double z = _random->gauss();
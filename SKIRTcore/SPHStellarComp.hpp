@@ -6,6 +6,7 @@
 #ifndef SPHSTELLARCOMP_HPP
 #define SPHSTELLARCOMP_HPP
 
+#include "AliasTable.hpp"
 #include "ArrayTable.hpp"
 #include "StellarComp.hpp"
 #include "Vec.hpp"
@@ -46,9 +47,16 @@ protected:
         \f$X_{\ell,i}\f$ is filled that contains the normalized cumulative luminosity, \f[
         X_{\ell,i} = \frac{ \sum_{j=0}^{i-1} L_{\ell,j} }{ \sum_{j=0}^{N-1} L_{\ell,j} } \f] . This
         matrix will be used for the efficient generation of random photon packages from the stellar
-        component. */
+        component. If the MonteCarloSimulation::aliasSampling() flag is set, the matrix is
+        subsequently replaced by an alias table for each wavelength bin. */
     void setupSelfBefore();
 
+private:
+    /** This function builds the alias table for the wavelength bin with index $\ell$ from the
+        corresponding row of the normalized cumulative luminosity matrix, and releases the memory
+        held by that row. It serves as the body of a parallelized loop over the wavelength bins. */
+    void buildAliasTable(size_t ell);
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -59,7 +67,9 @@ public:
         column is the SPH smoothing length \f$h\f$ (in pc), the fifth column is the initial mass of
         the stellar population (in \f$M_\odot\f$ at \f$t=0\f$), the sixth column is the metallicity
         \f$Z\f$ of the stellar population (dimensionless fraction), and the seventh column is the
-        age of the stellar population (in yr). */
+        age of the stellar population (in yr).
+        If a binary version of the file exists as described for the ColumnDataFile class, it is
+        used instead of the text file. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH star particles. */
@@ -90,7 +100,9 @@ public:
         randomly chooses an SPH particle from the \f$N\f$ possible particles by generating a random
         number \f${\cal{X}}\f$ and determining the particle number \f$i\f$ for which
         \f$X_{\ell,i}\leq{\cal{X}}<X_{\ell,i+1}\f$, with \f$X{\ell,i}\f$ the normalized cumulative
-        luminosity matrix defined in the setup phase and stored internally. Once the SPH particle
+        luminosity matrix defined in the setup phase and stored internally. If alias sampling is
+        enabled, the particle is instead drawn from the alias table for the wavelength bin in
+        constant time, with the same probabilities. Once the SPH particle
         has been determined, a position is determined randomly from the smoothed distribution
         around the particle centre, a random propagation direction is determined, and a photon
         package with these properties is constructed and returned. The function assumes the scaled
@@ -112,9 +124,11 @@ private:
     std::vector<double> _tv;
 
     Array _Ltotv;
-    ArrayTable<2> _Xvv;
+    ArrayTable<2> _Xvv;                 // cumulative distributions if alias sampling is off
+    std::vector<AliasTable> _aliasv;    // alias tables if alias sampling is on
 
     Random* _random;
+    bool _alias;
 };
 
 ////////////////////////////////////////////////////////////////////
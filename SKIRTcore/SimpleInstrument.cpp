@@ -4,7 +4,6 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "FatalError.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "SimpleInstrument.hpp"
 #include "WavelengthGrid.hpp"
@@ -14,6 +13,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 SimpleInstrument::SimpleInstrument()
+    : _ftoth(-1), _Ftoth(-1)
 {
 }
 
@@ -26,6 +26,8 @@ void SimpleInstrument::setupSelfBefore()
     int Nlambda = find<WavelengthGrid>()->Nlambda();
     _ftotv.resize(Nlambda*_Nframep);
     _Ftotv.resize(Nlambda);
+    _Ftoth = registerDetector(_Ftotv);
+    _ftoth = registerDetector(_ftotv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -40,11 +42,11 @@ SimpleInstrument::detect(PhotonPackage* pp)
     double extf = exp(-taupath);
     double Lextf = L*extf;
 
-    LockFree::add(_Ftotv[ell], Lextf);
+    record(_Ftoth, ell, Lextf);
     if (l>=0)
     {
         size_t m = l + ell*_Nframep;
-        LockFree::add(_ftotv[m], Lextf);
+        record(_ftoth, m, Lextf);
     }
 }
 
@@ -64,6 +64,8 @@ protected:
 private:
     Array _ftotv;
     Array _Ftotv;
+    int _ftoth;     // handle for the registered detector array _ftotv
+    int _Ftoth;     // handle for the registered detector array _Ftotv
 };
 
 ////////////////////////////////////////////////////////////////////
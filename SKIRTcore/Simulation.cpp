@@ -16,6 +16,7 @@
 ////////////////////////////////////////////////////////////////////
 
 Simulation::Simulation()
+    : _restart(false)
 {
     _paths = new FilePaths();
     _paths->setParent(this);
@@ -70,7 +71,39 @@ void Simulation::setupAndRun()
     TimeLogger logger(_log, "simulation " + _paths->outputPrefix() + processInfo);
 
     setup();
+    quint64 findcount = findCount();
     run();
+
+    // in debug builds, report the hierarchy lookups performed after setup; lookups in the hot loops
+    // of the run phase show up as a count proportional to the number of photon packages or cells
+#ifndef QT_NO_DEBUG
+    _log->info("Number of find() calls after setup: " + QString::number(findCount() - findcount));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Simulation::rerun()
+{
+    // verify setup
+    if (_state < SetupDone) throw FATALERROR("Simulation has not been setup before being rerun");
+
+    // setup the items that have been replaced since the previous run; the others return immediately
+    foreach (QObject* child, children())
+    {
+        SimulationItem* item = dynamic_cast<SimulationItem*>(child);
+        if (item) item->setup();
+    }
+
+    resetSelf();
+    run();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Simulation::resetSelf()
+{
+    _random->reset();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -103,6 +136,20 @@ PeerToPeerCommunicator* Simulation::communicator() const
 
 ////////////////////////////////////////////////////////////////////
 
+void Simulation::setRestart(bool value)
+{
+    _restart = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool Simulation::restart() const
+{
+    return _restart;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void Simulation::setRandom(Random* value)
 {
     if (_random) delete _random;
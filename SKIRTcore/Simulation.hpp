@@ -68,14 +68,31 @@ public:
     void run();
 
     /** This function performs setup and executes the simulation by invoking setup() and run() in
-        succession. */
+        succession. In debug builds, it also logs the number of invocations of the find() function
+        during the run phase, as returned by SimulationItem::findCount(). */
     void setupAndRun();
 
+    /** This function performs the simulation once more on the same hierarchy, after the caller
+        has replaced some of its top-level items by fresh ones that have not yet been setup. The
+        function sets up the fresh items, leaving the other items as they are, calls resetSelf()
+        to restore the state that a run depends on, and then invokes run(). This allows the caller
+        to avoid the cost of setting up the items that are not affected by a change to the
+        simulation parameters. The simulation must have been setup before invoking this function.
+        */
+    void rerun();
+
 protected:
     /** This function actually runs the simulation, assuming that setup() has been already performed.
         Its implementation must be provided by a subclass. */
     virtual void runSelf() = 0;
 
+    /** This function restores the state that a run of the simulation depends on to the state it
+        had after setup, so that a rerun produces the same results as a fresh simulation. The
+        implementation in this class resets the random number generator. A subclass that keeps
+        additional run-time state should override this function, calling the base class
+        implementation. */
+    virtual void resetSelf();
+
     //======== Getters for Non-Discoverable Attributes =======
 
 public:
@@ -91,6 +108,15 @@ public:
     /** Returns the PeerToPeerCommunicator of the simulation. */
     PeerToPeerCommunicator* communicator() const;
 
+    /** Sets the restart flag for the simulation. If the flag is true, a simulation that supports
+        checkpoints resumes from the most recent checkpoint written in the output path by a previous
+        run of the same simulation, rather than starting from scratch. The flag is false by
+        default. */
+    void setRestart(bool value);
+
+    /** Returns the restart flag for the simulation. */
+    bool restart() const;
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -118,6 +144,7 @@ protected:
     PeerToPeerCommunicator* _comm;      // the peer-to-peer communicator for the simulation
     Random* _random;                    // the random number generator for the simulation
     Units* _units;                      // the units system for the simulation
+    bool _restart;                      // true if the simulation should resume from a checkpoint
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -3,11 +3,22 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <atomic>
 #include "FatalError.hpp"
 #include "SimulationItem.hpp"
 
 ////////////////////////////////////////////////////////////////////
 
+#ifndef QT_NO_DEBUG
+namespace
+{
+    // the number of invocations of the find() function, counted in debug builds only
+    std::atomic<quint64> _findcount(0);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////
+
 SimulationItem::SimulationItem()
     : _state(Created)
 {
@@ -46,6 +57,10 @@ void SimulationItem::setupSelfAfter()
 
 QObject* SimulationItem::find(const char* className) const
 {
+#ifndef QT_NO_DEBUG
+    _findcount++;
+#endif
+
     // loop over all ancestors
     QObject* ancestor = const_cast<SimulationItem*>(this);  // cast away const
     while (ancestor)
@@ -68,6 +83,17 @@ QObject* SimulationItem::find(const char* className) const
 
 ////////////////////////////////////////////////////////////////////
 
+quint64 SimulationItem::findCount()
+{
+#ifndef QT_NO_DEBUG
+    return _findcount;
+#else
+    return 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+
 QList<SimulationItem*> SimulationItem::interfaceCandidates(const std::type_info& /*interfaceTypeInfo*/)
 {
     return QList<SimulationItem*>() << this;
@@ -73,6 +73,16 @@ private:
         name string argument rather than a data type template argument. */
     QObject* find(const char* className) const;
 
+public:
+    /** This function returns the number of times the find() function has been invoked since the
+        program was started, for all simulation hierarchies combined. The invocations are counted
+        only in debug builds (i.e. if QT_NO_DEBUG is not defined); in release builds this function
+        always returns zero. Because find() walks the hierarchy and compares class names, it is
+        intended for use during setup; simulation items should cache the pointers they need in the
+        run phase. The count allows detecting lookups that have inadvertently crept into the run
+        phase (see Simulation::setupAndRun()). */
+    static quint64 findCount();
+
 public:
     /** This template function looks for an interface of a specific type offered by the receiving
         simulation item, or by one of its self-designated delegates. The interface type is
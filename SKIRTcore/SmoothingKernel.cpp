@@ -3,6 +3,7 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include "Random.hpp"
 #include "SmoothingKernel.hpp"
 
 using namespace std;
@@ -10,6 +11,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 SmoothingKernel::SmoothingKernel()
+    : _random(0)
 {
 }
 
@@ -18,6 +20,8 @@ SmoothingKernel::SmoothingKernel()
 void SmoothingKernel::setupSelfBefore()
 {
     SimulationItem::setupSelfBefore();
+
+    _random = find<Random>();
 }
 
 //////////////////////////////////////////////////////////////////////
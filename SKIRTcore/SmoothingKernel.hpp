@@ -7,6 +7,7 @@
 #define SMOOTHINGKERNEL_HPP
 
 #include "SimulationItem.hpp"
+class Random;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -27,7 +28,8 @@ protected:
     SmoothingKernel();
 
     /** This function must be implemented in a subclass to initialize the kernel. In the abstract
-        SmoothingKernel class, this function does nothing. */
+        SmoothingKernel class, this function caches a pointer to the simulation's random number
+        generator, as a service to subclasses. */
     void setupSelfBefore();
 
     //======================== Other Functions =======================
@@ -43,6 +45,11 @@ public:
         function appropriately. */
     virtual double generateRadius() const = 0;
 
+    //======================== Data Members ========================
+
+protected:
+    // data member initialized in this class, as a service to subclasses
+    Random* _random;
 };
 
 //////////////////////////////////////////////////////////////////////
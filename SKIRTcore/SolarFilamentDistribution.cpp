@@ -405,9 +405,8 @@ double SolarFilamentDistribution::bulkVelocityZ(int m) const
 
 Position SolarFilamentDistribution::generatePosition() const
 {
-    Random* random = find<Random>();
-    int m = NR::locate_clip(_cumrhov, random->uniform());
-    return _mesh->randomPosition(random, m);
+    int m = NR::locate_clip(_cumrhov, _random->uniform());
+    return _mesh->randomPosition(_random, m);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -188,9 +188,8 @@ double SphericalAdaptiveMeshDustDistribution::density(Position bfr) const
 
 Position SphericalAdaptiveMeshDustDistribution::generatePosition() const
 {
-    Random* random = find<Random>();
-    int m = NR::locate_clip(_cumrhov, random->uniform());
-    return _mesh->randomPosition(random, m);
+    int m = NR::locate_clip(_cumrhov, _random->uniform());
+    return _mesh->randomPosition(_random, m);
 }
 
 //////////////////////////////////////////////////////////////////////
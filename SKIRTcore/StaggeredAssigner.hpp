@@ -73,7 +73,8 @@ public:
         amount of parts that need to be executed in the simulation. In the case that \c blocks = 1,
         this absolute index \f$t\f$ is determined by the following formula: \f[ t = i + u \cdot N_P \f]
         where \f$i\f$ is the rank of the process, \f$u\f$ is the relative index and \f$N_P\f$ is the
-        number of processes. If \c blocks > 1, the calculation is more complicated. */
+        number of processes. If \c blocks > 1, the index of the block multiplied by the block size is
+        added, so that each part of the work in each block has a distinct absolute index. */
     size_t absoluteIndex(size_t relativeIndex);
 
     /** This function takes the absolute index of a certain part of the work as an argument and returns
@@ -81,7 +82,8 @@ public:
         this process, _nvalues. In the case that \c blocks = 1, this relative index \f$u\f$ is
         determined by the following formula: \f[ u = \frac{t - i}{N_P} \f] where \f$i\f$ is the rank of
         the process, \f$t\f$ is the absolute index and \f$N_P\f$ is the number of processes. If \c
-        blocks > 1, the calculation is more complicated. */
+        blocks > 1, the calculation is performed for the position within the block, and the number of
+        values assigned to this process in the preceding blocks is added. */
     size_t relativeIndex(size_t absoluteIndex);
 
     /** This function returns the rank of the process that is assigned to a certain part of the work.
@@ -9,6 +9,7 @@
 #include "FilePaths.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "ResourceCacheFile.hpp"
 #include "StarburstSED.hpp"
 
 using namespace std;
@@ -24,41 +25,66 @@ void StarburstSED::setupSelfBefore()
 {
     StellarSED::setupSelfBefore();
 
-    // open the resource file and skip the header
+    // read the metallicities, the wavelengths, and the logarithm of the emissivities for each metallicity,
+    // either from the binary cache or from the resource file (caching the data for later use)
     QString filename = FilePaths::resource("SED/Starburst/StarburstSED.dat");
-    ifstream file(filename.toLocal8Bit().constData());
-    if (! file.is_open()) throw FATALERROR("Could not open the data file " + filename);
-    find<Log>()->info("Reading SED data from file " + filename + "...");
-    string line;
-    for (int i=0; i<6; i++) getline(file,line);
-
-    // get the metallicity range and the number of wavelengths
-    int NZ, Nlambda;
-    file >> NZ >> Nlambda;
-    Array Zv(NZ);
-    for (int l=0; l<NZ; l++) file >> Zv[l];
+    ResourceCacheFile cache("StarburstSED", QStringList() << filename);
+    Array Zv, lambdav;
+    vector<Array> logjvv;
+    if (cache.isCached())
+    {
+        find<Log>()->info("Reading SED data from cache file " + cache.filepath() + "...");
+        cache.readArray(Zv);
+        cache.readArray(lambdav);
+        logjvv.resize(Zv.size());
+        for (Array& logjv : logjvv) cache.readArray(logjv);
+    }
+    else
+    {
+        // open the resource file and skip the header
+        ifstream file(filename.toLocal8Bit().constData());
+        if (! file.is_open()) throw FATALERROR("Could not open the data file " + filename);
+        find<Log>()->info("Reading SED data from file " + filename + "...");
+        string line;
+        for (int i=0; i<6; i++) getline(file,line);
+
+        // get the metallicity range and the number of wavelengths
+        int NZ, Nlambda;
+        file >> NZ >> Nlambda;
+        Zv.resize(NZ);
+        for (int l=0; l<NZ; l++) file >> Zv[l];
+
+        // read the data from the file into local vectors
+        lambdav.resize(Nlambda);
+        logjvv.resize(NZ, Array(Nlambda));
+        double lambda;
+        for (int k=0; k<Nlambda; k++)
+        {
+            file >> lambda;
+            for (int l=0; l<NZ; l++) file >> logjvv[l][k];
+            lambdav[k] = lambda/1e10; // conversion from A to m
+        }
+        file.close();
+        find<Log>()->info("File " + filename + " closed.");
+
+        // cache the data
+        cache.writeArray(Zv);
+        cache.writeArray(lambdav);
+        for (const Array& logjv : logjvv) cache.writeArray(logjv);
+        if (cache.save()) find<Log>()->info("Cached SED data in file " + cache.filepath());
+    }
+
+    // determine the bracketing metallicities
+    int NZ = Zv.size();
+    int Nlambda = lambdav.size();
     int lL = NR::locate_fail(Zv,_Z);
     if (lL < 0) throw FATALERROR("The metallicity Z should be between "
                                  + QString::number(Zv[0]) + " and " + QString::number(Zv[NZ-1]));
     double ZL = Zv[lL];
     double ZR = Zv[lL+1];
-
-    // read the data from the file into local vectors
-    Array lambdav(Nlambda);
+    const Array& logjLv = logjvv[lL];
+    const Array& logjRv = logjvv[lL+1];
     Array jv(Nlambda);
-    Array logjLv(Nlambda);
-    Array logjRv(Nlambda);
-    double lambda, dummy;
-    for (int k=0; k<Nlambda; k++)
-    {
-        file >> lambda;
-        for (int l=0; l<lL; l++) file >> dummy;
-        file >> logjLv[k] >> logjRv[k];
-        for (int l=lL+2; l<NZ; l++) file >> dummy;
-        lambdav[k] = lambda/1e10; // conversion from A to m
-    }
-    file.close();
-    find<Log>()->info("File " + filename + " closed.");
 
     // interpolate linearly in log space
     for (int k=0; k<Nlambda; k++)
@@ -1,6 +1,7 @@
 ////////////////////////////////////////////////////////////////////
 
 #include "FatalError.hpp"
+#include "MonteCarloSimulation.hpp"
 #include "NR.hpp"
 #include "PhotonPackage.hpp"
 #include "Random.hpp"
@@ -13,7 +14,7 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 StellarSystem::StellarSystem()
-    : _random(0)
+    : _random(0), _alias(false)
 {
 }
 
@@ -68,12 +69,24 @@ void StellarSystem::setupSelfAfter()
         for (int h=0; h<Ncomp; h++)
             _Lv[ell] += _scv[h]->luminosity(ell);
 
-    // Fill the vectors _Xvv with the normalized cumulative luminosities (per wavelength bin)
-
-    _Xvv.resize(Nlambda,0);
-    for (int ell=0; ell<Nlambda; ell++)
+    // Fill the alias tables _aliasv or the vectors _Xvv with the normalized cumulative luminosities
+    // (per wavelength bin) used for selecting a component
+    _alias = find<MonteCarloSimulation>()->aliasSampling();
+    if (_alias)
+    {
+        _aliasv.resize(Nlambda);
+        for (int ell=0; ell<Nlambda; ell++)
+        {
+            _aliasv[ell].initialize(Ncomp, [this,ell](int h){return _scv[h]->luminosity(ell);} );
+        }
+    }
+    else
     {
-        NR::cdf(_Xvv[ell], Ncomp, [this,ell](int h){return _scv[h]->luminosity(ell);} );
+        _Xvv.resize(Nlambda,0);
+        for (int ell=0; ell<Nlambda; ell++)
+        {
+            NR::cdf(_Xvv[ell], Ncomp, [this,ell](int h){return _scv[h]->luminosity(ell);} );
+        }
     }
 }
 
@@ -104,7 +117,8 @@ int StellarSystem::Ncomp() const
 
 void StellarSystem::launch(PhotonPackage* pp, int ell, double L) const
 {
-    int h = NR::locate_clip(_Xvv[ell], _random->uniform());
+    double X = _random->uniform();
+    int h = _alias ? _aliasv[ell].sample(X) : NR::locate_clip(_Xvv[ell], X);
     _scv[h]->launch(pp,ell,L);
     pp->setStellarOrigin(h);
 }
@@ -6,6 +6,7 @@
 #ifndef STELLARSYSTEM_HPP
 #define STELLARSYSTEM_HPP
 
+#include "AliasTable.hpp"
 #include "ArrayTable.hpp"
 #include "SimulationItem.hpp"
 class PhotonPackage;
@@ -75,8 +76,9 @@ public:
 
     /** This function simulates the emission of a monochromatic photon package with a monochromatic
         luminosity \f$L\f$ at wavelength index \f$\ell\f$ from the stellar system. It randomly
-        chooses a stellar component from which to emit the photon and then simulates the emission
-        through the corresponding StellarComp::launch() function. */
+        chooses a stellar component from which to emit the photon, using an alias table or a
+        cumulative distribution depending on the MonteCarloSimulation::aliasSampling() flag, and
+        then simulates the emission through the corresponding StellarComp::launch() function. */
     void launch(PhotonPackage* pp, int ell, double L) const;
 
     //======================== Data Members ========================
@@ -84,9 +86,11 @@ public:
 private:
     QList<StellarComp*> _scv;
     Array _Lv;
-    ArrayTable<2> _Xvv;
+    ArrayTable<2> _Xvv;                 // cumulative distributions if alias sampling is off
+    std::vector<AliasTable> _aliasv;    // alias tables if alias sampling is on
 
     Random* _random;
+    bool _alias;
 };
 
 ////////////////////////////////////////////////////////////////
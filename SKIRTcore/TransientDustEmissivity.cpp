@@ -5,9 +5,11 @@
 
 #include <limits>
 #include "DustDistribution.hpp"
+#include "FatalError.hpp"
 #include "MultiGrainDustMix.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "ParallelFactory.hpp"
 #include "TransientDustEmissivity.hpp"
 #include "Table.hpp"
 #include "Units.hpp"
@@ -177,13 +179,14 @@ public:
     }
 
     // calculate the probabilities
-    // Pv: the calculated probabilities (out)
+    // Pv: the calculated probabilities (out); must have room for the number of points in the temperature grid
     // ioff: the index offset in the temperature grid used for this calculation (out)
     // Am: scratch memory for the calculation (internal only)
     // Tmin/Tmax: temperature range in which to perform the calculation (in), and
     //            temperature range where the calculated probabilities are above a certain fraction of maximum (out)
     // Jv: the radiation field (in)
-    void calcprobs(Array& Pv, int& ioff, Square<double>& Am, double& Tmin, double& Tmax, const Array& Jv) const
+    // The inner loops operate on plain pointers to contiguous rows so that the compiler can vectorize them
+    void calcprobs(double* Pv, int& ioff, Square<double>& Am, double& Tmin, double& Tmax, const Array& Jv) const
     {
         ioff = NR::locate_clip(_grid->_Tv, Tmin);
         int NT = NR::locate_clip(_grid->_Tv, Tmax) - ioff + 2;
@@ -194,10 +197,11 @@ public:
         {
             const short* ELLv = &_ELLm(f+ioff,ioff);
             const double* HRv = &_HRm(f+ioff,ioff);
+            double* Av = &Am(f,0);
             for (int i=0; i<f; i++)
             {
                 int ell = ELLv[i];
-                Am(f,i) = ell>=0 ? HRv[i] * Jv[ell] : 0.;
+                Av[i] = ell>=0 ? HRv[i] * Jv[ell] : 0.;
             }
         }
         for (int i=1; i<NT; i++)
@@ -208,30 +212,48 @@ public:
         // calculate the cumulative matrix coefficients, in place
         for (int f=NT-2; f>0; f--)
         {
-            for (int i=0; i<f; i++)
-            {
-                Am(f,i) += Am(f+1,i);
-            }
+            double* Av = &Am(f,0);
+            const double* Anextv = &Am(f+1,0);
+            for (int i=0; i<f; i++) Av[i] += Anextv[i];
         }
 
-        // calculate the probabilities
-        Pv.resize(NT);
+        // calculate the probabilities; the dot product uses four partial sums so that it can be vectorized
         Pv[0] = 1.;
         for (int i=1; i<NT; i++)
         {
-            double sum = 0.;
-            for (int j=0; j<i; j++) sum += Am(i,j) * Pv[j];
-            Pv[i] = sum / Am(i-1,i);
+            const double* Av = &Am(i,0);
+            double sum0 = 0., sum1 = 0., sum2 = 0., sum3 = 0.;
+            int j = 0;
+            for (; j+3<i; j+=4)
+            {
+                sum0 += Av[j] * Pv[j];
+                sum1 += Av[j+1] * Pv[j+1];
+                sum2 += Av[j+2] * Pv[j+2];
+                sum3 += Av[j+3] * Pv[j+3];
+            }
+            for (; j<i; j++) sum0 += Av[j] * Pv[j];
+            Pv[i] = ((sum0+sum1) + (sum2+sum3)) / Am(i-1,i);
 
             // rescale if needed to keep infinities from happening
-            if (Pv[i] > 1e10) for (int j=0; j<=i; j++) Pv[j]/=Pv[i];
+            if (Pv[i] > 1e10)
+            {
+                double scale = Pv[i];
+                for (int j=0; j<=i; j++) Pv[j] /= scale;
+            }
         }
 
         // normalize probabilities to unity
-        Pv /= Pv.sum();
+        double sum = 0.;
+        for (int i=0; i<NT; i++) sum += Pv[i];
+        double max = 0.;
+        for (int i=0; i<NT; i++)
+        {
+            Pv[i] /= sum;
+            if (Pv[i] > max) max = Pv[i];
+        }
 
         // determine the temperature range where the probabability is above a given fraction of its maximum
-        double frac = 1e-20 * Pv.max();
+        double frac = 1e-20 * max;
         int k;
         for (k=0; k!=NT-2; k++) if (Pv[k]>frac) break;
         Tmin = _grid->_Tv[k+ioff];
@@ -244,14 +266,20 @@ public:
     // Tmin/Tmax: temperature range in which to add radiation (in)
     // Pv: the probabilities calculated previously by this calculator (in)
     // ioff: the index offset in the temperature grid used for that previous calculation (in)
-    void addtransient(Array& ev, double Tmin, double Tmax, const Array& Pv, int ioff) const
+    void addtransient(Array& ev, double Tmin, double Tmax, const double* Pv, int ioff) const
     {
         int imin = NR::locate_clip(_grid->_Tv, Tmin);
         int imax = NR::locate_clip(_grid->_Tv, Tmax);
+        int Nlambda = _grid->_Nlambda;
 
+        // accumulate in place rather than through temporary arrays
+        double* ep = &ev[0];
+        const double* sigmap = &_sigmaabsv[0];
         for (int i=imin; i<=imax; i++)
         {
-            ev += _sigmaabsv * _grid->_Bvv[i] * Pv[i-ioff];
+            const double* Bp = &_grid->_Bvv[i][0];
+            double P = Pv[i-ioff];
+            for (int ell=0; ell<Nlambda; ell++) ep[ell] += sigmap[ell] * Bp[ell] * P;
         }
     }
 
@@ -267,6 +295,19 @@ public:
 
 ////////////////////////////////////////////////////////////////////
 
+// helper class to hold the scratch memory used by a single execution thread for calculating emissivities;
+// the memory is sized for the largest temperature grid in the simulation and reused for every invocation
+class TDE_Scratch
+{
+public:
+    Square<double> _Am;         // transition matrix
+    std::vector<double> _Pv;    // probabilities
+
+    TDE_Scratch(int NT) : _Am(NT), _Pv(NT) { }
+};
+
+////////////////////////////////////////////////////////////////////
+
 // configuration constants
 namespace
 {
@@ -293,7 +334,7 @@ namespace
 ////////////////////////////////////////////////////////////////////
 
 TransientDustEmissivity::TransientDustEmissivity()
-    : _Nlambda(0)
+    : _Nlambda(0), _NTmax(0), _parfac(0)
 {
 }
 
@@ -305,6 +346,7 @@ TransientDustEmissivity::~TransientDustEmissivity()
     foreach (const TDE_Calculator* calculator, _calculatorsB.values()) delete calculator;
     foreach (const TDE_Calculator* calculator, _calculatorsC.values()) delete calculator;
     foreach (const TDE_Grid* grid, _grids) delete grid;
+    for (TDE_Scratch* scratch : _scratchv) delete scratch;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -322,7 +364,8 @@ void TransientDustEmissivity::setupSelfBefore()
     int Ncomp = dd->Ncomp();
     for (int h=0; h<Ncomp; h++)
     {
-        const MultiGrainDustMix* mix = dd->mix(h)->find<MultiGrainDustMix>();
+        const MultiGrainDustMix* mix = dynamic_cast<const MultiGrainDustMix*>(dd->mix(h));
+        if (!mix) throw FATALERROR("Transient dust emissivity requires dust mixes of type MultiGrainDustMix");
 
         // create grids
         double Tupper = min(Tuppermax, mix->uppertemperature());
@@ -330,6 +373,7 @@ void TransientDustEmissivity::setupSelfBefore()
         const TDE_Grid* gridB = new TDE_Grid(lambdagrid, 2.,Tupper,Tupper/widthB,ratioB);
         const TDE_Grid* gridC = new TDE_Grid(lambdagrid, 2.,Tupper,Tupper/widthC,ratioC);
         _grids << gridA << gridB << gridC;
+        _NTmax = max(_NTmax, max(gridA->_NT, max(gridB->_NT, gridC->_NT)));
 
         // create calculators
         int Npop = mix->Npop();
@@ -340,22 +384,30 @@ void TransientDustEmissivity::setupSelfBefore()
             _calculatorsC.insert(QPair<const DustMix*,int>(mix,c), new TDE_Calculator(gridC,mix,c));
         }
     }
+
+    // provide a slot for the scratch memory of each execution thread; the memory is allocated on first use
+    _parfac = find<ParallelFactory>();
+    _scratchv.resize(_parfac->maxThreadCount());
 }
 
 ////////////////////////////////////////////////////////////////////
 
 Array TransientDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) const
 {
-    const MultiGrainDustMix* mgmix = mix->find<MultiGrainDustMix>();
+    // the dust mix has been verified to be a MultiGrainDustMix during setup
+    const MultiGrainDustMix* mgmix = static_cast<const MultiGrainDustMix*>(mix);
 
     // This dictionary is updated as the loop over all dust populations in the mix proceeds.
     // For each type of grain composition, it keeps track of the grain mass above which
     // the dust population is most certainly in equilibrium.
     QHash<QString,double> eqMass;
 
-    // provide room for the probabilities calculated over each of the temperature grids
-    Array Pv;
-    Square<double> Am(ceil(Tuppermax)+1);
+    // get the scratch memory for the current execution thread, allocating it if this is the first invocation
+    // (each thread accesses only its own slot, so there is no need for locking)
+    TDE_Scratch*& scratch = _scratchv[_parfac->currentThreadIndex()];
+    if (!scratch) scratch = new TDE_Scratch(_NTmax);
+    double* Pv = &scratch->_Pv[0];
+    Square<double>& Am = scratch->_Am;
 
     // accumulate the emissivities for all populations in the dust mix
     Array ev(_Nlambda);
@@ -6,10 +6,13 @@
 #ifndef TRANSIENTDUSTEMISSIVITY_HPP
 #define TRANSIENTDUSTEMISSIVITY_HPP
 
+#include <vector>
 #include <QHash>
 #include "DustEmissivity.hpp"
+class ParallelFactory;
 class TDE_Calculator;
 class TDE_Grid;
+class TDE_Scratch;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -108,6 +111,14 @@ private:
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsA;     // coarse grid
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsB;     // medium grid
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsC;     // fine grid
+
+    // the largest number of points in any of the temperature grids
+    int _NTmax;
+
+    // emissivity() allocates scratch memory in this vector on first use by each execution thread,
+    // so that subsequent invocations do not need to allocate memory for the calculation
+    ParallelFactory* _parfac;
+    mutable std::vector<TDE_Scratch*> _scratchv;
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -29,7 +29,7 @@ using namespace std;
 TreeDustGridStructure::TreeDustGridStructure()
     : _minlevel(0), _maxlevel(0),
       _search(TopDown), _Nrandom(100),
-      _maxOpticalDepth(0), _maxMassFraction(0), _maxDensDispFraction(0),
+      _maxOpticalDepth(0), _maxMassFraction(0), _maxDensDispFraction(0), _compact(false),
       _assigner(0), _parallel(0), _dd(0), _dmib(0),
       _totalmass(0), _eps(0),
       _Nnodes(0), _highestWriteLevel(0),
@@ -41,7 +41,7 @@ TreeDustGridStructure::TreeDustGridStructure()
 
 TreeDustGridStructure::~TreeDustGridStructure()
 {
-    for (int l=0; l<_Nnodes; l++)
+    for (unsigned int l=0; l<_tree.size(); l++)
         delete _tree[l];
 }
 
@@ -62,6 +62,8 @@ void TreeDustGridStructure::setupSelfBefore()
     if (_maxOpticalDepth < 0.0) throw FATALERROR("The maximum mean optical depth should be positive");
     if (_maxMassFraction < 0.0) throw FATALERROR("The maximum mass fraction should be positive");
     if (_maxDensDispFraction < 0.0) throw FATALERROR("The maximum density dispersion fraction should be positive");
+    if (_compact && _search == Bookkeeping)
+        throw FATALERROR("The compact tree representation does not support the bookkeeping search method");
 
     // If no assigner was set, use an IdenticalAssigner as default (each process builds the entire tree)
     if (!_assigner) setAssigner(new IdenticalAssigner(this));
@@ -161,6 +163,103 @@ void TreeDustGridStructure::setupSelfBefore()
         for (int l=0; l<_Nnodes; l++) _tree[l]->addneighbors();
         for (int l=0; l<_Nnodes; l++) _tree[l]->sortneighbors();
     }
+
+    // Convert the tree to its compact representation (if so requested)
+
+    if (_compact)
+    {
+        log->info("Converting the tree to its compact representation...");
+        buildcompacttree();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeDustGridStructure::buildcompacttree()
+{
+    // Determine the compact index for each node through a depth-first traversal of the tree.
+    // When a node is visited, a contiguous range of indices is reserved for its children,
+    // which are then visited in order. Leaf nodes are assigned cell numbers in the order of visiting.
+    vector<int> nodev(_Nnodes);     // the tree node id for each compact index
+    vector<int> indexv(_Nnodes);    // the compact index for each tree node id
+    _cellv.assign(_Nnodes, -1);
+    _leafv.resize(_Ncells);
+    int next = 1;
+    int m = 0;
+    vector<int> stack(1, 0);        // compact indices of the nodes to be visited
+    while (!stack.empty())
+    {
+        int i = stack.back();
+        stack.pop_back();
+        const TreeNode* node = _tree[nodev[i]];
+        if (node->ynchildless())
+        {
+            _cellv[i] = m;
+            _leafv[m] = i;
+            m++;
+        }
+        else
+        {
+            int Nchildren = node->children().size();
+            for (int c=0; c<Nchildren; c++)
+            {
+                int l = node->child(c)->id();
+                nodev[next+c] = l;
+                indexv[l] = next+c;
+            }
+            for (int c=Nchildren-1; c>=0; c--) stack.push_back(next+c);
+            next += Nchildren;
+        }
+    }
+
+    // Copy the node properties into the compact arrays
+    _boxv.resize(_Nnodes);
+    _firstchildv.assign(_Nnodes, -1);
+    _levelv.resize(_Nnodes);
+    _splitv.assign(_Nnodes, 0);
+    for (int i=0; i<_Nnodes; i++)
+    {
+        const TreeNode* node = _tree[nodev[i]];
+        _boxv[i] = node->extent();
+        _levelv[i] = node->level();
+        if (!node->ynchildless())
+        {
+            const TreeNode* child = node->child(0);
+            _firstchildv[i] = indexv[child->id()];
+            if (child->xmax() < node->xmax()) _splitv[i] |= 1;
+            if (child->ymax() < node->ymax()) _splitv[i] |= 2;
+            if (child->zmax() < node->zmax()) _splitv[i] |= 4;
+            int Nsplit = (_splitv[i]&1) + ((_splitv[i]>>1)&1) + ((_splitv[i]>>2)&1);
+            if ((1<<Nsplit) != static_cast<int>(node->children().size()))
+                throw FATALERROR("The compact tree representation does not support this type of tree node");
+        }
+    }
+
+    // Copy the neighbor lists of the leaf nodes into a single table
+    _nbrindexv.assign(6*_Nnodes+1, 0);
+    if (_search == Neighbor)
+    {
+        for (int i=0; i<_Nnodes; i++)
+        {
+            const TreeNode* node = _tree[nodev[i]];
+            for (int wall=0; wall<6; wall++)
+            {
+                _nbrindexv[6*i+wall] = _nbrv.size();
+                if (node->ynchildless())
+                {
+                    const vector<TreeNode*>& neighbors = node->neighbors(static_cast<TreeNode::Wall>(wall));
+                    for (unsigned int p=0; p<neighbors.size(); p++) _nbrv.push_back(indexv[neighbors[p]->id()]);
+                }
+            }
+        }
+        _nbrindexv[6*_Nnodes] = _nbrv.size();
+    }
+
+    // Discard the tree nodes and the related bookkeeping
+    for (int l=0; l<_Nnodes; l++) delete _tree[l];
+    vector<TreeNode*>().swap(_tree);
+    vector<int>().swap(_cellnumberv);
+    vector<int>().swap(_idv);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -393,6 +492,27 @@ ProcessAssigner* TreeDustGridStructure::assigner() const
 
 //////////////////////////////////////////////////////////////////////
 
+void TreeDustGridStructure::setCompactTree(bool value)
+{
+    _compact = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool TreeDustGridStructure::compactTree() const
+{
+    return _compact;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool TreeDustGridStructure::dependsOnDistribution() const
+{
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double TreeDustGridStructure::xmax() const
 {
     return _xmax;
@@ -418,14 +538,18 @@ double TreeDustGridStructure::volume(int m) const
 {
     if (m<0 || m>_Ncells)
         throw FATALERROR("Invalid cell number: " + QString::number(m));
-    TreeNode* node = getnode(m);
-    return node->xwidth() * node->ywidth() * node->zwidth();
+    return cellextent(m).volume();
 }
 
 //////////////////////////////////////////////////////////////////////
 
 int TreeDustGridStructure::whichcell(Position bfr) const
 {
+    if (_compact)
+    {
+        int i = compactnode(bfr);
+        return i>=0 ? _cellv[i] : -1;
+    }
     const TreeNode* node = root()->whichnode(bfr);
     return node ? cellnumber(node) : -1;
 }
@@ -434,14 +558,14 @@ int TreeDustGridStructure::whichcell(Position bfr) const
 
 Position TreeDustGridStructure::centralPositionInCell(int m) const
 {
-    return Position(getnode(m)->extent().center());
+    return Position(cellextent(m).center());
 }
 
 //////////////////////////////////////////////////////////////////////
 
 Position TreeDustGridStructure::randomPositionInCell(int m) const
 {
-    return _random->position(getnode(m)->extent());
+    return _random->position(cellextent(m));
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -454,6 +578,9 @@ void TreeDustGridStructure::path(DustGridPath* path) const
     // If the photon package starts outside the dust grid, move it into the first grid cell that it will pass
     Position r = path->moveInside(extent(), _eps);
 
+    // Use the compact representation of the tree if available
+    if (_compact) return compactpath(path, r);
+
     // Get the node containing the current location;
     // if the position is not inside the grid, return an empty path
     const TreeNode* node = root()->whichnode(r);
@@ -733,8 +860,8 @@ QList<SimulationItem*> TreeDustGridStructure::interfaceCandidates(const type_inf
 
 double TreeDustGridStructure::density(int h, int m) const
 {
-    TreeNode* node = getnode(m);
-    return _dmib->massInBox(h, node->extent()) / node->volume();
+    Box box = cellextent(m);
+    return _dmib->massInBox(h, box) / box.volume();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -745,10 +872,10 @@ void TreeDustGridStructure::write_xy(DustGridPlotFile* outfile) const
     outfile->writeRectangle(_xmin, _ymin, _xmax, _ymax);
     for (int m=0; m<_Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->zmin()) < 1e-8*extent().zwidth())
+        Box node = cellextent(m);
+        if (fabs(node.zmin()) < 1e-8*extent().zwidth())
         {
-            outfile->writeRectangle(node->xmin(), node->ymin(), node->xmax(), node->ymax());
+            outfile->writeRectangle(node.xmin(), node.ymin(), node.xmax(), node.ymax());
         }
     }
 }
@@ -761,10 +888,10 @@ void TreeDustGridStructure::write_xz(DustGridPlotFile* outfile) const
     outfile->writeRectangle(_xmin, _zmin, _xmax, _zmax);
     for (int m=0; m<_Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->ymin()) < 1e-8*extent().ywidth())
+        Box node = cellextent(m);
+        if (fabs(node.ymin()) < 1e-8*extent().ywidth())
         {
-            outfile->writeRectangle(node->xmin(), node->zmin(), node->xmax(), node->zmax());
+            outfile->writeRectangle(node.xmin(), node.zmin(), node.xmax(), node.zmax());
         }
     }
 }
@@ -777,10 +904,10 @@ void TreeDustGridStructure::write_yz(DustGridPlotFile* outfile) const
     outfile->writeRectangle(_ymin, _zmin, _ymax, _zmax);
     for (int m=0; m<_Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->xmin()) < 1e-8*extent().xwidth())
+        Box node = cellextent(m);
+        if (fabs(node.xmin()) < 1e-8*extent().xwidth())
         {
-            outfile->writeRectangle(node->ymin(), node->zmin(), node->ymax(), node->zmax());
+            outfile->writeRectangle(node.ymin(), node.zmin(), node.ymax(), node.zmax());
         }
     }
 }
@@ -792,9 +919,11 @@ void TreeDustGridStructure::write_xyz(DustGridPlotFile* outfile) const
     // Output all leaf cells up to a certain level
     for (int m=0; m<_Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (node->level() <= _highestWriteLevel)
-            outfile->writeCube(node->xmin(), node->ymin(), node->zmin(), node->xmax(), node->ymax(), node->zmax());
+        if (celllevel(m) <= _highestWriteLevel)
+        {
+            Box node = cellextent(m);
+            outfile->writeCube(node.xmin(), node.ymin(), node.zmin(), node.xmax(), node.ymax(), node.zmax());
+        }
     }
 }
 
@@ -820,3 +949,128 @@ int TreeDustGridStructure::cellnumber(const TreeNode* node) const
 }
 
 //////////////////////////////////////////////////////////////////////
+
+Box TreeDustGridStructure::cellextent(int m) const
+{
+    return _compact ? _boxv[_leafv[m]] : getnode(m)->extent();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int TreeDustGridStructure::celllevel(int m) const
+{
+    return _compact ? _levelv[_leafv[m]] : getnode(m)->level();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int TreeDustGridStructure::compactnode(Vec r) const
+{
+    if (!contains(r)) return -1;
+
+    int i = 0;
+    while (_firstchildv[i] >= 0)
+    {
+        // the upper corner of the first child is the point where the node has been split
+        int c = _firstchildv[i];
+        const Box& first = _boxv[c];
+        int split = _splitv[i];
+        int offset = 0;
+        int weight = 1;
+        if (split & 1) { if (r.x() >= first.xmax()) offset += weight; weight *= 2; }
+        if (split & 2) { if (r.y() >= first.ymax()) offset += weight; weight *= 2; }
+        if (split & 4) { if (r.z() >= first.zmax()) offset += weight; }
+        i = c + offset;
+    }
+    return i;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int TreeDustGridStructure::compactneighbor(int i, int wall, Vec r) const
+{
+    int pend = _nbrindexv[6*i+wall+1];
+    for (int p=_nbrindexv[6*i+wall]; p<pend; p++)
+    {
+        int j = _nbrv[p];
+        if (_boxv[j].contains(r)) return j;
+    }
+    return -1;  // specified position is not inside any of the neighbors
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeDustGridStructure::compactpath(DustGridPath* path, Position r) const
+{
+    // Get the node containing the current location;
+    // if the position is not inside the grid, return an empty path
+    int i = compactnode(r);
+    if (i<0) return path->clear();
+
+    double x,y,z;
+    r.cartesian(x,y,z);
+    double kx,ky,kz;
+    path->direction().cartesian(kx,ky,kz);
+
+    // Loop over nodes/path segments until we leave the grid
+    while (i>=0)
+    {
+        const Box& box = _boxv[i];
+        double xnext = (kx<0.0) ? box.xmin() : box.xmax();
+        double ynext = (ky<0.0) ? box.ymin() : box.ymax();
+        double znext = (kz<0.0) ? box.zmin() : box.zmax();
+        double dsx = (fabs(kx)>1e-15) ? (xnext-x)/kx : DBL_MAX;
+        double dsy = (fabs(ky)>1e-15) ? (ynext-y)/ky : DBL_MAX;
+        double dsz = (fabs(kz)>1e-15) ? (znext-z)/kz : DBL_MAX;
+
+        double ds;
+        int wall;
+        if (dsx<=dsy && dsx<=dsz)
+        {
+            ds = dsx;
+            wall = (kx<0.0) ? TreeNode::BACK : TreeNode::FRONT;
+        }
+        else if (dsy<=dsx && dsy<=dsz)
+        {
+            ds = dsy;
+            wall = (ky<0.0) ? TreeNode::LEFT : TreeNode::RIGHT;
+        }
+        else
+        {
+            ds = dsz;
+            wall = (kz<0.0) ? TreeNode::BOTTOM : TreeNode::TOP;
+        }
+        path->addSegment(_cellv[i], ds);
+        x += (ds+_eps)*kx;
+        y += (ds+_eps)*ky;
+        z += (ds+_eps)*kz;
+
+        // with the Neighbor search method, attempt to find the new node among the neighbors of the current node;
+        // on rare occasions this fails due to rounding errors (e.g. in a corner), so we use top-down search as a fall-back
+        int oldi = i;
+        i = (_search == Neighbor) ? compactneighbor(i, wall, Vec(x,y,z)) : -1;
+        if (i<0) i = compactnode(Vec(x,y,z));
+
+        // if we're stuck in the same node...
+        if (i==oldi)
+        {
+            // try to escape by advancing the position to the next representable coordinates
+            find<Log>()->warning("Photon package seems stuck in dust cell "
+                                 + QString::number(_cellv[i]) + " -- escaping");
+            x = nextafter(x, (kx<0.0) ? -DBL_MAX : DBL_MAX);
+            y = nextafter(y, (ky<0.0) ? -DBL_MAX : DBL_MAX);
+            z = nextafter(z, (kz<0.0) ? -DBL_MAX : DBL_MAX);
+            i = compactnode(Vec(x,y,z));
+
+            // if that didn't work, terminate the path
+            if (i==oldi)
+            {
+                find<Log>()->warning("Photon package is stuck in dust cell "
+                                     + QString::number(_cellv[i]) + " -- terminating this path");
+                break;
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -6,6 +6,7 @@
 #ifndef TREEDUSTGRIDSTRUCTURE_HPP
 #define TREEDUSTGRIDSTRUCTURE_HPP
 
+#include <vector>
 #include "Box.hpp"
 #include "DustGridDensityInterface.hpp"
 #include "DustMassInBoxInterface.hpp"
@@ -25,7 +26,12 @@ class ProcessAssigner;
     The type of TreeNode used by the TreeDustGridStructure is decided in each subclass through
     a factory method. Depending on the type of TreeNode, the tree
     can become an octtree (8 children per node) or a kd-tree (2 children per node). Other
-    node types could be implemented, as long as they are cuboids lined up with the axes. */
+    node types could be implemented, as long as they are cuboids lined up with the axes.
+
+    Optionally, the tree can be converted to a compact representation after it has been
+    constructed. In that case the node objects are discarded and the tree is represented by a few
+    contiguous arrays indexed on node, so that traversing the grid no longer involves chasing
+    pointers between heap-allocated nodes. See setCompactTree() for more information. */
 class TreeDustGridStructure : public GenDustGridStructure, public Box, public DustGridDensityInterface
 {
     Q_OBJECT
@@ -89,6 +95,11 @@ class TreeDustGridStructure : public GenDustGridStructure, public Box, public Du
     Q_CLASSINFO("MaxValue", "1")
     Q_CLASSINFO("Default", "0")
 
+    Q_CLASSINFO("Property", "compactTree")
+    Q_CLASSINFO("Title", "use a compact representation of the tree for traversing the grid")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     Q_CLASSINFO("Property", "assigner")
     Q_CLASSINFO("Title", "the parallel process assignment scheme")
     Q_CLASSINFO("Default", "IdenticalAssigner")
@@ -118,7 +129,8 @@ protected:
         ID vector if the node is a leaf, and the number -1 if the node is not a leaf (and hence not
         a dust cell). Finally, the function logs some details on the number of nodes and the number
         of cells, and if writeFlag() returns true, it writes the distribution of the grid cells to
-        a file. */
+        a file. If a compact representation of the tree was requested, the function calls
+        buildcompacttree() as a final step. */
     void setupSelfBefore();
 
 private:
@@ -146,6 +158,19 @@ private:
         create the eight child nodes of the node and add them to the tree. */
     void subdivide(TreeNode* node);
 
+    /** This function, only to be called at the end of the construction phase, converts the tree
+        to its compact representation and discards the node objects. The nodes are renumbered so
+        that the children of each node occupy a contiguous range of indices, and so that the
+        subtrees are laid out depth-first. The leaf nodes (and thus the dust cells) are numbered in
+        the same depth-first order, which corresponds to Morton (Z-order) for an octtree, so that
+        cells that are close in space tend to be close in memory as well. For each node, the
+        function stores the spatial extent, the index of the first child (or -1 for a leaf), the
+        cell number (or -1 for a non-leaf), the level, and the coordinate axes along which the
+        node has been split. If the Neighbor search method is used, the neighbor lists of the leaf
+        nodes are stored in a single table, with an index listing the start of the neighbors for
+        each node wall. */
+    void buildcompacttree();
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -244,9 +269,28 @@ public:
     /** Returns the process assigner for this tree dust grid structure. */
     Q_INVOKABLE ProcessAssigner* assigner() const;
 
+    /** Sets the flag that indicates whether the tree should be converted to a compact
+        representation after it has been constructed. The compact representation stores the node
+        extents, first-child indices and cell numbers in contiguous arrays, and replaces the
+        per-node neighbor lists by a single neighbor table. This substantially reduces the memory
+        footprint of the tree, and it speeds up the grid traversal in the path(), whichcell() and
+        randomPositionInCell() functions. The compact representation supports the TopDown and
+        Neighbor search methods, but not the Bookkeeping method. As a side effect, the dust cells
+        are numbered in depth-first order rather than in the order of construction. The default
+        value is false. */
+    Q_INVOKABLE void setCompactTree(bool value);
+
+    /** Returns the flag that indicates whether the tree should be converted to a compact
+        representation after it has been constructed. */
+    Q_INVOKABLE bool compactTree() const;
+
     //======================== Other Functions =======================
 
 public:
+    /** This function returns true since the tree is subdivided according to the dust
+        distribution. */
+    bool dependsOnDistribution() const;
+
     /** This function returns the maximum extent \f$x_{\text{max}}\f$ of the grid structure in the
         \f$x\f$ direction. */
     double xmax() const;
@@ -352,6 +396,30 @@ private:
         vector. */
     int cellnumber(const TreeNode* node) const;
 
+    /** This function returns the spatial extent of the dust cell with cell number \f$m\f$, using
+        either the tree nodes or the compact representation. */
+    Box cellextent(int m) const;
+
+    /** This function returns the tree level of the dust cell with cell number \f$m\f$, using
+        either the tree nodes or the compact representation. */
+    int celllevel(int m) const;
+
+    /** This function returns the index of the node in the compact representation that contains the
+        specified position, or -1 if the position is outside the grid. It starts at the root node
+        and repeatedly selects the child containing the position by comparing the position with the
+        upper corner of the first child along each of the axes in which the node has been split. */
+    int compactnode(Vec r) const;
+
+    /** This function returns the index of the node in the compact representation that lies just
+        beyond the specified wall of the node with index \f$i\f$ and contains the specified
+        position, or -1 if such a node can't be found among the neighbors of that wall. */
+    int compactneighbor(int i, int wall, Vec r) const;
+
+    /** This function implements the path() function for the compact representation of the tree. It
+        follows the same algorithm as the TopDown and Neighbor search methods on the tree nodes,
+        starting from the specified position inside the grid. */
+    void compactpath(DustGridPath* path, Position r) const;
+
 protected:
     /** This pure virtual function, to be implemented in each subclass, creates a root node
         of the appropriate type, using a node identifier of zero and the specified spatial extent,
@@ -370,6 +438,7 @@ private:
     double _maxOpticalDepth;
     double _maxMassFraction;
     double _maxDensDispFraction;
+    bool _compact;
     ProcessAssigner* _assigner;
 
     // data members initialized during setup
@@ -384,6 +453,16 @@ private:
     std::vector<int> _idv;
     int _highestWriteLevel;
 
+    // data members for the compact representation of the tree (indexed on compact node index unless noted)
+    std::vector<Box> _boxv;             // the spatial extent of each node
+    std::vector<int> _firstchildv;      // the index of the first child, or -1 for a leaf node
+    std::vector<int> _cellv;            // the cell number, or -1 for a non-leaf node
+    std::vector<unsigned char> _levelv; // the level of each node
+    std::vector<unsigned char> _splitv; // the axes along which the node is split (bit 0: x, bit 1: y, bit 2: z)
+    std::vector<int> _leafv;            // the node index for each cell (indexed on cell number)
+    std::vector<int> _nbrindexv;        // the start of the neighbors in _nbrv for each node wall (indexed on 6*i+wall)
+    std::vector<int> _nbrv;             // the neighbor table
+
 protected:
     bool _useDmibForSubdivide;
 };
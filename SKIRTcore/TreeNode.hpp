@@ -104,6 +104,10 @@ public:
         that wall. The function expects that the neighbors of the node have been added. */
     const TreeNode* whichnode(Wall wall, Vec r) const;
 
+    /** This function returns the list of neighbors corresponding to a given wall. The list is
+        empty if the neighbors of the node have not been added. */
+    const std::vector<TreeNode*>& neighbors(Wall wall) const;
+
     /** This function ensures that the node has 6 neighbor lists; it should be called before
         adding any neighbors to the node. */
     void ensureneighborlists();
@@ -38,7 +38,7 @@ double
 UniformSmoothingKernel::generateRadius()
 const
 {
-    double X = find<Random>()->uniform();
+    double X = _random->uniform();
     return pow(X,1.0/3.0);
 }
 
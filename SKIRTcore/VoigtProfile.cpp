@@ -0,0 +1,240 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cmath>
+#include "Random.hpp"
+#include "VoigtProfile.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the grid in |x| for the Voigt function terms
+    const double XMAXH = 10.;   // beyond this value the Gaussian core is negligible
+    const int NXH = 5000;       // number of grid intervals
+
+    // the grid in (log10 a, |x|) for the velocity sampler
+    const double LOGAMIN = -6.;
+    const double LOGAMAX = 0.;
+    const int NA = 13;          // number of grid points in log10 a
+    const double XMAXU = 20.;   // beyond this value the splitting velocity is obtained from its asymptotic expression
+    const int NXU = 200;        // number of grid intervals in |x|
+
+    const double SQRTPI = sqrt(M_PI);
+
+    // returns the Gaussian core term of the Voigt function
+    double coreterm(double x)
+    {
+        return exp(-x*x);
+    }
+
+    // returns the damping wing term of the Voigt function, i.e. the factor multiplying a
+    double wingterm(double x)
+    {
+        double x2 = x*x;
+        double zeta = (x2-0.855) / (x2+3.42);
+        if (zeta <= 0.) return 0.;
+        double PiZeta = (((5.678*zeta - 9.207)*zeta + 4.421)*zeta + 0.1117)*zeta;
+        return (1.+21./x2) * PiZeta / (SQRTPI*(x2+1.));
+    }
+
+    // returns a times the integral of the envelope for the first (Lorentzian) sampling variant
+    double envelopeLorentz(double a, double x, double u0)
+    {
+        double theta0 = atan((u0-x)/a);
+        return (theta0+M_PI_2) + exp(-u0*u0)*(M_PI_2-theta0);
+    }
+
+    // returns a times the integral of the envelope for the second (Gaussian) sampling variant
+    double envelopeGauss(double a, double x, double u0)
+    {
+        double theta0 = atan((u0-x)/a);
+        return a/((u0-x)*(u0-x)+a*a) * 0.5*SQRTPI*(1.+erf(u0)) + exp(-u0*u0)*(M_PI_2-theta0);
+    }
+
+    // returns the value of u in [umin,umax] that minimizes the specified function, using a coarse
+    // scan followed by a golden section search around the best scan point
+    template<typename Functor> double minimize(Functor f, double umin, double umax)
+    {
+        const int N = 40;
+        double du = (umax-umin)/N;
+        int kbest = 0;
+        double fbest = f(umin);
+        for (int k=1; k<=N; k++)
+        {
+            double fk = f(umin+k*du);
+            if (fk < fbest) { fbest = fk; kbest = k; }
+        }
+
+        const double g = 0.5*(sqrt(5.)-1.);
+        double lo = umin + max(kbest-1,0)*du;
+        double hi = umin + min(kbest+1,N)*du;
+        double u1 = hi - g*(hi-lo);
+        double u2 = lo + g*(hi-lo);
+        double f1 = f(u1);
+        double f2 = f(u2);
+        for (int i=0; i<30; i++)
+        {
+            if (f1 < f2) { hi = u2; u2 = u1; f2 = f1; u1 = hi - g*(hi-lo); f1 = f(u1); }
+            else         { lo = u1; u1 = u2; f1 = f2; u2 = lo + g*(hi-lo); f2 = f(u2); }
+        }
+        return 0.5*(lo+hi);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+VoigtProfile::VoigtProfile()
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void VoigtProfile::initialize()
+{
+    // tabulate the core and wing terms of the Voigt function
+    _hv.resize(2*(NXH+1));
+    for (int k=0; k<=NXH; k++)
+    {
+        double x = k*(XMAXH/NXH);
+        _hv[2*k] = coreterm(x);
+        _hv[2*k+1] = wingterm(x);
+    }
+
+    // determine the optimal sampling variant and splitting velocity for each grid point
+    _u0vv.resize(NA, NXU+1);
+    _gaussv.assign(NA*(NXU+1), 0);
+    for (int i=0; i<NA; i++)
+    {
+        double a = pow(10., LOGAMIN + i*(LOGAMAX-LOGAMIN)/(NA-1));
+        for (int j=0; j<=NXU; j++)
+        {
+            double x = j*(XMAXU/NXU);
+
+            auto lorentz = [a,x](double u0){ return envelopeLorentz(a,x,u0); };
+            double u0 = minimize(lorentz, 0., max(x,1.));
+            double envelope = lorentz(u0);
+
+            if (x > 1.)
+            {
+                auto gauss = [a,x](double u0){ return envelopeGauss(a,x,u0); };
+                double u0g = minimize(gauss, 0., x);
+                if (gauss(u0g) < envelope)
+                {
+                    u0 = u0g;
+                    _gaussv[i*(NXU+1)+j] = 1;
+                }
+            }
+            _u0vv(i,j) = u0;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double VoigtProfile::operator()(double a, double x) const
+{
+    x = fabs(x);
+    if (x >= XMAXH) return a*wingterm(x);
+
+    double p = x*(NXH/XMAXH);
+    int k = static_cast<int>(p);
+    p -= k;
+    const double* h = &_hv[2*k];
+    return (1.-p)*h[0] + p*h[2] + a*((1.-p)*h[1] + p*h[3]);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double VoigtProfile::splitting(double a, double x, bool& gauss) const
+{
+    // far in the line wings the second variant is always preferred; its envelope integral behaves as
+    // a sqrt(pi)/(x-u0)^2 + pi exp(-u0^2), which is minimal for u0^2 = ln(sqrt(pi) u0 (x-u0)^3 / a);
+    // starting from the balance exp(-u0^2) pi = a sqrt(pi)/x^2, a few fixed-point iterations converge
+    if (x > XMAXU)
+    {
+        gauss = true;
+        double u0 = sqrt(max(0., log(SQRTPI*x*x/a)));
+        for (int k=0; k<3; k++) u0 = sqrt(max(0., log(SQRTPI*u0*(x-u0)*(x-u0)*(x-u0)/a)));
+        return min(u0, x);
+    }
+
+    int i = static_cast<int>(floor((log10(a)-LOGAMIN) * ((NA-1)/(LOGAMAX-LOGAMIN)) + 0.5));
+    i = max(0, min(NA-1, i));
+    int j = min(NXU, static_cast<int>(x*(NXU/XMAXU) + 0.5));
+    gauss = _gaussv[i*(NXU+1)+j] != 0;
+
+    // the second variant requires u0 <= x, which may be violated by the nearest grid point
+    double u0 = _u0vv(i,j);
+    return gauss ? min(u0, x) : u0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double VoigtProfile::sampleParallelVelocity(Random* random, double a, double x) const
+{
+    // the distribution for negative x is the mirror image of the one for positive x
+    double sign = x < 0. ? -1. : 1.;
+    x = fabs(x);
+
+    bool gauss;
+    double u0 = splitting(a, x, gauss);
+    double theta0 = atan((u0-x)/a);
+    double eu0 = exp(-u0*u0);
+    double wtail = eu0*(M_PI_2-theta0);
+
+    if (!gauss)
+    {
+        // Lorentzian proposal on both sides of u0
+        double p = (theta0+M_PI_2) / (theta0+M_PI_2+wtail);
+        while (true)
+        {
+            bool core = random->uniform() <= p;
+            double theta = core ? -M_PI_2 + (theta0+M_PI_2)*random->uniform()
+                                : theta0 + (M_PI_2-theta0)*random->uniform();
+            double u = a*tan(theta) + x;
+            double R = random->uniform();
+            if (core ? R <= exp(-u*u) : R*eu0 <= exp(-u*u)) return sign*u;
+        }
+    }
+    else
+    {
+        // Gaussian proposal below u0 and Lorentzian proposal above u0
+        double L0 = (u0-x)*(u0-x) + a*a;
+        double wcore = a/L0 * 0.5*SQRTPI*(1.+erf(u0));
+        double p = wcore / (wcore+wtail);
+        while (true)
+        {
+            if (random->uniform() <= p)
+            {
+                double u;
+                do u = M_SQRT1_2*random->gauss(); while (u > u0);
+                if (random->uniform()*((u-x)*(u-x)+a*a) <= L0) return sign*u;
+            }
+            else
+            {
+                double u = a*tan(theta0 + (M_PI_2-theta0)*random->uniform()) + x;
+                if (random->uniform()*eu0 <= exp(-u*u)) return sign*u;
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double VoigtProfile::acceptanceRate(double a, double x) const
+{
+    x = fabs(x);
+    bool gauss;
+    double u0 = splitting(a, x, gauss);
+    double envelope = gauss ? envelopeGauss(a,x,u0) : envelopeLorentz(a,x,u0);
+
+    // the approximation for H(a,x) overestimates the exact value near the line centre for large a
+    return min(1., M_PI * (*this)(a,x) / envelope);
+}
+
+//////////////////////////////////////////////////////////////////////
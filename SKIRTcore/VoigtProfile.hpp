@@ -0,0 +1,93 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef VOIGTPROFILE_HPP
+#define VOIGTPROFILE_HPP
+
+#include <vector>
+#include "Array.hpp"
+#include "Table.hpp"
+class Random;
+
+//////////////////////////////////////////////////////////////////////
+
+/** VoigtProfile is a technical class that provides the quantities needed for resonant line
+    scattering with a Voigt line profile, in a form that can be evaluated efficiently for every
+    scattering event. The profile is described by the dimensionless damping parameter \f$a\f$ (the
+    ratio of the natural line width to the Doppler width) and the dimensionless frequency offset
+    \f$x\f$ from the line centre in units of the Doppler width.
+
+    The Voigt function is evaluated using the approximation by Tasitsiomi (2006, ApJ 645, 792), \f[
+    H(a,x) = {\rm e}^{-x^2} + a\,\frac{(1+21/x^2)\,\Pi(\zeta)}{\sqrt{\pi}\,(x^2+1)} \qquad
+    \text{with}\quad \zeta=\frac{x^2-0.855}{x^2+3.42}, \f] where \f$\Pi(\zeta)\f$ is a fourth-order
+    polynomial for \f$\zeta>0\f$ and zero otherwise. Because the approximation is linear in
+    \f$a\f$, the table over \f$(a,x)\f$ reduces to two one-dimensional tables over \f$|x|\f$ for the
+    Gaussian core and for the damping wing term, which are linearly interpolated. Beyond the
+    tabulated range the core vanishes and the wing term is evaluated directly.
+
+    The velocity \f$u_\parallel\f$ of the scattering atom along the photon direction, in units of
+    the thermal velocity, follows the distribution \f[ f(u_\parallel) \propto \frac{{\rm
+    e}^{-u_\parallel^2}} {(u_\parallel-x)^2+a^2}. \f] It is sampled with a two-piece rejection
+    method, splitting the velocity axis at a value \f$u_0\f$. The first variant, due to Zheng &
+    Miralda-Escudé (2002, ApJ 578, 33), uses a Lorentzian proposal on both sides of \f$u_0\f$,
+    multiplied by \f${\rm e}^{-u_0^2}\f$ for \f$u_\parallel>u_0\f$. The second variant is more
+    efficient far in the line wings. It uses a Gaussian proposal multiplied by the Lorentzian value
+    at \f$u_0\f$ for \f$u_\parallel\le u_0\le x\f$, and the same Lorentzian tail as the first variant
+    for \f$u_\parallel>u_0\f$. Any choice of \f$u_0\f$ yields the exact distribution, but the
+    acceptance rate depends strongly on \f$u_0\f$. During initialization the acceptance rate of both
+    variants is therefore maximized over \f$u_0\f$ on a grid in \f$\log_{10}a\f$ and \f$|x|\le20\f$.
+    The variant and \f$u_0\f$ of the nearest grid point are used for sampling. Beyond the grid, the
+    second variant is used with the optimal \f$u_0\f$ obtained from the asymptotic form of its
+    envelope integral, \f$a\sqrt{\pi}/(x-u_0)^2+\pi\,{\rm e}^{-u_0^2}\f$, so that the acceptance
+    rate approaches unity for large \f$|x|\f$ rather than decaying. Since the envelope
+    integrals are known analytically, the acceptance rate for a given \f$(a,x)\f$ is known in
+    advance and can be obtained with the acceptanceRate() function.
+
+    An object of this class is cheap to construct. The tables are built by the initialize()
+    function. After that, all functions are read-only and can be called concurrently from multiple
+    threads. */
+class VoigtProfile
+{
+public:
+    /** The constructor creates an uninitialized profile. The initialize() function must be called
+        before any of the other functions. */
+    VoigtProfile();
+
+    /** This function builds the tables for the Voigt function and for the velocity sampler, as
+        described in the class header. */
+    void initialize();
+
+    /** This function returns the value of the Voigt function \f$H(a,x)\f$ for the specified
+        damping parameter \f$a\f$ and frequency offset \f$x\f$, interpolated from the tables. */
+    double operator()(double a, double x) const;
+
+    /** This function returns a random velocity \f$u_\parallel\f$ of the scattering atom along the
+        direction of the incoming photon, in units of the thermal velocity. The photon has a
+        frequency offset \f$x\f$ in a medium with damping parameter \f$a\f$, and \em random is the
+        random number generator to use. */
+    double sampleParallelVelocity(Random* random, double a, double x) const;
+
+    /** This function returns the probability that a single proposal of the
+        sampleParallelVelocity() function is accepted, for the specified damping parameter
+        \f$a\f$ and frequency offset \f$x\f$. The expected number of proposals per sample is the
+        inverse of this value. */
+    double acceptanceRate(double a, double x) const;
+
+private:
+    /** This function determines the grid point nearest to the specified damping parameter \f$a\f$
+        and absolute frequency offset \f$x\ge0\f$. It returns the splitting velocity \f$u_0\f$ for
+        that grid point, and sets \em gauss to true if the second sampling variant should be used.
+        Beyond the grid in \f$|x|\f$, the function returns the asymptotically optimal \f$u_0\f$ for
+        the second variant instead. */
+    double splitting(double a, double x, bool& gauss) const;
+
+    Array _hv;                  // tabulated core and wing terms of H (interleaved) on a regular grid in |x|
+    Table<2> _u0vv;             // optimal splitting velocity u0 on a grid in (log10 a, |x|)
+    std::vector<char> _gaussv;  // flag indicating the second sampling variant for each grid point
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif // VOIGTPROFILE_HPP
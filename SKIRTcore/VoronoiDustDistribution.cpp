@@ -54,7 +54,7 @@ void VoronoiDustDistribution::setupSelfAfter()
     }
 
     // import the Voronoi mesh
-    _mesh = new VoronoiMesh(_meshfile, fieldIndices, Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax));
+    _mesh = new VoronoiMesh(_meshfile, fieldIndices, Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax), this);
     find<Log>()->info("Voronoi mesh data was successfully imported: " + QString::number(_mesh->Ncells()) + " cells.");
 
     // add a density field for each of our components, so that the mesh holds the total density
@@ -201,9 +201,8 @@ double VoronoiDustDistribution::density(Position bfr) const
 
 Position VoronoiDustDistribution::generatePosition() const
 {
-    Random* random = find<Random>();
-    int m = NR::locate_clip(_cumrhov, random->uniform());
-    return _mesh->randomPosition(random, m);
+    int m = NR::locate_clip(_cumrhov, _random->uniform());
+    return _mesh->randomPosition(_random, m);
 }
 
 //////////////////////////////////////////////////////////////////////
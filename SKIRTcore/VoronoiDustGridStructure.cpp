@@ -21,7 +21,8 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 VoronoiDustGridStructure::VoronoiDustGridStructure()
-    : _numParticles(0), _distribution(DustDensity), _meshfile(0), _mesh(0), _meshOwned(true)
+    : _numParticles(0), _distribution(DustDensity), _meshfile(0), _precomputePlanes(false),
+      _mesh(0), _meshOwned(true)
 {
 }
 
@@ -55,7 +56,7 @@ void VoronoiDustGridStructure::setupSelfBefore()
             }
             log->info("Computing Voronoi tesselation for " + QString::number(_numParticles)
                       + " uniformly distributed random particles...");
-            _mesh = new VoronoiMesh(rv, extent());
+            _mesh = new VoronoiMesh(rv, extent(), this);
             break;
         }
     case CentralPeak:
@@ -80,7 +81,7 @@ void VoronoiDustGridStructure::setupSelfBefore()
             }
             log->info("Computing Voronoi tesselation for " + QString::number(_numParticles)
                       + " random particles distributed in a central peak...");
-            _mesh = new VoronoiMesh(rv, extent());
+            _mesh = new VoronoiMesh(rv, extent(), this);
             break;
         }
     case DustDensity:
@@ -102,7 +103,7 @@ void VoronoiDustGridStructure::setupSelfBefore()
             }
             log->info("Computing Voronoi tesselation for " + QString::number(_numParticles)
                       + " random particles distributed according to dust density...");
-            _mesh = new VoronoiMesh(rv, extent());
+            _mesh = new VoronoiMesh(rv, extent(), this);
             break;
         }
     case DustTesselation:
@@ -121,14 +122,14 @@ void VoronoiDustGridStructure::setupSelfBefore()
             if (!dpi) throw FATALERROR("Can't retrieve particle locations from this dust distribution");
             log->info("Computing Voronoi tesselation for " + QString::number(dpi->numParticles())
                       + " dust distribution particles...");
-            _mesh = new VoronoiMesh(dpi, extent());
+            _mesh = new VoronoiMesh(dpi, extent(), this);
             break;
         }
     case File:
         {
             if (!_meshfile) throw FATALERROR("File containing particle locations is not defined");
             log->info("Computing Voronoi tesselation for particles loaded from file " + _meshfile->filename() + "...");
-            _mesh = new VoronoiMesh(_meshfile, QList<int>(), extent());
+            _mesh = new VoronoiMesh(_meshfile, QList<int>(), extent(), this);
             break;
         }
     default:
@@ -171,6 +172,13 @@ void VoronoiDustGridStructure::setupSelfBefore()
     log->info("  Minimum number of cells per tree : " + QString::number(minRefsPerTree));
     log->info("  Maximum number of cells per tree : " + QString::number(maxRefsPerTree));
 
+    // If requested, precompute the bisecting planes used for calculating paths
+    if (_precomputePlanes)
+    {
+        log->info("Precomputing the bisecting planes between neighboring cells...");
+        _mesh->precomputePlanes();
+    }
+
     // If requested, output the plot files (we have to reconstruct the Voronoi tesselation...)
     if (writeGrid())
     {
@@ -306,6 +314,28 @@ VoronoiMeshFile* VoronoiDustGridStructure::voronoiMeshFile() const
 {
     return _meshfile;
 }
+
+//////////////////////////////////////////////////////////////////////
+
+void VoronoiDustGridStructure::setPrecomputePlanes(bool value)
+{
+    _precomputePlanes = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool VoronoiDustGridStructure::precomputePlanes() const
+{
+    return _precomputePlanes;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool VoronoiDustGridStructure::dependsOnDistribution() const
+{
+    return _distribution == DustDensity || _distribution == DustTesselation || _distribution == SPHParticles;
+}
+
 //////////////////////////////////////////////////////////////////////
 
 double VoronoiDustGridStructure::xmax() const
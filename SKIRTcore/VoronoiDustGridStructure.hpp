@@ -69,6 +69,11 @@ class VoronoiDustGridStructure : public GenDustGridStructure, public Box
     Q_CLASSINFO("Default", "VoronoiMeshAsciiFile")
     Q_CLASSINFO("RelevantIf", "distribution")
 
+    Q_CLASSINFO("Property", "precomputePlanes")
+    Q_CLASSINFO("Title", "precompute the bisecting planes between neighboring cells to accelerate paths")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -140,9 +145,22 @@ public:
         value \em File. */
     Q_INVOKABLE VoronoiMeshFile* voronoiMeshFile() const;
 
+    /** Sets the flag that indicates whether the planes bisecting each cell and its neighbors are
+        precomputed during setup. This accelerates the path calculation at the cost of additional
+        memory; see VoronoiMesh::precomputePlanes(). The default value is false. */
+    Q_INVOKABLE void setPrecomputePlanes(bool value);
+
+    /** Returns the flag that indicates whether the planes bisecting each cell and its neighbors
+        are precomputed during setup. */
+    Q_INVOKABLE bool precomputePlanes() const;
+
     //======================== Other Functions =======================
 
 public:
+    /** This function returns true if the generating points are sampled from the dust distribution
+        or taken from its tesselation or particles, and false otherwise. */
+    bool dependsOnDistribution() const;
+
     /** This function returns the maximum extent \f$x_{\text{max}}\f$ of the grid structure in the
         \f$x\f$ direction. */
     double xmax() const;
@@ -182,6 +200,7 @@ private:
     int _numParticles;
     Distribution _distribution;
     VoronoiMeshFile* _meshfile;
+    bool _precomputePlanes;
 
     // data members initialized during setup
     VoronoiMesh* _mesh;
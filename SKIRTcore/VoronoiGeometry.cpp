@@ -39,7 +39,7 @@ void VoronoiGeometry::setupSelfBefore()
 
     // import the Voronoi mesh
     _mesh = new VoronoiMesh(_meshfile, QList<int>() << _densityIndex << _multiplierIndex,
-                             Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax));
+                             Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax), this);
     _mesh->addDensityDistribution(_densityIndex, _multiplierIndex);
     find<Log>()->info("Voronoi mesh data was successfully imported: " + QString::number(_mesh->Ncells()) + " cells.");
 
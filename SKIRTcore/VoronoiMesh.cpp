@@ -10,6 +10,10 @@
 #include "VoronoiMesh.hpp"
 #include "VoronoiMeshFile.hpp"
 #include "FatalError.hpp"
+#include "IdenticalAssigner.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
+#include "ParallelTarget.hpp"
 #include "Random.hpp"
 #include "container.hh"
 
@@ -71,6 +75,9 @@ namespace VoronoiMesh_Private
 
         // returns a list of neighboring cell/particle ids
         const vector<int>& neighbors() { return _neighbors; }
+
+        // releases the memory used by the list of neighboring cell/particle ids
+        void clearNeighbors() { vector<int>().swap(_neighbors); }
     };
 
     // function to compare two points according to the specified axis (0,1,2)
@@ -224,13 +231,62 @@ namespace VoronoiMesh_Private
             return best;
         }
     };
+
+    // class to compute the Voronoi cells for the particles in each block of a Voro++ container (parallelized)
+    class CellCalculator : public ParallelTarget
+    {
+    private:
+        // data members initialized in constructor
+        voro::container& _con;
+        vector<VoronoiCell*>& _cells;
+        ParallelFactory* _factory;
+
+        // a Voro++ compute object for each execution thread, constructed when first needed;
+        // such an object holds the search state so that the shared container is only read
+        vector< voro::voro_compute<voro::container>* > _vcv;
+
+    public:
+        // constructor
+        CellCalculator(voro::container& con, vector<VoronoiCell*>& cells, ParallelFactory* factory)
+            : _con(con), _cells(cells), _factory(factory), _vcv(factory->maxThreadCount(), 0) { }
+
+        // destructor
+        ~CellCalculator()
+        {
+            for (auto vc : _vcv) delete vc;
+        }
+
+        // the parallelized loop body; the index specifies a block in the container
+        void body(size_t index)
+        {
+            voro::voro_compute<voro::container>*& vc = _vcv[_factory->currentThreadIndex()];
+            if (!vc) vc = new voro::voro_compute<voro::container>(_con, _con.nx, _con.ny, _con.nz);
+
+            // for each particle in the block:
+            //   - compute the corresponding cell in the Voronoi tesselation
+            //   - extract and copy the relevant information to the cell object with the same index
+            int ijk = index;
+            int k = ijk/_con.nxy;
+            int j = (ijk-_con.nxy*k)/_con.nx;
+            int i = ijk-_con.nxy*k-_con.nx*j;
+            for (int q=0; q<_con.co[ijk]; q++)
+            {
+                int m = _con.id[ijk][q];
+                voro::voronoicell_neighbor fullcell;
+                bool ok = vc->compute_cell(fullcell, ijk, q, i, j, k);
+                if (!ok) throw FATALERROR("Can't compute Voronoi cell " + QString::number(m));
+                _cells[m]->init(fullcell);
+            }
+        }
+    };
 }
 
 using namespace VoronoiMesh_Private;
 
 ////////////////////////////////////////////////////////////////////
 
-VoronoiMesh::VoronoiMesh(VoronoiMeshFile* meshfile, QList<int> fieldIndices, const Box& extent)
+VoronoiMesh::VoronoiMesh(VoronoiMeshFile* meshfile, QList<int> fieldIndices, const Box& extent,
+                         SimulationItem* item)
     : _extent(extent), _eps(1e-12 * extent.widths().norm()),
       _Ndistribs(0), _integratedDensity(0)
 {
@@ -273,22 +329,22 @@ VoronoiMesh::VoronoiMesh(VoronoiMeshFile* meshfile, QList<int> fieldIndices, con
     meshfile->close();
 
     // construct the Voronoi tesselation
-    buildMesh(particles);
+    buildMesh(particles, item);
 }
 
 ////////////////////////////////////////////////////////////////////
 
-VoronoiMesh::VoronoiMesh(const std::vector<Vec> &particles, const Box &extent)
+VoronoiMesh::VoronoiMesh(const std::vector<Vec> &particles, const Box &extent, SimulationItem* item)
     : _extent(extent), _eps(1e-12 * extent.widths().norm()),
       _Ndistribs(0), _integratedDensity(0)
 {
     // construct the Voronoi tesselation
-    buildMesh(particles);
+    buildMesh(particles, item);
 }
 
 ////////////////////////////////////////////////////////////////////
 
-VoronoiMesh::VoronoiMesh(DustParticleInterface *dpi, const Box &extent)
+VoronoiMesh::VoronoiMesh(DustParticleInterface *dpi, const Box &extent, SimulationItem* item)
     : _extent(extent), _eps(1e-12 * extent.widths().norm()),
       _Ndistribs(0), _integratedDensity(0)
 {
@@ -302,12 +358,12 @@ VoronoiMesh::VoronoiMesh(DustParticleInterface *dpi, const Box &extent)
     }
 
     // construct the Voronoi tesselation
-    buildMesh(particles);
+    buildMesh(particles, item);
 }
 
 ////////////////////////////////////////////////////////////////////
 
-void VoronoiMesh::buildMesh(const std::vector<Vec>& particles)
+void VoronoiMesh::buildMesh(const std::vector<Vec>& particles, SimulationItem* item)
 {
     // Cache some often used values
     _Ncells = particles.size();
@@ -330,28 +386,28 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles)
         con.put(m, r.x(),r.y(),r.z());
     }
 
+    // Compute the Voronoi cells and copy the relevant information into our cell objects,
+    // distributing the blocks of the container over the parallel threads (each process computes all cells)
+    ParallelFactory* factory = item->find<ParallelFactory>();
+    Parallel* parallel = factory->parallel();
+    IdenticalAssigner* assigner = new IdenticalAssigner(item);
+    {
+        CellCalculator calc(con, _cells, factory);
+        assigner->assign(con.nxyz);
+        parallel->call(&calc, assigner);
+    }
+    delete assigner;
+
     // Initialize a vector of nb x nb x nb lists, each containing the cells overlapping a certain block in the domain
     _blocklists.resize(_nb3);
 
-    // For each particle:
-    //   - compute the corresponding cell in the Voronoi tesselation
-    //   - extract and copy the relevant information to one of our own cell objects
-    //   - store the cell object in the vector indexed on cell number
-    //   - add the cell object to the lists for all blocks it overlaps
+    // Add each cell object to the lists for all blocks it may overlap
+    // --> a precise intersection test is really slow and doesn't substantially accelerate whichcell()
+    // --> loop over the cells in container order so that the lists do not depend on the number of threads
     voro::c_loop_all loop(con);
     if (loop.start()) do
     {
-        // Compute the cell
-        voro::voronoicell_neighbor fullcell;
-        bool ok = con.compute_cell(fullcell, loop);
-        if (!ok) throw FATALERROR("Can't compute Voronoi cell " + QString::number(loop.pid()));
-
-        // Copy all relevant information to the cell object that will stay around
         VoronoiCell* cell = _cells[loop.pid()];
-        cell->init(fullcell);
-
-        // Add the cell object to the lists for all blocks it may overlap
-        // --> a precise intersection test is really slow and doesn't substantially accelerate whichcell()
         int i1,j1,k1, i2,j2,k2;
         _extent.cellindices(i1,j1,k1, cell->rmin()-Vec(_eps,_eps,_eps), _nb,_nb,_nb);
         _extent.cellindices(i2,j2,k2, cell->rmax()+Vec(_eps,_eps,_eps), _nb,_nb,_nb);
@@ -363,15 +419,43 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles)
     while (loop.inc());
 
     // for each block that contains more than a predefined number of cells,
-    // construct a search tree on the particle locations of the cells
+    // construct a search tree on the particle locations of the cells (parallelized)
     _blocktrees.resize(_nb3);
-    for (int b = 0; b<_nb3; b++)
+    assigner->assign(_nb3);
+    parallel->call(this, &VoronoiMesh::buildTreeBody, assigner);
+
+    // copy the particle positions and the neighbor lists into compact arrays used for tracing paths,
+    // releasing the neighbor lists held by the cell objects
+    _xv.resize(_Ncells);
+    _yv.resize(_Ncells);
+    _zv.resize(_Ncells);
+    _nbrfirstv.resize(_Ncells+1);
+    _nbrfirstv[0] = 0;
+    for (int m=0; m<_Ncells; m++)
     {
-        vector<int>& ids = _blocklists[b];
-        if (ids.size() > 5)
-        {
-            _blocktrees[b] = buildTree(ids.begin(), ids.end(), 0);
-        }
+        Vec r = _cells[m]->particle();
+        _xv[m] = r.x();
+        _yv[m] = r.y();
+        _zv[m] = r.z();
+        _nbrfirstv[m+1] = _nbrfirstv[m] + _cells[m]->neighbors().size();
+    }
+    _nbrv.resize(_nbrfirstv[_Ncells]);
+    for (int m=0; m<_Ncells; m++)
+    {
+        const vector<int>& neighbors = _cells[m]->neighbors();
+        copy(neighbors.begin(), neighbors.end(), _nbrv.begin()+_nbrfirstv[m]);
+        _cells[m]->clearNeighbors();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void VoronoiMesh::buildTreeBody(size_t b)
+{
+    vector<int>& ids = _blocklists[b];
+    if (ids.size() > 5)
+    {
+        _blocktrees[b] = buildTree(ids.begin(), ids.end(), 0);
     }
 }
 
@@ -445,7 +529,7 @@ void VoronoiMesh::neighborStatistics(double &average, int &minimum, int &maximum
     qint64 totalNeighbors = 0;
     for (int m=0; m<_Ncells; m++)
     {
-        int ns = _cells[m]->neighbors().size();
+        int ns = _nbrfirstv[m+1] - _nbrfirstv[m];
         totalNeighbors += ns;
         minNeighbors = min(minNeighbors, ns);
         maxNeighbors = max(maxNeighbors, ns);
@@ -591,25 +675,26 @@ Position VoronoiMesh::randomPosition(Random* random, int m) const
 
     // get loop-invariant information about the cell
     const Box& box = _cells[m]->extent();
-    const vector<int>& neighbors = _cells[m]->neighbors();
+    const int* begin = _nbrv.data() + _nbrfirstv[m];
+    const int* end = _nbrv.data() + _nbrfirstv[m+1];
 
     // generate random points in the enclosing box until one happens to be inside the cell
     for (int i=0; i<10000; i++)
     {
         Vec r = random->position(box);
-        if (isPointClosestTo(r, m, neighbors)) return Position(r);
+        if (isPointClosestTo(r, m, begin, end)) return Position(r);
     }
     throw FATALERROR("Can't find random position in cell");
 }
 
 //////////////////////////////////////////////////////////////////////
 
-bool VoronoiMesh::isPointClosestTo(Vec r, int m, const vector<int>& ids) const
+bool VoronoiMesh::isPointClosestTo(Vec r, int m, const int* begin, const int* end) const
 {
     double target = _cells[m]->squaredDistanceTo(r);
-    foreach (int id, ids)
+    for (const int* id=begin; id!=end; ++id)
     {
-        if (id>=0 && _cells[id]->squaredDistanceTo(r) < target) return false;
+        if (*id>=0 && _cells[*id]->squaredDistanceTo(r) < target) return false;
     }
     return true;
 }
@@ -734,11 +819,46 @@ double VoronoiMesh::SigmaZ() const
 
 ////////////////////////////////////////////////////////////////////
 
+void VoronoiMesh::precomputePlanes()
+{
+    if (!_nxv.empty()) return;
+
+    // for each neighbor entry l of each cell m, store the normal n = p(mi)-p(m) and the offset d = n.p,
+    // where p = (p(mi)+p(m))/2 is a point on the bisecting plane, so that the plane is given by n.x = d
+    int Nentries = _nbrv.size();
+    _nxv.resize(Nentries);
+    _nyv.resize(Nentries);
+    _nzv.resize(Nentries);
+    _dv.resize(Nentries);
+    for (int m=0; m<_Ncells; m++)
+    {
+        for (int l=_nbrfirstv[m]; l<_nbrfirstv[m+1]; l++)
+        {
+            int mi = _nbrv[l];
+            if (mi>=0)
+            {
+                double nx = _xv[mi]-_xv[m];
+                double ny = _yv[mi]-_yv[m];
+                double nz = _zv[mi]-_zv[m];
+                _nxv[l] = nx;
+                _nyv[l] = ny;
+                _nzv[l] = nz;
+                _dv[l] = 0.5 * (nx*(_xv[mi]+_xv[m]) + ny*(_yv[mi]+_yv[m]) + nz*(_zv[mi]+_zv[m]));
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void VoronoiMesh::path(DustGridPath* path) const
 {
     // Initialize the path
     path->clear();
     Direction bfk = path->direction();
+    double kx = bfk.x();
+    double ky = bfk.y();
+    double kz = bfk.z();
 
     // If the photon package starts outside the dust grid, move it into the first grid cell that it will pass
     Position r = path->moveInside(_extent, _eps);
@@ -748,47 +868,63 @@ void VoronoiMesh::path(DustGridPath* path) const
     int mr = cellIndex(r);
     if (mr<0) return path->clear();
 
+    // Determine whether the bisecting planes have been precomputed
+    bool planes = !_nxv.empty();
+
     // Start the loop over cells/path segments until we leave the grid
     while (mr>=0)
     {
-        // get the particle position for this cell
-        Vec pr = _cells[mr]->particle();
+        // get the current position and the particle position for this cell
+        double rx = r.x();
+        double ry = r.y();
+        double rz = r.z();
+        double prx = _xv[mr];
+        double pry = _yv[mr];
+        double prz = _zv[mr];
 
         // initialize the smallest nonnegative intersection distance and corresponding index
         double sq = DBL_MAX;          // very large, but not infinity (so that infinite si values are discarded)
         const int NO_INDEX = -99;     // meaningless cell index
         int mq = NO_INDEX;
 
-        // loop over the list of neighbor indices
-        const vector<int>& mv = _cells[mr]->neighbors();
-        int n = mv.size();
-        for (int i=0; i<n; i++)
+        // loop over the range of neighbor entries for this cell
+        int lend = _nbrfirstv[mr+1];
+        for (int l=_nbrfirstv[mr]; l<lend; l++)
         {
-            int mi = mv[i];
+            int mi = _nbrv[l];
 
             // declare the intersection distance for this neighbor (init to a value that will be rejected)
             double si = 0;
 
-            // --- intersection with neighboring cell
-            if (mi>=0)
+            // --- intersection with neighboring cell, using the precomputed plane n.x = d
+            if (mi>=0 && planes)
             {
-                // get the particle position for this neighbor
-                Vec pi = _cells[mi]->particle();
+                // calculate the denominator of the intersection quotient
+                double ndotk = _nxv[l]*kx + _nyv[l]*ky + _nzv[l]*kz;
 
+                // if the denominator is negative the intersection distance is negative, so don't calculate it
+                if (ndotk > 0) si = (_dv[l] - (_nxv[l]*rx + _nyv[l]*ry + _nzv[l]*rz)) / ndotk;
+            }
+
+            // --- intersection with neighboring cell, calculating the plane on the fly
+            else if (mi>=0)
+            {
                 // calculate the (unnormalized) normal on the bisecting plane
-                Vec n = pi - pr;
+                double nx = _xv[mi] - prx;
+                double ny = _yv[mi] - pry;
+                double nz = _zv[mi] - prz;
 
                 // calculate the denominator of the intersection quotient
-                double ndotk = Vec::dot(n,bfk);
+                double ndotk = nx*kx + ny*ky + nz*kz;
 
                 // if the denominator is negative the intersection distance is negative, so don't calculate it
                 if (ndotk > 0)
                 {
-                    // calculate a point on the bisecting plane
-                    Vec p = 0.5 * (pi + pr);
-
-                    // calculate the intersection distance
-                    si = Vec::dot(n,p-r) / ndotk;
+                    // calculate the intersection distance using a point on the bisecting plane
+                    double px = 0.5 * (_xv[mi] + prx);
+                    double py = 0.5 * (_yv[mi] + pry);
+                    double pz = 0.5 * (_zv[mi] + prz);
+                    si = (nx*(px-rx) + ny*(py-ry) + nz*(pz-rz)) / ndotk;
                 }
             }
 
@@ -797,12 +933,12 @@ void VoronoiMesh::path(DustGridPath* path) const
             {
                 switch (mi)
                 {
-                case -1: si = (extent().xmin()-r.x())/bfk.x(); break;
-                case -2: si = (extent().xmax()-r.x())/bfk.x(); break;
-                case -3: si = (extent().ymin()-r.y())/bfk.y(); break;
-                case -4: si = (extent().ymax()-r.y())/bfk.y(); break;
-                case -5: si = (extent().zmin()-r.z())/bfk.z(); break;
-                case -6: si = (extent().zmax()-r.z())/bfk.z(); break;
+                case -1: si = (extent().xmin()-rx)/kx; break;
+                case -2: si = (extent().xmax()-rx)/kx; break;
+                case -3: si = (extent().ymin()-ry)/ky; break;
+                case -4: si = (extent().ymax()-ry)/ky; break;
+                case -5: si = (extent().zmin()-rz)/kz; break;
+                case -6: si = (extent().zmax()-rz)/kz; break;
                 default: throw FATALERROR("Invalid neighbor ID");
                 }
             }
@@ -14,6 +14,7 @@
 class DustGridPath;
 class DustParticleInterface;
 class Random;
+class SimulationItem;
 class VoronoiMeshFile;
 namespace VoronoiMesh_Private { class VoronoiCell; class Node; }
 
@@ -58,22 +59,28 @@ public:
         to zero-based column or variable indices. The data file must contain a sufficient number of
         columns or variables to accommodate the highest index in the list; additional columns or
         variables in the file are ignored. The indices may be specified in any order, and the same
-        index may be specified more than once. Negative values are ignored. The last argument \em
+        index may be specified more than once. Negative values are ignored. The argument \em
         extent specifies the extent of the domain as a box lined up with the coordinate axes.
-        Any particles located outside of the domain are discarded. */
-    VoronoiMesh(VoronoiMeshFile* meshfile, QList<int> fieldIndices, const Box& extent);
+        Any particles located outside of the domain are discarded. The last argument \em item
+        specifies a simulation item in the hierarchy of the caller; it is used to locate the
+        ParallelFactory that provides the execution threads for building the tesselation. */
+    VoronoiMesh(VoronoiMeshFile* meshfile, QList<int> fieldIndices, const Box& extent, SimulationItem* item);
 
     /** This constructor obtains the particle coordinates from a DustParticleInterface instance.
-        There are no field values associated with the particles. The last argument \em extent
+        There are no field values associated with the particles. The argument \em extent
         specifies the extent of the domain as a box lined up with the coordinate axes.
-        Any particles located outside of the domain are discarded. */
-    VoronoiMesh(DustParticleInterface* dpi, const Box& extent);
+        Any particles located outside of the domain are discarded. The last argument \em item
+        specifies a simulation item in the hierarchy of the caller, as for the first constructor.
+        */
+    VoronoiMesh(DustParticleInterface* dpi, const Box& extent, SimulationItem* item);
 
     /** This constructor uses the particle coordinates specified as a vector. There are no field
-        values associated with the particles. The last argument \em extent specifies the extent of
+        values associated with the particles. The argument \em extent specifies the extent of
         the domain as a box lined up with the coordinate axes. The specified particle locations
-        are assumed to be inside the domain; no check is performed. */
-    VoronoiMesh(const std::vector<Vec>& particles, const Box& extent);
+        are assumed to be inside the domain; no check is performed. The last argument \em item
+        specifies a simulation item in the hierarchy of the caller, as for the first constructor.
+        */
+    VoronoiMesh(const std::vector<Vec>& particles, const Box& extent, SimulationItem* item);
 
 private:
     /** This private function is called from each constructor. Given a list of generating
@@ -83,7 +90,7 @@ private:
         discarded.
 
         The function performs the following steps:
-         - add the particles to a Voro++ container, and compute the Voronoi cells one by one;
+         - add the particles to a Voro++ container, and compute the Voronoi cells in parallel;
          - copy the relevant cell information (such as the list of neighboring cells) from the
            Voro++ data structures into our own;
          - build a data structure that allows fast retrieval of a list of the Voronoi cells
@@ -102,12 +109,23 @@ private:
         To further reduce the search time within blocks that overlaps with a large number of cells,
         this function builds a binary search tree on the cell particle locations for those blocks
         (see for example <a href="http://en.wikipedia.org/wiki/Kd-tree">en.wikipedia.org/wiki/Kd-tree</a>).
-    */
-    void buildMesh(const std::vector<Vec>& particles);
+
+        The Voronoi cells are computed in parallel, distributing the blocks of the Voro++ container
+        over the execution threads. Each thread uses its own Voro++ compute object, which holds
+        the search state, so that the container itself is only read. The block lists are then
+        filled serially in the original container order, and the search trees for the different
+        blocks are again built in parallel. As a result, the mesh data structures do not depend on
+        the number of threads. */
+    void buildMesh(const std::vector<Vec>& particles, SimulationItem* item);
 
     /** This private function builds the binary search tree. TO DO: complete documentation. */
     VoronoiMesh_Private::Node* buildTree(std::vector<int>::iterator first, std::vector<int>::iterator last, int depth);
 
+    /** This private function builds the binary search tree for the block with index \em b, if that
+        block overlaps more than a predefined number of cells. It serves as the body of the parallel
+        loop over all blocks in buildMesh(). */
+    void buildTreeBody(size_t b);
+
 public:
     /** This function adds a density distribution accessed by functions such as density() and
         integratedDensity(). The first argument \em densityField specifies the index \f$g_d\f$ of
@@ -205,9 +223,11 @@ public:
 private:
     /** This function returns true if the specified point is closer to the particle
         defining the cell with index \em m than to all of the particles defining the cells with the
-        indices in the list \em ids; otherwise it returns false. If the list \em ids contains the
-        neighbors of \em m then this function returns true if the point is inside cell \em m. */
-    bool isPointClosestTo(Vec r, int m, const std::vector<int> &ids) const;
+        indices in the range [\em begin, \em end); otherwise it returns false. Negative indices
+        (representing walls) are ignored. If the range contains the neighbors of \em m, for
+        example the corresponding range in the _nbrv array, then this function returns true if the
+        point is inside cell \em m. */
+    bool isPointClosestTo(Vec r, int m, const int* begin, const int* end) const;
 
 public:
     /** This function returns the value \f$F_g(m)\f$ of the specified field in the cell with given
@@ -350,9 +370,25 @@ public:
         position vectors for the wall plane in this last formula. For example, for the left wall
         with \f$m_i=-1\f$ one has \f$\mathbf{n}=(-1,0,0)\f$ and \f$\mathbf{p}=(x_\text{min},0,0)\f$
         so that \f[s_i=\frac{x_\text{min}-r_x}{k_x}.\f]
+
+        The particle positions and the neighbor lists used by this function are stored in compact
+        arrays rather than in the individual cell objects, so that the loop over the neighbors of
+        a cell reads contiguous memory. If precomputePlanes() has been called, the function
+        evaluates the equivalent expression \f$s_i=(d-\mathbf{n}\cdot\mathbf{r})/
+        (\mathbf{n}\cdot\mathbf{k})\f$ with the precomputed normal \f$\mathbf{n}\f$ and offset
+        \f$d=\mathbf{n}\cdot\mathbf{p}\f$ for each neighbor, avoiding any access to the particle
+        positions of the neighbors.
     */
     void path(DustGridPath* path) const;
 
+    /** This function precomputes the normal \f$\mathbf{n}\f$ and the offset
+        \f$d=\mathbf{n}\cdot\mathbf{p}\f$ of the plane bisecting each cell and each of its
+        neighbors, as described for the path() function, and stores them for use by that function.
+        This accelerates the path calculation at the cost of 32 bytes of memory per neighbor entry,
+        i.e. typically around 500 bytes per cell. Calling this function more than once has no
+        further effect. */
+    void precomputePlanes();
+
     //========================= Data members =======================
 
 private:
@@ -380,6 +416,14 @@ private:
     std::vector< std::vector<int> > _blocklists;            // list of cell indices per block, indexed on i*_nb2+j*_nb+k
     std::vector< VoronoiMesh_Private::Node* > _blocktrees;  // root node of search tree or null for each block,
                                                             // indexed on i*_nb2+j*_nb+k
+
+    // compact data structures for tracing paths
+    std::vector<double> _xv, _yv, _zv;          // particle positions, indexed on m
+    std::vector<int> _nbrfirstv;                // index in _nbrv of the first neighbor entry l for each cell,
+                                                // indexed on m (with an extra element equal to the number of entries)
+    std::vector<int> _nbrv;                     // neighbor cell or wall ids for all cells, indexed on l
+    std::vector<double> _nxv, _nyv, _nzv, _dv;  // bisecting plane normals and offsets, indexed on l
+                                                // (empty unless precomputePlanes() has been called)
 };
 
 ////////////////////////////////////////////////////////////////////
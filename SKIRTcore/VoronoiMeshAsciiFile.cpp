@@ -3,8 +3,8 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
-#include <QFile>
 #include "VoronoiMeshAsciiFile.hpp"
+#include "ColumnDataFile.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "Log.hpp"
@@ -12,12 +12,19 @@
 ////////////////////////////////////////////////////////////////////
 
 VoronoiMeshAsciiFile::VoronoiMeshAsciiFile()
-    : _coordinateUnits(0)
+    : _coordinateUnits(0), _infile(0)
 {
 }
 
 //////////////////////////////////////////////////////////////////////
 
+VoronoiMeshAsciiFile::~VoronoiMeshAsciiFile()
+{
+    delete _infile;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void VoronoiMeshAsciiFile::setupSelfBefore()
 {
     VoronoiMeshFile::setupSelfBefore();
@@ -44,38 +51,27 @@ double VoronoiMeshAsciiFile::coordinateUnits() const
 
 void VoronoiMeshAsciiFile::open()
 {
-    // open the data file
+    // open the data file, or its binary version if available
+    close();
     QString filepath = find<FilePaths>()->input(_filename);
-    _infile.setFileName(filepath);
-    if (!_infile.open(QIODevice::ReadOnly|QIODevice::Text))
-        throw FATALERROR("Could not open the Voronoi mesh data file " + filepath);
-    find<Log>()->info("Reading Voronoi mesh data from ASCII file " + filepath + "...");
-    _columns.clear();
+    _infile = new ColumnDataFile(filepath, "Voronoi mesh data");
+    find<Log>()->info("Reading Voronoi mesh data from " + QString(_infile->isBinary() ? "binary" : "ASCII")
+                      + " file " + _infile->filepath() + "...");
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void VoronoiMeshAsciiFile::close()
 {
-    _infile.close();
-    _columns.clear();
+    delete _infile;
+    _infile = 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 
 bool VoronoiMeshAsciiFile::read()
 {
-    // read the next line, splitting it in columns, and skip empty and comment lines
-    while (!_infile.atEnd())
-    {
-        _columns = _infile.readLine().simplified().split(' ');
-        if (!_columns[0].isEmpty() && !_columns[0].startsWith('#'))
-        {
-            return true;
-        }
-    }
-    _columns.clear();
-    return false;
+    return _infile && _infile->read();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -83,13 +79,13 @@ bool VoronoiMeshAsciiFile::read()
 Vec VoronoiMeshAsciiFile::particle() const
 {
     // verify index range
-    if (_columns.size() < 3) throw FATALERROR("Insufficient number of particle coordinates in Voronoi mesh data");
+    if (!_infile || _infile->numValues() < 3) throw FATALERROR("Insufficient number of particle coordinates in Voronoi mesh data");
 
     // get the coordinate values
     bool okx, oky, okz;
-    double x = _columns.value(0).toDouble(&okx);
-    double y = _columns.value(1).toDouble(&oky);
-    double z = _columns.value(2).toDouble(&okz);
+    double x = _infile->value(0, &okx);
+    double y = _infile->value(1, &oky);
+    double z = _infile->value(2, &okz);
     if (!okx || !oky || !okz) throw FATALERROR("Invalid particle coordinate(s) in Voronoi mesh data");
 
     // convert to SI units
@@ -102,11 +98,11 @@ double VoronoiMeshAsciiFile::value(int g) const
 {
     // verify index range
     if (g < 0) throw FATALERROR("Field index out of range");
-    if (g+3 >= _columns.size()) throw FATALERROR("Insufficient number of field values in Voronoi mesh data");
+    if (!_infile || g+3 >= _infile->numValues()) throw FATALERROR("Insufficient number of field values in Voronoi mesh data");
 
     // get the appropriate column value
     bool ok;
-    double value = _columns.value(g+3).toDouble(&ok);
+    double value = _infile->value(g+3, &ok);
     if (!ok) throw FATALERROR("Invalid field value in Voronoi mesh data");
     return value;
 }
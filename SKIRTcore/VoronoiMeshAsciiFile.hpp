@@ -6,8 +6,8 @@
 #ifndef VORONOIMESHASCIIFILE_HPP
 #define VORONOIMESHASCIIFILE_HPP
 
-#include <QFile>
 #include "VoronoiMeshFile.hpp"
+class ColumnDataFile;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -19,7 +19,10 @@
     provide the x,y,z coordinates of the particle for this record. Subsequent numbers provide the
     \f$N_{fields}\f$ values of the fields for this record, i.e. the fourth number provides the
     value for field \f$F_0\f$, the fifth for \f$F_1\f$, and so on. All record lines in the file
-    must contain the same number of field values. */
+    must contain the same number of field values.
+
+    If a binary version of the data file exists next to the text file, as described for the
+    ColumnDataFile class, the binary file is used instead, avoiding the cost of parsing text. */
 class VoronoiMeshAsciiFile : public VoronoiMeshFile
 {
     Q_OBJECT
@@ -37,6 +40,9 @@ public:
     /** The default constructor. */
     Q_INVOKABLE VoronoiMeshAsciiFile();
 
+    /** The destructor closes the data file if it is still open. */
+    ~VoronoiMeshAsciiFile();
+
 protected:
     /** This function verifies the property values. */
     virtual void setupSelfBefore();
@@ -80,8 +86,7 @@ public:
 
 private:
     double _coordinateUnits;     // the units in which the file specifies particle coordinates
-    QFile _infile;               // the input file
-    QList<QByteArray> _columns;  // the columns of the current record, or empty if there is no current record
+    ColumnDataFile* _infile;     // the input file, or null if the file is not open
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -48,7 +48,7 @@ void VoronoiStellarComp::setupSelfBefore()
 
     // import the Voronoi mesh
     _mesh = new VoronoiMesh(_meshfile, QList<int>() << _densityIndex << _metallicityIndex << _ageIndex,
-                             Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax));
+                             Box(-_xmax,-_ymax,-_zmax, _xmax,_ymax,_zmax), this);
     find<Log>()->info("Voronoi mesh data was successfully imported: " + QString::number(_mesh->Ncells()) + " cells.");
 
     // construct the library of SED models
@@ -60,36 +60,21 @@ void VoronoiStellarComp::setupSelfBefore()
     const double pc = Units::pc();
     const double pc3 = pc*pc*pc;
 
-    // the sizes of our vectors
-    int Nlambda = find<WavelengthGrid>()->Nlambda();
+    // get the mass, metallicity and age of the population in each cell
     int Ncells = _mesh->Ncells();
-
-    // construct a temporary matrix Lv with the luminosity of each cell at each wavelength
-    // and also the permanent vector _Ltotv with the total luminosity for every wavelength bin
-    ArrayTable<2> Lvv(Nlambda,Ncells);
-    _Ltotv.resize(Nlambda);
+    vector<double> Mv(Ncells), Zv(Ncells), tv(Ncells);
     for (int m=0; m<Ncells; m++)
     {
         double rho = _mesh->value(_densityIndex, m);    // density in Msun / pc^3
         double V = _mesh->volume(m);                    // volume in m^3
-        double M = rho * ( V/pc3 );                     // mass in Msun
-        double Z = _mesh->value(_metallicityIndex, m);  // metallicity as dimensionless fraction
-        double t = _mesh->value(_ageIndex, m);          // age in years
-
-        const Array& Lv = bc.luminosities(M,Z,t);
-        for (int ell=0; ell<Nlambda; ell++)
-        {
-            Lvv[ell][m] = Lv[ell];
-            _Ltotv[ell] += Lv[ell];
-        }
+        Mv[m] = rho * ( V/pc3 );                        // mass in Msun
+        Zv[m] = _mesh->value(_metallicityIndex, m);     // metallicity as dimensionless fraction
+        tv[m] = _mesh->value(_ageIndex, m);             // age in years
     }
 
     // construct the permanent vectors _Xvv with the normalized cumulative luminosities (per wavelength bin)
-    _Xvv.resize(Nlambda,0);
-    for (int ell=0; ell<Nlambda; ell++)
-    {
-        NR::cdf(_Xvv[ell], Lvv[ell]);
-    }
+    // and _Ltotv with the total luminosity for every wavelength bin
+    bc.cdfs(Mv, Zv, tv, _Xvv, _Ltotv);
 }
 
 //////////////////////////////////////////////////////////////////////
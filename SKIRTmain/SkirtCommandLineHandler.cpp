@@ -9,6 +9,7 @@
 #include <QFileInfo>
 #include <QSharedPointer>
 #include <QHostInfo>
+#include "ColumnDataFile.hpp"
 #include "CommandLineArguments.hpp"
 #include "Console.hpp"
 #include "ConsoleHierarchyCreator.hpp"
@@ -35,7 +36,7 @@
 namespace
 {
     // the allowed options list, in the format consumed by the CommandLineArguments constructor
-    static const char* allowedOptions = "-t* -s* -b -v -i* -o* -k -r -x";
+    static const char* allowedOptions = "-t* -s* -b -v -i* -o* -k -r -e -c -x";
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -65,10 +66,12 @@ int SkirtCommandLineHandler::perform()
     try
     {
         // if there are no arguments at all --> interactive mode
+        // if the -c option is present with at least one file path argument --> convert data files
         // if there is at least one file path argument --> batch mode
         // if the -x option is present --> export smile schema (undocumented option)
         // otherwise --> error
         if (_args.isValid() && !_args.hasOptions() && !_args.hasFilepaths()) return doInteractive();
+        if (_args.isPresent("-c") && _args.hasFilepaths()) return doConvert();
         if (_args.hasFilepaths()) return doBatch();
         if (_args.isPresent("-x")) return doSmileSchema();
         _console.error("Invalid command line arguments");
@@ -175,6 +178,22 @@ int SkirtCommandLineHandler::doBatch()
 
 ////////////////////////////////////////////////////////////////////
 
+int SkirtCommandLineHandler::doConvert()
+{
+    if (ProcessManager::isMultiProc()) throw FATALERROR("Data file conversion cannot be run with multiple processes");
+
+    foreach (QString filepath, _args.filepaths())
+    {
+        TimeLogger logger(&_console, "converting column data file " + filepath);
+        qint64 Nrecords = ColumnDataFile::convert(filepath);
+        _console.info("Wrote " + QString::number(Nrecords) + " records to binary file "
+                      + ColumnDataFile::binaryPath(filepath));
+    }
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////
+
 int SkirtCommandLineHandler::doSmileSchema()
 {
     SmileSchemaWriter writer;
@@ -272,6 +291,9 @@ void SkirtCommandLineHandler::doSimulation(size_t index)
     simulation->filePaths()->setInputPath((_args.value("-i").startsWith('/') ? "" : base + "/") + _args.value("-i"));
     simulation->filePaths()->setOutputPath((_args.value("-o").startsWith('/') ? "" : base + "/") + _args.value("-o"));
 
+    //  - whether to resume from a checkpoint written by a previous run
+    simulation->setRestart(_args.isPresent("-e"));
+
     //  - the number of parallel threads
     if (_args.intValue("-t") > 0) simulation->parallelFactory()->setMaxThreadCount(_args.intValue("-t"));
 
@@ -320,10 +342,11 @@ void SkirtCommandLineHandler::printHelp()
     _console.warning("");
     _console.warning("To create a new ski file interactively:    skirt");
     _console.warning("To run a simulation with default options:  skirt <ski-filename>");
+    _console.warning("To convert particle data files to binary:  skirt -c {<datafile>}*");
     _console.warning("");
     _console.warning("  skirt [-b] [-v] [-s <simulations>] [-t <threads>]");
     _console.warning("        [-k] [-i <dirpath>] [-o <dirpath>]");
-    _console.warning("        [-r] {<filepath>}*");
+    _console.warning("        [-e] [-r] {<filepath>}*");
     _console.warning("");
     _console.warning("  -b : forces brief console logging");
     _console.warning("  -v : forces verbose logging");
@@ -332,6 +355,7 @@ void SkirtCommandLineHandler::printHelp()
     _console.warning("  -k : makes the input/output paths relative to the ski file being processed");
     _console.warning("  -i <dirpath> : the relative or absolute path for simulation input files");
     _console.warning("  -o <dirpath> : the relative or absolute path for simulation output files");
+    _console.warning("  -e : resumes the simulation from the most recent checkpoint, if any");
     _console.warning("  -r : causes recursive directory descent for all specified ski file paths");
     _console.warning("  <filepath> : the relative or absolute file path for a ski file");
     _console.warning("               (the filename may contain ? and * wildcards)");
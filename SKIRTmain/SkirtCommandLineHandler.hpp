@@ -24,7 +24,7 @@ simulations in the ski files specified on the command line according to the foll
 \verbatim
     skirt [-b] [-s <simulations>] [-t <threads>]
           [-k] [-i <dirpath>] [-o <dirpath>]
-          [-r] {<filepath>}*
+          [-e] [-r] {<filepath>}*
 \endverbatim
 
 The -b option forces brief console logging (only success and error messages are shown). The
@@ -37,9 +37,22 @@ each simulation; the default value is the number of logical cores on the compute
 SKIRT. The -k option causes the simulation input/output paths to be relative to the ski file
 being processed, rather than to the current directory. The -i option specifies the absolute or
 relative path for simulation input files. The -o option specifies the absolute or relative path
-for simulation output files. The -r option causes recursive directory descent for all specified
-\<filepath\> arguments, in other words all directories inside the specified base paths are
-searched for the specified filename (or filename pattern).
+for simulation output files. The -e option causes a simulation to resume from the most recent
+checkpoint file written by a previous run with the same ski file and output path, skipping the
+simulation phases completed before the checkpoint (see PanMonteCarloSimulation for the
+simulations that support checkpoints). The -r option causes recursive directory descent for all
+specified \<filepath\> arguments, in other words all directories inside the specified base paths
+are searched for the specified filename (or filename pattern).
+
+When the -c option is present, SKIRT does not perform any simulations. Instead, each
+\<filepath\> argument is interpreted as the path of a particle data file in text column format
+(for example, an SPH particle file or a Voronoi mesh file), which is converted to the
+corresponding binary format described for the ColumnDataFile class. The binary file is stored
+next to the text file, and subsequent simulations automatically use it instead of the text file:
+
+\verbatim
+    skirt -c {<filepath>}*
+\endverbatim
 
 In the simplest case, a \<filepath\> argument specifies the relative or absolute file path for a
 single ski file, with or without the .ski extension. However the filename (NOT the base path)
@@ -79,6 +92,11 @@ private:
         returns an appropriate application exit value. */
     int doBatch();
 
+    /** This function converts the text column data files specified on the command line to the
+        binary format, as requested by the -c option. The function returns an appropriate
+        application exit value. */
+    int doConvert();
+
     /** This function exports a smile schema. This is an undocumented option. */
     int doSmileSchema();
 
@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#  SKIRT -- an advanced radiative transfer code
+#  © Astronomical Observatory, Ghent University
+#-------------------------------------------------
+
+#---------------------------------------------------------------------
+# This console application times the tabulated Voigt profile and
+# velocity sampler against a direct implementation, and verifies
+# that both agree. It links in the SKIRT core libraries.
+#---------------------------------------------------------------------
+
+# overall setup
+TEMPLATE = app
+TARGET   = voigtbench
+QT      -= gui
+QT      *= network
+CONFIG  -= app_bundle
+CONFIG  *= link_prl thread console c++11
+
+# compile C++ with maximum optimization
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+# include libraries internal to the project
+INCLUDEPATH += $$PWD/../Fundamentals $$PWD/../SKIRTcore $$PWD/../MPIsupport
+DEPENDPATH += $$PWD/../Fundamentals $$PWD/../SKIRTcore $$PWD/../MPIsupport
+unix: LIBS += -L$$OUT_PWD/../Fundamentals/ -lfundamentals \
+              -L$$OUT_PWD/../Cfitsio/ -lcfitsio \
+              -L$$OUT_PWD/../Voro/ -lvoro \
+              -L$$OUT_PWD/../SKIRTcore/ -lskirtcore \
+              -L$$OUT_PWD/../MPIsupport/ -lmpisupport
+unix: PRE_TARGETDEPS += $$OUT_PWD/../Fundamentals/libfundamentals.a \
+                        $$OUT_PWD/../Cfitsio/libcfitsio.a \
+                        $$OUT_PWD/../Voro/libvoro.a \
+                        $$OUT_PWD/../SKIRTcore/libskirtcore.a \
+                        $$OUT_PWD/../MPIsupport/libmpisupport.a
+
+# Enable MPI compilation if required
+include(../BuildUtils/EnableMPI.pri)
+
+#--------------------------------------------------
+# source and header files: maintained by Qt creator
+#--------------------------------------------------
+
+HEADERS += \
+    VoigtBenchMain.hpp
+
+SOURCES += \
+    VoigtBenchMain.cpp
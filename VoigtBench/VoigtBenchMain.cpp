@@ -0,0 +1,238 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <clocale>
+#include <cmath>
+#include <vector>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include "Console.hpp"
+#include "FatalError.hpp"
+#include "Log.hpp"
+#include "ProcessManager.hpp"
+#include "Random.hpp"
+#include "Simulation.hpp"
+#include "VoigtBenchMain.hpp"
+#include "VoigtProfile.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the number of Voigt function evaluations and of velocity samples per (a,x) pair
+    const int NEVAL = 2000000;
+    const int NSAMPLE = 1000000;
+
+    // the smallest acceptance rate for which the reference sampler is run; its acceptance rate equals H(a,x),
+    // so that it becomes impractically slow in the line wings
+    const double MINREFACCEPTANCE = 0.01;
+
+    // the smallest acceptable acceptance rate of the tabulated sampler beyond the tabulated range |x|>20,
+    // where the acceptance rate should keep increasing with |x|
+    const double MINWINGACCEPTANCE = 0.65;
+
+    // the tolerances for the relative deviation of the Voigt function and for the chi-squared
+    // per degree of freedom of the two-sample comparison of the velocity distributions
+    const double MAXDEVIATION = 1e-3;
+    const double MAXCHI2DOF = 1.5;
+
+    // the binning used for comparing the velocity distributions
+    const int NBINS = 100;
+    const double BINMARGIN = 4.;
+
+    // a minimal simulation, used only to provide a properly initialized random number generator
+    class BenchSimulation : public Simulation
+    {
+    protected:
+        void runSelf() { }
+    };
+
+    // returns the Voigt function evaluated directly from the Tasitsiomi (2006) approximation,
+    // as in the original implementation but with the 21/x^2 term corrected
+    double voigtdirect(double a, double x)
+    {
+        double zeta = (pow(x,2.0) - 0.855) / (pow(x,2.0) + 3.42);
+        double q = 0.0;
+        if (zeta > 0.0)
+        {
+            double PiZeta = 5.678*pow(zeta,4.0) - 9.207*pow(zeta,3.0) + 4.421*pow(zeta,2.0) + 0.1117*zeta;
+            q = (1.0+21.0/(x*x)) * (a/(M_PI*(x*x+1.0))) * PiZeta;
+        }
+        return q*sqrt(M_PI) + exp(-x*x);
+    }
+
+    // returns a random parallel velocity sampled with the rejection method of Zheng & Miralda-Escude (2002)
+    // with a splitting velocity u0=0, as in the original implementation but with the acceptance test corrected;
+    // the envelope is then a single Lorentzian, so that the acceptance rate equals H(a,x)
+    double samplereference(Random* random, double a, double x)
+    {
+        double u0 = 0.;
+        double theta0 = atan((u0-x)/a);
+        double eu0 = exp(-u0*u0);
+        double p = (theta0+0.5*M_PI) / ((1.-eu0)*theta0 + (1.+eu0)*0.5*M_PI);
+        while (true)
+        {
+            if (random->uniform() <= p)
+            {
+                double u = a*tan((theta0+0.5*M_PI)*random->uniform() - 0.5*M_PI) + x;
+                if (random->uniform() <= exp(-u*u)) return u;
+            }
+            else
+            {
+                double u = a*tan((0.5*M_PI-theta0)*random->uniform() + theta0) + x;
+                if (random->uniform()*eu0 <= exp(-u*u)) return u;
+            }
+        }
+    }
+
+    // returns the bin index for the specified velocity in the range [lo,hi], with an underflow bin
+    // at index 0 and an overflow bin at index NBINS+1
+    int bin(double u, double lo, double hi)
+    {
+        if (u < lo) return 0;
+        if (u >= hi) return NBINS+1;
+        return 1 + static_cast<int>((u-lo) * (NBINS/(hi-lo)));
+    }
+
+    // returns the time in nanoseconds per invocation of the specified function,
+    // which should perform the specified number of invocations
+    template<typename Functor> double nanoseconds(Functor f, int n)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        f();
+        return static_cast<double>(timer.nsecsElapsed()) / n;
+    }
+
+    // compares the tabulated and the direct Voigt function, and returns true if they agree
+    bool benchvoigt(Log* log, Random* random, const VoigtProfile& profile)
+    {
+        // generate the (a,x) pairs up front so that random number generation is not timed
+        vector<double> av(NEVAL), xv(NEVAL);
+        for (int i=0; i<NEVAL; i++)
+        {
+            av[i] = pow(10., -6.*random->uniform());
+            xv[i] = 60.*random->uniform() - 30.;
+        }
+
+        // time both implementations, accumulating the results to keep the calls from being optimized away
+        double sumtab = 0., sumdir = 0.;
+        double ttab = nanoseconds([&]{ for (int i=0; i<NEVAL; i++) sumtab += profile(av[i],xv[i]); }, NEVAL);
+        double tdir = nanoseconds([&]{ for (int i=0; i<NEVAL; i++) sumdir += voigtdirect(av[i],xv[i]); }, NEVAL);
+
+        // determine the maximum relative deviation
+        double maxdev = 0.;
+        for (int i=0; i<NEVAL; i++)
+        {
+            double h = voigtdirect(av[i],xv[i]);
+            maxdev = max(maxdev, fabs(profile(av[i],xv[i])-h)/h);
+        }
+
+        log->info("H(a,x): tabulated " + QString::number(ttab,'f',1) + " ns, direct "
+                  + QString::number(tdir,'f',1) + " ns per evaluation (sums " + QString::number(sumtab)
+                  + " and " + QString::number(sumdir) + ")");
+        log->info("H(a,x): maximum relative deviation " + QString::number(maxdev,'e',2)
+                  + " (tolerance " + QString::number(MAXDEVIATION,'e',2) + ")");
+        return maxdev <= MAXDEVIATION;
+    }
+
+    // compares the tabulated and the reference velocity sampler for the specified (a,x) pair,
+    // and returns true if the binned distributions agree; if the reference sampler would be too slow,
+    // only the tabulated sampler is timed and the function returns true unless the acceptance rate
+    // beyond the tabulated range is too low
+    bool benchsampler(Log* log, Random* random, const VoigtProfile& profile, double a, double x)
+    {
+        double lo = min(0.,x) - BINMARGIN;
+        double hi = max(0.,x) + BINMARGIN;
+        vector<double> ntabv(NBINS+2), nrefv(NBINS+2);
+
+        QString pair = "a=" + QString::number(a,'e',0) + " x=" + QString::number(x) + ": ";
+        double ttab = nanoseconds([&]{ for (int i=0; i<NSAMPLE; i++)
+                                           ntabv[bin(profile.sampleParallelVelocity(random,a,x),lo,hi)]++; }, NSAMPLE);
+        double rate = profile.acceptanceRate(a,x);
+        double refrate = voigtdirect(a,x);
+        if (refrate < MINREFACCEPTANCE)
+        {
+            log->info(pair + "tabulated " + QString::number(ttab,'f',1) + " ns per sample; acceptance rate "
+                      + QString::number(rate,'f',3) + " versus " + QString::number(refrate,'e',1)
+                      + " for the reference, which is not run");
+            return fabs(x) <= 20. || rate >= MINWINGACCEPTANCE;
+        }
+        double tref = nanoseconds([&]{ for (int i=0; i<NSAMPLE; i++)
+                                           nrefv[bin(samplereference(random,a,x),lo,hi)]++; }, NSAMPLE);
+
+        // perform a two-sample chi-squared test on the bins that contain any samples
+        double chi2 = 0.;
+        int dof = -1;
+        for (int k=0; k<NBINS+2; k++)
+        {
+            double n = ntabv[k] + nrefv[k];
+            if (n > 0.)
+            {
+                chi2 += (ntabv[k]-nrefv[k])*(ntabv[k]-nrefv[k]) / n;
+                dof++;
+            }
+        }
+        double chi2dof = dof > 0 ? chi2/dof : 0.;
+
+        log->info(pair + "tabulated " + QString::number(ttab,'f',1) + " ns, reference "
+                  + QString::number(tref,'f',1) + " ns per sample; acceptance rate " + QString::number(rate,'f',3)
+                  + " versus " + QString::number(refrate,'f',3) + "; chi2/dof " + QString::number(chi2dof,'f',3));
+        return chi2dof <= MAXCHI2DOF;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    // force standard locale so that number formatting always produces the same result
+    setlocale(LC_ALL, "C");
+
+    // initialize remote communication capability, if present
+    ProcessManager::initialize(&argc, &argv);
+
+    // construct application object for such things as the application name,
+    // but don't run the event loop because we don't need it
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("VoigtBench");
+
+    Console console;
+    bool success = true;
+    try
+    {
+        // setup a simulation to obtain a random number generator and a log
+        BenchSimulation simulation;
+        simulation.setup();
+        Log* log = simulation.log();
+        Random* random = simulation.random();
+
+        VoigtProfile profile;
+        profile.initialize();
+
+        success &= benchvoigt(log, random, profile);
+
+        const double as[] = { 1e-6, 1e-4, 1e-2, 0.3 };
+        const double xs[] = { 0., 1., -1.5, 2., 4., 10., -30., 50., -100. };
+        for (double a : as) for (double x : xs) success &= benchsampler(log, random, profile, a, x);
+
+        if (success) log->info("All comparisons are within tolerance");
+        else log->error("Some comparisons exceed the tolerance");
+    }
+    catch (FatalError& error)
+    {
+        foreach (QString line, error.message()) console.error(line);
+        success = false;
+    }
+
+    // finalize remote communication capability, if present
+    ProcessManager::finalize();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,34 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef VOIGTBENCHMAIN_HPP
+#define VOIGTBENCHMAIN_HPP
+
+////////////////////////////////////////////////////////////////////
+
+/** The VoigtBench main function times the tabulated Voigt profile and velocity sampler provided by
+    the VoigtProfile class against a direct implementation of the same quantities, and verifies
+    that both implementations agree. The direct implementation follows the code that was used
+    before the VoigtProfile class was introduced: the Voigt function is evaluated from the
+    Tasitsiomi (2006) approximation using pow(), and the parallel velocity of the scattering atom
+    is sampled with the rejection method of Zheng & Miralda-Escudé (2002). The reference sampler
+    uses a splitting velocity \f$u_0=0\f$, so that its acceptance rate equals \f$H(a,x)\f$; it is
+    therefore skipped for \f$(a,x)\f$ pairs far in the line wings. The defects in the original code
+    (the \f$21/x^2\f$ term and the acceptance test) have been corrected, so that both
+    implementations should produce the same results.
+
+    For the Voigt function, the program reports the time per evaluation for both implementations
+    and the maximum relative deviation over a large number of random \f$(a,x)\f$ pairs. For the
+    sampler, it reports the time per sample for a number of representative \f$(a,x)\f$ pairs,
+    together with the chi-squared per degree of freedom of a two-sample comparison of the binned
+    velocity distributions. The representative pairs include frequency offsets \f$|x|>20\f$ beyond
+    the tabulated range of the sampler, where only the acceptance rate is verified. The program
+    returns a nonzero exit code if the deviation or the chi-squared exceeds its tolerance, or if
+    the acceptance rate beyond the tabulated range is too low. */
+int main(int argc, char** argv);
+
+////////////////////////////////////////////////////////////////////
+
+#endif // VOIGTBENCHMAIN_HPP